@@ -0,0 +1,205 @@
+// Market-making backtests over a recorded journal (orderbook --record),
+// swept over a grid of strategy parameters on every core.
+//
+//   ./backtest session.jrnl --symbol BTCUSDT --half-spread 1,2,5 --size 0.001,0.01
+//              --inventory-skew 0,0.5 --imbalance-skew 0,2 --toxicity 1,0.8
+//              --latency-ms 0,50 --threads 8 --report sweep.csv
+//
+// Every list option adds a dimension to the grid; the runs are the full
+// cartesian product. The journal is decoded once (backtest.h) and each run
+// replays it through its own book. Results are printed best PnL first.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <algorithm>
+#include "backtest.h"
+
+using namespace std;
+
+const int DEFAULT_LADDER_WINDOW = 1 << 16;
+
+void printUsage(const char* prog) {
+    cerr << "usage: " << prog << " <journal> [--symbol <spec>]  instrument to trade (default BTCUSDT)\n"
+         << "           spec: SYMBOL[:priceDecimals:qtyDecimals[:wallQty[:wallRange]]]\n"
+         << "       [--no-sync]  apply diffs without snapshot/sequence checks\n"
+         << "       [--window <ticks>]  price ladder window (default " << DEFAULT_LADDER_WINDOW << ")\n"
+         << "       [--threads <n>]  sweep workers (default: every core) [--pin]  pin worker i to core i\n"
+         << "   grid, each a comma-separated list:\n"
+         << "       [--half-spread <ticks>]       quote distance from the fair price (default 1)\n"
+         << "       [--size <qty>]                quote size (default 0.01)\n"
+         << "       [--max-inventory <qty>]       stop quoting a side at this position (default 0.1)\n"
+         << "       [--inventory-skew <ticks>]    fair price shift per quote of inventory (default 0)\n"
+         << "       [--imbalance-skew <ticks>]    fair price shift at full top-of-book imbalance (default 0)\n"
+         << "       [--toxicity <ratio>]          pull a side past this aggression ratio (default 1: never)\n"
+         << "       [--latency-ms <ms>]           quote latency in exchange time (default 0)\n"
+         << "       [--fee-bps <bps>]             maker fee, negative for a rebate (default 0)\n"
+         << "       [--top <n>]  rows printed (default 20) [--report <out.csv>]  every run as CSV\n";
+}
+
+vector<string> splitList(const string& s) {
+    vector<string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == string::npos) comma = s.size();
+        if (comma > start) out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+vector<double> parseNumbers(const string& s) {
+    vector<double> out;
+    for (const string& v : splitList(s)) out.push_back(atof(v.c_str()));
+    if (out.empty()) throw runtime_error("empty list: " + s);
+    return out;
+}
+
+// quantities are given in units and carried as lots, like the book's
+vector<int64_t> parseQuantities(const string& s, int qtyDecimals) {
+    vector<int64_t> out;
+    for (const string& v : splitList(s)) {
+        int64_t lots;
+        if (!depth_parser::parseFixed(v.data(), v.data() + v.size(), qtyDecimals, lots) || lots <= 0)
+            throw runtime_error("bad quantity: " + v);
+        out.push_back(lots);
+    }
+    if (out.empty()) throw runtime_error("empty list: " + s);
+    return out;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2 || argv[1][0] == '-') {
+        printUsage(argv[0]);
+        return 1;
+    }
+    string journalPath = argv[1], symbol = "BTCUSDT", reportPath;
+    string halfSpreads = "1", sizes = "0.01", maxInventories = "0.1", inventorySkews = "0",
+           imbalanceSkews = "0", toxicities = "1", latencies = "0", fees = "0";
+    bool sync = true, pin = false;
+    int  window = DEFAULT_LADDER_WINDOW, top = 20;
+    int  threads = (int)max(1u, thread::hardware_concurrency());
+
+    for (int i = 2; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--symbol" && hasValue)         symbol = argv[++i];
+        else if (arg == "--no-sync")                    sync = false;
+        else if (arg == "--window" && hasValue)         window = max(64, atoi(argv[++i]));
+        else if (arg == "--threads" && hasValue)        threads = max(1, atoi(argv[++i]));
+        else if (arg == "--pin")                        pin = true;
+        else if (arg == "--half-spread" && hasValue)    halfSpreads = argv[++i];
+        else if (arg == "--size" && hasValue)           sizes = argv[++i];
+        else if (arg == "--max-inventory" && hasValue)  maxInventories = argv[++i];
+        else if (arg == "--inventory-skew" && hasValue) inventorySkews = argv[++i];
+        else if (arg == "--imbalance-skew" && hasValue) imbalanceSkews = argv[++i];
+        else if (arg == "--toxicity" && hasValue)       toxicities = argv[++i];
+        else if (arg == "--latency-ms" && hasValue)     latencies = argv[++i];
+        else if (arg == "--fee-bps" && hasValue)        fees = argv[++i];
+        else if (arg == "--top" && hasValue)            top = max(1, atoi(argv[++i]));
+        else if (arg == "--report" && hasValue)         reportPath = argv[++i];
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    try {
+        InstrumentSpec spec = parseInstrumentSpec(symbol);
+
+        vector<SweepJob> jobs;
+        for (double hs : parseNumbers(halfSpreads))
+        for (int64_t size : parseQuantities(sizes, spec.qtyDecimals))
+        for (int64_t maxInv : parseQuantities(maxInventories, spec.qtyDecimals))
+        for (double is : parseNumbers(inventorySkews))
+        for (double ims : parseNumbers(imbalanceSkews))
+        for (double tox : parseNumbers(toxicities))
+        for (double lat : parseNumbers(latencies))
+        for (double fee : parseNumbers(fees)) {
+            SweepJob j;
+            j.params.halfSpreadTicks    = max(0, (int)hs);
+            j.params.quoteLots          = size;
+            j.params.maxInventoryLots   = maxInv;
+            j.params.inventorySkewTicks = is;
+            j.params.imbalanceSkewTicks = ims;
+            j.params.toxicity           = tox;
+            j.params.latencyMs          = max(0, (int)lat);
+            j.params.feeBps             = fee;
+            jobs.push_back(j);
+        }
+
+        auto t0 = chrono::steady_clock::now();
+        Tape tape = loadTape(journalPath, spec, sync);
+        auto t1 = chrono::steady_clock::now();
+        double decodeS = chrono::duration<double>(t1 - t0).count();
+        double hours   = (tape.lastEventMs - tape.firstEventMs) / 3.6e6;
+        cout << spec.symbol << ": " << tape.diffs << " diffs, " << tape.levels.size() << " levels, "
+             << tape.snapshots << " snapshots, " << tape.resets << " resets, " << tape.dropped
+             << " stale, " << tape.malformed << " malformed, " << tape.otherFrames
+             << " frames for other symbols\n"
+             << fixed << setprecision(2) << hours << " h of exchange time, decoded in "
+             << decodeS << " s (" << (tape.levels.size() * sizeof(TapeLevel)) / (1 << 20) << " MB)\n";
+        if (tape.diffs == 0) throw runtime_error("no " + spec.symbol + " updates to replay");
+
+        threads = min(threads, (int)jobs.size());
+        runSweep(tape, jobs, threads, window, pin);
+        double sweepS = chrono::duration<double>(chrono::steady_clock::now() - t1).count();
+        double levels = (double)tape.levels.size() * jobs.size();
+        cout << jobs.size() << " runs on " << threads << " threads in " << sweepS << " s: "
+             << setprecision(1) << levels / sweepS / 1e6 << "M levels/s, "
+             << levels / sweepS / 1e6 / threads << "M levels/s per thread, "
+             << setprecision(0) << (double)tape.diffs * jobs.size() / sweepS / threads
+             << " diffs/s per thread\n\n";
+
+        sort(jobs.begin(), jobs.end(),
+             [](const SweepJob& a, const SweepJob& b) { return a.result.pnl > b.result.pnl; });
+
+        const int pd = spec.priceDecimals, qd = spec.qtyDecimals;
+        cout << right << setw(6) << "spread" << setw(10) << "size" << setw(10) << "max_inv"
+             << setw(9) << "inv_skew" << setw(9) << "imb_skew" << setw(7) << "toxic" << setw(7) << "lat"
+             << setw(9) << "fills" << setw(12) << "bought" << setw(12) << "sold" << setw(11) << "position"
+             << setw(11) << "max_pos" << setw(11) << "fees" << setw(13) << "pnl" << setw(12) << "max_dd"
+             << "\n";
+        for (int i = 0; i < (int)jobs.size() && i < top; i++) {
+            const MakerParams& p = jobs[i].params;
+            const MakerResult& r = jobs[i].result;
+            cout << setw(6) << p.halfSpreadTicks << setprecision(qd)
+                 << setw(10) << fixedToDouble(p.quoteLots, qd) << setw(10) << fixedToDouble(p.maxInventoryLots, qd)
+                 << setprecision(2) << setw(9) << p.inventorySkewTicks << setw(9) << p.imbalanceSkewTicks
+                 << setw(7) << p.toxicity << setw(7) << p.latencyMs << setw(9) << r.fills << setprecision(qd)
+                 << setw(12) << fixedToDouble(r.boughtLots, qd) << setw(12) << fixedToDouble(r.soldLots, qd)
+                 << setw(11) << fixedToDouble(r.inventoryLots, qd)
+                 << setw(11) << fixedToDouble(r.maxInventoryLots, qd) << setprecision(pd + 2)
+                 << setw(11) << r.fees << setw(13) << r.pnl << setw(12) << r.maxDrawdown << "\n";
+        }
+
+        if (!reportPath.empty()) {
+            ofstream report(reportPath);
+            if (!report) throw runtime_error("cannot open " + reportPath);
+            report << fixed;
+            report << "half_spread_ticks,size,max_inventory,inventory_skew_ticks,imbalance_skew_ticks,"
+                      "toxicity,latency_ms,fee_bps,fills,quotes,bought,sold,position,max_position,"
+                      "fees,pnl,max_drawdown\n";
+            for (const SweepJob& j : jobs) {
+                const MakerParams& p = j.params;
+                const MakerResult& r = j.result;
+                report << p.halfSpreadTicks << ',' << setprecision(qd) << fixedToDouble(p.quoteLots, qd)
+                       << ',' << fixedToDouble(p.maxInventoryLots, qd) << ',' << setprecision(4)
+                       << p.inventorySkewTicks << ',' << p.imbalanceSkewTicks << ',' << p.toxicity << ','
+                       << p.latencyMs << ',' << p.feeBps << ',' << r.fills << ',' << r.quotesPlaced << ','
+                       << setprecision(qd) << fixedToDouble(r.boughtLots, qd) << ','
+                       << fixedToDouble(r.soldLots, qd) << ',' << fixedToDouble(r.inventoryLots, qd) << ','
+                       << fixedToDouble(r.maxInventoryLots, qd) << ',' << setprecision(pd + 2) << r.fees
+                       << ',' << r.pnl << ',' << r.maxDrawdown << '\n';
+            }
+        }
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
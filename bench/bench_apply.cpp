@@ -0,0 +1,271 @@
+// The per-level apply path: the side- and scale-specialised code against
+// the runtime version it replaced, for each compiled scale.
+//
+//   ./bench_apply [--messages 5000] [--rounds 5]
+//
+// For each scale the synthetic feed is rendered at those decimals and
+// split into frames once. Each stage then runs --rounds times per path,
+// alternating, and the best round is reported in cycles per level (the
+// CPU's cycle counter, as in cycle_clock.h):
+//   parse    forEachLevel over every frame, decimals from the spec against
+//            decimals fixed at compile time
+//   update   the decoded levels into a fresh book: the previous
+//            updateLevel, which tests a runtime side flag for the ladder,
+//            walls, best price and aggression, against the side templates
+//   apply    both together on a fresh book: the previous applyLevels
+//            against the instrument's compiled one (Instrument::apply)
+// The books each path leaves behind are compared.
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include "../book_engine.h"
+#include "../cycle_clock.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+// The previous per-level path, kept here as the baseline.
+void runtimeUpdateLevel(Instrument& in, bool isBid, Ticks price, Lots qty) {
+    auto& ladder = isBid ? in.bidLadder : in.askLadder;
+    auto& walls  = isBid ? in.bidWalls  : in.askWalls;
+    const InstrumentSpec& spec = in.spec;
+
+    Lots prevQty = ladder.set(price, qty);
+    int64_t nowMs = in.eventTimeMs;
+
+    if (isBid) {
+        if (qty > 0 && price > in.bestBid) in.bestBid = price;
+    } else {
+        if (qty > 0 && (in.bestAsk == NO_PRICE || price < in.bestAsk)) in.bestAsk = price;
+    }
+
+    if (!isBid && qty < prevQty)
+        in.updateAggressiveBuy  += prevQty - qty;
+    if (isBid  && qty < prevQty)
+        in.updateAggressiveSell += prevQty - qty;
+
+    if (qty >= spec.wallThreshold && prevQty >= spec.wallThreshold)
+        walls.resize(price, qty, nowMs);
+
+    if (qty >= spec.wallThreshold && prevQty < spec.wallThreshold) {
+        walls.appear(price, qty, nowMs);
+        BookEvent e = {EVENT_WALL_APPEARED, isBid, 0, 0, price, 0, qty, 0};
+        emitEvent(in, e);
+    }
+
+    if (prevQty >= spec.wallThreshold && qty < spec.wallThreshold) {
+        bool atTouch = isBid ? ladder.bestAtOrAbove(price + 1) == NO_PRICE
+                             : ladder.bestAtOrBelow(price - 1) == NO_PRICE;
+        int64_t life = walls.disappear(price, atTouch, nowMs);
+        BookEvent e = {(uint8_t)(atTouch ? EVENT_WALL_FILLED : EVENT_WALL_PULLED), isBid, 0, 0,
+                       price, 0, prevQty, life};
+        emitEvent(in, e);
+    }
+}
+
+int runtimeApplyLevels(Instrument& in, string_view bids, string_view asks) {
+    int numBids = forEachLevel(bids, in.spec.priceDecimals, in.spec.qtyDecimals,
+        [&in](int64_t ticks, int64_t lots) { runtimeUpdateLevel(in, true, ticks, toLots(lots)); });
+    int numAsks = forEachLevel(asks, in.spec.priceDecimals, in.spec.qtyDecimals,
+        [&in](int64_t ticks, int64_t lots) { runtimeUpdateLevel(in, false, ticks, toLots(lots)); });
+    return numBids < 0 || numAsks < 0 ? -1 : numBids + numAsks;
+}
+
+struct Frame {
+    int64_t     eventTime;
+    string_view bids;
+    string_view asks;
+};
+
+struct DecodedLevel {
+    Ticks price;
+    Lots  qty;
+    bool  isBid;
+};
+
+// What a book looks like after a run, to compare paths by.
+struct BookSummary {
+    int64_t buy = 0, sell = 0;   // aggression totals
+    size_t  walls = 0;
+    vector<Level> top;
+
+    void finish(const Instrument& in) {
+        walls = in.bidWalls.size() + in.askWalls.size();
+        for (bool bid : {true, false}) {
+            Level l[TOP_LEVELS];
+            int n = collectTop(in, bid, l, TOP_LEVELS);
+            top.insert(top.end(), l, l + n);
+        }
+    }
+    bool operator==(const BookSummary& o) const {
+        if (buy != o.buy || sell != o.sell || walls != o.walls || top.size() != o.top.size()) return false;
+        for (size_t i = 0; i < top.size(); i++)
+            if (top[i].price != o.top[i].price || top[i].qty != o.top[i].qty) return false;
+        return true;
+    }
+};
+
+template <class Parse>
+uint64_t timeParse(const vector<Frame>& frames, Parse&& parse, int64_t& checksum) {
+    checksum = 0;
+    auto sink = [&checksum](int64_t ticks, int64_t lots) { checksum += ticks ^ lots; };
+    uint64_t t0 = cycleNow();
+    for (const Frame& f : frames) {
+        parse(f.bids, sink);
+        parse(f.asks, sink);
+    }
+    return cycleNow() - t0;
+}
+
+template <int PriceDecimals, int QtyDecimals>
+uint64_t timeFixedParse(const vector<Frame>& frames, int64_t& checksum) {
+    return timeParse(frames, [](string_view levels, auto& sink) {
+        return forEachLevel<PriceDecimals, QtyDecimals>(levels, sink);
+    }, checksum);
+}
+
+// The compiled scales, as in book_engine.cpp's APPLY_SCALES.
+struct BenchScale {
+    const char* spec;
+    uint64_t  (*fixedParse)(const vector<Frame>&, int64_t&);
+};
+const BenchScale SCALES[] = {
+    {"BTCUSDT",     timeFixedParse<2, 5>},
+    {"ETHUSDT:2:4", timeFixedParse<2, 4>},
+    {"SOLUSDT:2:3", timeFixedParse<2, 3>},
+    {"XRPUSDT:4:1", timeFixedParse<4, 1>},
+    {"BTCUSDT:1:3", timeFixedParse<1, 3>},
+};
+
+// Levels of frames into a fresh book, one frame per diff.
+template <class Update>
+uint64_t timeUpdate(const InstrumentSpec& spec, const vector<Frame>& frames, const vector<DecodedLevel>& levels,
+                    const vector<uint32_t>& counts, Update&& update, BookSummary& out) {
+    unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+    uint64_t cycles = 0;
+    size_t next = 0;
+    out = BookSummary();
+    for (size_t f = 0; f < frames.size(); f++) {
+        in->eventTimeMs = frames[f].eventTime;
+        uint64_t t0 = cycleNow();
+        for (uint32_t i = 0; i < counts[f]; i++, next++)
+            update(*in, levels[next].isBid, levels[next].price, levels[next].qty);
+        cycles += cycleNow() - t0;
+        out.buy  += in->updateAggressiveBuy;
+        out.sell += in->updateAggressiveSell;
+        updateToxicityWindow(*in);
+        recoverBest(*in);
+    }
+    out.finish(*in);
+    return cycles;
+}
+
+uint64_t timeApply(const InstrumentSpec& spec, const vector<Frame>& frames, ApplyLevelsFn apply,
+                   BookSummary& out) {
+    unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+    uint64_t cycles = 0;
+    out = BookSummary();
+    for (const Frame& f : frames) {
+        in->eventTimeMs = f.eventTime;
+        uint64_t t0 = cycleNow();
+        int n = apply(*in, f.bids, f.asks);
+        cycles += cycleNow() - t0;
+        if (n < 0) throw runtime_error("synthetic frame did not apply");
+        out.buy  += in->updateAggressiveBuy;
+        out.sell += in->updateAggressiveSell;
+        updateToxicityWindow(*in);
+        recoverBest(*in);
+    }
+    out.finish(*in);
+    return cycles;
+}
+
+int main(int argc, char** argv) {
+    int messages = 5000, rounds = 5;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue) messages = max(1, atoi(argv[++i]));
+        else if (arg == "--rounds" && hasValue)   rounds = max(1, atoi(argv[++i]));
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--rounds <n>]\n";
+            return 1;
+        }
+    }
+
+    try {
+        syncEnabled = false;
+        bool allSame = true;
+
+        cout << left << setw(14) << "scale" << setw(8) << "stage" << right << setw(10) << "runtime"
+             << setw(10) << "compiled" << setw(10) << "speedup" << "   cycles/level\n";
+        for (const BenchScale& bs : SCALES) {
+            InstrumentSpec spec = parseInstrumentSpec(bs.spec);
+            SyntheticFeed feed(defaultFeedProfile());
+            SyntheticMessage m;
+            vector<string> json;
+            vector<Frame>  frames;
+            json.reserve(messages);
+            for (int i = 0; i < messages; i++) {
+                feed.next(m);
+                string j(SyntheticFeed::maxJsonBytes(m), '\0');
+                j.resize(feed.toJson(m, &j[0], spec.priceDecimals, spec.qtyDecimals, spec.symbol.c_str()));
+                json.push_back(move(j));
+            }
+            vector<DecodedLevel> levels;
+            vector<uint32_t>     counts;
+            for (const string& j : json) {
+                DepthMessage msg;
+                if (!parseDepthMessage(j.data(), j.size(), msg)) throw runtime_error("synthetic frame did not parse");
+                frames.push_back({msg.eventTime, msg.bids, msg.asks});
+                size_t before = levels.size();
+                forEachLevel(msg.bids, spec.priceDecimals, spec.qtyDecimals,
+                    [&levels](int64_t t, int64_t l) { levels.push_back({t, toLots(l), true}); });
+                forEachLevel(msg.asks, spec.priceDecimals, spec.qtyDecimals,
+                    [&levels](int64_t t, int64_t l) { levels.push_back({t, toLots(l), false}); });
+                counts.push_back((uint32_t)(levels.size() - before));
+            }
+            if (applyLevelsFor(spec) == applyLevelsAnyScale)
+                throw runtime_error(string(bs.spec) + " has no compiled apply path");
+
+            // best of --rounds, [stage][runtime, compiled]
+            uint64_t best[3][2] = {};
+            BookSummary books[3][2];
+            bool parseSame = true;
+            auto keep = [&best](int stage, int path, uint64_t cycles) {
+                if (best[stage][path] == 0 || cycles < best[stage][path]) best[stage][path] = cycles;
+            };
+            for (int round = 0; round < rounds; round++) {
+                int64_t a = 0, b = 0;
+                keep(0, 0, timeParse(frames, [&spec](string_view lv, auto& sink) {
+                    return forEachLevel(lv, spec.priceDecimals, spec.qtyDecimals, sink);
+                }, a));
+                keep(0, 1, bs.fixedParse(frames, b));
+                parseSame = parseSame && a == b;
+                keep(1, 0, timeUpdate(spec, frames, levels, counts, runtimeUpdateLevel, books[1][0]));
+                keep(1, 1, timeUpdate(spec, frames, levels, counts, updateLevel, books[1][1]));
+                keep(2, 0, timeApply(spec, frames, runtimeApplyLevels, books[2][0]));
+                keep(2, 1, timeApply(spec, frames, applyLevelsFor(spec), books[2][1]));
+            }
+
+            string scale = spec.symbol + " " + to_string(spec.priceDecimals) + "/" + to_string(spec.qtyDecimals);
+            const char* stages[] = {"parse", "update", "apply"};
+            for (int st = 0; st < 3; st++)
+                cout << left << setw(14) << (st == 0 ? scale : "") << setw(8) << stages[st] << right << fixed
+                     << setprecision(1) << setw(10) << (double)best[st][0] / levels.size() << setw(10)
+                     << (double)best[st][1] / levels.size() << setw(9) << setprecision(2)
+                     << (double)best[st][0] / best[st][1] << "x\n";
+            bool same = parseSame && books[1][0] == books[1][1] && books[2][0] == books[2][1] &&
+                        books[1][0] == books[2][0];
+            if (!same) cout << "  MISMATCH: the paths left different books\n";
+            allSame = allSame && same;
+        }
+        cout << "\n" << (allSame ? "both paths left identical books" : "books differ") << "\n";
+        return allSame ? 0 : 1;
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+}
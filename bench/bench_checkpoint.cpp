@@ -0,0 +1,150 @@
+// Book checkpoints (checkpoint.h): what writing one costs the worker that
+// owns the book, and how long a warm start takes to restore it.
+//
+//   ./bench_checkpoint [--messages 20000] [--every 100] [--path /tmp/pulse_bench.ckpt]
+//
+// copy       what the worker pays, every --every messages of the synthetic
+//            feed: saveCheckpoint into a CheckpointWriter buffer and submit
+// write      the writer thread's side: the buffer into the mapped slot plus
+//            commit (checksum and generation); deferred counts the copies
+//            skipped because both buffers were still queued
+// restore    a fresh mapping of the file: latest() (which verifies the
+//            checksum) and restoreCheckpoint into an empty book
+//
+// The restored book is compared level by level with the one that wrote
+// the checkpoint.
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include "../book_engine.h"
+#include "../checkpoint.h"
+#include "../cycle_clock.h"
+#include "../latency_histogram.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+void printRow(const char* name, const LatencySnapshot& h, const string& extra = "") {
+    cout << left << setw(9) << name << right << setw(8) << h.count << setw(10)
+         << h.percentile(0.50) << setw(10) << h.percentile(0.99) << setw(11) << h.maxNs << "  "
+         << extra << "\n";
+}
+
+int main(int argc, char** argv) {
+    int    messages = 20000, every = 100;
+    string path = "/tmp/pulse_bench_" + to_string(getpid()) + ".ckpt";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue) messages = max(1, atoi(argv[++i]));
+        else if (arg == "--every" && hasValue)    every = max(1, atoi(argv[++i]));
+        else if (arg == "--path" && hasValue)     path = argv[++i];
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--every <n>] [--path <file>]\n";
+            return 1;
+        }
+    }
+
+    try {
+        CycleClock clock = CycleClock::calibrate();
+        InstrumentSpec spec = parseInstrumentSpec("BTCUSDT");
+        syncEnabled = false;
+
+        unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+        BookEventRing events(4096);
+        in->events = &events;
+        SyntheticFeed feed(defaultFeedProfile());
+        SyntheticMessage m;
+        vector<char> json;
+        LatencyHistogram copyHist;
+        size_t bytes = 0;
+        uint64_t engineCycles = 0, written = 0, writeSumNs = 0, writeMaxNs = 0, deferred = 0;
+        int lastCopied = 0;
+        {
+            CheckpointFile file(path, 1, sizeof(BookCheckpoint), CHECKPOINT_LAYOUT);
+            file.startWriting();
+            CheckpointWriter writer(file, 1, sizeof(BookCheckpoint));
+            for (int i = 1; i <= messages; i++) {
+                feed.next(m);
+                json.resize(SyntheticFeed::maxJsonBytes(m));
+                size_t len = feed.toJson(m, json.data(), spec.priceDecimals, spec.qtyDecimals,
+                                         spec.symbol.c_str());
+                uint64_t t0 = cycleNow();
+                DepthMessage msg;
+                if (!parseDepthMessage(json.data(), len, msg)) throw runtime_error("synthetic frame did not parse");
+                in->eventTimeMs = msg.eventTime;
+                int n = applyLevels(*in, msg.bids, msg.asks);
+                updateToxicityWindow(*in);
+                updateAnalytics(*in, 0.0, n);
+                engineCycles += cycleNow() - t0;
+                if (i % every) continue;
+
+                uint64_t s0 = cycleNow();
+                void* buf = writer.acquire(0);
+                if (!buf) continue;
+                bytes = saveCheckpoint(*in, *static_cast<BookCheckpoint*>(buf));
+                writer.submit(0, 0, spec.symbol, bytes);
+                copyHist.record(clock.elapsedNs(s0, cycleNow()));
+                lastCopied = i;
+            }
+            writer.stop();
+            written    = writer.written();
+            writeSumNs = writer.writeSumNs();
+            writeMaxNs = writer.writeMaxNs();
+            deferred   = writer.busy();
+        }
+
+        auto t0 = chrono::steady_clock::now();
+        unique_ptr<Instrument> warm(new Instrument(spec, 0, 1 << 16));
+        CheckpointFile file(path, 1, sizeof(BookCheckpoint), CHECKPOINT_LAYOUT);
+        int64_t savedNs = 0;
+        const void* p = file.latest(spec.symbol, savedNs);
+        if (!p || !restoreCheckpoint(*warm, *static_cast<const BookCheckpoint*>(p)))
+            throw runtime_error("no checkpoint to restore");
+        double restoreUs = chrono::duration<double, micro>(chrono::steady_clock::now() - t0).count();
+
+        // the last copy was of the final book only if it was due and not deferred
+        const BookCheckpoint& c = *static_cast<const BookCheckpoint*>(p);
+        Level a[CHECKPOINT_LEVELS], b[CHECKPOINT_LEVELS];
+        int mismatches = 0, levels = 0;
+        for (bool bid : {true, false}) {
+            int n = collectTop(*warm, bid, a, CHECKPOINT_LEVELS);
+            const Level* saved = c.levels + (bid ? 0 : c.numBids);
+            int want = bid ? c.numBids : c.numAsks;
+            mismatches += n != want;
+            for (int i = 0; i < min(n, want); i++)
+                mismatches += a[i].price != saved[i].price || a[i].qty != saved[i].qty;
+            levels += n;
+            if (lastCopied == messages) {
+                int k = collectTop(*in, bid, b, CHECKPOINT_LEVELS);
+                mismatches += k != n;
+            }
+        }
+        remove(path.c_str());
+
+        cout << file.fileBytes() / 1024 << " KB file, " << bytes / 1024 << " KB last checkpoint ("
+             << levels << " levels), engine " << fixed << setprecision(0)
+             << clock.toNs(engineCycles) / messages << " ns/msg\n\n"
+             << left << setw(9) << "" << right << setw(8) << "count" << setw(10) << "p50 ns"
+             << setw(10) << "p99 ns" << setw(11) << "max ns" << "\n";
+        LatencySnapshot cs;
+        cs.add(copyHist);
+        char extra[96];
+        snprintf(extra, sizeof(extra), "one every %d msgs: %.2f%% of the engine's time", every,
+                 100.0 * cs.meanNs() * cs.count / clock.toNs(engineCycles));
+        printRow("copy", cs, extra);
+        cout << left << setw(9) << "write" << right << setw(8) << written << "  avg "
+             << (written ? writeSumNs / written : 0) << " ns  max " << writeMaxNs << " ns on the writer thread, "
+             << deferred << " deferred\n";
+        cout << "restore  " << setprecision(1) << restoreUs << " us, "
+             << (mismatches ? "MISMATCH" : "book identical to the checkpoint") << "\n";
+        return mismatches ? 1 : 0;
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,258 @@
+// Per-stage engine benchmarks on a synthetic feed shaped like the real one,
+// with a regression report.
+//
+//   ./bench_engine [--profile pulse_data.csv] [--messages 20000] [--iterations 5]
+//                  [--seed 42] [--report out.csv] [--baseline old.csv] [--tolerance 5]
+//
+// Every stage is timed on the cycle counter around exactly the code the
+// engine runs (pulse_engine), once per message:
+//
+//   parse      parseDepthMessage and a walk over every level
+//   apply      applyLevels: ladder writes, best tracking, wall detection
+//   best       recoverBest after the message
+//   top5       collectTop on both sides
+//   walls      nearestWalls
+//   bands      depthBands: band depths, cost to move and sweep prices
+//   signals    updateSignals: microprice, OFI, spread and volatility windows
+//   analytics  toxicity window and the whole updateAnalytics
+//   csv        makeTelemetryRow + formatTelemetryRow
+//   pipeline   parse + apply + analytics + csv
+//
+// Each iteration replays the same feed into a fresh book; the fastest
+// iteration per stage is reported. --report writes the table as CSV, and
+// --baseline compares against an earlier report, exiting 1 if any stage
+// got slower by more than --tolerance percent.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <memory>
+#include "../book_engine.h"
+#include "../cycle_clock.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+enum BenchStage { B_PARSE, B_APPLY, B_BEST, B_TOP, B_WALLS, B_BANDS, B_SIGNALS, B_ANALYTICS, B_CSV,
+                  B_PIPELINE, NUM_BENCH };
+const char* const BENCH_NAMES[NUM_BENCH] = {
+    "parse", "apply", "best", "top5", "walls", "bands", "signals", "analytics", "csv", "pipeline"
+};
+
+struct Feed {
+    vector<char>   json;
+    vector<size_t> offsets;   // message i is json[offsets[i], offsets[i+1])
+    size_t         levels = 0;
+};
+
+Feed buildFeed(const FeedProfile& profile, int messages, uint64_t seed, const InstrumentSpec& spec) {
+    Feed f;
+    SyntheticFeed gen(profile, seed);
+    SyntheticMessage m;
+    for (int i = 0; i < messages; i++) {
+        gen.next(m);
+        f.levels += m.levels.size();
+        size_t at = f.json.size();
+        f.offsets.push_back(at);
+        f.json.resize(at + SyntheticFeed::maxJsonBytes(m));
+        f.json.resize(at + gen.toJson(m, &f.json[at], spec.priceDecimals, spec.qtyDecimals,
+                                      spec.symbol.c_str()));
+    }
+    f.offsets.push_back(f.json.size());
+    return f;
+}
+
+// Cycles spent per stage over one pass of the feed.
+void runOnce(const Feed& feed, const InstrumentSpec& spec, uint64_t cycles[NUM_BENCH],
+             uint64_t& checksum) {
+    unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+    unique_ptr<Signals>    signals(new Signals);   // a second copy, timed on its own
+    BookView               signalView;
+    BookEventRing events(4096);   // published to as live, nobody reads it
+    in->events = &events;
+    char line[CSV_MAX_LINE];
+    for (int i = 0; i < NUM_BENCH; i++) cycles[i] = 0;
+    checksum = 0;
+
+    for (size_t i = 0; i + 1 < feed.offsets.size(); i++) {
+        const char* data = &feed.json[feed.offsets[i]];
+        size_t      len  = feed.offsets[i + 1] - feed.offsets[i];
+
+        uint64_t t0 = cycleNow();
+        DepthMessage msg;
+        if (!parseDepthMessage(data, len, msg)) throw runtime_error("synthetic frame did not parse");
+        int64_t sum = 0;
+        auto walk = [&sum](int64_t t, int64_t q) { sum += t ^ q; };
+        forEachLevel(msg.bids, spec.priceDecimals, spec.qtyDecimals, walk);
+        forEachLevel(msg.asks, spec.priceDecimals, spec.qtyDecimals, walk);
+        uint64_t t1 = cycleNow();
+        int numUpdates = applyLevels(*in, msg.bids, msg.asks);
+        uint64_t t2 = cycleNow();
+
+        // timed on its own, then undone so analytics recovers as it would live
+        Ticks savedBid = in->bestBid, savedAsk = in->bestAsk;
+        recoverBest(*in);
+        uint64_t t3 = cycleNow();
+        in->bestBid = savedBid;
+        in->bestAsk = savedAsk;
+
+        uint64_t t4 = cycleNow();
+        updateToxicityWindow(*in);
+        updateAnalytics(*in, 0.0, numUpdates);
+        uint64_t t5 = cycleNow();
+
+        Level top[TOP_LEVELS];
+        int n = collectTop(*in, true, top, TOP_LEVELS) + collectTop(*in, false, top, TOP_LEVELS);
+        uint64_t t6 = cycleNow();
+        Level bidWall, askWall;
+        nearestWalls(*in, in->view.back().midTicks2, bidWall, askWall);
+        uint64_t t7 = cycleNow();
+        BookView& bands = in->view.back();
+        depthBands(*in, bands.midTicks2, bands);
+        uint64_t t7b = cycleNow();
+
+        TopOfBook tob;
+        tob.numBids   = bands.numBids;
+        tob.numAsks   = bands.numAsks;
+        tob.midTicks2 = bands.midTicks2;
+        copy(bands.topBids, bands.topBids + bands.numBids, tob.bids);
+        copy(bands.topAsks, bands.topAsks + bands.numAsks, tob.asks);
+        uint64_t t7c = cycleNow();
+        updateSignals(*signals, tob, in->eventTimeMs, signalView);
+        uint64_t t7d = cycleNow();
+
+        TelemetryRow row;
+        makeTelemetryRow(in->view.back(), row);
+        size_t written = formatTelemetryRow(line, row, spec);
+        uint64_t t8 = cycleNow();
+
+        cycles[B_PARSE]     += t1 - t0;
+        cycles[B_APPLY]     += t2 - t1;
+        cycles[B_BEST]      += t3 - t2;
+        cycles[B_ANALYTICS] += t5 - t4;
+        cycles[B_TOP]       += t6 - t5;
+        cycles[B_WALLS]     += t7 - t6;
+        cycles[B_BANDS]     += t7b - t7;
+        cycles[B_SIGNALS]   += t7d - t7c;
+        cycles[B_CSV]       += t8 - t7d;
+        checksum = checksum * 31 + (uint64_t)sum + n + written + bidWall.price + askWall.price
+                 + bands.costUpLots + bands.sweepAskPx + signalView.ofiWindow;
+    }
+    cycles[B_PIPELINE] = cycles[B_PARSE] + cycles[B_APPLY] + cycles[B_ANALYTICS] + cycles[B_CSV];
+}
+
+struct Result {
+    double nsPerMsg;
+    double nsPerLevel;
+    double msgsPerSec;
+};
+
+map<string, Result> readReport(const string& path) {
+    map<string, Result> out;
+    ifstream in(path);
+    if (!in) throw runtime_error("cannot open " + path);
+    string line;
+    getline(in, line);
+    while (getline(in, line)) {
+        stringstream ss(line);
+        string name, a, b, c;
+        if (!getline(ss, name, ',') || !getline(ss, a, ',') || !getline(ss, b, ',') || !getline(ss, c, ','))
+            continue;
+        out[name] = {atof(a.c_str()), atof(b.c_str()), atof(c.c_str())};
+    }
+    return out;
+}
+
+int main(int argc, char** argv) {
+    string profilePath = "pulse_data.csv", reportPath, baselinePath;
+    int    messages = 20000, iterations = 5;
+    uint64_t seed = 42;
+    double tolerance = 5.0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--profile" && hasValue)    profilePath = argv[++i];
+        else if (arg == "--messages" && hasValue)   messages = max(1, atoi(argv[++i]));
+        else if (arg == "--iterations" && hasValue) iterations = max(1, atoi(argv[++i]));
+        else if (arg == "--seed" && hasValue)       seed = strtoull(argv[++i], nullptr, 10);
+        else if (arg == "--report" && hasValue)     reportPath = argv[++i];
+        else if (arg == "--baseline" && hasValue)   baselinePath = argv[++i];
+        else if (arg == "--tolerance" && hasValue)  tolerance = atof(argv[++i]);
+        else {
+            cerr << "usage: " << argv[0] << " [--profile <pulse_data.csv>] [--messages <n>]"
+                 << " [--iterations <n>] [--seed <n>]\n"
+                 << "       [--report <out.csv>] [--baseline <old.csv>] [--tolerance <pct>]\n";
+            return 1;
+        }
+    }
+
+    FeedProfile profile;
+    try {
+        profile = calibrateFromCsv(profilePath);
+    } catch (exception const& e) {
+        cerr << e.what() << "; using the built-in profile\n";
+        profile = defaultFeedProfile();
+    }
+
+    InstrumentSpec spec = parseInstrumentSpec("BTCUSDT");
+    CycleClock clock = CycleClock::calibrate();
+    Feed feed = buildFeed(profile, messages, seed, spec);
+
+    cout << messages << " messages, " << feed.levels << " levels (" << fixed << setprecision(1)
+         << (double)feed.levels / messages << " per message), " << feed.json.size() / 1024
+         << " KB of JSON\n"
+         << "profile: " << profile.source << ", far levels ~" << setprecision(0)
+         << profile.farMeanTicks << " ticks from mid\n"
+         << "clock: " << clock.source << " " << setprecision(2) << clock.hz / 1e9 << " GHz, best of "
+         << iterations << "\n\n";
+
+    uint64_t best[NUM_BENCH];
+    uint64_t checksum = 0;
+    for (int it = 0; it < iterations; it++) {
+        uint64_t cycles[NUM_BENCH];
+        runOnce(feed, spec, cycles, checksum);
+        for (int i = 0; i < NUM_BENCH; i++)
+            if (it == 0 || cycles[i] < best[i]) best[i] = cycles[i];
+    }
+
+    map<string, Result> baseline;
+    if (!baselinePath.empty()) baseline = readReport(baselinePath);
+
+    ofstream report;
+    if (!reportPath.empty()) {
+        report.open(reportPath);
+        if (!report) { cerr << "cannot open " << reportPath << "\n"; return 1; }
+        report << "benchmark,ns_per_msg,ns_per_level,msgs_per_sec\n";
+    }
+
+    bool regressed = false;
+    cout << left << setw(11) << "stage" << right << setw(12) << "ns/msg" << setw(12) << "ns/level"
+         << setw(14) << "msgs/sec" << (baseline.empty() ? "" : "    vs baseline") << "\n";
+    for (int i = 0; i < NUM_BENCH; i++) {
+        double ns = clock.toNs(best[i]);
+        Result r = {ns / messages, ns / feed.levels, ns > 0 ? messages * 1e9 / ns : 0};
+        cout << left << setw(11) << BENCH_NAMES[i] << right << setprecision(1)
+             << setw(12) << r.nsPerMsg << setprecision(2) << setw(12) << r.nsPerLevel
+             << setprecision(0) << setw(14) << r.msgsPerSec;
+
+        auto b = baseline.find(BENCH_NAMES[i]);
+        if (b != baseline.end() && b->second.nsPerMsg > 0) {
+            double delta = 100.0 * (r.nsPerMsg - b->second.nsPerMsg) / b->second.nsPerMsg;
+            cout << "    " << showpos << setprecision(1) << delta << "%" << noshowpos;
+            if (delta > tolerance) {
+                cout << "  REGRESSION";
+                regressed = true;
+            }
+        }
+        cout << "\n";
+
+        if (report.is_open())
+            report << BENCH_NAMES[i] << ',' << setprecision(3) << r.nsPerMsg << ','
+                   << setprecision(4) << r.nsPerLevel << ',' << setprecision(0) << r.msgsPerSec << '\n';
+    }
+    cout << "checksum " << hex << checksum << dec << "\n";
+    return regressed ? 1 : 0;
+}
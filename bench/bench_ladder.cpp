@@ -0,0 +1,193 @@
+// Best-level recovery and top-N extraction: linear cell scan (the ladder
+// before the occupancy bitmap) against PriceLadder's bitmap walk.
+//
+//   ./bench_ladder                    synthetic sweep-heavy workload
+//   ./bench_ladder session.jrnl       replay a recorded journal
+//
+// Both ladders see the identical sequence of level updates; after every
+// message each one recovers best bid/ask and collects the top 5 levels per
+// side, and the results are folded into a checksum that must match. The
+// bitmap and depth tree cost something on every update, so the apply, the
+// query and their total are reported side by side.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <random>
+#include <chrono>
+#include "../journal.h"
+#include "../depth_parser.h"
+#include "../price_ladder.h"
+
+using namespace std;
+
+const int PRICE_DECIMALS = 2;
+const int QTY_DECIMALS   = 5;
+const int WINDOW         = 1 << 16;
+const int TOP_N          = 5;
+
+struct Update { bool isBid; Ticks price; Lots qty; };
+typedef vector<Update> Message;
+
+// Flat window with linear scans; the recovery strategy renderOrderBook
+// used before the bitmap. Anchored once, no re-centering, so the workload
+// must stay inside the window.
+struct ScanLadder {
+    Ticks base;
+    vector<Lots> cells;
+
+    ScanLadder(Ticks anchor) : base(anchor - WINDOW / 2), cells(WINDOW, 0) {}
+
+    bool inWindow(Ticks t) const { return t >= base && t < base + WINDOW; }
+    Lots get(Ticks t) const { return inWindow(t) ? cells[t - base] : 0; }
+    void set(Ticks t, Lots q) { if (inWindow(t)) cells[t - base] = q; }
+
+    Ticks bestAtOrBelow(Ticks from) const {
+        for (Ticks t = min(from, base + WINDOW - 1); t >= base; --t)
+            if (cells[t - base]) return t;
+        return NO_PRICE;
+    }
+    Ticks bestAtOrAbove(Ticks from) const {
+        for (Ticks t = max(from, base); t < base + WINDOW; ++t)
+            if (cells[t - base]) return t;
+        return NO_PRICE;
+    }
+};
+
+// Same best-tracking logic as updateLevel/renderOrderBook.
+template <typename Ladder>
+struct Book {
+    Ladder bids, asks;
+    Ticks bestBid = NO_PRICE, bestAsk = NO_PRICE;
+
+    Book(Ladder b, Ladder a) : bids(b), asks(a) {}
+
+    void apply(const Update& u) {
+        if (u.isBid) {
+            bids.set(u.price, u.qty);
+            if (u.qty > 0 && u.price > bestBid) bestBid = u.price;
+        } else {
+            asks.set(u.price, u.qty);
+            if (u.qty > 0 && (bestAsk == NO_PRICE || u.price < bestAsk)) bestAsk = u.price;
+        }
+    }
+
+    uint64_t query() {
+        if (bestBid != NO_PRICE && bids.get(bestBid) == 0) bestBid = bids.bestAtOrBelow(bestBid);
+        if (bestAsk != NO_PRICE && asks.get(bestAsk) == 0) bestAsk = asks.bestAtOrAbove(bestAsk);
+
+        uint64_t h = 0;
+        int n = 0;
+        for (Ticks t = bestBid; t != NO_PRICE && n < TOP_N; t = bids.bestAtOrBelow(t - 1), n++)
+            h = h * 31 + (uint64_t)t * 7 + bids.get(t);
+        n = 0;
+        for (Ticks t = bestAsk; t != NO_PRICE && n < TOP_N; t = asks.bestAtOrAbove(t + 1), n++)
+            h = h * 31 + (uint64_t)t * 7 + asks.get(t);
+        return h;
+    }
+};
+
+// Resting book spread over most of the window, then repeated sweeps that
+// wipe out everything within d ticks of the touch (d is usually small but
+// occasionally thousands of ticks), each followed by liquidity refilling
+// the gap.
+vector<Message> syntheticSweeps(Ticks mid, int messages) {
+    mt19937_64 rng(42);
+    vector<Message> out;
+
+    Message seed;
+    for (Ticks d = 1; d < WINDOW / 2 - 1; d += 1 + rng() % 40) {
+        seed.push_back({true,  mid - d, (Lots)(1 + rng() % 200000)});
+        seed.push_back({false, mid + d, (Lots)(1 + rng() % 200000)});
+    }
+    out.push_back(seed);
+
+    Ticks topBid = mid - 1, topAsk = mid + 1;
+    for (int m = 0; m < messages; m++) {
+        Message msg;
+        bool bidSide = rng() & 1;
+        Ticks depth  = (rng() % 10 == 0) ? 500 + rng() % 5000 : 1 + rng() % 20;
+        Ticks top    = bidSide ? topBid : topAsk;
+
+        for (Ticks d = 0; d <= depth; d++)
+            msg.push_back({bidSide, bidSide ? top - d : top + d, 0});
+        out.push_back(msg);
+
+        // refill half the gap on the next message so the sweep persists
+        // through one full recovery
+        Message refill;
+        for (Ticks d = depth; d >= depth / 2; d -= 1 + rng() % 8)
+            refill.push_back({bidSide, bidSide ? top - d : top + d, (Lots)(1 + rng() % 200000)});
+        for (Ticks d = depth / 2; d >= 0; d -= 1 + rng() % 8)
+            refill.push_back({bidSide, bidSide ? top - d : top + d, (Lots)(1 + rng() % 200000)});
+        out.push_back(refill);
+    }
+    return out;
+}
+
+vector<Message> fromJournal(const char* path) {
+    JournalReader reader(path);
+    JournalFrame f;
+    vector<Message> out;
+    while (reader.next(f)) {
+        if (f.type != JOURNAL_FRAME) continue;
+        DepthMessage msg;
+        if (!parseDepthMessage(f.data, f.length, msg)) continue;
+        Message m;
+        forEachLevel(msg.bids, PRICE_DECIMALS, QTY_DECIMALS,
+            [&](int64_t t, int64_t l) { m.push_back({true, t, toLots(l)}); });
+        forEachLevel(msg.asks, PRICE_DECIMALS, QTY_DECIMALS,
+            [&](int64_t t, int64_t l) { m.push_back({false, t, toLots(l)}); });
+        out.push_back(m);
+    }
+    return out;
+}
+
+template <typename Ladder>
+void run(const char* name, Book<Ladder> book, const vector<Message>& msgs,
+         uint64_t& checksum, double& applyNs, double& queryNs) {
+    applyNs  = 0;
+    queryNs  = 0;
+    checksum = 0;
+    for (auto& m : msgs) {
+        auto t0 = chrono::steady_clock::now();
+        for (auto& u : m) book.apply(u);
+        auto t1 = chrono::steady_clock::now();
+        checksum = checksum * 1099511628211ULL + book.query();
+        auto t2 = chrono::steady_clock::now();
+        applyNs += chrono::duration<double, nano>(t1 - t0).count();
+        queryNs += chrono::duration<double, nano>(t2 - t1).count();
+    }
+    cout << left << setw(10) << name << right << fixed << setprecision(1)
+         << setw(12) << applyNs / msgs.size() << " ns/msg apply"
+         << setw(12) << queryNs / msgs.size() << " ns/msg best+top" << TOP_N
+         << setw(12) << (applyNs + queryNs) / msgs.size() << " ns/msg total"
+         << "   checksum " << hex << checksum << dec << "\n";
+}
+
+int main(int argc, char** argv) {
+    vector<Message> msgs = argc > 1 ? fromJournal(argv[1]) : syntheticSweeps(6900000, 20000);
+    if (msgs.empty() || msgs[0].empty()) { cerr << "no updates to replay\n"; return 1; }
+
+    // both ladders are anchored on the first level seen; the scan ladder
+    // never re-centres so the workload is kept within one window
+    Ticks anchor = msgs[0][0].price;
+    size_t levels = 0;
+    for (auto& m : msgs) levels += m.size();
+    cout << msgs.size() << " messages, " << levels << " level updates\n";
+
+    uint64_t scanSum, bitmapSum;
+    double   scanApply, scanQuery, bitmapApply, bitmapQuery;
+    run("scan",   Book<ScanLadder>(ScanLadder(anchor), ScanLadder(anchor)), msgs, scanSum, scanApply, scanQuery);
+    run("bitmap", Book<PriceLadder>(PriceLadder(WINDOW), PriceLadder(WINDOW)), msgs, bitmapSum, bitmapApply,
+        bitmapQuery);
+    cout << fixed << setprecision(2) << "bitmap vs scan: apply " << scanApply / bitmapApply << "x, query "
+         << scanQuery / bitmapQuery << "x, apply+query " << (scanApply + scanQuery) / (bitmapApply + bitmapQuery)
+         << "x (above 1 is faster)\n";
+
+    if (scanSum != bitmapSum) {
+        cerr << "MISMATCH: ladders disagree\n";
+        return 1;
+    }
+    return 0;
+}
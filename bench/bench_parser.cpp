@@ -0,0 +1,138 @@
+// Parser benchmark: nlohmann::json + stod (the original read-loop path)
+// against the streaming depth parser, over the frames of a recorded journal.
+//
+//   ./bench_parser session.jrnl [iterations]
+//
+// Both paths reduce every level to the same (ticks, lots) pair and fold it
+// into a checksum, so the run also proves they agree on every frame.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <cmath>
+#include <chrono>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <nlohmann/json.hpp>
+#include "../journal.h"
+#include "../depth_parser.h"
+
+using namespace std;
+using json = nlohmann::json;
+
+static atomic<long long> allocations{0};
+
+void* operator new(size_t n) {
+    allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+
+// Every form of delete frees what the matching new malloc'd. GCC inlines
+// these into callers and then reports free() on an operator new pointer.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+const int PRICE_DECIMALS = 2;
+const int QTY_DECIMALS   = 5;
+
+struct Frame { const char* data; size_t len; };
+
+struct Result {
+    double    nsPerMsg;
+    double    nsPerLevel;
+    double    allocsPerMsg;
+    long long levels;
+    uint64_t  checksum;
+};
+
+inline uint64_t mix(uint64_t h, int64_t ticks, int64_t lots) {
+    return (h ^ (uint64_t)ticks) * 0x100000001b3ULL + (uint64_t)lots;
+}
+
+uint64_t jsonPath(const Frame& f, long long& levels) {
+    uint64_t h = 0;
+    string msg(f.data, f.len);
+    auto j = json::parse(msg);
+    for (const char* side : {"b", "a"}) {
+        for (auto& level : j[side]) {
+            double price = stod(level[0].get<string>());
+            double qty   = stod(level[1].get<string>());
+            h = mix(h, llround(price * 100.0), llround(qty * 100000.0));
+            levels++;
+        }
+    }
+    return h;
+}
+
+uint64_t streamingPath(const Frame& f, long long& levels) {
+    uint64_t h = 0;
+    DepthMessage msg;
+    if (!parseDepthMessage(f.data, f.len, msg)) return 0;
+    auto onLevel = [&](int64_t ticks, int64_t lots) { h = mix(h, ticks, lots); };
+    int n = forEachLevel(msg.bids, PRICE_DECIMALS, QTY_DECIMALS, onLevel);
+    n    += forEachLevel(msg.asks, PRICE_DECIMALS, QTY_DECIMALS, onLevel);
+    levels += n;
+    return h;
+}
+
+template <typename Path>
+Result run(const vector<Frame>& frames, int iterations, Path path) {
+    Result r{};
+    long long allocStart = allocations.load();
+    auto t0 = chrono::steady_clock::now();
+    for (int it = 0; it < iterations; it++) {
+        for (auto& f : frames) r.checksum += path(f, r.levels);
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count();
+    long long msgs = (long long)frames.size() * iterations;
+    r.nsPerMsg     = ns / msgs;
+    r.nsPerLevel   = r.levels ? ns / r.levels : 0.0;
+    r.allocsPerMsg = (double)(allocations.load() - allocStart) / msgs;
+    return r;
+}
+
+void report(const char* name, const Result& r) {
+    cout << left << setw(12) << name << right
+         << fixed << setprecision(1)
+         << setw(12) << r.nsPerMsg   << " ns/msg"
+         << setw(10) << r.nsPerLevel << " ns/level"
+         << setw(10) << r.allocsPerMsg << " allocs/msg"
+         << "   checksum " << hex << r.checksum << dec << "\n";
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        cerr << "usage: " << argv[0] << " <journal> [iterations]\n";
+        return 1;
+    }
+    int iterations = argc > 2 ? atoi(argv[2]) : 20;
+
+    JournalReader reader(argv[1]);
+    vector<Frame> frames;
+    JournalFrame jf;
+    while (reader.next(jf))
+        if (jf.type == JOURNAL_FRAME) frames.push_back({jf.data, jf.length});
+    if (frames.empty()) { cerr << "journal is empty\n"; return 1; }
+
+    cout << frames.size() << " frames x " << iterations << " iterations\n";
+    Result a = run(frames, iterations, jsonPath);
+    Result b = run(frames, iterations, streamingPath);
+    report("json+stod", a);
+    report("streaming", b);
+    cout << "speedup: " << fixed << setprecision(2) << a.nsPerMsg / b.nsPerMsg << "x\n";
+
+    if (a.checksum != b.checksum) {
+        cerr << "MISMATCH: parsers disagree\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,431 @@
+// The live reader against a local stand-in for the exchange: a TLS
+// WebSocket server on 127.0.0.1 with a throwaway self-signed certificate,
+// sending synthetic depthUpdate frames at a fixed rate.
+//
+//   ./bench_reader [--messages 20000] [--rate 20000] [--busy-poll <us>]
+//
+// Four runs against the same frames:
+//
+//   blocking   the reader as it was: blocking ws.read into a new
+//              flat_buffer every frame, copied out with buffers_to_string
+//   async      WsReader: async_read into one reserved buffer, in place
+//   reconnect  the server drops the connection three times; WsReader must
+//              come back through its backoff and see every frame
+//   redundant  two servers send the same schedule, each adding its own
+//              random per-frame delay (--jitter-us a,b); two WsReaders on
+//              one io_context feed a FeedArbiter. Leg 0 is cut off half
+//              way and resumes live, as the exchange would, missing what
+//              it was sent meanwhile. Every frame must still arrive once.
+//
+// For the first two it reports heap allocations per frame on the reader
+// thread and send -> parsed latency: the server stamps the cycle counter
+// just before each write, the reader stops it after parseDepthMessage and
+// a walk over the levels.
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <memory>
+#include <new>
+#include <cstdlib>
+#include <random>
+#include <algorithm>
+#include <openssl/evp.h>
+#include <openssl/ec.h>
+#include <openssl/x509.h>
+#include "../ws_reader.h"
+#include "../depth_parser.h"
+#include "../cycle_clock.h"
+#include "../latency_histogram.h"
+#include "../feed_arbiter.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+namespace beast     = boost::beast;
+namespace websocket = beast::websocket;
+namespace net       = boost::asio;
+namespace ssl       = boost::asio::ssl;
+using tcp = net::ip::tcp;
+
+// ===== ALLOCATION COUNTING =====
+// Only allocations made on a thread that has switched counting on.
+atomic<uint64_t> allocations{0};
+thread_local bool countAllocations = false;
+
+void* operator new(size_t n) {
+    if (countAllocations) allocations.fetch_add(1, memory_order_relaxed);
+    if (void* p = malloc(n ? n : 1)) return p;
+    throw bad_alloc();
+}
+void* operator new[](size_t n) { return operator new(n); }
+
+// Every form of delete frees what the matching new malloc'd. GCC inlines
+// these into callers and then reports free() on an operator new pointer.
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+void operator delete(void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+#pragma GCC diagnostic pop
+
+// ===== STAND-IN SERVER =====
+void installSelfSignedCert(ssl::context& ctx) {
+    EVP_PKEY* key = nullptr;
+    EVP_PKEY_CTX* kc = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (!kc || EVP_PKEY_keygen_init(kc) <= 0 ||
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kc, NID_X9_62_prime256v1) <= 0 ||
+        EVP_PKEY_keygen(kc, &key) <= 0)
+        throw runtime_error("key generation failed");
+    EVP_PKEY_CTX_free(kc);
+
+    X509* cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME* name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC, (const unsigned char*)"localhost", -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    if (!X509_sign(cert, key, EVP_sha256())) throw runtime_error("certificate signing failed");
+
+    SSL_CTX_use_certificate(ctx.native_handle(), cert);
+    SSL_CTX_use_PrivateKey(ctx.native_handle(), key);
+    X509_free(cert);
+    EVP_PKEY_free(key);
+}
+
+struct StandIn {
+    vector<string>             frames;
+    unique_ptr<atomic<uint64_t>[]> sentCycles;
+    double                     rate;
+    CycleClock                 clock;
+    double                     jitterUs    = 0;     // extra delay per frame, uniform in [0, jitterUs]
+    bool                       resumeLive  = false; // after a reconnect, skip what was missed
+    uint64_t                   startCycles = 0;     // schedule origin; 0 = first connection
+    net::io_context            ioc;
+    ssl::context               ctx{ssl::context::tlsv12_server};
+    tcp::acceptor              acceptor{ioc, tcp::endpoint(net::ip::make_address("127.0.0.1"), 0)};
+
+    StandIn(vector<string> f, double r, const CycleClock& c)
+        : frames(move(f)), sentCycles(new atomic<uint64_t>[frames.size()]), rate(r), clock(c) {
+        installSelfSignedCert(ctx);
+    }
+
+    unsigned short port() const { return acceptor.local_endpoint().port(); }
+    uint64_t gap() const { return (uint64_t)(clock.hz / rate); }
+    uint64_t scheduled(size_t i) const { return startCycles + i * gap(); }
+
+    // Serves frames in order over `connections` successive connections,
+    // closing each after its share. Frame i is due at startCycles + i/rate
+    // plus the jitter; a frame that is late goes out as soon as it can.
+    void serve(int connections) {
+        mt19937_64 rng(port());
+        uniform_real_distribution<double> jitter(0.0, jitterUs * clock.hz / 1e6);
+        size_t next = 0;
+        for (int c = 0; c < connections; c++) {
+            tcp::socket sock = acceptor.accept();
+            sock.set_option(tcp::no_delay(true));
+            websocket::stream<beast::ssl_stream<tcp::socket>> ws(move(sock), ctx);
+            try {
+                ws.next_layer().handshake(ssl::stream_base::server);
+                ws.accept();
+                ws.text(true);
+                if (!startCycles) startCycles = cycleNow();
+
+                size_t end = c + 1 == connections ? frames.size() : frames.size() * (c + 1) / connections;
+                if (c > 0 && resumeLive)
+                    while (next < end && scheduled(next) < cycleNow()) next++;
+                uint64_t lastDue = 0;
+                for (; next < end; next++) {
+                    uint64_t due = max(lastDue, scheduled(next) + (uint64_t)jitter(rng));
+                    lastDue = due;
+                    while (cycleNow() < due) this_thread::yield();
+                    sentCycles[next].store(cycleNow(), memory_order_release);
+                    ws.write(net::buffer(frames[next]));
+                }
+                beast::error_code ec;
+                ws.close(websocket::close_code::normal, ec);
+            } catch (exception const&) {
+                return;   // the client went away
+            }
+        }
+    }
+};
+
+// ===== CLIENTS =====
+struct RunResult {
+    LatencySnapshot latency;
+    uint64_t        frames      = 0;
+    uint64_t        allocations = 0;
+};
+
+struct Consumer {
+    StandIn&         server;
+    LatencyHistogram hist;
+    uint64_t         received = 0;
+    uint64_t         checksum = 0;
+
+    explicit Consumer(StandIn& s) : server(s) {}
+
+    // parse and walk exactly as the engine's parse stage does
+    void onFrame(const char* data, size_t len) {
+        DepthMessage msg;
+        if (!parseDepthMessage(data, len, msg)) throw runtime_error("bad frame");
+        auto walk = [this](int64_t t, int64_t q) { checksum += t ^ q; };
+        forEachLevel(msg.bids, 2, 5, walk);
+        forEachLevel(msg.asks, 2, 5, walk);
+        uint64_t sent = server.sentCycles[received].load(memory_order_acquire);
+        hist.record(server.clock.elapsedNs(sent, cycleNow()));
+        received++;
+        if (received == 1) {
+            allocations.store(0);
+            countAllocations = true;   // steady state from the second frame on
+        }
+    }
+
+    RunResult result() {
+        countAllocations = false;
+        RunResult r;
+        r.latency.add(hist);
+        r.frames      = received;
+        r.allocations = allocations.load();
+        return r;
+    }
+};
+
+// The reader loop this project used before WsReader.
+RunResult runBlocking(StandIn& server) {
+    Consumer c(server);
+    net::io_context ioc;
+    ssl::context ctx(ssl::context::tlsv12_client);
+    websocket::stream<beast::ssl_stream<tcp::socket>> ws(ioc, ctx);
+    tcp::resolver resolver(ioc);
+    net::connect(get_lowest_layer(ws), resolver.resolve("127.0.0.1", to_string(server.port())));
+    get_lowest_layer(ws).set_option(tcp::no_delay(true));
+    ws.next_layer().handshake(ssl::stream_base::client);
+    ws.handshake("127.0.0.1", "/");
+
+    while (c.received < server.frames.size()) {
+        beast::flat_buffer buffer;
+        ws.read(buffer);
+        string s = beast::buffers_to_string(buffer.data());
+        c.onFrame(s.data(), s.size());
+    }
+    RunResult r = c.result();
+    beast::flat_buffer closing;
+    beast::error_code  ec;
+    ws.read(closing, ec);   // the server's close
+    return r;
+}
+
+RunResult runAsync(StandIn& server, ReaderOptions opts, ReaderStats* statsOut = nullptr,
+                   vector<int>* backoffs = nullptr) {
+    Consumer c(server);
+    opts.host = "127.0.0.1";
+    opts.port = to_string(server.port());
+    WsReader* self = nullptr;
+    WsReader reader(opts, "/",
+        [&](uint64_t, const char* data, size_t len) {
+            c.onFrame(data, len);
+            if (c.received == server.frames.size()) self->stop();
+        },
+        nullptr,
+        [&](const string&, int retryMs) { if (backoffs) backoffs->push_back(retryMs); });
+    self = &reader;
+    reader.run();
+    RunResult r = c.result();
+    if (statsOut) {
+        statsOut->connects.store(reader.stats().connects.load());
+        statsOut->disconnects.store(reader.stats().disconnects.load());
+    }
+    return r;
+}
+
+// Two legs on one io_context through a FeedArbiter. Latency here is from
+// the frame's scheduled time, which both servers share, so the legs and
+// the arbitrated stream can be compared directly.
+struct RedundantResult {
+    LatencySnapshot legLatency[2];
+    LatencySnapshot arbitrated;
+    LatencySnapshot lag[2];
+    uint64_t        wins[2]       = {};
+    uint64_t        legFrames[2]  = {};
+    uint64_t        applied       = 0;
+    uint64_t        missing       = 0;
+    uint64_t        duplicates    = 0;   // applied twice
+};
+
+RedundantResult runRedundant(StandIn* servers[2], const vector<int64_t>& finalIds, ReaderOptions opts,
+                             const CycleClock& clock) {
+    net::io_context ioc;
+    FeedArbiter arbiter(2, 1, clock);
+    LatencyHistogram legHist[2], arbHist;
+    vector<uint8_t> seen(finalIds.size(), 0);
+    RedundantResult res;
+    size_t remaining = finalIds.size();
+    int64_t lastFinal = finalIds.back();
+
+    vector<unique_ptr<WsReader>> legs;
+    for (int leg = 0; leg < 2; leg++) {
+        ReaderOptions o = opts;
+        o.host = "127.0.0.1";
+        o.port = to_string(servers[leg]->port());
+        legs.emplace_back(new WsReader(ioc, o, "/",
+            [&, leg](uint64_t recvCycles, const char* data, size_t len) {
+                int64_t u;
+                if (!peekFinalUpdateId(data, len, u)) throw runtime_error("bad frame");
+                size_t i = lower_bound(finalIds.begin(), finalIds.end(), u) - finalIds.begin();
+                legHist[leg].record(clock.elapsedNs(servers[leg]->scheduled(i), recvCycles));
+                if (!arbiter.accept(leg, 0, u, recvCycles)) return;
+
+                DepthMessage msg;
+                if (!parseDepthMessage(data, len, msg)) throw runtime_error("bad frame");
+                arbHist.record(clock.elapsedNs(servers[leg]->scheduled(i), cycleNow()));
+                if (seen[i]++) res.duplicates++;
+                else remaining--;
+                res.applied++;
+                if (u == lastFinal) ioc.stop();
+            },
+            [&arbiter, leg] { arbiter.legUp(leg); },
+            [&arbiter, leg](const string&, int) { arbiter.legDown(leg); }));
+    }
+    for (auto& l : legs) l->start();
+    ioc.run();
+
+    for (int leg = 0; leg < 2; leg++) {
+        res.legLatency[leg].add(legHist[leg]);
+        res.lag[leg].add(arbiter.leg(leg).lag);
+        res.wins[leg]      = arbiter.leg(leg).wins.load();
+        res.legFrames[leg] = arbiter.leg(leg).frames.load();
+    }
+    res.arbitrated.add(arbHist);
+    res.missing = remaining;
+    return res;
+}
+
+void printRun(const char* name, const RunResult& r) {
+    const LatencySnapshot& h = r.latency;
+    cout << left << setw(10) << name << right << setw(9) << r.frames << fixed << setprecision(2)
+         << setw(12) << (r.frames > 1 ? (double)r.allocations / (r.frames - 1) : 0.0)
+         << setprecision(0) << setw(10) << h.percentile(0.50) << setw(10) << h.percentile(0.99)
+         << setw(10) << h.percentile(0.999) << setw(10) << h.maxNs << "\n";
+}
+
+int main(int argc, char** argv) {
+    int    messages = 20000;
+    double rate     = 20000;
+    double jitterUs[2] = {200, 1000};
+    ReaderOptions opts;
+    opts.verifyPeer   = false;   // the stand-in's certificate is self-signed
+    opts.backoffMinMs = 20;
+    opts.backoffMaxMs = 200;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue)  messages = max(2, atoi(argv[++i]));
+        else if (arg == "--rate" && hasValue)      rate = max(1.0, atof(argv[++i]));
+        else if (arg == "--busy-poll" && hasValue) opts.busyPollUs = atoi(argv[++i]);
+        else if (arg == "--jitter-us" && hasValue &&
+                 sscanf(argv[++i], "%lf,%lf", &jitterUs[0], &jitterUs[1]) == 2) {}
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--rate <msgs/sec>] [--busy-poll <us>]\n"
+                 << "       [--jitter-us <leg0>,<leg1>]  per-frame delay the two redundant servers add\n";
+            return 1;
+        }
+    }
+
+    CycleClock clock = CycleClock::calibrate();
+    vector<string>  frames;
+    vector<int64_t> finalIds;
+    {
+        SyntheticFeed feed(defaultFeedProfile());
+        SyntheticMessage m;
+        vector<char> buf;
+        for (int i = 0; i < messages; i++) {
+            feed.next(m);
+            buf.resize(SyntheticFeed::maxJsonBytes(m));
+            frames.emplace_back(buf.data(), feed.toJson(m, buf.data(), 2, 5));
+            finalIds.push_back(m.finalUpdateId);
+        }
+    }
+
+    cout << messages << " frames at " << fixed << setprecision(0) << rate << "/s over TLS to 127.0.0.1\n\n"
+         << left << setw(10) << "reader" << right << setw(9) << "frames" << setw(12) << "allocs/msg"
+         << setw(10) << "p50 ns" << setw(10) << "p99 ns" << setw(10) << "p99.9 ns" << setw(10)
+         << "max ns" << "\n";
+
+    try {
+        {
+            StandIn server(frames, rate, clock);
+            thread t([&] { server.serve(1); });
+            printRun("blocking", runBlocking(server));
+            t.join();
+        }
+        {
+            StandIn server(frames, rate, clock);
+            thread t([&] { server.serve(1); });
+            printRun("async", runAsync(server, opts));
+            t.join();
+        }
+
+        StandIn server(frames, rate, clock);
+        thread t([&] { server.serve(4); });
+        ReaderStats stats;
+        vector<int> backoffs;
+        RunResult r = runAsync(server, opts, &stats, &backoffs);
+        t.join();
+        cout << "\nreconnect: " << r.frames << "/" << frames.size() << " frames over "
+             << stats.connects.load() << " connections, backoff ms:";
+        for (int b : backoffs) cout << " " << b;
+        cout << "\n";
+        if (r.frames != frames.size()) {
+            cerr << "reader lost frames across reconnects\n";
+            return 1;
+        }
+
+        StandIn a(frames, rate, clock), b(frames, rate, clock);
+        StandIn* servers[2] = {&a, &b};
+        for (int leg = 0; leg < 2; leg++) {
+            servers[leg]->jitterUs   = jitterUs[leg];
+            servers[leg]->resumeLive = true;
+            servers[leg]->startCycles = cycleNow() + (uint64_t)(0.2 * clock.hz);   // time to connect
+        }
+        thread ta([&] { a.serve(2); }), tb([&] { b.serve(1); });
+        RedundantResult rr = runRedundant(servers, finalIds, opts, clock);
+        ta.join();
+        tb.join();
+
+        cout << "\nredundant (latency from the scheduled send, ns; leg 0 cut off half way)\n"
+             << left << setw(12) << "stream" << right << setw(9) << "frames" << setw(8) << "won"
+             << setw(10) << "p50" << setw(10) << "p99" << setw(10) << "p99.9" << setw(12)
+             << "lag p50" << setw(12) << "lag p99" << "\n";
+        for (int leg = 0; leg < 2; leg++) {
+            const LatencySnapshot& h = rr.legLatency[leg];
+            cout << "leg " << leg << " +" << setw(4) << left << (int)jitterUs[leg] << "us" << right
+                 << setw(9) << rr.legFrames[leg] << setw(7) << setprecision(1)
+                 << (rr.legFrames[leg] ? 100.0 * rr.wins[leg] / rr.legFrames[leg] : 0.0) << "%"
+                 << setprecision(0) << setw(10) << h.percentile(0.50) << setw(10) << h.percentile(0.99)
+                 << setw(10) << h.percentile(0.999) << setw(12) << rr.lag[leg].percentile(0.50)
+                 << setw(12) << rr.lag[leg].percentile(0.99) << "\n";
+        }
+        const LatencySnapshot& h = rr.arbitrated;
+        cout << left << setw(12) << "arbitrated" << right << setw(9) << rr.applied << setw(8) << ""
+             << setw(10) << h.percentile(0.50) << setw(10) << h.percentile(0.99) << setw(10)
+             << h.percentile(0.999) << "\n";
+        if (rr.missing || rr.duplicates) {
+            cerr << "arbitration: " << rr.missing << " frames missing, " << rr.duplicates
+                 << " applied twice\n";
+            return 1;
+        }
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
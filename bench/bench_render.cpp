@@ -0,0 +1,116 @@
+// What the UI hands to ncurses per frame: a full repaint against the
+// back-buffered diff (screen_buffer.h).
+//
+//   ./bench_render [--frames 20000] [--rows 50] [--cols 160] [--changes 3]
+//
+// Each frame draws a book screen like the detail view's: a header, 20 asks
+// and 20 bids with size bars, and a symbol table, of which --changes levels
+// move per frame (a 100 ms diff typically touches a handful near the top).
+// The old path erased the screen and sent every string through its own
+// attron / mvprintw / attroff; the new one sends one attrset + mvaddnstr
+// per changed run. Both are counted without a terminal; the ns/frame is
+// the back buffer's own cost (clear, put, flush).
+
+#include <iostream>
+#include <iomanip>
+#include <chrono>
+#include <random>
+#include <string>
+#include <cstdio>
+#include "../screen_buffer.h"
+
+using namespace std;
+
+struct Level {
+    long long price;
+    long long qty;
+};
+
+int main(int argc, char** argv) {
+    int frames = 20000, rows = 50, cols = 160, changes = 3;
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--frames" && hasValue)  frames = max(1, atoi(argv[++i]));
+        else if (arg == "--rows" && hasValue)    rows = max(48, atoi(argv[++i]));
+        else if (arg == "--cols" && hasValue)    cols = max(80, atoi(argv[++i]));
+        else if (arg == "--changes" && hasValue) changes = max(0, atoi(argv[++i]));
+        else {
+            cerr << "usage: " << argv[0] << " [--frames <n>] [--rows <n>] [--cols <n>] [--changes <n>]\n";
+            return 1;
+        }
+    }
+
+    mt19937_64 rng(42);
+    Level asks[20], bids[20];
+    for (int i = 0; i < 20; i++) {
+        asks[i] = {6500001 + i, 1000 + (long long)(rng() % 50000)};
+        bids[i] = {6500000 - i, 1000 + (long long)(rng() % 50000)};
+    }
+    long long updates = 0;
+
+    ScreenBuffer screen;
+    screen.resize(rows, cols);
+    uint64_t putCalls = 0, putCells = 0;
+    char buf[160];
+    auto put = [&](int row, int col, uint8_t attr, const char* s, int n) {
+        screen.put(row, col, attr, s, n);
+        putCalls++;
+        putCells += n;
+    };
+    auto drawFrame = [&]() {
+        screen.clear();
+        int n = snprintf(buf, sizeof(buf), "BTCUSDT  mid %.2f  spread %.2f  updates %lld",
+                         (asks[0].price + bids[0].price) / 200.0, (asks[0].price - bids[0].price) / 100.0,
+                         updates);
+        put(0, 0, 1 | SCREEN_BOLD, buf, n);
+        for (int i = 0; i < 20; i++) {
+            const Level* side[2] = {&asks[19 - i], &bids[i]};
+            for (int s = 0; s < 2; s++) {
+                int row = 2 + i + s * 21;
+                n = snprintf(buf, sizeof(buf), "%10.2f %12.5f ", side[s]->price / 100.0, side[s]->qty / 1e5);
+                put(row, 0, (uint8_t)(2 + s), buf, n);
+                string bar((size_t)(side[s]->qty * 40 / 51000), '#');
+                put(row, n, (uint8_t)(2 + s), bar.data(), (int)bar.size());
+            }
+        }
+        for (int i = 0; i < 8; i++) {
+            n = snprintf(buf, sizeof(buf), "  SYM%-6d %12.2f %9.2f %9lld", i, 1000.0 + i, 0.01,
+                         updates / (i + 1));
+            put(1 + i, 72, 4, buf, n);
+        }
+    };
+
+    ScreenFlushStats total;
+    uint64_t fullCalls = 0, fullCells = 0;
+    auto sink = [](int, int, uint8_t, const char*, size_t) {};
+    auto t0 = chrono::steady_clock::now();
+    for (int f = 0; f < frames; f++) {
+        for (int c = 0; c < changes; c++) {
+            Level* side = rng() & 1 ? asks : bids;
+            side[rng() % 5].qty = 1000 + (long long)(rng() % 50000);
+        }
+        updates += changes;
+        putCalls = putCells = 0;
+        drawFrame();
+        ScreenFlushStats st = screen.flush(sink);
+        total.cells += st.cells;
+        total.runs  += st.runs;
+        fullCalls   += putCalls;
+        fullCells   += putCells;
+    }
+    double ns = chrono::duration<double, nano>(chrono::steady_clock::now() - t0).count() / frames;
+
+    // a run is a cursor move and an attribute switch; the old path also
+    // switched the attribute back after every string and erased the screen
+    cout << frames << " frames of " << rows << "x" << cols << ", " << changes << " levels changed each\n\n"
+         << left << setw(14) << "" << right << setw(12) << "calls/frame" << setw(13) << "cells/frame"
+         << setw(12) << "attr/frame" << "\n"
+         << fixed << setprecision(1)
+         << left << setw(14) << "full repaint" << right << setw(12) << (double)fullCalls / frames
+         << setw(13) << (double)fullCells / frames << setw(12) << 2.0 * fullCalls / frames << "\n"
+         << left << setw(14) << "diff" << right << setw(12) << (double)total.runs / frames
+         << setw(13) << (double)total.cells / frames << setw(12) << (double)total.runs / frames << "\n\n"
+         << "back buffer: " << setprecision(0) << ns << " ns/frame (clear, put, flush)\n";
+    return 0;
+}
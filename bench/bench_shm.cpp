@@ -0,0 +1,222 @@
+// Shared-memory book publication: what it costs the engine, and what a
+// reader in another process sees.
+//
+//   ./bench_shm [--messages 20000] [--updates 200000] [--rate 50000]
+//   ./bench_shm --attach /pulse_book [--symbol BTCUSDT]
+//
+// writer     the synthetic feed through the engine (parse, apply,
+//            analytics), timing makeShmBook + ShmBookWriter::publish
+//            against the rest of the pipeline per message
+// read       ShmBookReader::read of an idle slot, one consistent copy
+// visible    a forked reader process polls the slot's version while this
+//            process publishes --updates books at --rate; each is timed
+//            from the cycle stamp taken just before publish to the end
+//            of the reader's copy, with the retries the seqlock needed
+//
+// --attach reads a running `orderbook --shm <name>` instead and prints the
+// top of the book ten times a second: the reader library in ~20 lines.
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <sys/wait.h>
+#include "../book_engine.h"
+#include "../shm_book.h"
+#include "../cycle_clock.h"
+#include "../latency_histogram.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+void printRow(const char* name, const LatencySnapshot& h, const string& extra = "") {
+    cout << left << setw(9) << name << right << setw(10) << h.count << setw(9)
+         << h.percentile(0.50) << setw(9) << h.percentile(0.99) << setw(10) << h.percentile(0.999)
+         << setw(11) << h.maxNs << "  " << extra << "\n";
+}
+
+int attach(const string& name, const string& symbol) {
+    ShmBookReader shm(name);
+    int i = shm.find(symbol);
+    if (i < 0) {
+        cerr << symbol << " is not in " << name << "\n";
+        return 1;
+    }
+    uint64_t seen = 0;
+    ShmBook b;
+    while (shm.state() != SHM_CLOSED) {
+        if (shm.version(i) != seen && shm.read(i, b)) {
+            seen = shm.version(i);
+            cout << b.symbol << "  #" << b.updateCount << "  bid " << fixedToDouble(b.bestBid, b.priceDecimals)
+                 << " x " << fixedToDouble(b.bids[0].qty, b.qtyDecimals) << "  ask "
+                 << fixedToDouble(b.bestAsk, b.priceDecimals) << " x "
+                 << fixedToDouble(b.asks[0].qty, b.qtyDecimals) << "  imb " << setprecision(3)
+                 << b.imbalance << "  aggr " << b.aggressionRatio << (b.synced ? "" : "  (syncing)")
+                 << "\n";
+        }
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+    return 0;
+}
+
+int main(int argc, char** argv) {
+    int    messages = 20000, updates = 200000;
+    double rate = 50000;
+    string attachName, symbol = "BTCUSDT";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue) messages = max(1, atoi(argv[++i]));
+        else if (arg == "--updates" && hasValue)  updates = max(1, atoi(argv[++i]));
+        else if (arg == "--rate" && hasValue)     rate = max(1.0, atof(argv[++i]));
+        else if (arg == "--attach" && hasValue)   attachName = argv[++i];
+        else if (arg == "--symbol" && hasValue)   symbol = argv[++i];
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--updates <n>] [--rate <per sec>]\n"
+                 << "       " << argv[0] << " --attach <name> [--symbol <SYMBOL>]\n";
+            return 1;
+        }
+    }
+
+    try {
+        if (!attachName.empty()) return attach(attachName, symbol);
+
+        CycleClock clock = CycleClock::calibrate();
+        string name = "/pulse_bench_" + to_string(getpid());
+        ShmBookWriter writer(name, 1);
+        InstrumentSpec spec = parseInstrumentSpec(symbol);
+
+        // ---- writer overhead on the engine path ----
+        unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+        BookEventRing events(4096);
+        in->events = &events;
+        SyntheticFeed feed(defaultFeedProfile());
+        SyntheticMessage m;
+        vector<char> json;
+        uint64_t engineCycles = 0, shmCycles = 0;
+        LatencyHistogram publishHist;
+        for (int i = 0; i < messages; i++) {
+            feed.next(m);
+            json.resize(SyntheticFeed::maxJsonBytes(m));
+            size_t len = feed.toJson(m, json.data(), spec.priceDecimals, spec.qtyDecimals, spec.symbol.c_str());
+
+            uint64_t t0 = cycleNow();
+            DepthMessage msg;
+            if (!parseDepthMessage(json.data(), len, msg)) throw runtime_error("synthetic frame did not parse");
+            int n = applyLevels(*in, msg.bids, msg.asks);
+            updateToxicityWindow(*in);
+            updateAnalytics(*in, 0.0, n);
+            uint64_t t1 = cycleNow();
+            ShmBook b = {};
+            makeShmBook(*in, in->view.back(), b);
+            writer.publish(0, b);
+            uint64_t t2 = cycleNow();
+            engineCycles += t1 - t0;
+            shmCycles    += t2 - t1;
+            publishHist.record(clock.elapsedNs(t1, t2));
+        }
+        writer.setLive();
+
+        cout << "segment " << name << ": " << shmSegmentBytes(1) << " bytes for 1 book, "
+             << sizeof(ShmBook) << "-byte snapshots (" << SHM_LEVELS << " levels a side)\n\n"
+             << left << setw(9) << "" << right << setw(10) << "count" << setw(9) << "p50 ns"
+             << setw(9) << "p99 ns" << setw(10) << "p99.9 ns" << setw(11) << "max ns" << "\n";
+
+        LatencySnapshot ps;
+        ps.add(publishHist);
+        char extra[128];
+        snprintf(extra, sizeof(extra), "%.0f ns/msg on top of %.0f ns/msg engine (+%.1f%%)",
+                 clock.toNs(shmCycles) / messages, clock.toNs(engineCycles) / messages,
+                 100.0 * shmCycles / engineCycles);
+        printRow("writer", ps, extra);
+
+        // ---- uncontended reads ----
+        ShmBookReader reader(name);
+        LatencyHistogram readHist;
+        ShmBook copy;
+        uint64_t sink = 0;
+        for (int i = 0; i < 100000; i++) {
+            uint64_t t0 = cycleNow();
+            reader.read(0, copy);
+            uint64_t t1 = cycleNow();
+            readHist.record(clock.elapsedNs(t0, t1));
+            sink += copy.bestBid;
+        }
+        LatencySnapshot rs;
+        rs.add(readHist);
+        printRow("read", rs, "idle slot, includes two cycle-counter reads");
+
+        // ---- publish -> visible in another process ----
+        int fds[2];
+        if (pipe(fds) != 0) throw runtime_error("pipe failed");
+        bool oneCore = thread::hardware_concurrency() <= 1;
+        pid_t child = fork();
+        if (child == 0) {
+            close(fds[0]);
+            ShmBookReader shm(name);
+            LatencyHistogram visible;
+            uint64_t seen = shm.version(0), retries = 0, seenUpdates = 0;
+            ShmBook b;
+            while (true) {
+                uint64_t v = shm.version(0);
+                if (v == seen) {
+                    if (shm.state() == SHM_CLOSED) break;
+                    if (oneCore) this_thread::yield();
+                    continue;
+                }
+                int r = 0;
+                if (!shm.read(0, b, 1000, &r)) continue;
+                uint64_t now = cycleNow();
+                seen = shm.version(0);
+                retries += r;
+                if (b.updateCount == 0) break;   // end marker
+                visible.record(clock.elapsedNs(b.publishCycles, now));
+                seenUpdates++;
+            }
+            LatencySnapshot s;
+            s.add(visible);
+            ssize_t w = write(fds[1], &s, sizeof(s));
+            w += write(fds[1], &retries, sizeof(retries));
+            w += write(fds[1], &seenUpdates, sizeof(seenUpdates));
+            _exit(w > 0 ? 0 : 1);
+        }
+        close(fds[1]);
+
+        this_thread::sleep_for(chrono::milliseconds(100));   // let the reader attach
+        ShmBook b = {};
+        makeShmBook(*in, in->view.back(), b);
+        uint64_t gap = (uint64_t)(clock.hz / rate), due = cycleNow();
+        for (int i = 1; i <= updates; i++) {
+            while (cycleNow() < due) {
+                if (oneCore) this_thread::yield();
+            }
+            due += gap;
+            b.updateCount   = (uint64_t)i;
+            b.publishCycles = cycleNow();
+            writer.publish(0, b);
+        }
+        this_thread::sleep_for(chrono::milliseconds(50));
+        b.updateCount = 0;
+        writer.publish(0, b);
+
+        LatencySnapshot vs;
+        uint64_t retries = 0, seenUpdates = 0;
+        bool ok = read(fds[0], &vs, sizeof(vs)) == (ssize_t)sizeof(vs) &&
+                  read(fds[0], &retries, sizeof(retries)) == (ssize_t)sizeof(retries) &&
+                  read(fds[0], &seenUpdates, sizeof(seenUpdates)) == (ssize_t)sizeof(seenUpdates);
+        int status = 0;
+        waitpid(child, &status, 0);
+        if (!ok) throw runtime_error("reader process failed");
+        snprintf(extra, sizeof(extra), "%llu of %d updates seen (rest conflated), %llu seqlock retries%s",
+                 (unsigned long long)seenUpdates, updates, (unsigned long long)retries,
+                 oneCore ? " (1 CPU: reader yields)" : "");
+        printRow("visible", vs, extra);
+        if (sink == 42) cout << "\n";
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,230 @@
+// The metric store (metric_store.h) against the CSV it sits beside: file
+// size, append cost, and the time to answer the same question from each.
+//
+//   ./bench_store [--messages 5000] [--rows 200000] [--dir /tmp]
+//
+// The synthetic feed runs through the engine once; its telemetry rows are
+// then repeated, later in time, up to --rows and written both as CSV (as
+// --csv does) and to a store (as --store does). The query is the mid's
+// mean, min and max, imbalance p1/p50/p99 and wall event counts over the
+// middle half of the time range:
+//   csv     read the file and parse the three columns it needs
+//   store   queryStore over the mapped file, which also works out the VWAP
+// The two answers are compared.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <memory>
+#include <chrono>
+#include <cstdio>
+#include <algorithm>
+#include "../book_engine.h"
+#include "../store_query.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+struct CsvAnswer {
+    uint64_t rows = 0;
+    double   midSum = 0.0, midMin = INFINITY, midMax = -INFINITY;
+    vector<double> imbalance;
+    uint64_t wallEvents = 0;
+};
+
+// The fields of one line, split at commas in place.
+int splitCsv(char* line, char** fields, int max) {
+    int n = 0;
+    fields[n++] = line;
+    for (char* p = line; *p && n < max; p++)
+        if (*p == ',') {
+            *p = 0;
+            fields[n++] = p + 1;
+        }
+    return n;
+}
+
+CsvAnswer queryCsv(const string& path, int64_t fromMs, int64_t toMs) {
+    ifstream in(path);
+    string header, line;
+    getline(in, header);
+    vector<char> buf(header.begin(), header.end());
+    buf.push_back(0);
+    char* names[128];
+    int numNames = splitCsv(buf.data(), names, 128);
+    int cMid = -1, cImb = -1, cEvent = -1;
+    for (int i = 0; i < numNames; i++) {
+        string n = names[i];
+        if (n == "mid_price") cMid = i;
+        if (n == "imbalance") cImb = i;
+        if (n == "wall_event") cEvent = i;
+    }
+    if (cMid < 0 || cImb < 0 || cEvent < 0) throw runtime_error("unexpected CSV header");
+
+    CsvAnswer a;
+    string lastEvent;
+    char* f[128];
+    while (getline(in, line)) {
+        int n = splitCsv(&line[0], f, 128);
+        if (n < numNames) continue;
+        int64_t ts = atoll(f[0]);
+        if (ts < fromMs || ts >= toMs) continue;
+        double mid = strtod(f[cMid], nullptr);
+        a.rows++;
+        a.midSum += mid;
+        a.midMin = min(a.midMin, mid);
+        a.midMax = max(a.midMax, mid);
+        a.imbalance.push_back(strtod(f[cImb], nullptr));
+        // the CSV has the event's text only: count changes of it
+        if (*f[cEvent] && lastEvent != f[cEvent]) a.wallEvents++;
+        lastEvent = f[cEvent];
+    }
+    return a;
+}
+
+double percentile(vector<double>& v, double q) {
+    if (v.empty()) return NAN;
+    size_t k = (size_t)max(1.0, ceil(q * v.size())) - 1;
+    nth_element(v.begin(), v.begin() + k, v.end());
+    return v[k];
+}
+
+int main(int argc, char** argv) {
+    int    messages = 5000, rows = 200000;
+    string dir = "/tmp";
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue) messages = max(1, atoi(argv[++i]));
+        else if (arg == "--rows" && hasValue)     rows = max(1, atoi(argv[++i]));
+        else if (arg == "--dir" && hasValue)      dir = argv[++i];
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--rows <n>] [--dir <path>]\n";
+            return 1;
+        }
+    }
+    string csvPath   = dir + "/pulse_bench_" + to_string(getpid()) + ".csv";
+    string storePath = dir + "/pulse_bench_" + to_string(getpid()) + ".store";
+
+    try {
+        InstrumentSpec spec = parseInstrumentSpec("BTCUSDT");
+        syncEnabled = false;
+
+        // one pass of the feed through the engine
+        unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+        BookEventRing events(4096);
+        in->events = &events;
+        SyntheticFeed feed(defaultFeedProfile());
+        SyntheticMessage m;
+        vector<char> json;
+        vector<TelemetryRow> tape;
+        for (int i = 0; i < messages; i++) {
+            feed.next(m);
+            json.resize(SyntheticFeed::maxJsonBytes(m));
+            size_t len = feed.toJson(m, json.data(), spec.priceDecimals, spec.qtyDecimals, spec.symbol.c_str());
+            DepthMessage msg;
+            if (!parseDepthMessage(json.data(), len, msg)) throw runtime_error("synthetic frame did not parse");
+            in->eventTimeMs = msg.eventTime;
+            int n = applyLevels(*in, msg.bids, msg.asks);
+            updateToxicityWindow(*in);
+            updateAnalytics(*in, 0.0, n);
+            const BookView& v = in->view.back();
+            if (v.bestBid != NO_PRICE && v.bestAsk != NO_PRICE) {
+                tape.emplace_back();
+                makeTelemetryRow(v, tape.back());
+                tape.back().instrument  = 0;
+                tape.back().timestampMs = msg.eventTime;
+            }
+        }
+        if (tape.empty()) throw runtime_error("the feed built no two-sided book");
+        int64_t span = tape.back().timestampMs - tape.front().timestampMs + 100;
+
+        // the same rows as CSV and as a store
+        vector<StoreColumn> columns = storeColumns();
+        vector<StoreValue>  values(columns.size());
+        vector<char>        line(CSV_MAX_LINE);
+        remove(storePath.c_str());
+        double storeNs = 0.0, csvNs = 0.0;
+        int64_t firstMs = 0, lastMs = 0;
+        {
+            ofstream csv(csvPath);
+            csv << csvHeader();
+            MetricStoreWriter store(storePath, columns);
+            for (int i = 0; i < rows; i++) {
+                TelemetryRow r = tape[i % tape.size()];
+                r.timestampMs += span * (int64_t)(i / tape.size());
+                r.updateCount  = i + 1;
+                if (i == 0) firstMs = r.timestampMs;
+                lastMs = r.timestampMs;
+
+                auto t0 = chrono::steady_clock::now();
+                size_t len = formatTelemetryRow(line.data(), r, spec);
+                csv.write(line.data(), (streamsize)len);
+                auto t1 = chrono::steady_clock::now();
+                makeStoreRow(r, values.data());
+                store.append(0, spec.symbol.c_str(), spec.priceDecimals, spec.qtyDecimals, values.data());
+                auto t2 = chrono::steady_clock::now();
+                csvNs   += chrono::duration<double, nano>(t1 - t0).count();
+                storeNs += chrono::duration<double, nano>(t2 - t1).count();
+            }
+        }
+
+        QueryOptions q;
+        q.fromMs = firstMs + (lastMs - firstMs) / 4;
+        q.toMs   = lastMs - (lastMs - firstMs) / 4;
+
+        auto t0 = chrono::steady_clock::now();
+        CsvAnswer a = queryCsv(csvPath, q.fromMs, q.toMs);
+        double p[3] = {percentile(a.imbalance, 0.01), percentile(a.imbalance, 0.50),
+                       percentile(a.imbalance, 0.99)};
+        auto t1 = chrono::steady_clock::now();
+        vector<SymbolSummary> symbols;
+        QueryStats st;
+        {
+            MetricStoreReader r(storePath);
+            queryStore(r, q, symbols, st);
+        }
+        auto t2 = chrono::steady_clock::now();
+        double csvMs   = chrono::duration<double, milli>(t1 - t0).count();
+        double storeMs = chrono::duration<double, milli>(t2 - t1).count();
+
+        // the CSV prints the mid to whole ticks, the store keeps the half tick
+        const SymbolSummary& s = symbols.at(0);
+        double tick = pow(10.0, -s.priceDecimals) * 1.001;
+        bool same = s.rows == a.rows && fabs(s.midMin - a.midMin) < tick && fabs(s.midMax - a.midMax) < tick &&
+                    fabs(s.midMean() - a.midSum / a.rows) < tick;
+        for (int i = 0; i < 3; i++)
+            same = same && fabs(s.imbalancePercentile(i == 0 ? 0.01 : i == 1 ? 0.50 : 0.99) - p[i]) < 1.5e-4;
+        uint64_t storeEvents = 0;
+        for (int e = 0; e < NUM_EVENT_TYPES; e++) storeEvents += s.wallEvents[e];
+        same = same && storeEvents == a.wallEvents;
+
+        ifstream csvFile(csvPath, ios::ate | ios::binary), storeFile(storePath, ios::ate | ios::binary);
+        double csvMb = csvFile.tellg() / 1048576.0, storeMb = storeFile.tellg() / 1048576.0;
+        remove(csvPath.c_str());
+        remove(storePath.c_str());
+
+        cout << rows << " rows (" << tape.size() << " from the engine, repeated), " << columns.size()
+             << " columns\n\n"
+             << fixed << setprecision(2) << left << setw(7) << "" << right << setw(10) << "MB"
+             << setw(12) << "append ns" << setw(12) << "query ms" << setw(12) << "Mrows/s\n"
+             << left << setw(7) << "csv" << right << setw(10) << csvMb << setw(12) << setprecision(0)
+             << csvNs / rows << setw(12) << setprecision(2) << csvMs << setw(11) << a.rows / csvMs / 1000.0
+             << "\n"
+             << left << setw(7) << "store" << right << setw(10) << storeMb << setw(12) << setprecision(0)
+             << storeNs / rows << setw(12) << setprecision(2) << storeMs << setw(11)
+             << st.rowsScanned / storeMs / 1000.0 << "\n\n"
+             << setprecision(1) << csvMb / storeMb << "x smaller, query " << csvMs / storeMs << "x faster; "
+             << st.blocksSkipped << " of " << st.blocks << " blocks skipped on their time index, "
+             << st.bytesDecoded / 1024 << " KB decoded\n"
+             << "mid VWAP " << setprecision(s.priceDecimals + 1) << s.vwap() << ", answers "
+             << (same ? "match the CSV" : "MISMATCH") << "\n";
+        return same ? 0 : 1;
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        remove(csvPath.c_str());
+        remove(storePath.c_str());
+        return 1;
+    }
+}
@@ -0,0 +1,187 @@
+// The UDP broadcast (udp_feed.h, --udp): frame sizes and encoding cost,
+// what posting costs the engine, and a publisher and receiver over
+// loopback with datagrams dropped on purpose.
+//
+//   ./bench_udp [--messages 20000] [--rate 20000] [--interval 5] [--full 50]
+//               [--drop 7] [--port 19100]
+//
+// encode     the synthetic feed through the engine; per message, makeUdpBook
+//            plus a FULL frame, a DELTA against the previous message, and a
+//            DELTA against the message --conflate (10) back, as conflation
+//            sends; bytes and ns per frame
+// post       UdpPublisher::post, what --udp adds to each engine update
+// loopback   the same books posted at --rate to a publisher sending to
+//            127.0.0.1:--port every --interval ms, with a FULL frame every
+//            --full ms and every --drop-th datagram left unsent. A receiver
+//            thread rebuilds the book. close() sends a last FULL frame, so
+//            the receiver's book must then equal the last one posted and
+//            its loss count the publisher's drops exactly.
+
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include "../book_engine.h"
+#include "../udp_feed.h"
+#include "../cycle_clock.h"
+#include "synthetic_feed.h"
+
+using namespace std;
+
+bool sameFields(const UdpBook& a, const UdpBook& b) {
+    int64_t fa[UDP_FIELDS], fb[UDP_FIELDS];
+    udpToFields(a, fa);
+    udpToFields(b, fb);
+    return memcmp(fa, fb, sizeof(fa)) == 0 && strcmp(a.symbol, b.symbol) == 0 &&
+           a.priceDecimals == b.priceDecimals && a.qtyDecimals == b.qtyDecimals;
+}
+
+int main(int argc, char** argv) {
+    int    messages = 20000, intervalMs = 5, fullMs = 50, dropEvery = 7, port = 19100, conflate = 10;
+    double rate = 20000;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--messages" && hasValue) messages = max(1, atoi(argv[++i]));
+        else if (arg == "--rate" && hasValue)     rate = max(1.0, atof(argv[++i]));
+        else if (arg == "--interval" && hasValue) intervalMs = max(1, atoi(argv[++i]));
+        else if (arg == "--full" && hasValue)     fullMs = max(1, atoi(argv[++i]));
+        else if (arg == "--drop" && hasValue)     dropEvery = max(0, atoi(argv[++i]));
+        else if (arg == "--port" && hasValue)     port = atoi(argv[++i]);
+        else if (arg == "--conflate" && hasValue) conflate = max(1, atoi(argv[++i]));
+        else {
+            cerr << "usage: " << argv[0] << " [--messages <n>] [--rate <per sec>] [--interval <ms>]\n"
+                 << "           [--full <ms>] [--drop <n>] [--port <n>] [--conflate <n>]\n";
+            return 1;
+        }
+    }
+
+    try {
+        CycleClock clock = CycleClock::calibrate();
+        InstrumentSpec spec = parseInstrumentSpec("BTCUSDT");
+        syncEnabled = false;
+
+        // ---- frames from the engine's books ----
+        unique_ptr<Instrument> in(new Instrument(spec, 0, 1 << 16));
+        BookEventRing events(4096);
+        in->events = &events;
+        SyntheticFeed feed(defaultFeedProfile());
+        SyntheticMessage m;
+        vector<char> json;
+        vector<UdpBook> books;
+        books.reserve(messages);
+        uint64_t engineCycles = 0, makeCycles = 0, fullCycles = 0, deltaCycles = 0;
+        uint64_t fullBytes = 0, deltaBytes = 0, conflatedBytes = 0, deltas = 0, unchanged = 0, conflated = 0;
+        UdpEncoder everyFull(1, 1), everyDelta(1, 1), everyKth(1, 1);
+        uint8_t frame[UDP_MAX_FRAME];
+        for (int i = 0; i < messages; i++) {
+            feed.next(m);
+            json.resize(SyntheticFeed::maxJsonBytes(m));
+            size_t len = feed.toJson(m, json.data(), spec.priceDecimals, spec.qtyDecimals, spec.symbol.c_str());
+
+            uint64_t t0 = cycleNow();
+            DepthMessage msg;
+            if (!parseDepthMessage(json.data(), len, msg)) throw runtime_error("synthetic frame did not parse");
+            in->eventTimeMs = msg.eventTime;
+            int n = applyLevels(*in, msg.bids, msg.asks);
+            updateToxicityWindow(*in);
+            updateAnalytics(*in, 0.0, n);
+            uint64_t t1 = cycleNow();
+            books.emplace_back();
+            UdpBook& b = books.back();
+            memset(&b, 0, sizeof(b));
+            makeUdpBook(*in, in->view.back(), b);
+            uint64_t t2 = cycleNow();
+            fullBytes += everyFull.encode(0, b, true, frame);
+            uint64_t t3 = cycleNow();
+            size_t d = everyDelta.encode(0, b, i == 0, frame);
+            uint64_t t4 = cycleNow();
+            if (i > 0) {
+                deltaBytes += d;
+                deltas += d > 0;
+                unchanged += d == 0;
+                deltaCycles += t4 - t3;
+            }
+            if (i % conflate == 0) {
+                size_t c = everyKth.encode(0, b, i == 0, frame);
+                if (i > 0 && c) {
+                    conflatedBytes += c;
+                    conflated++;
+                }
+            }
+            engineCycles += t1 - t0;
+            makeCycles   += t2 - t1;
+            fullCycles   += t3 - t2;
+        }
+
+        cout << sizeof(UdpBook) << "-byte books, " << UDP_LEVELS << " levels a side, " << UDP_FIELDS
+             << " fields; " << messages << " engine updates\n\n"
+             << fixed << setprecision(1) << left << setw(22) << "" << right << setw(10) << "bytes"
+             << setw(10) << "ns\n"
+             << left << setw(22) << "makeUdpBook" << right << setw(10) << "" << setw(9)
+             << clock.toNs(makeCycles) / messages << "\n"
+             << left << setw(22) << "full" << right << setw(10) << (double)fullBytes / messages << setw(9)
+             << clock.toNs(fullCycles) / messages << "\n"
+             << left << setw(22) << "delta, every update" << right << setw(10)
+             << (deltas ? (double)deltaBytes / deltas : 0.0) << setw(9)
+             << clock.toNs(deltaCycles) / max(1, messages - 1) << "   " << unchanged << " unchanged, not sent\n"
+             << left << setw(22) << ("delta, every " + to_string(conflate) + "th") << right << setw(10)
+             << (conflated ? (double)conflatedBytes / conflated : 0.0) << "\n"
+             << left << setw(22) << "engine update" << right << setw(10) << "" << setw(9)
+             << clock.toNs(engineCycles) / messages << "\n\n";
+
+        // ---- loopback ----
+        UdpReceiver rx(to_string(port));
+        UdpOptions opts;
+        opts.destination = "127.0.0.1:" + to_string(port);
+        opts.intervalMs  = intervalMs;
+        opts.fullEveryMs = fullMs;
+        opts.dropEvery   = dropEvery;
+        UdpPublisher pub(opts, 1);
+
+        atomic<bool> stop{false};
+        thread receiver([&rx, &stop] {
+            while (!stop.load(memory_order_acquire)) rx.poll(20);
+        });
+
+        bool oneCore = thread::hardware_concurrency() <= 1;
+        uint64_t gap = (uint64_t)(clock.hz / rate), due = cycleNow(), postCycles = 0;
+        auto start = chrono::steady_clock::now();
+        for (const UdpBook& b : books) {
+            while (cycleNow() < due) {
+                if (oneCore) this_thread::yield();
+            }
+            due += gap;
+            uint64_t t0 = cycleNow();
+            pub.post(0, b);
+            postCycles += cycleNow() - t0;
+        }
+        double postSecs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        // close() sends the FULL frame that repairs whatever the drops broke
+        pub.close();
+        this_thread::sleep_for(chrono::milliseconds(50));
+        stop.store(true, memory_order_release);
+        receiver.join();
+
+        const UdpStats& ps = pub.stats();
+        const UdpReceiveStats& rs = rx.stats();
+        uint64_t sent = ps.frames.load(), dropped = ps.dropped.load();
+        bool same = rx.has(0) && sameFields(rx.book(0), books.back());
+        cout << "post " << setprecision(1) << clock.toNs(postCycles) / messages << " ns per update on the worker\n"
+             << "loopback: " << messages << " updates in " << setprecision(2) << postSecs << " s -> "
+             << sent << " frames (" << ps.fullFrames.load() << " full), " << setprecision(1)
+             << ps.bytes.load() / 1024.0 << " KB, " << setprecision(1) << (double)messages / max<uint64_t>(1, sent)
+             << " updates per frame\n"
+             << "receiver: " << rs.datagrams << " frames, " << rs.fullFrames << " full, " << rs.deltaFrames
+             << " deltas applied, " << rs.lost << " lost (" << dropped << " dropped on purpose), " << rs.skipped
+             << " deltas skipped until a full frame, " << rs.late << " late, " << rs.malformed
+             << " malformed\n"
+             << "final book " << (same ? "matches the source" : "MISMATCH") << "\n";
+        return same && rs.lost == dropped && rs.malformed == 0 ? 0 : 1;
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,196 @@
+#pragma once
+
+// Synthetic depthUpdate stream shaped like the real feed, for benchmarks
+// that should not depend on having a journal at hand.
+//
+// The shape comes from a FeedProfile, which calibrateFromCsv() fits to a
+// pulse_data.csv written by the engine:
+//
+//   batch sizes   sampled from the num_updates column (20 to 1,500 levels,
+//                 median ~130 in the checked-in file)
+//   mid drift     sampled from consecutive mid_price differences
+//   far levels    exponential in distance from the mid, with the mean of
+//                 the nearest-wall distances (~7,600 ticks)
+//
+// The CSV cannot show how updates cluster at the touch or how many are
+// deletions, so those stay at the fixed assumptions in FeedProfile. Output
+// is deterministic for a given seed.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <random>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include "../fixed_point.h"
+
+struct FeedProfile {
+    std::vector<int>     batchSizes;     // levels per message
+    std::vector<int64_t> midMoves;       // ticks per message
+    double  nearFraction  = 0.6;         // updates within nearTicks of the mid
+    int64_t nearTicks     = 200;
+    double  farMeanTicks  = 7600;
+    double  deleteFraction = 0.35;       // qty 0
+    double  wallFraction  = 0.002;       // qty at or above wallLots
+    int64_t wallLots      = 5 * 100000;
+    int64_t startMid      = 6900000;     // ticks
+    std::string source    = "built-in";
+};
+
+// Values fitted from the repository's pulse_data.csv, for when no CSV is
+// given or it cannot be read.
+inline FeedProfile defaultFeedProfile() {
+    FeedProfile p;
+    p.batchSizes = {20, 45, 80, 107, 130, 180, 250, 323, 481, 493, 700, 1100, 1573};
+    p.midMoves   = {-1724, -400, -120, -20, 0, 0, 0, 15, 110, 380, 2233};
+    return p;
+}
+
+// Fits batch sizes, mid drift and the far-level distance to a telemetry
+// CSV. Prices are read at priceDecimals. Throws if the file has no rows.
+inline FeedProfile calibrateFromCsv(const std::string& path, int priceDecimals = 2) {
+    std::ifstream in(path);
+    if (!in) throw std::runtime_error("cannot open " + path);
+
+    std::string line;
+    std::getline(in, line);
+    std::vector<std::string> header;
+    {
+        std::stringstream ss(line);
+        for (std::string col; std::getline(ss, col, ',');) header.push_back(col);
+    }
+    auto column = [&](const char* name) {
+        for (size_t i = 0; i < header.size(); i++)
+            if (header[i] == name) return (int)i;
+        throw std::runtime_error(path + " has no " + name + " column");
+    };
+    int colUpdates = column("num_updates");
+    int colMid     = column("mid_price");
+    int colAskWall = column("nearest_ask_wall_price");
+    int colBidWall = column("nearest_bid_wall_price");
+
+    auto toTicks = [&](const std::string& s) {
+        return (int64_t)llround(strtod(s.c_str(), nullptr) * (double)FIXED_POW10[priceDecimals]);
+    };
+
+    FeedProfile p;
+    p.source = path;
+    double  wallDistSum = 0;
+    int     wallDistN   = 0;
+    int64_t prevMid     = -1;
+    std::vector<std::string> f;
+    while (std::getline(in, line)) {
+        f.clear();
+        std::stringstream ss(line);
+        for (std::string col; std::getline(ss, col, ',');) f.push_back(col);
+        if ((int)f.size() <= colBidWall) continue;
+
+        int n = atoi(f[colUpdates].c_str());
+        if (n > 0) p.batchSizes.push_back(n);
+
+        int64_t mid = toTicks(f[colMid]);
+        if (prevMid >= 0) p.midMoves.push_back(mid - prevMid);
+        else              p.startMid = mid;
+        prevMid = mid;
+
+        for (int c : {colAskWall, colBidWall}) {
+            int64_t wall = toTicks(f[c]);
+            if (wall > 0) {
+                wallDistSum += (double)llabs(wall - mid);
+                wallDistN++;
+            }
+        }
+    }
+    if (p.batchSizes.empty()) throw std::runtime_error(path + " has no rows");
+    if (p.midMoves.empty()) p.midMoves.push_back(0);
+    if (wallDistN) p.farMeanTicks = wallDistSum / wallDistN;
+    p.nearTicks = std::max<int64_t>(10, (int64_t)(p.farMeanTicks / 40));
+    return p;
+}
+
+struct SyntheticLevel {
+    bool    isBid;
+    int64_t price;   // ticks
+    int64_t qty;     // lots
+};
+
+struct SyntheticMessage {
+    int64_t firstUpdateId;
+    int64_t finalUpdateId;
+    std::vector<SyntheticLevel> levels;
+};
+
+class SyntheticFeed {
+public:
+    SyntheticFeed(const FeedProfile& profile, uint64_t seed = 42)
+        : p_(profile), rng_(seed), far_(1.0 / profile.farMeanTicks), mid_(profile.startMid) {}
+
+    void next(SyntheticMessage& m) {
+        int n = p_.batchSizes[rng_() % p_.batchSizes.size()];
+        mid_ += p_.midMoves[rng_() % p_.midMoves.size()];
+        if (mid_ < 2 * p_.nearTicks) mid_ = 2 * p_.nearTicks;
+
+        m.firstUpdateId = nextId_;
+        m.finalUpdateId = nextId_ + n - 1;
+        nextId_ += n;
+        m.levels.resize(n);
+        for (auto& l : m.levels) {
+            l.isBid = rng_() & 1;
+            int64_t d = unit_(rng_) < p_.nearFraction
+                      ? 1 + (int64_t)(rng_() % p_.nearTicks)
+                      : 1 + (int64_t)far_(rng_);
+            l.price = l.isBid ? std::max<int64_t>(1, mid_ - d) : mid_ + d;
+            double r = unit_(rng_);
+            l.qty = r < p_.deleteFraction ? 0
+                  : r < p_.deleteFraction + p_.wallFraction
+                      ? p_.wallLots + (int64_t)(rng_() % p_.wallLots)
+                      : 1 + (int64_t)(rng_() % 200000);
+        }
+    }
+
+    // Renders m as the bare depthUpdate JSON the exchange sends; returns
+    // the length written to out, which must hold at least maxJsonBytes(m).
+    size_t toJson(const SyntheticMessage& m, char* out, int priceDecimals, int qtyDecimals,
+                  const char* symbol = "BTCUSDT") const {
+        char* p = out;
+        p += sprintf(p, "{\"e\":\"depthUpdate\",\"E\":%lld,\"s\":\"%s\",\"U\":%lld,\"u\":%lld,\"b\":[",
+                     (long long)(1700000000000LL + m.firstUpdateId), symbol,
+                     (long long)m.firstUpdateId, (long long)m.finalUpdateId);
+        p = side(m, true, p, priceDecimals, qtyDecimals);
+        p += sprintf(p, "],\"a\":[");
+        p = side(m, false, p, priceDecimals, qtyDecimals);
+        p += sprintf(p, "]}");
+        return p - out;
+    }
+
+    static size_t maxJsonBytes(const SyntheticMessage& m) { return 160 + m.levels.size() * 48; }
+
+private:
+    static char* side(const SyntheticMessage& m, bool isBid, char* p, int pd, int qd) {
+        bool first = true;
+        for (auto& l : m.levels) {
+            if (l.isBid != isBid) continue;
+            if (!first) *p++ = ',';
+            first = false;
+            *p++ = '['; *p++ = '"';
+            p += formatFixed(p, l.price, pd, pd);
+            *p++ = '"'; *p++ = ','; *p++ = '"';
+            p += formatFixed(p, l.qty, qd, qd);
+            *p++ = '"'; *p++ = ']';
+        }
+        return p;
+    }
+
+    FeedProfile                            p_;
+    std::mt19937_64                        rng_;
+    std::uniform_real_distribution<double> unit_{0.0, 1.0};
+    std::exponential_distribution<double>  far_;
+    int64_t                                mid_;
+    int64_t                                nextId_ = 1;
+};
@@ -0,0 +1,785 @@
+#include "book_engine.h"
+#include <cstring>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+#include <cstddef>
+#include <type_traits>
+
+using namespace std;
+
+bool syncEnabled = true;
+int  imbalanceBandsBps[MAX_BANDS] = {10, 50, 100};
+int  numImbalanceBands = 3;
+int  costToMoveBps     = 10;
+
+const char* const EVENT_TYPE_NAMES[NUM_EVENT_TYPES] = {
+    "wall_appeared", "wall_pulled", "wall_filled", "best", "spread", "gap"
+};
+
+// ===== RESET STATE ON RECONNECT =====
+void resetBook(Instrument& in) {
+    in.bidLadder.reset();
+    in.askLadder.reset();
+    in.bestBid = NO_PRICE;
+    in.bestAsk = NO_PRICE;
+    in.bidWalls.clear();
+    in.askWalls.clear();
+    in.numRecentWallEvents = 0;
+    in.lastBestBid = NO_PRICE;
+    in.lastBestAsk = NO_PRICE;
+    in.spreadWide  = false;
+    // the previous top belonged to the old book
+    in.signals.lastNumBids   = 0;
+    in.signals.lastNumAsks   = 0;
+    in.signals.lastMidTicks2 = 0;
+}
+
+void resetState(Instrument& in) {
+    resetBook(in);
+    in.aggressiveBuy.clear();
+    in.aggressiveSell.clear();
+    in.updateAggressiveBuy  = 0;
+    in.updateAggressiveSell = 0;
+    resetSignals(in.signals);
+}
+
+string formatPrice(const InstrumentSpec& s, Ticks ticks) {
+    char buf[24];
+    return string(buf, formatFixed(buf, ticks, s.priceDecimals, s.priceDecimals));
+}
+
+string formatQty(const InstrumentSpec& s, int64_t lots) {
+    char buf[24];
+    return string(buf, formatFixed(buf, lots, s.qtyDecimals, 2));
+}
+
+// ===== EVENTS =====
+void emitEvent(Instrument& in, BookEvent& e) {
+    e.instrument = in.id;
+    e.timeMs     = in.eventTimeMs;
+    if (in.events) in.events->publish(e);
+
+    if (WALL_EVENTS & eventBit(e.type)) {
+        if (in.numRecentWallEvents == WALL_EVENT_SLOTS) {
+            for (int i = 1; i < WALL_EVENT_SLOTS; i++) in.recentWallEvents[i - 1] = in.recentWallEvents[i];
+            in.numRecentWallEvents--;
+        }
+        in.recentWallEvents[in.numRecentWallEvents++] = e;
+    }
+}
+
+size_t formatEvent(char* out, const BookEvent& e, const InstrumentSpec& s) {
+    char a[24], b[24];
+    const char* side = e.isBid ? "BID" : "ASK";
+    int n = 0;
+    switch (e.type) {
+    case EVENT_WALL_APPEARED:
+        a[formatFixed(a, e.price, s.priceDecimals, s.priceDecimals)] = '\0';
+        b[formatFixed(b, e.qty, s.qtyDecimals, 2)] = '\0';
+        n = snprintf(out, EVENT_TEXT_CHARS, "[WALL APPEARED] %s $%s  %s %s", side, a, b, s.base.c_str());
+        break;
+    case EVENT_WALL_PULLED:
+    case EVENT_WALL_FILLED:
+        a[formatFixed(a, e.price, s.priceDecimals, s.priceDecimals)] = '\0';
+        b[formatFixed(b, e.qty, s.qtyDecimals, 2)] = '\0';
+        n = snprintf(out, EVENT_TEXT_CHARS, "[WALL GONE !!!] %s $%s  was %s %s%s", side, a, b,
+                     s.base.c_str(), e.type == EVENT_WALL_PULLED ? " << SPOOF?" : " (at touch)");
+        break;
+    case EVENT_BEST_CHANGE:
+        a[formatFixed(a, e.price, s.priceDecimals, s.priceDecimals)] = '\0';
+        b[formatFixed(b, e.price2, s.priceDecimals, s.priceDecimals)] = '\0';
+        n = snprintf(out, EVENT_TEXT_CHARS, "[BEST] %s $%s / $%s", s.symbol.c_str(), a, b);
+        break;
+    case EVENT_SPREAD_WIDE:
+        a[formatFixed(a, e.price, s.priceDecimals, s.priceDecimals)] = '\0';
+        b[formatFixed(b, e.price2, s.priceDecimals, s.priceDecimals)] = '\0';
+        n = snprintf(out, EVENT_TEXT_CHARS, "[SPREAD WIDE] %s $%s vs avg $%s", s.symbol.c_str(), a, b);
+        break;
+    case EVENT_GAP:
+        n = snprintf(out, EVENT_TEXT_CHARS, "[GAP] %s after id %lld got %lld, resyncing",
+                     s.symbol.c_str(), (long long)e.value, (long long)e.price2);
+        break;
+    default:
+        out[0] = '\0';
+    }
+    return n < 0 ? 0 : min((size_t)n, (size_t)EVENT_TEXT_CHARS - 1);
+}
+
+// ===== APPLY =====
+// What differs between the sides of the book, resolved at compile time.
+struct BidSide {
+    static PriceLadder& ladder(Instrument& in) { return in.bidLadder; }
+    static WallIndex&   walls(Instrument& in)  { return in.bidWalls; }
+    static Ticks&       best(Instrument& in)   { return in.bestBid; }
+    // a bid that shrinks was sold into
+    static int64_t&     taken(Instrument& in)  { return in.updateAggressiveSell; }
+    static constexpr bool isBid = true;
+};
+
+struct AskSide {
+    static PriceLadder& ladder(Instrument& in) { return in.askLadder; }
+    static WallIndex&   walls(Instrument& in)  { return in.askWalls; }
+    static Ticks&       best(Instrument& in)   { return in.bestAsk; }
+    static int64_t&     taken(Instrument& in)  { return in.updateAggressiveBuy; }
+    static constexpr bool isBid = false;
+};
+
+template <class Side>
+static void updateSide(Instrument& in, Ticks price, Lots qty) {
+    PriceLadder& ladder = Side::ladder(in);
+    WallIndex&   walls  = Side::walls(in);
+    Ticks&       best   = Side::best(in);
+    const Lots   wall   = in.spec.wallThreshold;
+
+    Lots prevQty = ladder.set(price, qty);
+    int64_t nowMs = in.eventTimeMs;
+
+    // NO_PRICE is -1, so as unsigned it is worse than any ask
+    bool better;
+    if constexpr (Side::isBid) better = price > best;
+    else                       better = (uint64_t)price < (uint64_t)best;
+    best = qty > 0 && better ? price : best;
+
+    Side::taken(in) += prevQty > qty ? prevQty - qty : 0;
+
+    if (qty >= wall && prevQty >= wall)
+        walls.resize(price, qty, nowMs);
+
+    if (qty >= wall && prevQty < wall) {
+        walls.appear(price, qty, nowMs);
+        BookEvent e = {EVENT_WALL_APPEARED, Side::isBid, 0, 0, price, 0, qty, 0};
+        emitEvent(in, e);
+    }
+
+    if (prevQty >= wall && qty < wall) {
+        // nothing resting in front of it: it went at the touch
+        bool atTouch;
+        if constexpr (Side::isBid) atTouch = ladder.bestAtOrAbove(price + 1) == NO_PRICE;
+        else                       atTouch = ladder.bestAtOrBelow(price - 1) == NO_PRICE;
+        int64_t life = walls.disappear(price, atTouch, nowMs);
+        BookEvent e = {(uint8_t)(atTouch ? EVENT_WALL_FILLED : EVENT_WALL_PULLED), Side::isBid, 0, 0,
+                       price, 0, prevQty, life};
+        emitEvent(in, e);
+    }
+}
+
+void updateLevel(Instrument& in, bool isBid, Ticks price, Lots qty) {
+    if (isBid) updateSide<BidSide>(in, price, qty);
+    else       updateSide<AskSide>(in, price, qty);
+}
+
+// Price and size decimals fixed at compile time.
+template <int PriceDecimals, int QtyDecimals>
+struct FixedScale {
+    template <class OnLevel>
+    static int forEach(const InstrumentSpec&, string_view levels, OnLevel&& onLevel) {
+        return forEachLevel<PriceDecimals, QtyDecimals>(levels, onLevel);
+    }
+};
+
+// ...or read from the spec.
+struct SpecScale {
+    template <class OnLevel>
+    static int forEach(const InstrumentSpec& s, string_view levels, OnLevel&& onLevel) {
+        return forEachLevel(levels, s.priceDecimals, s.qtyDecimals, onLevel);
+    }
+};
+
+template <class Scale>
+static int applyScaled(Instrument& in, string_view bids, string_view asks) {
+    int numBids = Scale::forEach(in.spec, bids, [&in](int64_t ticks, int64_t lots) {
+        updateSide<BidSide>(in, ticks, toLots(lots));
+    });
+    int numAsks = Scale::forEach(in.spec, asks, [&in](int64_t ticks, int64_t lots) {
+        updateSide<AskSide>(in, ticks, toLots(lots));
+    });
+    return numBids < 0 || numAsks < 0 ? -1 : numBids + numAsks;
+}
+
+int applyLevelsAnyScale(Instrument& in, string_view bids, string_view asks) {
+    return applyScaled<SpecScale>(in, bids, asks);
+}
+
+// Decimals with their own instantiation, and the Binance symbols that use them.
+struct ApplyScale {
+    int           priceDecimals;
+    int           qtyDecimals;
+    ApplyLevelsFn apply;
+};
+const ApplyScale APPLY_SCALES[] = {
+    {2, 5, applyScaled<FixedScale<2, 5>>},   // BTCUSDT
+    {2, 4, applyScaled<FixedScale<2, 4>>},   // ETHUSDT
+    {2, 3, applyScaled<FixedScale<2, 3>>},   // BNBUSDT, SOLUSDT
+    {4, 1, applyScaled<FixedScale<4, 1>>},   // XRPUSDT, ADAUSDT
+    {1, 3, applyScaled<FixedScale<1, 3>>},   // BTCUSDT perpetual
+};
+
+ApplyLevelsFn applyLevelsFor(const InstrumentSpec& s) {
+    for (const ApplyScale& a : APPLY_SCALES)
+        if (a.priceDecimals == s.priceDecimals && a.qtyDecimals == s.qtyDecimals) return a.apply;
+    return applyLevelsAnyScale;
+}
+
+void updateToxicityWindow(Instrument& in) {
+    in.aggressiveBuy.push(in.updateAggressiveBuy);
+    in.aggressiveSell.push(in.updateAggressiveSell);
+    in.updateAggressiveBuy  = 0;
+    in.updateAggressiveSell = 0;
+}
+
+// ===== ANALYTICS =====
+void recoverBest(Instrument& in) {
+    if (in.bestBid != NO_PRICE && in.bidLadder.get(in.bestBid) == 0)
+        in.bestBid = in.bidLadder.bestAtOrBelow(in.bestBid);
+    if (in.bestAsk != NO_PRICE && in.askLadder.get(in.bestAsk) == 0)
+        in.bestAsk = in.askLadder.bestAtOrAbove(in.bestAsk);
+}
+
+int collectTop(const Instrument& in, bool isBid, Level* out, int n) {
+    auto put = [&](Ticks t, Lots q) { *out++ = {t, q}; };
+    if (isBid) return in.bestBid == NO_PRICE ? 0 : in.bidLadder.walkDown(in.bestBid, n, put);
+    return in.bestAsk == NO_PRICE ? 0 : in.askLadder.walkUp(in.bestAsk, n, put);
+}
+
+void nearestWalls(const Instrument& in, Ticks midTicks2, Level& bidWall, Level& askWall) {
+    WallInfo b = in.bidWalls.nearest(midTicks2, in.spec.wallRange);
+    WallInfo a = in.askWalls.nearest(midTicks2, in.spec.wallRange);
+    bidWall = {b.price, b.qty};
+    askWall = {a.price, a.qty};
+}
+
+void depthBands(const Instrument& in, Ticks midTicks2, BookView& v) {
+    // bids at or below the mid, asks at or above it, rounded outwards
+    Ticks midLo = midTicks2 / 2, midHi = (midTicks2 + 1) / 2;
+    v.numBands = numImbalanceBands;
+    for (int b = 0; b < numImbalanceBands; b++) {
+        Ticks delta = midTicks2 * imbalanceBandsBps[b] / 20000;
+        int64_t bid = in.bidLadder.depthBetween(midLo - delta, midLo);
+        int64_t ask = in.askLadder.depthBetween(midHi, midHi + delta);
+        v.bandBidDepth[b]  = bid;
+        v.bandAskDepth[b]  = ask;
+        v.bandImbalance[b] = bid + ask > 0 ? (double)bid / (double)(bid + ask) : 0.5;
+    }
+
+    Ticks move = max<Ticks>(1, midTicks2 * costToMoveBps / 20000);
+    v.costUpLots   = in.bestAsk != NO_PRICE ? in.askLadder.depthBetween(in.bestAsk, in.bestAsk + move - 1) : 0;
+    v.costDownLots = in.bestBid != NO_PRICE ? in.bidLadder.depthBetween(in.bestBid - move + 1, in.bestBid) : 0;
+
+    Ticks up   = in.bestAsk != NO_PRICE ? in.askLadder.sweepUp(in.bestAsk, in.spec.wallThreshold) : NO_PRICE;
+    Ticks down = in.bestBid != NO_PRICE ? in.bidLadder.sweepDown(in.bestBid, in.spec.wallThreshold) : NO_PRICE;
+    v.sweepAskPx = up   == NO_PRICE ? 0 : up;
+    v.sweepBidPx = down == NO_PRICE ? 0 : down;
+}
+
+void updateTopOfBook(Instrument& in, TopOfBook& t) {
+    recoverBest(in);
+    t.numAsks = collectTop(in, false, t.asks, TOP_LEVELS);
+    t.numBids = collectTop(in, true,  t.bids, TOP_LEVELS);
+
+    Ticks bidPx = t.numBids ? t.bids[0].price : 0;
+    Ticks askPx = t.numAsks ? t.asks[0].price : 0;
+    t.midTicks2 = (t.numBids && t.numAsks) ? bidPx + askPx
+                : t.numBids ? 2 * bidPx
+                : 2 * askPx;
+
+    // keep the flat part of both ladders centred on the market
+    in.bidLadder.maybeRecenter(t.midTicks2 / 2);
+    in.askLadder.maybeRecenter(t.midTicks2 / 2);
+
+    int64_t bidVolume = 0, askVolume = 0;
+    for (int i = 0; i < t.numBids; i++) bidVolume += t.bids[i].qty;
+    for (int i = 0; i < t.numAsks; i++) askVolume += t.asks[i].qty;
+    t.imbalance = (bidVolume + askVolume > 0)
+                  ? (double)bidVolume / (double)(bidVolume + askVolume) : 0.5;
+
+    int64_t totalAggressive = in.aggressiveBuy.sum() + in.aggressiveSell.sum();
+    t.aggressionRatio = (totalAggressive > 0)
+                        ? (double)in.aggressiveBuy.sum() / (double)totalAggressive : 0.5;
+}
+
+// Order-flow imbalance (Cont, Kukanov & Stoikov), summed over the top
+// levels: per level, bid size arriving at or above the previous bid price
+// counts for the buyers and size leaving it against them, and the
+// reverse for asks. Levels missing before or after the diff are skipped.
+static int64_t levelFlow(const Level& now, const Level& before, bool isBid) {
+    bool better = isBid ? now.price > before.price : now.price < before.price;
+    if (better) return now.qty;
+    if (now.price == before.price) return (int64_t)now.qty - (int64_t)before.qty;
+    return -(int64_t)before.qty;
+}
+
+void updateSignals(Signals& s, const TopOfBook& t, int64_t timeMs, BookView& v) {
+    bool twoSided = t.numBids && t.numAsks;
+    Ticks bidPx = t.numBids ? t.bids[0].price : 0, askPx = t.numAsks ? t.asks[0].price : 0;
+    if (twoSided) {
+        double bidQty = t.bids[0].qty, askQty = t.asks[0].qty;
+        v.microprice = (bidPx * askQty + askPx * bidQty) / (bidQty + askQty);
+    } else {
+        v.microprice = t.midTicks2 / 2.0;
+    }
+
+    int64_t ofi = 0;
+    for (int i = 0; i < min(t.numBids, s.lastNumBids); i++) ofi += levelFlow(t.bids[i], s.lastBids[i], true);
+    for (int i = 0; i < min(t.numAsks, s.lastNumAsks); i++) ofi -= levelFlow(t.asks[i], s.lastAsks[i], false);
+    s.ofi.push(ofi);
+    copy(t.bids, t.bids + t.numBids, s.lastBids);
+    copy(t.asks, t.asks + t.numAsks, s.lastAsks);
+    s.lastNumBids = t.numBids;
+    s.lastNumAsks = t.numAsks;
+    v.ofi       = ofi;
+    v.ofiWindow = s.ofi.sum();
+
+    for (int h = 0; h < NUM_HORIZONS; h++) {
+        if (twoSided) {
+            s.spreads[h].push(askPx - bidPx, timeMs);
+            if (s.lastMidTicks2)
+                s.returnsBps[h].push((t.midTicks2 - s.lastMidTicks2) * 10000.0 / s.lastMidTicks2, timeMs);
+        }
+        v.spreadAvg[h] = s.spreads[h].mean();
+        v.spreadMax[h] = s.spreads[h].empty() ? 0 : s.spreads[h].max();
+        v.volBps[h]    = sqrt(s.returnsBps[h].sumSquares());
+    }
+    if (twoSided) s.lastMidTicks2 = t.midTicks2;
+}
+
+void resetSignals(Signals& s) {
+    s.lastNumBids   = 0;
+    s.lastNumAsks   = 0;
+    s.lastMidTicks2 = 0;
+    s.ofi.clear();
+    for (int h = 0; h < NUM_HORIZONS; h++) {
+        s.spreads[h].clear();
+        s.returnsBps[h].clear();
+    }
+}
+
+void updateAnalytics(Instrument& in, double latencyNs, int numUpdates) {
+    in.updateCount++;
+    in.latencySumNs += latencyNs;
+    in.latencyMaxNs  = max(in.latencyMaxNs, latencyNs);
+
+    BookView& v = in.view.back();
+    TopOfBook top;
+    updateTopOfBook(in, top);
+    v.numAsks = top.numAsks;
+    v.numBids = top.numBids;
+    copy(top.asks, top.asks + top.numAsks, v.topAsks);
+    copy(top.bids, top.bids + top.numBids, v.topBids);
+
+    Ticks bidPx     = v.numBids ? v.topBids[0].price : 0;
+    Ticks askPx     = v.numAsks ? v.topAsks[0].price : 0;
+    Ticks midTicks2 = top.midTicks2;
+    Ticks spread    = askPx - bidPx;
+    double imbalance = top.imbalance;
+
+    in.imbalanceHistory.push(imbalance);
+    updateSignals(in.signals, top, in.eventTimeMs, v);
+
+    int64_t buyAggression   = in.aggressiveBuy.sum();
+    int64_t sellAggression  = in.aggressiveSell.sum();
+    double  aggressionRatio = top.aggressionRatio;
+
+    Ticks keep = WALL_KEEP_RANGES * in.spec.wallRange;
+    in.bidWalls.prune(midTicks2 / 2 - keep, midTicks2 / 2 + keep);
+    in.askWalls.prune(midTicks2 / 2 - keep, midTicks2 / 2 + keep);
+    nearestWalls(in, midTicks2, v.nearestBidWall, v.nearestAskWall);
+    v.numNearBidWalls = v.numBids ? in.bidWalls.below(bidPx, v.nearBidWalls, NEAR_WALLS) : 0;
+    v.numNearAskWalls = v.numAsks ? in.askWalls.above(askPx, v.nearAskWalls, NEAR_WALLS) : 0;
+    v.liveWalls       = (int)(in.bidWalls.size() + in.askWalls.size());
+    v.bidWallStats    = in.bidWalls.stats();
+    v.askWallStats    = in.askWalls.stats();
+    v.eventTimeMs     = in.eventTimeMs;
+    depthBands(in, midTicks2, v);
+
+    v.instrument      = in.id;
+    v.updateCount     = in.updateCount;
+    v.timestampMs     = chrono::duration_cast<chrono::milliseconds>(
+                            chrono::system_clock::now().time_since_epoch()).count();
+    v.midTicks2       = midTicks2;
+    v.bestBid         = bidPx;
+    v.bestAsk         = askPx;
+    v.spread          = spread;
+    v.latencyNs       = latencyNs;
+    v.latencyAvgNs    = in.latencySumNs / in.updateCount;
+    v.latencyMaxNs    = in.latencyMaxNs;
+    v.numUpdates      = numUpdates;
+    v.imbalance       = imbalance;
+    v.buyAggression   = buyAggression;
+    v.sellAggression  = sellAggression;
+    v.aggressionRatio = aggressionRatio;
+    v.buyVolume       = in.aggressiveBuy.empty() ? 0 : in.aggressiveBuy.newest();
+    v.sellVolume      = in.aggressiveSell.empty() ? 0 : in.aggressiveSell.newest();
+
+    if (bidPx != in.lastBestBid || askPx != in.lastBestAsk) {
+        BookEvent e = {EVENT_BEST_CHANGE, false, 0, 0, bidPx, askPx, 0, 0};
+        emitEvent(in, e);
+        in.lastBestBid = bidPx;
+        in.lastBestAsk = askPx;
+    }
+    if (spread > 0) {
+        double avg = in.spreadEma.mean();
+        if (!in.spreadWide && in.spreadEma.seeded() && spread >= SPREAD_WIDE_FACTOR * avg) {
+            BookEvent e = {EVENT_SPREAD_WIDE, false, 0, 0, spread, llround(avg), 0, 0};
+            emitEvent(in, e);
+            in.spreadWide = true;
+        } else if (in.spreadWide && spread * 2 < SPREAD_WIDE_FACTOR * avg) {
+            in.spreadWide = false;
+        }
+        in.spreadEma.update((double)spread);
+    }
+
+    v.numWallEvents = in.numRecentWallEvents;
+    copy(in.recentWallEvents, in.recentWallEvents + in.numRecentWallEvents, v.wallEvents);
+
+    const auto& history = in.imbalanceHistory;
+    v.imbalanceCount = history.size();
+    for (int i = 0; i < history.size(); i++) v.imbalanceHistory[i] = history[i];
+    v.imbalanceMin = history.min();
+    v.imbalanceMax = history.max();
+
+    v.syncEnabled      = syncEnabled;
+    v.syncState        = in.depthSync.stateName();
+    v.syncLive         = in.depthSync.state() == SyncState::Live;
+    v.syncUpdateId     = in.depthSync.lastUpdateId();
+    v.syncGaps         = in.depthSync.gaps();
+    v.syncSnapshots    = in.depthSync.snapshots();
+    v.syncLastResyncMs = in.depthSync.lastResyncMs();
+}
+
+// ===== SHARED MEMORY =====
+void makeShmBook(const Instrument& in, const BookView& v, ShmBook& out) {
+    snprintf(out.symbol, SHM_SYMBOL_CHARS, "%s", in.spec.symbol.c_str());
+    out.priceDecimals = in.spec.priceDecimals;
+    out.qtyDecimals   = in.spec.qtyDecimals;
+    out.updateCount   = (uint64_t)v.updateCount;
+    out.eventTimeMs   = v.eventTimeMs;
+    out.publishNs     = chrono::duration_cast<chrono::nanoseconds>(
+                            chrono::system_clock::now().time_since_epoch()).count();
+    out.publishCycles = v.publishCycles;
+    out.lastUpdateId  = v.syncUpdateId;
+    out.synced        = !v.syncEnabled || v.syncLive;
+
+    out.bestBid   = v.bestBid;
+    out.bestAsk   = v.bestAsk;
+    out.midTicks2 = v.midTicks2;
+    out.spread    = v.spread;
+    Level levels[SHM_LEVELS];
+    out.numBids = collectTop(in, true, levels, SHM_LEVELS);
+    for (int i = 0; i < out.numBids; i++) out.bids[i] = {levels[i].price, levels[i].qty};
+    out.numAsks = collectTop(in, false, levels, SHM_LEVELS);
+    for (int i = 0; i < out.numAsks; i++) out.asks[i] = {levels[i].price, levels[i].qty};
+
+    out.imbalance       = v.imbalance;
+    out.aggressionRatio = v.aggressionRatio;
+    out.buyAggression   = v.buyAggression;
+    out.sellAggression  = v.sellAggression;
+    out.nearestBidWall  = {v.nearestBidWall.price, v.nearestBidWall.qty};
+    out.nearestAskWall  = {v.nearestAskWall.price, v.nearestAskWall.qty};
+    out.numBands = min(v.numBands, SHM_BANDS);
+    for (int b = 0; b < out.numBands; b++) {
+        out.bandBps[b]       = imbalanceBandsBps[b];
+        out.bandImbalance[b] = v.bandImbalance[b];
+    }
+    out.costUpLots   = v.costUpLots;
+    out.costDownLots = v.costDownLots;
+    out.costBps      = costToMoveBps;
+}
+
+// ===== UDP =====
+void makeUdpBook(const Instrument& in, const BookView& v, UdpBook& out) {
+    snprintf(out.symbol, UDP_SYMBOL_CHARS, "%s", in.spec.symbol.c_str());
+    out.priceDecimals = in.spec.priceDecimals;
+    out.qtyDecimals   = in.spec.qtyDecimals;
+    out.updateCount   = (uint64_t)v.updateCount;
+    out.eventTimeMs   = v.eventTimeMs;
+    out.bestBid       = v.bestBid == NO_PRICE ? 0 : v.bestBid;
+    out.bestAsk       = v.bestAsk == NO_PRICE ? 0 : v.bestAsk;
+    Level levels[UDP_LEVELS];
+    out.numBids = collectTop(in, true, levels, UDP_LEVELS);
+    for (int i = 0; i < out.numBids; i++) out.bids[i] = {levels[i].price, levels[i].qty};
+    out.numAsks = collectTop(in, false, levels, UDP_LEVELS);
+    for (int i = 0; i < out.numAsks; i++) out.asks[i] = {levels[i].price, levels[i].qty};
+
+    out.imbalance       = v.imbalance;
+    out.aggressionRatio = v.aggressionRatio;
+    out.buyAggression   = v.buyAggression;
+    out.sellAggression  = v.sellAggression;
+    out.nearestBidWall  = {v.nearestBidWall.price, v.nearestBidWall.qty};
+    out.nearestAskWall  = {v.nearestAskWall.price, v.nearestAskWall.qty};
+    out.liveWalls       = v.liveWalls;
+    if (v.numWallEvents > 0) {
+        const BookEvent& e = v.wallEvents[v.numWallEvents - 1];
+        out.wallEvent       = e.type == EVENT_WALL_APPEARED ? UDP_WALL_APPEARED
+                            : e.type == EVENT_WALL_PULLED   ? UDP_WALL_PULLED
+                            : e.type == EVENT_WALL_FILLED   ? UDP_WALL_FILLED : UDP_WALL_NONE;
+        out.wallEventBid    = e.isBid;
+        out.wallEventPrice  = e.price;
+        out.wallEventQty    = e.qty;
+        out.wallEventTimeMs = e.timeMs;
+    }
+}
+
+// ===== CSV TELEMETRY =====
+string csvHeader() {
+    string h = "timestamp_ms,update_count,mid_price,best_bid,best_ask,"
+               "spread,latency_ns,num_updates,imbalance,buy_aggression,"
+               "sell_aggression,aggression_ratio,nearest_ask_wall_price,"
+               "nearest_ask_wall_qty,nearest_bid_wall_price,"
+               "nearest_bid_wall_qty,wall_event,symbol";
+    for (int b = 0; b < numImbalanceBands; b++)
+        h += ",imb_" + to_string(imbalanceBandsBps[b]) + "bps";
+    h += ",cost_up_qty,cost_down_qty,microprice,ofi,ofi_" + to_string(OFI_WINDOW);
+    for (int i = 0; i < NUM_HORIZONS; i++) {
+        string secs = to_string(SIGNAL_HORIZONS_MS[i] / 1000) + "s";
+        h += ",spread_avg_" + secs + ",vol_" + secs + "_bps";
+    }
+    return h + "\n";
+}
+
+inline char* putChar(char* p, char c) { *p++ = c; return p; }
+
+inline char* putFixed(char* p, int64_t value, int valueDecimals, int outDecimals) {
+    return p + formatFixed(p, value, valueDecimals, outDecimals);
+}
+
+inline char* putInt(char* p, long long v) { return putFixed(p, v, 0, 0); }
+
+// ratios in [0,1] and other analytics that stay floating point
+inline char* putRatio(char* p, double v) { return putFixed(p, llround(v * 10000.0), 4, 4); }
+
+void makeTelemetryRow(const BookView& v, TelemetryRow& r) {
+    r.instrument      = v.instrument;
+    r.updateCount     = v.updateCount;
+    r.timestampMs     = v.timestampMs;
+    r.midTicks2       = v.midTicks2;
+    r.bestBid         = v.bestBid;
+    r.bestAsk         = v.bestAsk;
+    r.spread          = v.spread;
+    r.latencyNs       = llround(v.latencyNs);
+    r.numUpdates      = v.numUpdates;
+    r.imbalance       = v.imbalance;
+    r.buyAggression   = v.buyAggression;
+    r.sellAggression  = v.sellAggression;
+    r.aggressionRatio = v.aggressionRatio;
+    r.buyVolume       = v.buyVolume;
+    r.sellVolume      = v.sellVolume;
+    r.nearestAskWall  = v.nearestAskWall;
+    r.nearestBidWall  = v.nearestBidWall;
+    r.hasWallEvent = v.numWallEvents > 0;
+    if (r.hasWallEvent) r.wallEvent = v.wallEvents[v.numWallEvents - 1];
+    r.numBands = v.numBands;
+    copy(v.bandImbalance, v.bandImbalance + v.numBands, r.bandImbalance);
+    r.costUpLots   = v.costUpLots;
+    r.costDownLots = v.costDownLots;
+    r.microprice   = v.microprice;
+    r.ofi          = v.ofi;
+    r.ofiWindow    = v.ofiWindow;
+    copy(v.spreadAvg, v.spreadAvg + NUM_HORIZONS, r.spreadAvg);
+    copy(v.volBps, v.volBps + NUM_HORIZONS, r.volBps);
+}
+
+size_t formatTelemetryRow(char* line, const TelemetryRow& r, const InstrumentSpec& s) {
+    const int pd = s.priceDecimals, qd = s.qtyDecimals;
+    char* p = line;
+    p = putInt(p, r.timestampMs);                                 p = putChar(p, ',');
+    p = putInt(p, r.updateCount);                                 p = putChar(p, ',');
+    p = putFixed(p, r.midTicks2 * 5, pd + 1, pd);                 p = putChar(p, ',');
+    p = putFixed(p, r.bestBid, pd, pd);                           p = putChar(p, ',');
+    p = putFixed(p, r.bestAsk, pd, pd);                           p = putChar(p, ',');
+    p = putFixed(p, r.spread,  pd, pd);                           p = putChar(p, ',');
+    p = putInt(p, r.latencyNs);                                   p = putChar(p, ',');
+    p = putInt(p, r.numUpdates);                                  p = putChar(p, ',');
+    p = putRatio(p, r.imbalance);                                 p = putChar(p, ',');
+    p = putFixed(p, r.buyAggression,  qd, 4);                     p = putChar(p, ',');
+    p = putFixed(p, r.sellAggression, qd, 4);                     p = putChar(p, ',');
+    p = putRatio(p, r.aggressionRatio);                           p = putChar(p, ',');
+    p = putFixed(p, r.nearestAskWall.price, pd, pd);              p = putChar(p, ',');
+    p = putFixed(p, r.nearestAskWall.qty,   qd, 2);               p = putChar(p, ',');
+    p = putFixed(p, r.nearestBidWall.price, pd, pd);              p = putChar(p, ',');
+    p = putFixed(p, r.nearestBidWall.qty,   qd, 2);               p = putChar(p, ',');
+
+    if (r.hasWallEvent) {
+        char* e = p;
+        p += formatEvent(p, r.wallEvent, s);
+        replace(e, p, ',', ';');
+    }
+    p = putChar(p, ',');
+    memcpy(p, s.symbol.data(), s.symbol.size());
+    p += s.symbol.size();
+    for (int b = 0; b < r.numBands; b++) {
+        p = putChar(p, ',');
+        p = putRatio(p, r.bandImbalance[b]);
+    }
+    p = putChar(p, ',');
+    p = putFixed(p, r.costUpLots,   qd, 4);                       p = putChar(p, ',');
+    p = putFixed(p, r.costDownLots, qd, 4);                       p = putChar(p, ',');
+    p = putFixed(p, llround(r.microprice * 100.0), pd + 2, pd + 2); p = putChar(p, ',');
+    p = putFixed(p, r.ofi,       qd, 4);                          p = putChar(p, ',');
+    p = putFixed(p, r.ofiWindow, qd, 4);
+    for (int h = 0; h < NUM_HORIZONS; h++) {
+        p = putChar(p, ',');
+        p = putFixed(p, llround(r.spreadAvg[h] * 100.0), pd + 2, pd + 2);
+        p = putChar(p, ',');
+        p = putFixed(p, llround(r.volBps[h] * 100.0), 2, 2);
+    }
+    p = putChar(p, '\n');
+    return p - line;
+}
+
+// ===== METRIC STORE =====
+vector<StoreColumn> storeColumns() {
+    vector<StoreColumn> c = {
+        storeColumn("timestamp_ms", STORE_DELTA),
+        storeColumn("update_count", STORE_DELTA),
+        storeColumn("mid_price", STORE_DELTA, STORE_PRICE, 1),   // bid + ask, times 5
+        storeColumn("best_bid", STORE_DELTA, STORE_PRICE),
+        storeColumn("best_ask", STORE_DELTA, STORE_PRICE),
+        storeColumn("spread", STORE_DELTA, STORE_PRICE),
+        storeColumn("latency_ns", STORE_DELTA),
+        storeColumn("num_updates", STORE_DELTA),
+        storeColumn("imbalance", STORE_XOR),
+        storeColumn("buy_aggression", STORE_DELTA, STORE_QTY),
+        storeColumn("sell_aggression", STORE_DELTA, STORE_QTY),
+        storeColumn("aggression_ratio", STORE_XOR),
+        storeColumn("buy_volume", STORE_DELTA, STORE_QTY),
+        storeColumn("sell_volume", STORE_DELTA, STORE_QTY),
+        storeColumn("nearest_ask_wall_price", STORE_DELTA, STORE_PRICE),
+        storeColumn("nearest_ask_wall_qty", STORE_DELTA, STORE_QTY),
+        storeColumn("nearest_bid_wall_price", STORE_DELTA, STORE_PRICE),
+        storeColumn("nearest_bid_wall_qty", STORE_DELTA, STORE_QTY),
+        storeColumn("wall_event", STORE_DELTA),
+        storeColumn("wall_event_bid", STORE_DELTA),
+        storeColumn("wall_event_price", STORE_DELTA, STORE_PRICE),
+        storeColumn("wall_event_qty", STORE_DELTA, STORE_QTY),
+        storeColumn("wall_event_time_ms", STORE_DELTA),
+    };
+    for (int b = 0; b < numImbalanceBands; b++)
+        c.push_back(storeColumn("imb_" + to_string(imbalanceBandsBps[b]) + "bps", STORE_XOR));
+    c.push_back(storeColumn("cost_up_qty", STORE_DELTA, STORE_QTY));
+    c.push_back(storeColumn("cost_down_qty", STORE_DELTA, STORE_QTY));
+    c.push_back(storeColumn("microprice", STORE_XOR, STORE_PRICE));
+    c.push_back(storeColumn("ofi", STORE_DELTA, STORE_QTY));
+    c.push_back(storeColumn("ofi_" + to_string(OFI_WINDOW), STORE_DELTA, STORE_QTY));
+    for (int i = 0; i < NUM_HORIZONS; i++) {
+        string secs = to_string(SIGNAL_HORIZONS_MS[i] / 1000) + "s";
+        c.push_back(storeColumn("spread_avg_" + secs, STORE_XOR, STORE_PRICE));
+        c.push_back(storeColumn("vol_" + secs + "_bps", STORE_XOR));
+    }
+    return c;
+}
+
+void makeStoreRow(const TelemetryRow& r, StoreValue* out) {
+    StoreValue* p = out;
+    auto i = [&](int64_t v) { (p++)->i = v; };
+    auto f = [&](double v) { (p++)->f = v; };
+    i(r.timestampMs);
+    i(r.updateCount);
+    i(r.midTicks2 * 5);
+    i(r.bestBid);
+    i(r.bestAsk);
+    i(r.spread);
+    i(r.latencyNs);
+    i(r.numUpdates);
+    f(r.imbalance);
+    i(r.buyAggression);
+    i(r.sellAggression);
+    f(r.aggressionRatio);
+    i(r.buyVolume);
+    i(r.sellVolume);
+    i(r.nearestAskWall.price);
+    i(r.nearestAskWall.qty);
+    i(r.nearestBidWall.price);
+    i(r.nearestBidWall.qty);
+    i(r.hasWallEvent ? r.wallEvent.type + 1 : 0);
+    i(r.hasWallEvent && r.wallEvent.isBid);
+    i(r.hasWallEvent ? r.wallEvent.price : 0);
+    i(r.hasWallEvent ? r.wallEvent.qty : 0);
+    i(r.hasWallEvent ? r.wallEvent.timeMs : 0);
+    for (int b = 0; b < numImbalanceBands; b++) f(b < r.numBands ? r.bandImbalance[b] : 0.0);
+    i(r.costUpLots);
+    i(r.costDownLots);
+    f(r.microprice);
+    i(r.ofi);
+    i(r.ofiWindow);
+    for (int h = 0; h < NUM_HORIZONS; h++) {
+        f(r.spreadAvg[h]);
+        f(r.volBps[h]);
+    }
+}
+
+// ===== CHECKPOINTS =====
+static_assert(std::is_trivially_copyable<BookCheckpoint>::value,
+              "a checkpoint is written and read as raw bytes");
+
+size_t saveCheckpoint(const Instrument& in, BookCheckpoint& c) {
+    snprintf(c.symbol, sizeof(c.symbol), "%s", in.spec.symbol.c_str());
+    c.priceDecimals = in.spec.priceDecimals;
+    c.qtyDecimals   = in.spec.qtyDecimals;
+    c.eventTimeMs   = in.eventTimeMs;
+    c.lastUpdateId  = syncEnabled ? in.depthSync.lastUpdateId() : 0;
+    c.updateCount   = in.updateCount;
+
+    c.bidWallStats = in.bidWalls.stats();
+    c.askWallStats = in.askWalls.stats();
+    c.numBidWalls  = in.bidWalls.below(INT64_MAX, c.bidWalls, CHECKPOINT_WALLS);
+    c.numAskWalls  = in.askWalls.above(0, c.askWalls, CHECKPOINT_WALLS);
+    c.numRecentWallEvents = in.numRecentWallEvents;
+    copy(in.recentWallEvents, in.recentWallEvents + in.numRecentWallEvents, c.recentWallEvents);
+
+    c.spreadEma        = in.spreadEma;
+    c.spreadWide       = in.spreadWide;
+    c.aggressiveBuy    = in.aggressiveBuy;
+    c.aggressiveSell   = in.aggressiveSell;
+    c.imbalanceHistory = in.imbalanceHistory;
+    c.signals          = in.signals;
+
+    c.numBids = collectTop(in, true, c.levels, CHECKPOINT_LEVELS);
+    c.numAsks = collectTop(in, false, c.levels + c.numBids, CHECKPOINT_LEVELS);
+    return offsetof(BookCheckpoint, levels) + (size_t)(c.numBids + c.numAsks) * sizeof(Level);
+}
+
+bool restoreCheckpoint(Instrument& in, const BookCheckpoint& c) {
+    if (strncmp(c.symbol, in.spec.symbol.c_str(), sizeof(c.symbol)) != 0 ||
+        c.priceDecimals != in.spec.priceDecimals || c.qtyDecimals != in.spec.qtyDecimals)
+        return false;
+    // the counts index fixed arrays: a file that passed the checksum but
+    // disagrees with this build's layout is a cold start, not an overrun
+    if (c.numBids < 0 || c.numBids > CHECKPOINT_LEVELS || c.numAsks < 0 || c.numAsks > CHECKPOINT_LEVELS ||
+        c.numBidWalls < 0 || c.numBidWalls > CHECKPOINT_WALLS || c.numAskWalls < 0 ||
+        c.numAskWalls > CHECKPOINT_WALLS || c.numRecentWallEvents < 0 ||
+        c.numRecentWallEvents > WALL_EVENT_SLOTS)
+        return false;
+
+    // the levels were already resting: no wall or aggression events
+    resetState(in);
+    BookEventRing* events = in.events;
+    in.events      = nullptr;
+    in.eventTimeMs = c.eventTimeMs;
+    for (int i = 0; i < c.numBids; i++) updateSide<BidSide>(in, c.levels[i].price, c.levels[i].qty);
+    for (int i = c.numBids; i < c.numBids + c.numAsks; i++)
+        updateSide<AskSide>(in, c.levels[i].price, c.levels[i].qty);
+    in.events = events;
+    in.updateAggressiveBuy  = 0;
+    in.updateAggressiveSell = 0;
+    in.lastBestBid = in.bestBid;
+    in.lastBestAsk = in.bestAsk;
+
+    in.bidWalls.clear();
+    in.askWalls.clear();
+    for (int i = 0; i < c.numBidWalls; i++) in.bidWalls.restore(c.bidWalls[i]);
+    for (int i = 0; i < c.numAskWalls; i++) in.askWalls.restore(c.askWalls[i]);
+    in.bidWalls.restoreStats(c.bidWallStats);
+    in.askWalls.restoreStats(c.askWallStats);
+    in.numRecentWallEvents = c.numRecentWallEvents;
+    copy(c.recentWallEvents, c.recentWallEvents + c.numRecentWallEvents, in.recentWallEvents);
+
+    in.spreadEma        = c.spreadEma;
+    in.spreadWide       = c.spreadWide;
+    in.aggressiveBuy    = c.aggressiveBuy;
+    in.aggressiveSell   = c.aggressiveSell;
+    in.imbalanceHistory = c.imbalanceHistory;
+    in.signals          = c.signals;
+    in.updateCount      = c.updateCount;
+    return true;
+}
@@ -0,0 +1,444 @@
+#pragma once
+
+// The single-instrument book engine: ladders, best-level tracking, wall
+// and toxicity analytics, and the BookView / CSV row built after every
+// update. Everything here runs on the worker that owns the instrument and
+// touches no socket, terminal or file; the threads, rings and I/O around it
+// live in orderbook.cpp. Built as the pulse_engine library so benchmarks
+// link the same code the binary runs.
+
+#include <cstdint>
+#include <cmath>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "fixed_point.h"
+#include "depth_parser.h"
+#include "price_ladder.h"
+#include "depth_sync.h"
+#include "pipeline.h"
+#include "instrument.h"
+#include "wall_index.h"
+#include "event_bus.h"
+#include "shm_book.h"
+#include "rolling_window.h"
+#include "checkpoint.h"
+#include "metric_store.h"
+#include "udp_feed.h"
+
+const int TOXICITY_WINDOW   = 100;
+const int IMBALANCE_HISTORY = 60;
+
+// Whether diffs go through snapshot/sequence checks; set once from the
+// command line before any worker starts.
+extern bool syncEnabled;
+
+// Depth bands, in basis points of the mid, over which band imbalance is
+// measured, and the move in bps the cost-to-move metric prices. Set once
+// from the command line before any worker starts.
+const int MAX_BANDS = 4;
+extern int imbalanceBandsBps[MAX_BANDS];
+extern int numImbalanceBands;
+extern int costToMoveBps;
+
+struct Level {
+    Ticks price;
+    Lots  qty;
+};
+
+const int TOP_LEVELS       = 5;
+const int NEAR_WALLS       = 3;   // walls listed per side from the touch
+const int WALL_KEEP_RANGES = 4;   // walls beyond this many wall ranges are pruned
+const int WALL_EVENT_SLOTS = 3;
+const int EVENT_TEXT_CHARS = 96;
+
+// ===== EVENTS =====
+// What the engine reports as it goes, as fixed-size records published to
+// the worker's EventRing. Nothing is formatted on the engine thread;
+// formatEvent() is for consumers.
+enum EventType : uint8_t {
+    EVENT_WALL_APPEARED,   // price, qty
+    EVENT_WALL_PULLED,     // price, qty = size before it went, value = lifetime ms (-1 unknown)
+    EVENT_WALL_FILLED,     // same, but nothing was resting in front of it
+    EVENT_BEST_CHANGE,     // price = best bid, price2 = best ask
+    EVENT_SPREAD_WIDE,     // price = spread, price2 = its running average
+    EVENT_GAP,             // value = last applied update id, price2 = first id received
+    NUM_EVENT_TYPES
+};
+
+extern const char* const EVENT_TYPE_NAMES[NUM_EVENT_TYPES];
+const uint32_t ALL_EVENTS  = (1u << NUM_EVENT_TYPES) - 1;
+const uint32_t WALL_EVENTS = (1u << EVENT_WALL_APPEARED) | (1u << EVENT_WALL_PULLED) |
+                             (1u << EVENT_WALL_FILLED);
+
+struct BookEvent {
+    uint8_t  type;
+    bool     isBid;
+    uint16_t instrument;
+    int64_t  timeMs;       // exchange event time of the diff
+    Ticks    price;
+    Ticks    price2;
+    int64_t  qty;
+    int64_t  value;
+};
+
+using BookEventRing = EventRing<BookEvent>;
+using BookEventBus  = EventBus<BookEvent>;
+
+// Spread alerts fire when the spread reaches SPREAD_WIDE_FACTOR times its
+// running average and re-arm once it is back under half that.
+const double SPREAD_WIDE_FACTOR = 3.0;
+const double SPREAD_EMA_ALPHA   = 0.02;
+
+// Microstructure signals, updated once per diff from the top of the book.
+// Order-flow imbalance is summed over the last OFI_WINDOW updates; spread
+// and mid volatility are kept over each of SIGNAL_HORIZONS_MS of exchange
+// time, in windows of up to HORIZON_SAMPLES updates.
+const int     OFI_WINDOW      = 100;
+const int     NUM_HORIZONS    = 3;
+const int64_t SIGNAL_HORIZONS_MS[NUM_HORIZONS] = {1000, 10000, 60000};
+const int     HORIZON_SAMPLES = 1024;
+
+// Everything a consumer needs about one book update, as plain data so the
+// engine can hand it across threads through a TripleBuffer.
+struct BookView {
+    uint16_t  instrument;     // index into instruments
+    long long updateCount;
+    long long timestampMs;
+    Ticks     midTicks2;      // bid + ask, exact at half-tick resolution
+    Ticks     bestBid;
+    Ticks     bestAsk;
+    Ticks     spread;
+    double    latencyNs;
+    double    latencyAvgNs;
+    double    latencyMaxNs;
+    int       numUpdates;
+    uint64_t  publishCycles;
+
+    double    imbalance;
+    int64_t   buyAggression;
+    int64_t   sellAggression;
+    double    aggressionRatio;
+    int64_t   buyVolume;        // lots taken from the asks by this diff
+    int64_t   sellVolume;       // ...and from the bids
+
+    Level     topAsks[TOP_LEVELS];
+    Level     topBids[TOP_LEVELS];
+    int       numAsks;
+    int       numBids;
+    Level     nearestAskWall;
+    Level     nearestBidWall;
+    WallInfo  nearAskWalls[NEAR_WALLS];   // outwards from the best ask
+    WallInfo  nearBidWalls[NEAR_WALLS];
+    int       numNearAskWalls;
+    int       numNearBidWalls;
+    int       liveWalls;
+    WallStats askWallStats;
+    WallStats bidWallStats;
+    long long eventTimeMs;                // exchange time of the last diff
+
+    double    bandImbalance[MAX_BANDS];   // bid / (bid + ask) within each band
+    int64_t   bandBidDepth[MAX_BANDS];
+    int64_t   bandAskDepth[MAX_BANDS];
+    int       numBands;
+    int64_t   costUpLots;       // asks to lift to move the ask up costToMoveBps
+    int64_t   costDownLots;     // bids to hit to move the bid down costToMoveBps
+    Ticks     sweepAskPx;       // where a wall-sized buy stops, or 0
+    Ticks     sweepBidPx;       // where a wall-sized sell stops, or 0
+
+    BookEvent wallEvents[WALL_EVENT_SLOTS];   // oldest first
+    int       numWallEvents;
+
+    double    imbalanceHistory[IMBALANCE_HISTORY];   // oldest first
+    int       imbalanceCount;
+    double    imbalanceMin;                          // over the history
+    double    imbalanceMax;
+
+    double    microprice;       // ticks; touch prices weighted by the opposite side's size
+    int64_t   ofi;              // lots; order-flow imbalance of this diff over the top levels
+    int64_t   ofiWindow;        // summed over the last OFI_WINDOW diffs
+    double    spreadAvg[NUM_HORIZONS];   // ticks, per SIGNAL_HORIZONS_MS
+    Ticks     spreadMax[NUM_HORIZONS];
+    double    volBps[NUM_HORIZONS];      // realised: root of summed squared mid returns
+
+    bool      syncEnabled;
+    const char* syncState;
+    bool      syncLive;
+    long long syncUpdateId;
+    long long syncGaps;
+    long long syncSnapshots;
+    double    syncLastResyncMs;
+};
+
+// What the signals remember between diffs.
+struct Signals {
+    Level lastBids[TOP_LEVELS];
+    Level lastAsks[TOP_LEVELS];
+    int   lastNumBids   = 0;
+    int   lastNumAsks   = 0;
+    Ticks lastMidTicks2 = 0;   // 0: no two-sided book yet
+
+    RollingWindow<int64_t, 128> ofi{OFI_WINDOW};
+    using SpreadWindow = RollingWindow<Ticks, HORIZON_SAMPLES, true>;
+    using ReturnWindow = RollingWindow<double, HORIZON_SAMPLES>;
+    SpreadWindow spreads[NUM_HORIZONS];
+    ReturnWindow returnsBps[NUM_HORIZONS];
+
+    Signals() {
+        for (int h = 0; h < NUM_HORIZONS; h++) {
+            spreads[h]    = SpreadWindow(HORIZON_SAMPLES, SIGNAL_HORIZONS_MS[h]);
+            returnsBps[h] = ReturnWindow(HORIZON_SAMPLES, SIGNAL_HORIZONS_MS[h]);
+        }
+    }
+};
+
+// ===== INSTRUMENT STATE =====
+struct Instrument;
+
+// An instrument's apply path (see applyLevelsFor).
+typedef int (*ApplyLevelsFn)(Instrument& in, std::string_view bids, std::string_view asks);
+ApplyLevelsFn applyLevelsFor(const InstrumentSpec& s);
+
+// Everything one book needs. Owned and mutated by exactly one engine
+// worker; the UI only sees it through the view triple buffer.
+struct Instrument {
+    InstrumentSpec spec;
+    uint16_t       id;
+    int            worker = 0;
+    std::string    snapshotUrl;
+    ApplyLevelsFn  apply;         // compiled for spec's decimals
+
+    PriceLadder bidLadder;
+    PriceLadder askLadder;
+    Ticks bestBid = NO_PRICE;
+    Ticks bestAsk = NO_PRICE;
+
+    WallIndex bidWalls;
+    WallIndex askWalls;
+    BookEvent recentWallEvents[WALL_EVENT_SLOTS];   // oldest first
+    int       numRecentWallEvents = 0;
+    BookEventRing* events = nullptr;   // the owning worker's ring, if anyone listens
+    Ticks     lastBestBid = NO_PRICE;
+    Ticks     lastBestAsk = NO_PRICE;
+    Ewma      spreadEma{SPREAD_EMA_ALPHA};
+    bool      spreadWide  = false;
+    int64_t   eventTimeMs = 0;    // of the diff being applied; wall lifetimes run on it
+
+    RollingWindow<int64_t, 128> aggressiveBuy{TOXICITY_WINDOW};    // per diff
+    RollingWindow<int64_t, 128> aggressiveSell{TOXICITY_WINDOW};
+    int64_t updateAggressiveBuy  = 0;
+    int64_t updateAggressiveSell = 0;
+
+    RollingWindow<double, 64, true> imbalanceHistory{IMBALANCE_HISTORY};
+    Signals                         signals;
+    double                          latencySumNs = 0.0;
+    double                          latencyMaxNs = 0.0;
+
+    long long updateCount = 0;
+    DepthSync depthSync;
+    bool      restored = false;       // from a checkpoint, not yet continued by the stream
+    uint64_t  checkpointDue = 0;      // cycles
+
+    TripleBuffer<BookView> view;
+
+    Instrument(const InstrumentSpec& s, uint16_t index, int window)
+        : spec(s), id(index), apply(applyLevelsFor(s)), bidLadder(window), askLadder(window) {}
+};
+
+// Empties the book: ladders, best levels and walls. The flow windows and
+// signal history are kept.
+void resetBook(Instrument& in);
+
+// The book and everything derived from the flow over it.
+void resetState(Instrument& in);
+
+// display edge conversions
+inline double ticksToPrice(const InstrumentSpec& s, Ticks ticks) { return fixedToDouble(ticks, s.priceDecimals); }
+inline double lotsToQty(const InstrumentSpec& s, int64_t lots)   { return fixedToDouble(lots, s.qtyDecimals); }
+
+std::string formatPrice(const InstrumentSpec& s, Ticks ticks);
+std::string formatQty(const InstrumentSpec& s, int64_t lots);
+
+// Stamps e with the instrument and the current diff's time, publishes it,
+// and keeps wall events for the view.
+void emitEvent(Instrument& in, BookEvent& e);
+
+// Renders e the way the UI and CSV show it; returns the length written
+// (at most EVENT_TEXT_CHARS - 1).
+size_t formatEvent(char* out, const BookEvent& e, const InstrumentSpec& s);
+
+// ===== APPLY =====
+// The per-level path is a template on the side, so the ladder, wall
+// index, best price and aggression total it touches are fixed at compile
+// time and it carries no side tests. updateLevel picks the side once.
+void updateLevel(Instrument& in, bool isBid, Ticks price, Lots qty);
+
+// Applies every level of a parsed diff (or snapshot side pair). Returns
+// the number of levels, or -1 on a malformed level.
+inline int applyLevels(Instrument& in, std::string_view bids, std::string_view asks) {
+    return in.apply(in, bids, asks);
+}
+
+// applyLevelsFor returns a path instantiated for the spec's price and
+// size decimals when one is compiled in (APPLY_SCALES in book_engine.cpp:
+// BTCUSDT's 2/5, ETHUSDT's 2/4 and a few more), so the parse scales by
+// constants. Any other instrument gets this one, which reads the decimals
+// from the spec.
+int applyLevelsAnyScale(Instrument& in, std::string_view bids, std::string_view asks);
+
+void updateToxicityWindow(Instrument& in);
+
+// ===== ANALYTICS =====
+// Re-finds best bid/ask if an update emptied them.
+void recoverBest(Instrument& in);
+
+// Up to n levels from the touch outwards; returns how many were found.
+int collectTop(const Instrument& in, bool isBid, Level* out, int n);
+
+// Closest wall on each side within the instrument's wall range of the mid,
+// or {0, 0}. O(log walls).
+void nearestWalls(const Instrument& in, Ticks midTicks2, Level& bidWall, Level& askWall);
+
+// Band depths and imbalances, cost to move and sweep prices from the
+// ladders' depth index: O(log window) per query, whatever the band width.
+void depthBands(const Instrument& in, Ticks midTicks2, BookView& v);
+
+// The top of the book and the two signals the UI shows and the backtester
+// quotes on, as they stand after an update.
+struct TopOfBook {
+    Level  bids[TOP_LEVELS];
+    Level  asks[TOP_LEVELS];
+    int    numBids;
+    int    numAsks;
+    Ticks  midTicks2;          // bid + ask; twice the one side left if the other is empty
+    double imbalance;          // top-of-book bid / (bid + ask)
+    double aggressionRatio;    // aggressive buys / all aggressive, over the toxicity window
+};
+
+// Recovers the best levels, reads the top TOP_LEVELS a side and re-centres
+// the ladders on the mid. Call after updateToxicityWindow.
+void updateTopOfBook(Instrument& in, TopOfBook& t);
+
+// Microprice, order-flow imbalance and the spread and volatility horizons
+// for a diff at timeMs, from the top of the book after it; writes them to
+// v. O(TOP_LEVELS) and allocation-free.
+void updateSignals(Signals& s, const TopOfBook& t, int64_t timeMs, BookView& v);
+void resetSignals(Signals& s);
+
+// Runs the per-update analytics and fills in.view.back(); the caller
+// publishes it.
+void updateAnalytics(Instrument& in, double latencyNs, int numUpdates);
+
+// ===== CSV TELEMETRY =====
+// Column names, including one imb_<bps>bps column per configured band and
+// spread_avg / vol columns per signal horizon.
+std::string csvHeader();
+const size_t CSV_MAX_LINE = 640;
+
+// One CSV row as the engine hands it to the telemetry writer: raw integers,
+// formatted later on the writer's thread.
+struct TelemetryRow {
+    uint16_t  instrument;
+    long long updateCount;
+    long long timestampMs;
+    Ticks     midTicks2;
+    Ticks     bestBid;
+    Ticks     bestAsk;
+    Ticks     spread;
+    int64_t   latencyNs;
+    int       numUpdates;
+    double    imbalance;
+    int64_t   buyAggression;
+    int64_t   sellAggression;
+    double    aggressionRatio;
+    int64_t   buyVolume;
+    int64_t   sellVolume;
+    Level     nearestAskWall;
+    Level     nearestBidWall;
+    BookEvent wallEvent;      // the latest wall event, if hasWallEvent
+    bool      hasWallEvent;
+    double    bandImbalance[MAX_BANDS];
+    int       numBands;
+    int64_t   costUpLots;
+    int64_t   costDownLots;
+    double    microprice;
+    int64_t   ofi;
+    int64_t   ofiWindow;
+    double    spreadAvg[NUM_HORIZONS];
+    double    volBps[NUM_HORIZONS];
+};
+
+void makeTelemetryRow(const BookView& v, TelemetryRow& r);
+
+// ===== SHARED MEMORY =====
+// Fills a shared-memory book from the view just built for in, plus the
+// deeper SHM_LEVELS levels per side read from its ladders. Runs on the
+// owning worker, before ShmBookWriter::publish.
+void makeShmBook(const Instrument& in, const BookView& v, ShmBook& out);
+
+// ===== UDP =====
+// Fills a UDP book (udp_feed.h, --udp) the same way, to UDP_LEVELS levels
+// per side, with the latest wall event. out must start zeroed.
+void makeUdpBook(const Instrument& in, const BookView& v, UdpBook& out);
+
+// Writes one CSV line (at most CSV_MAX_LINE bytes) and returns its length.
+size_t formatTelemetryRow(char* line, const TelemetryRow& r, const InstrumentSpec& s);
+
+// ===== METRIC STORE =====
+// The same rows for the columnar store (metric_store.h, --store): the CSV's
+// columns under the CSV's names, unscaled, plus the per-diff buy_volume and
+// sell_volume. wall_event is the latest wall event's type + 1 (0 for none),
+// with its side, price, size and time in the columns after it; a row
+// repeats it until the next one, as in the CSV.
+std::vector<StoreColumn> storeColumns();
+void makeStoreRow(const TelemetryRow& r, StoreValue* out);
+
+// ===== CHECKPOINTS =====
+// What a warm restart needs of one book, as plain data written in place
+// into a CheckpointFile slot (checkpoint.h): the levels, the walls with
+// their lifetimes, and the flow windows and signals byte for byte. Levels
+// go last and only those in use are written; up to CHECKPOINT_LEVELS a
+// side are kept from the touch out, as deep as the largest REST snapshot.
+// Bump CHECKPOINT_LAYOUT whenever this struct, or anything in it, changes
+// shape: files with another layout are not read.
+const uint32_t CHECKPOINT_LAYOUT = 1;
+const int      CHECKPOINT_LEVELS = 5000;
+const int      CHECKPOINT_WALLS  = 256;
+
+struct BookCheckpoint {
+    char      symbol[CHECKPOINT_SYMBOL_CHARS];
+    int32_t   priceDecimals;
+    int32_t   qtyDecimals;
+    int64_t   eventTimeMs;
+    int64_t   lastUpdateId;      // where the book is in the stream; 0 with sync off
+    long long updateCount;
+
+    WallStats bidWallStats;
+    WallStats askWallStats;
+    WallInfo  bidWalls[CHECKPOINT_WALLS];
+    WallInfo  askWalls[CHECKPOINT_WALLS];
+    int32_t   numBidWalls;
+    int32_t   numAskWalls;
+    BookEvent recentWallEvents[WALL_EVENT_SLOTS];
+    int32_t   numRecentWallEvents;
+
+    Ewma      spreadEma;
+    bool      spreadWide;
+    decltype(Instrument::aggressiveBuy)    aggressiveBuy;
+    decltype(Instrument::aggressiveSell)   aggressiveSell;
+    decltype(Instrument::imbalanceHistory) imbalanceHistory;
+    Signals   signals;
+
+    int32_t   numBids;
+    int32_t   numAsks;
+    Level     levels[2 * CHECKPOINT_LEVELS];   // bids best first, then asks best first
+};
+
+// Copies in into c and returns how many bytes of c were written. Call on
+// a book in sequence (or with sync off), after its analytics ran.
+size_t saveCheckpoint(const Instrument& in, BookCheckpoint& c);
+
+// Rebuilds in from c. Levels go back through updateLevel without events;
+// walls, flow windows and signals come back as saved. False, leaving in
+// untouched, if c belongs to another symbol or scale.
+bool restoreCheckpoint(Instrument& in, const BookCheckpoint& c);
@@ -0,0 +1,327 @@
+#pragma once
+
+// A memory-mapped file of book checkpoints, for warm restarts.
+//
+// The file is a CheckpointHeader followed by two slots per book. A book's
+// owner writes each new checkpoint into the slot not holding the newest
+// one: it zeroes the slot's generation, writes the payload straight into
+// the mapping, then sets the checksum and a generation one higher than
+// the last. A process that dies mid-write leaves a zero generation (or,
+// after a power cut, a checksum that no longer matches) in that slot, and
+// the other one is still whole. The writes land in the page cache; the
+// kernel writes the pages back on its own schedule, and a clean exit
+// syncs them.
+//
+// A book's owner does not write the mapping itself: CheckpointWriter
+// takes a copy made in private memory and does the copy into the slot,
+// the checksum and the commit on a thread of its own, so write faults on
+// the mapping and waits on pages under writeback never reach the worker.
+//
+// The payload is opaque here: the engine decides what a book checkpoint
+// holds (book_engine.h) and passes its size and a layout version. A file
+// written by a build with another layout, version or number of books is
+// not read; it is recreated and the start is cold. Books are found by
+// symbol, so the order of --symbols may change between runs.
+
+#include <atomic>
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <chrono>
+#include <memory>
+#include <thread>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint64_t CHECKPOINT_MAGIC        = 0x3154504b43534c50ULL;   // "PLSCKPT1"
+const int      CHECKPOINT_SYMBOL_CHARS = 16;
+
+struct alignas(64) CheckpointHeader {
+    uint64_t magic;
+    uint32_t layout;      // the payload's version, from the caller
+    uint32_t numBooks;
+    uint64_t payloadBytes;
+    uint64_t slotBytes;
+};
+
+struct alignas(64) CheckpointSlot {
+    std::atomic<uint64_t> generation;   // 0: empty or being written
+    uint64_t checksum;                  // of the first `bytes` bytes of the payload
+    uint64_t bytes;
+    int64_t  savedNs;                   // wall clock at commit
+    char     symbol[CHECKPOINT_SYMBOL_CHARS];
+};
+
+// Four interleaved 64-bit word hashes, so the multiplies of one lane do
+// not wait on another's; a torn write shows up as a mismatch.
+inline uint64_t checkpointChecksum(const void* data, size_t bytes) {
+    const unsigned char* p = static_cast<const unsigned char*>(data);
+    const uint64_t K = 0xff51afd7ed558ccdULL;
+    uint64_t h[4] = {0x9e3779b97f4a7c15ULL ^ bytes, 1, 2, 3};
+    size_t i = 0;
+    for (; i + 32 <= bytes; i += 32) {
+        for (int l = 0; l < 4; l++) {
+            uint64_t w;
+            memcpy(&w, p + i + 8 * l, 8);
+            h[l] = (h[l] ^ w) * K;
+            h[l] ^= h[l] >> 29;
+        }
+    }
+    uint64_t r = h[0];
+    for (int l = 1; l < 4; l++) r = ((r ^ h[l]) * K) ^ (r >> 31);
+    for (; i < bytes; i++) r = (r ^ p[i]) * 0x100000001b3ULL;
+    return r;
+}
+
+class CheckpointFile {
+public:
+    CheckpointFile(const std::string& path, int numBooks, size_t payloadBytes, uint32_t layout)
+        : path_(path), numBooks_(numBooks), payloadBytes_(payloadBytes),
+          slotBytes_(roundUp(sizeof(CheckpointSlot) + payloadBytes, 4096)),
+          bytes_(roundUp(sizeof(CheckpointHeader), 4096) + 2 * (size_t)numBooks * slotBytes_),
+          nextGeneration_(numBooks, 1), writeSlot_(numBooks, 0) {
+        int fd = open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd < 0) throw std::runtime_error("cannot open checkpoint file " + path);
+        struct stat st;
+        bool sized = fstat(fd, &st) == 0 && (size_t)st.st_size == bytes_;
+        if (!sized && (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)bytes_) != 0)) {
+            close(fd);
+            throw std::runtime_error("cannot size checkpoint file " + path);
+        }
+        void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("cannot map checkpoint file " + path);
+        base_   = static_cast<char*>(p);
+        header_ = reinterpret_cast<CheckpointHeader*>(base_);
+
+        valid_ = sized && header_->magic == CHECKPOINT_MAGIC && header_->layout == layout &&
+                 header_->numBooks == (uint32_t)numBooks && header_->payloadBytes == payloadBytes &&
+                 header_->slotBytes == slotBytes_;
+        if (!valid_) {
+            memset(base_, 0, bytes_);
+            header_->layout       = layout;
+            header_->numBooks     = (uint32_t)numBooks;
+            header_->payloadBytes = payloadBytes;
+            header_->slotBytes    = slotBytes_;
+            std::atomic_thread_fence(std::memory_order_release);
+            header_->magic = CHECKPOINT_MAGIC;
+        }
+    }
+
+    ~CheckpointFile() {
+        msync(base_, bytes_, MS_SYNC);
+        munmap(base_, bytes_);
+    }
+
+    CheckpointFile(const CheckpointFile&) = delete;
+    CheckpointFile& operator=(const CheckpointFile&) = delete;
+
+    // False when the file was missing or written by an incompatible build
+    // and has been recreated empty.
+    bool   compatible() const { return valid_; }
+    size_t fileBytes() const  { return bytes_; }
+
+    // The newest whole checkpoint of symbol, or null. Call before any
+    // book is written.
+    const void* latest(const std::string& symbol, int64_t& savedNs) const {
+        const CheckpointSlot* best = nullptr;
+        for (int s = 0; s < 2 * numBooks_; s++) {
+            const CheckpointSlot* c = slot(s);
+            uint64_t gen = c->generation.load(std::memory_order_acquire);
+            if (gen == 0 || (best && gen <= best->generation.load(std::memory_order_relaxed))) continue;
+            if (strncmp(c->symbol, symbol.c_str(), CHECKPOINT_SYMBOL_CHARS) != 0) continue;
+            if (c->bytes > payloadBytes_ || checkpointChecksum(payload(c), c->bytes) != c->checksum) continue;
+            best = c;
+        }
+        if (!best) return nullptr;
+        savedNs = best->savedNs;
+        return payload(best);
+    }
+
+    // Checkpoints of book i are written from one thread only: begin()
+    // returns the payload to fill, commit() publishes the first bytes of it.
+    void* begin(int i) {
+        CheckpointSlot* c = slot(2 * i + writeSlot_[i]);
+        c->generation.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return payload(c);
+    }
+
+    void commit(int i, const std::string& symbol, size_t bytes) {
+        CheckpointSlot* c = slot(2 * i + writeSlot_[i]);
+        c->bytes    = bytes;
+        c->checksum = checkpointChecksum(payload(c), bytes);
+        c->savedNs  = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::system_clock::now().time_since_epoch()).count();
+        snprintf(c->symbol, CHECKPOINT_SYMBOL_CHARS, "%s", symbol.c_str());
+        c->generation.store(nextGeneration_[i]++, std::memory_order_release);
+        writeSlot_[i] ^= 1;
+    }
+
+    // Once restoring is done. New generations start above everything
+    // already in the file, so a restarted writer's first checkpoint
+    // outranks the one it restored, and each book first overwrites the
+    // older of its two slots.
+    void startWriting() {
+        uint64_t top = 0;
+        for (int s = 0; s < 2 * numBooks_; s++)
+            top = std::max(top, slot(s)->generation.load(std::memory_order_relaxed));
+        for (int i = 0; i < numBooks_; i++) {
+            nextGeneration_[i] = top + 1;
+            writeSlot_[i] = slot(2 * i)->generation.load(std::memory_order_relaxed) <=
+                            slot(2 * i + 1)->generation.load(std::memory_order_relaxed) ? 0 : 1;
+        }
+    }
+
+private:
+    static size_t roundUp(size_t n, size_t to) { return (n + to - 1) / to * to; }
+
+    CheckpointSlot* slot(int s) const {
+        return reinterpret_cast<CheckpointSlot*>(base_ + roundUp(sizeof(CheckpointHeader), 4096) +
+                                                 (size_t)s * slotBytes_);
+    }
+    static char* payload(const CheckpointSlot* c) {
+        return reinterpret_cast<char*>(const_cast<CheckpointSlot*>(c)) + sizeof(CheckpointSlot);
+    }
+
+    std::string       path_;
+    int               numBooks_;
+    size_t            payloadBytes_;
+    size_t            slotBytes_;
+    size_t            bytes_;
+    char*             base_;
+    CheckpointHeader* header_;
+    bool              valid_;
+    std::vector<uint64_t> nextGeneration_;
+    std::vector<int>      writeSlot_;
+};
+
+// ===== WRITER =====
+// Each producer (an engine worker) has two private buffers. It fills a
+// free one with a book's payload and submits it; the writer thread
+// commits it to the book's slot and frees the buffer. A producer never
+// waits: with both its buffers still queued, acquire() returns null and
+// the checkpoint is tried again later. A producer's buffers are written
+// in the order submitted, so a book's generations stay in order.
+class CheckpointWriter {
+public:
+    CheckpointWriter(CheckpointFile& file, int producers, size_t payloadBytes)
+        : file_(file), producers_(producers) {
+        for (auto& p : producers_)
+            for (auto& b : p.buffers) b.data.reset(new char[payloadBytes]);
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~CheckpointWriter() { stop(); }
+
+    CheckpointWriter(const CheckpointWriter&) = delete;
+    CheckpointWriter& operator=(const CheckpointWriter&) = delete;
+
+    // A free buffer of producer p to fill, or null if both are queued.
+    void* acquire(int p) {
+        Producer& pr = producers_[p];
+        for (int k = 0; k < 2; k++) {
+            Buffer& b = pr.buffers[k];
+            if (b.state.load(std::memory_order_acquire) == FREE) {
+                pr.filling = k;
+                return b.data.get();
+            }
+        }
+        busy_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    // Queues the buffer acquire() last returned as book's checkpoint.
+    // symbol must outlive the write.
+    void submit(int p, int book, const std::string& symbol, size_t bytes) {
+        Producer& pr = producers_[p];
+        Buffer& b = pr.buffers[pr.filling];
+        b.book   = book;
+        b.symbol = &symbol;
+        b.bytes  = bytes;
+        b.order  = ++pr.submitted;
+        b.state.store(READY, std::memory_order_release);
+    }
+
+    // Commits everything submitted so far, then ends the thread.
+    void stop() {
+        if (!thread_.joinable()) return;
+        stopping_.store(true, std::memory_order_release);
+        thread_.join();
+    }
+
+    uint64_t written()    const { return written_.load(std::memory_order_relaxed); }
+    uint64_t busy()       const { return busy_.load(std::memory_order_relaxed); }
+    uint64_t writeSumNs() const { return writeSumNs_.load(std::memory_order_relaxed); }
+    uint64_t writeMaxNs() const { return writeMaxNs_.load(std::memory_order_relaxed); }
+
+private:
+    enum { FREE, READY };
+
+    struct Buffer {
+        std::atomic<int>        state{FREE};
+        int                     book = 0;
+        const std::string*      symbol = nullptr;
+        size_t                  bytes = 0;
+        uint64_t                order = 0;
+        std::unique_ptr<char[]> data;
+    };
+
+    struct alignas(64) Producer {
+        Buffer   buffers[2];
+        int      filling   = 0;   // producer only
+        uint64_t submitted = 0;   // producer only
+    };
+
+    void run() {
+        while (true) {
+            bool last = stopping_.load(std::memory_order_acquire);
+            bool wrote = false;
+            for (auto& p : producers_) {
+                Buffer* b = next(p);
+                if (!b) continue;
+                write(*b);
+                wrote = true;
+            }
+            if (last && !wrote) return;
+            if (!wrote) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    }
+
+    // the older of p's ready buffers
+    static Buffer* next(Producer& p) {
+        Buffer* best = nullptr;
+        for (auto& b : p.buffers)
+            if (b.state.load(std::memory_order_acquire) == READY && (!best || b.order < best->order))
+                best = &b;
+        return best;
+    }
+
+    void write(Buffer& b) {
+        auto t0 = std::chrono::steady_clock::now();
+        memcpy(file_.begin(b.book), b.data.get(), b.bytes);
+        file_.commit(b.book, *b.symbol, b.bytes);
+        b.state.store(FREE, std::memory_order_release);
+        uint64_t ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                          std::chrono::steady_clock::now() - t0).count();
+        written_.fetch_add(1, std::memory_order_relaxed);
+        writeSumNs_.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > writeMaxNs_.load(std::memory_order_relaxed))
+            writeMaxNs_.store(ns, std::memory_order_relaxed);
+    }
+
+    CheckpointFile&       file_;
+    std::vector<Producer> producers_;
+    std::atomic<bool>     stopping_{false};
+    std::atomic<uint64_t> written_{0};
+    std::atomic<uint64_t> busy_{0};
+    std::atomic<uint64_t> writeSumNs_{0};
+    std::atomic<uint64_t> writeMaxNs_{0};
+    std::thread           thread_;
+};
@@ -0,0 +1,79 @@
+#pragma once
+
+// Cheap, monotonic cycle counter for latency measurement.
+//
+//   x86-64   RDTSC. With an invariant TSC (every x86 server of the last
+//            decade) it ticks at a constant rate on all cores, so stamps
+//            taken on one thread can be compared on another. The rate is
+//            not architecturally visible and is calibrated against
+//            steady_clock at startup.
+//   AArch64  The generic timer's virtual count (CNTVCT_EL0), system-wide
+//            by definition, at the rate CNTFRQ_EL0 reports.
+//   other    steady_clock nanoseconds.
+//
+// Reading the counter is a single unprivileged instruction; converting to
+// nanoseconds is one multiply, done off the hot path where possible.
+
+#include <cstdint>
+#include <chrono>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#include <cpuid.h>
+#endif
+
+inline uint64_t cycleNow() {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#elif defined(__aarch64__)
+    uint64_t v;
+    asm volatile("mrs %0, cntvct_el0" : "=r"(v));
+    return v;
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+struct CycleClock {
+    double      hz         = 1e9;
+    double      nsPerCycle = 1.0;
+    const char* source     = "steady_clock";
+    bool        invariant  = true;   // rate constant across cores and P-states
+
+    double   toNs(uint64_t cycles) const { return (double)cycles * nsPerCycle; }
+    uint64_t toNsInt(uint64_t cycles) const { return (uint64_t)((double)cycles * nsPerCycle); }
+
+    // Stamps taken on different threads can be a few cycles out of order;
+    // treat that as zero rather than a huge unsigned difference.
+    uint64_t elapsedNs(uint64_t from, uint64_t to) const {
+        return to > from ? toNsInt(to - from) : 0;
+    }
+
+    // Blocks for about calibrateMs on x86; instant elsewhere.
+    static CycleClock calibrate(int calibrateMs = 50) {
+        CycleClock c;
+#if defined(__x86_64__) || defined(__i386__)
+        c.source = "tsc";
+        unsigned a, b, cx, d;
+        c.invariant = __get_cpuid(0x80000007, &a, &b, &cx, &d) && (d & (1u << 8));
+
+        typedef std::chrono::steady_clock Clock;
+        auto     t0 = Clock::now();
+        uint64_t c0 = cycleNow();
+        while (Clock::now() - t0 < std::chrono::milliseconds(calibrateMs)) {}
+        auto     t1 = Clock::now();
+        uint64_t c1 = cycleNow();
+        c.hz = (double)(c1 - c0) / std::chrono::duration<double>(t1 - t0).count();
+#elif defined(__aarch64__)
+        (void)calibrateMs;
+        c.source = "cntvct";
+        uint64_t f;
+        asm volatile("mrs %0, cntfrq_el0" : "=r"(f));
+        c.hz = (double)f;
+#else
+        (void)calibrateMs;
+#endif
+        c.nsPerCycle = 1e9 / c.hz;
+        return c;
+    }
+};
@@ -0,0 +1,335 @@
+#pragma once
+
+// Streaming parser for Binance depthUpdate frames.
+//
+// Works directly on the bytes of the received frame: the header fields are
+// decoded into a DepthMessage of integers and string_views, and the "b"/"a"
+// arrays are only located, not materialised. forEachLevel() then walks an
+// array and hands every level to a callback as integer price ticks and
+// quantity lots, parsed straight from the decimal strings. Nothing here
+// touches the heap or goes through double.
+
+#include <cstdint>
+#include <string_view>
+#include "fixed_point.h"
+
+struct DepthMessage {
+    std::string_view eventType;
+    std::string_view symbol;
+    int64_t eventTime         = 0;
+    int64_t firstUpdateId     = 0;   // "U"
+    int64_t finalUpdateId     = 0;   // "u"
+    int64_t prevFinalUpdateId = -1;  // "pu", futures streams only
+    std::string_view bids;           // raw "[[p,q],...]" text
+    std::string_view asks;
+};
+
+// REST /depth snapshot: {"lastUpdateId":N,"bids":[...],"asks":[...]}
+struct DepthSnapshot {
+    int64_t lastUpdateId = 0;
+    std::string_view bids;
+    std::string_view asks;
+};
+
+namespace depth_parser {
+
+inline void skipWs(const char*& p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\n' || *p == '\r' || *p == '\t')) ++p;
+}
+
+inline bool expect(const char*& p, const char* end, char c) {
+    skipWs(p, end);
+    if (p >= end || *p != c) return false;
+    ++p;
+    return true;
+}
+
+// "..." without escape handling beyond skipping \x pairs; depth frames
+// never carry escaped characters in the fields we read
+inline bool readString(const char*& p, const char* end, std::string_view& out) {
+    if (!expect(p, end, '"')) return false;
+    const char* s = p;
+    while (p < end && *p != '"') {
+        if (*p == '\\') ++p;
+        ++p;
+    }
+    if (p >= end) return false;
+    out = std::string_view(s, p - s);
+    ++p;
+    return true;
+}
+
+inline bool readInt(const char*& p, const char* end, int64_t& out) {
+    skipWs(p, end);
+    bool neg = false;
+    if (p < end && *p == '-') { neg = true; ++p; }
+    if (p >= end || *p < '0' || *p > '9') return false;
+    int64_t v = 0;
+    while (p < end && *p >= '0' && *p <= '9') v = v * 10 + (*p++ - '0');
+    out = neg ? -v : v;
+    return true;
+}
+
+// Decimal text -> fixed point with `decimals` fractional digits.
+// Digits past the scale may only be zeros, which is how the exchange pads
+// them; a non-zero one means the instrument's decimals are wrong, and the
+// value is rejected rather than rounded onto a coarser tick.
+inline bool parseFixed(const char* p, const char* end, int decimals, int64_t& out) {
+    if (p >= end) return false;
+    int64_t whole = 0;
+    while (p < end && *p >= '0' && *p <= '9') whole = whole * 10 + (*p++ - '0');
+
+    int64_t frac = 0;
+    int     fracDigits = 0;
+    if (p < end && *p == '.') {
+        ++p;
+        while (p < end && *p >= '0' && *p <= '9') {
+            if (fracDigits < decimals) { frac = frac * 10 + (*p - '0'); fracDigits++; }
+            else if (*p != '0') return false;
+            ++p;
+        }
+    }
+    if (p != end) return false;
+    out = whole * FIXED_POW10[decimals] + frac * FIXED_POW10[decimals - fracDigits];
+    return true;
+}
+
+// The same for a scale known at compile time. Exactly Decimals digits are
+// read after the point, padded with zeros, so the scaling is a constant
+// multiply rather than a table lookup on the digit count.
+template <int Decimals>
+inline bool parseFixed(const char* p, const char* end, int64_t& out) {
+    if (p >= end) return false;
+    int64_t whole = 0;
+    while (p < end && *p >= '0' && *p <= '9') whole = whole * 10 + (*p++ - '0');
+
+    int64_t frac = 0;
+    if (p < end && *p == '.') {
+        ++p;
+        for (int i = 0; i < Decimals; i++) {
+            int digit = 0;
+            if (p < end && *p >= '0' && *p <= '9') digit = *p++ - '0';
+            frac = frac * 10 + digit;
+        }
+        while (p < end && *p == '0') ++p;
+    }
+    if (p != end) return false;
+    out = whole * FIXED_POW10[Decimals] + frac;
+    return true;
+}
+
+// Skips any JSON value: string, number, literal, array or object.
+inline bool skipValue(const char*& p, const char* end) {
+    skipWs(p, end);
+    if (p >= end) return false;
+    if (*p == '"') { std::string_view s; return readString(p, end, s); }
+    if (*p == '[' || *p == '{') {
+        int depth = 0;
+        while (p < end) {
+            char c = *p;
+            if (c == '"') { std::string_view s; if (!readString(p, end, s)) return false; continue; }
+            if (c == '[' || c == '{') depth++;
+            else if (c == ']' || c == '}') { if (--depth == 0) { ++p; return true; } }
+            ++p;
+        }
+        return false;
+    }
+    while (p < end && *p != ',' && *p != '}' && *p != ']') ++p;
+    return true;
+}
+
+inline bool readRawValue(const char*& p, const char* end, std::string_view& out) {
+    skipWs(p, end);
+    const char* s = p;
+    if (!skipValue(p, end)) return false;
+    out = std::string_view(s, p - s);
+    return true;
+}
+
+} // namespace depth_parser
+
+// Decodes the top-level object. Unknown keys are skipped so the same
+// parser serves spot, futures and combined-stream payloads.
+inline bool parseDepthMessage(const char* data, size_t len, DepthMessage& out) {
+    using namespace depth_parser;
+    const char* p   = data;
+    const char* end = data + len;
+    out = DepthMessage{};
+
+    if (!expect(p, end, '{')) return false;
+    skipWs(p, end);
+    if (p < end && *p == '}') return true;
+
+    while (true) {
+        std::string_view key;
+        if (!readString(p, end, key) || !expect(p, end, ':')) return false;
+
+        bool ok;
+        if      (key == "b")  ok = readRawValue(p, end, out.bids);
+        else if (key == "a")  ok = readRawValue(p, end, out.asks);
+        else if (key == "U")  ok = readInt(p, end, out.firstUpdateId);
+        else if (key == "u")  ok = readInt(p, end, out.finalUpdateId);
+        else if (key == "pu") ok = readInt(p, end, out.prevFinalUpdateId);
+        else if (key == "E")  ok = readInt(p, end, out.eventTime);
+        else if (key == "e")  ok = readString(p, end, out.eventType);
+        else if (key == "s")  ok = readString(p, end, out.symbol);
+        else                  ok = skipValue(p, end);
+        if (!ok) return false;
+
+        skipWs(p, end);
+        if (p < end && *p == ',') { ++p; continue; }
+        if (p < end && *p == '}') return true;
+        return false;
+    }
+}
+
+// Combined-stream envelope: {"stream":"btcusdt@depth","data":{...}}.
+// Yields the stream name and the raw payload object, which is then parsed
+// as a plain depth message.
+inline bool parseStreamEnvelope(const char* data, size_t len,
+                                std::string_view& stream, std::string_view& payload) {
+    using namespace depth_parser;
+    const char* p   = data;
+    const char* end = data + len;
+    stream = payload = std::string_view();
+
+    if (!expect(p, end, '{')) return false;
+    for (bool first = true;; first = false) {
+        std::string_view key;
+        if (!readString(p, end, key) || !expect(p, end, ':')) return false;
+        // a bare depth message: bail out before walking its level arrays
+        if (first && key != "stream" && key != "data") return false;
+
+        bool ok;
+        if      (key == "stream") ok = readString(p, end, stream);
+        else if (key == "data")   ok = readRawValue(p, end, payload);
+        else                      ok = skipValue(p, end);
+        if (!ok) return false;
+
+        skipWs(p, end);
+        if (p < end && *p == ',') { ++p; continue; }
+        if (p < end && *p == '}') return !stream.empty() && !payload.empty();
+        return false;
+    }
+}
+
+// Reads only the "s" field of a depth message, stopping as soon as it is
+// found; the exchange sends it third, ahead of the level arrays.
+inline bool peekSymbol(const char* data, size_t len, std::string_view& symbol) {
+    using namespace depth_parser;
+    const char* p   = data;
+    const char* end = data + len;
+
+    if (!expect(p, end, '{')) return false;
+    while (true) {
+        std::string_view key;
+        if (!readString(p, end, key) || !expect(p, end, ':')) return false;
+        if (key == "s") return readString(p, end, symbol);
+        if (!skipValue(p, end)) return false;
+        if (!expect(p, end, ',')) return false;
+    }
+}
+
+// Reads only the "u" field of a depth message; it comes ahead of the level
+// arrays, so this is as cheap as peekSymbol.
+inline bool peekFinalUpdateId(const char* data, size_t len, int64_t& finalUpdateId) {
+    using namespace depth_parser;
+    const char* p   = data;
+    const char* end = data + len;
+
+    if (!expect(p, end, '{')) return false;
+    while (true) {
+        std::string_view key;
+        if (!readString(p, end, key) || !expect(p, end, ':')) return false;
+        if (key == "u") return readInt(p, end, finalUpdateId);
+        if (!skipValue(p, end)) return false;
+        if (!expect(p, end, ',')) return false;
+    }
+}
+
+inline bool parseDepthSnapshot(const char* data, size_t len, DepthSnapshot& out) {
+    using namespace depth_parser;
+    const char* p   = data;
+    const char* end = data + len;
+    out = DepthSnapshot{};
+
+    if (!expect(p, end, '{')) return false;
+    bool haveId = false;
+    while (true) {
+        std::string_view key;
+        if (!readString(p, end, key) || !expect(p, end, ':')) return false;
+
+        bool ok;
+        if      (key == "bids")         ok = readRawValue(p, end, out.bids);
+        else if (key == "asks")         ok = readRawValue(p, end, out.asks);
+        else if (key == "lastUpdateId") ok = haveId = readInt(p, end, out.lastUpdateId);
+        else                            ok = skipValue(p, end);
+        if (!ok) return false;
+
+        skipWs(p, end);
+        if (p < end && *p == ',') { ++p; continue; }
+        if (p < end && *p == '}') return haveId;
+        return false;
+    }
+}
+
+namespace depth_parser {
+
+// Walks a "[[price,qty],...]" array, turning each entry's strings into
+// ticks and lots with parse(priceStr, qtyStr, ticks, lots), and calls
+// onLevel(ticks, lots). Returns the number of levels, or -1 if malformed.
+template <typename Parse, typename OnLevel>
+inline int walkLevels(std::string_view levels, Parse&& parse, OnLevel&& onLevel) {
+    const char* p   = levels.data();
+    const char* end = levels.data() + levels.size();
+    if (levels.empty()) return 0;
+
+    if (!expect(p, end, '[')) return -1;
+    skipWs(p, end);
+    if (p < end && *p == ']') return 0;
+
+    int count = 0;
+    while (true) {
+        std::string_view priceStr, qtyStr;
+        if (!expect(p, end, '[') || !readString(p, end, priceStr) ||
+            !expect(p, end, ',') || !readString(p, end, qtyStr)) return -1;
+        // tolerate extra trailing fields in the level tuple
+        skipWs(p, end);
+        while (p < end && *p == ',') { ++p; if (!skipValue(p, end)) return -1; skipWs(p, end); }
+        if (!expect(p, end, ']')) return -1;
+
+        int64_t ticks, lots;
+        if (!parse(priceStr, qtyStr, ticks, lots)) return -1;
+        onLevel(ticks, lots);
+        count++;
+
+        skipWs(p, end);
+        if (p < end && *p == ',') { ++p; continue; }
+        if (p < end && *p == ']') return count;
+        return -1;
+    }
+}
+
+} // namespace depth_parser
+
+// Walks a "[[price,qty],...]" array and calls onLevel(priceTicks, qtyLots)
+// for each entry. Returns the number of levels, or -1 if malformed.
+template <typename OnLevel>
+inline int forEachLevel(std::string_view levels, int priceDecimals, int qtyDecimals,
+                        OnLevel&& onLevel) {
+    return depth_parser::walkLevels(levels,
+        [priceDecimals, qtyDecimals](std::string_view price, std::string_view qty, int64_t& ticks, int64_t& lots) {
+            return depth_parser::parseFixed(price.data(), price.data() + price.size(), priceDecimals, ticks) &&
+                   depth_parser::parseFixed(qty.data(), qty.data() + qty.size(), qtyDecimals, lots);
+        }, onLevel);
+}
+
+// forEachLevel with the decimals fixed at compile time.
+template <int PriceDecimals, int QtyDecimals, typename OnLevel>
+inline int forEachLevel(std::string_view levels, OnLevel&& onLevel) {
+    return depth_parser::walkLevels(levels,
+        [](std::string_view price, std::string_view qty, int64_t& ticks, int64_t& lots) {
+            return depth_parser::parseFixed<PriceDecimals>(price.data(), price.data() + price.size(), ticks) &&
+                   depth_parser::parseFixed<QtyDecimals>(qty.data(), qty.data() + qty.size(), lots);
+        }, onLevel);
+}
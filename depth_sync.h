@@ -0,0 +1,176 @@
+#pragma once
+
+// Snapshot + diff synchronisation for the depth stream.
+//
+// Follows the exchange's procedure for maintaining a local book:
+//   1. diffs are buffered until a REST snapshot is available
+//   2. the snapshot is rejected if it is older than the first buffered diff
+//   3. diffs with u <= lastUpdateId are stale and dropped (u < lastUpdateId
+//      on futures streams, whose diffs carry pu)
+//   4. the first diff applied must straddle lastUpdateId + 1 (futures:
+//      U <= lastUpdateId <= u)
+//   5. afterwards each diff must continue the previous one: U == prev u + 1
+//      on spot streams, pu == prev u on futures streams
+// A break in 5 is a gap. The caller wipes the book and fetches a fresh
+// snapshot while the socket stays open; the diffs that arrive meanwhile are
+// buffered here and replayed once the snapshot is in.
+//
+// This class only makes decisions. It owns no book and does no I/O, so the
+// live feed and journal replay drive it the same way.
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <chrono>
+#include "depth_parser.h"
+
+enum class SyncState {
+    AwaitingSnapshot,   // buffering diffs, snapshot wanted
+    Bridging,           // snapshot applied, waiting for the straddling diff
+    Live                // in sequence
+};
+
+enum class SyncVerdict {
+    Apply,
+    Drop,     // stale or not a depth update
+    Buffer,   // hold until the snapshot is applied
+    Gap       // sequence broken; caller must restart()
+};
+
+class DepthSync {
+public:
+    SyncState state() const { return state_; }
+
+    const char* stateName() const {
+        switch (state_) {
+            case SyncState::AwaitingSnapshot: return "SNAPSHOT";
+            case SyncState::Bridging:         return "BRIDGING";
+            case SyncState::Live:             return "LIVE";
+        }
+        return "?";
+    }
+
+    bool needsSnapshot() const {
+        return state_ == SyncState::AwaitingSnapshot && !pending_.empty();
+    }
+
+    SyncVerdict onUpdate(const DepthMessage& m) {
+        if (m.finalUpdateId == 0) return SyncVerdict::Drop;
+
+        switch (state_) {
+        case SyncState::AwaitingSnapshot:
+            return SyncVerdict::Buffer;
+
+        case SyncState::Bridging: {
+            // futures snapshots are bridged by the diff that contains
+            // lastUpdateId itself, spot ones by the diff after it; a futures
+            // diff that continues lastUpdateId exactly (pu) bridges too. A
+            // restored checkpoint already holds the diff that ended at
+            // lastUpdateId, so only one strictly after it bridges.
+            bool futures = m.prevFinalUpdateId >= 0;
+            int64_t bridge = futures && fromSnapshot_ ? lastUpdateId_ : lastUpdateId_ + 1;
+            if (m.finalUpdateId < bridge) { staleDropped_++; return SyncVerdict::Drop; }
+            bool continues = futures && m.prevFinalUpdateId == lastUpdateId_;
+            if (fromSnapshot_ ? m.firstUpdateId > bridge && !continues
+                              : futures ? !continues : m.firstUpdateId > bridge)
+                return gap();
+            goLive(m.finalUpdateId);
+            return SyncVerdict::Apply;
+        }
+
+        case SyncState::Live: {
+            bool inSequence = m.prevFinalUpdateId >= 0
+                              ? m.prevFinalUpdateId == lastUpdateId_
+                              : m.firstUpdateId == lastUpdateId_ + 1;
+            if (inSequence) {
+                lastUpdateId_ = m.finalUpdateId;
+                return SyncVerdict::Apply;
+            }
+            if (m.finalUpdateId <= lastUpdateId_) { staleDropped_++; return SyncVerdict::Drop; }
+            return gap();
+        }
+        }
+        return SyncVerdict::Drop;
+    }
+
+    // copies the frame; only happens while a snapshot is outstanding
+    void buffer(const char* data, size_t len, int64_t firstUpdateId) {
+        if (pending_.empty()) firstPendingId_ = firstUpdateId;
+        pending_.emplace_back(data, len);
+    }
+
+    // Drops the book's sequence position and starts buffering for a new
+    // snapshot. Called on a gap and on reconnect.
+    void restart() {
+        state_ = SyncState::AwaitingSnapshot;
+        pending_.clear();
+        resyncStart_ = std::chrono::steady_clock::now();
+    }
+
+    // A snapshot older than the first buffered diff cannot be bridged;
+    // the caller must fetch again.
+    bool acceptSnapshot(int64_t lastUpdateId) {
+        if (!pending_.empty() && lastUpdateId < firstPendingId_) {
+            staleSnapshots_++;
+            return false;
+        }
+        return true;
+    }
+
+    // Called once the snapshot levels are in the book. Returns the frames
+    // buffered meanwhile, which the caller feeds back through onUpdate.
+    std::vector<std::string> snapshotApplied(int64_t lastUpdateId) {
+        lastUpdateId_ = lastUpdateId;
+        state_ = SyncState::Bridging;
+        fromSnapshot_ = true;
+        snapshots_++;
+        lastResyncMs_ = std::chrono::duration<double, std::milli>(
+            std::chrono::steady_clock::now() - resyncStart_).count();
+        std::vector<std::string> out;
+        out.swap(pending_);
+        return out;
+    }
+
+    // The book was restored from a checkpoint taken at lastUpdateId. It is
+    // kept only if the stream continues it exactly (pu == lastUpdateId on
+    // futures, U <= lastUpdateId + 1 <= u on spot); diffs up to
+    // lastUpdateId are already in it and are dropped, and a stream that has
+    // moved past it is a gap (and a cold resync).
+    void resume(int64_t lastUpdateId) {
+        lastUpdateId_ = lastUpdateId;
+        state_ = SyncState::Bridging;
+        fromSnapshot_ = false;
+        pending_.clear();
+    }
+
+    int64_t   lastUpdateId()   const { return lastUpdateId_; }
+    long long gaps()           const { return gaps_; }
+    long long snapshots()      const { return snapshots_; }
+    long long staleDropped()   const { return staleDropped_; }
+    long long staleSnapshots() const { return staleSnapshots_; }
+    double    lastResyncMs()   const { return lastResyncMs_; }
+
+private:
+    SyncVerdict gap() {
+        gaps_++;
+        return SyncVerdict::Gap;
+    }
+
+    void goLive(int64_t finalUpdateId) {
+        lastUpdateId_ = finalUpdateId;
+        state_ = SyncState::Live;
+    }
+
+    SyncState state_ = SyncState::AwaitingSnapshot;
+    int64_t   lastUpdateId_   = 0;
+    int64_t   firstPendingId_ = 0;
+    bool      fromSnapshot_   = true;   // bridging a REST snapshot, not a restored checkpoint
+    std::vector<std::string> pending_;
+
+    std::chrono::steady_clock::time_point resyncStart_ = std::chrono::steady_clock::now();
+    long long gaps_           = 0;
+    long long snapshots_      = 0;
+    long long staleDropped_   = 0;
+    long long staleSnapshots_ = 0;
+    double    lastResyncMs_   = 0.0;
+};
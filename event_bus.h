@@ -0,0 +1,132 @@
+#pragma once
+
+// Fixed-size typed events from the engine workers to any number of
+// subscribers, without locks or allocation on the publishing side.
+//
+// Each producer (one engine worker) owns an EventRing: a power-of-two array
+// of slots it overwrites in order and never waits on. Every slot carries a
+// sequence word written before and after the event, seqlock style, so a
+// reader can tell a finished event from one being overwritten under it.
+// Subscribers keep their own cursor per ring and a type mask, and poll;
+// one that falls more than a ring behind skips ahead and counts what it
+// lost. Events are plain structs with a small integer `type` field, so
+// publishing is a copy and three stores, and turning one into text is left
+// to whichever consumer wants text.
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <type_traits>
+#include <vector>
+#include "pipeline.h"
+
+inline uint32_t eventBit(int type) { return 1u << type; }
+
+template <typename Event>
+class EventRing {
+    static_assert(std::is_trivially_copyable<Event>::value, "events are copied between threads raw");
+
+public:
+    // capacity is rounded up to a power of two
+    explicit EventRing(size_t capacity) {
+        size_t cap = 64;
+        while (cap < capacity) cap <<= 1;
+        slots_.reset(new Slot[cap]);
+        mask_ = cap - 1;
+    }
+
+    size_t capacity() const { return mask_ + 1; }
+
+    // Number of events ever published; the next one gets this number.
+    uint64_t head() const { return head_.load(std::memory_order_acquire); }
+
+    // ---- producer side ----
+
+    void publish(const Event& e) {
+        uint64_t n = head_.load(std::memory_order_relaxed);
+        Slot& s = slots_[n & mask_];
+        s.seq.store(2 * n + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        s.event = e;
+        s.seq.store(2 * n + 2, std::memory_order_release);
+        head_.store(n + 1, std::memory_order_release);
+    }
+
+    // ---- consumer side ----
+
+    // Copies event n into out; false if it has been overwritten since.
+    bool read(uint64_t n, Event& out) const {
+        const Slot& s = slots_[n & mask_];
+        uint64_t before = s.seq.load(std::memory_order_acquire);
+        if (before != 2 * n + 2) return false;
+        out = s.event;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.seq.load(std::memory_order_relaxed) == before;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint64_t> seq{0};
+        Event                 event;
+    };
+
+    std::unique_ptr<Slot[]> slots_;
+    size_t                  mask_;
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+};
+
+template <typename Event>
+class EventBus {
+public:
+    struct Subscriber {
+        uint32_t              mask = 0;
+        std::vector<uint64_t> cursors;        // next event number, per ring
+        uint64_t              delivered = 0;
+        uint64_t              lost      = 0;  // overwritten before it was read
+    };
+
+    // Rings are added before any producer or subscriber starts.
+    EventRing<Event>& addProducer(size_t capacity) {
+        rings_.emplace_back(new EventRing<Event>(capacity));
+        return *rings_.back();
+    }
+
+    size_t producers() const { return rings_.size(); }
+
+    // A subscriber sees events published from now on whose type is in mask.
+    Subscriber subscribe(uint32_t mask) const {
+        Subscriber sub;
+        sub.mask = mask;
+        for (auto& r : rings_) sub.cursors.push_back(r->head());
+        return sub;
+    }
+
+    // Hands every new matching event to f(const Event&), ring by ring, and
+    // returns how many were delivered.
+    template <typename F>
+    size_t poll(Subscriber& sub, F&& f) const {
+        size_t n = 0;
+        Event e;
+        for (size_t i = 0; i < rings_.size(); i++) {
+            const EventRing<Event>& r = *rings_[i];
+            uint64_t& cur  = sub.cursors[i];
+            uint64_t  head = r.head();
+            if (head - cur > r.capacity()) {
+                sub.lost += head - r.capacity() - cur;
+                cur = head - r.capacity();
+            }
+            for (; cur < head; cur++) {
+                if (!r.read(cur, e)) { sub.lost++; continue; }
+                if (!(sub.mask & eventBit(e.type))) continue;
+                f(e);
+                n++;
+            }
+        }
+        sub.delivered += n;
+        return n;
+    }
+
+private:
+    std::vector<std::unique_ptr<EventRing<Event>>> rings_;
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+// First-arrival arbitration between redundant connections ("legs") to the
+// same depth stream.
+//
+// Every leg delivers the same updates in order, so per instrument it is
+// enough to remember the highest final update id ("u") already passed on:
+// a copy at or below it is a duplicate and is dropped after one compare,
+// before the frame is journaled or copied into a worker ring. A leg that
+// stalls or dies simply stops winning; the others carry the book with no
+// gap. Depth updates carry absolute level quantities, so even if two
+// connections were batched differently, an overlapping range applied twice
+// is harmless, and the engine's own sequence checks still catch a real gap.
+//
+// For statistics the arbiter keeps the arrival time of the last RECENT
+// winners per instrument, keyed by u. A duplicate that finds its winner
+// there records how far behind it arrived in its leg's lag histogram.
+//
+// Single-threaded: all legs run on the reader's io_context. The statistics
+// are relaxed atomics so the UI can read them.
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include "cycle_clock.h"
+#include "latency_histogram.h"
+
+struct LegStats {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> wins{0};        // first copy of an update
+    std::atomic<uint64_t> duplicates{0};  // dropped: another leg was first
+    std::atomic<bool>     up{false};
+    LatencyHistogram      lag;            // duplicates: ns behind the winner
+};
+
+class FeedArbiter {
+public:
+    static const int RECENT = 1024;   // power of two
+
+    FeedArbiter(int legs, int instruments, const CycleClock& clock)
+        : numLegs_(legs), legs_(new LegStats[legs]), books_(instruments), clock_(clock) {}
+
+    int legs() const { return numLegs_; }
+    const LegStats& leg(int i) const { return legs_[i]; }
+
+    // True if this copy of update finalUpdateId is the first to arrive and
+    // should be applied.
+    bool accept(int leg, int instrument, int64_t finalUpdateId, uint64_t recvCycles) {
+        LegStats& s = legs_[leg];
+        Book&     b = books_[instrument];
+        s.frames.store(s.frames.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+        if (finalUpdateId <= b.lastFinal) {
+            s.duplicates.store(s.duplicates.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            const Arrival& a = b.recent[finalUpdateId & (RECENT - 1)];
+            if (a.finalUpdateId == finalUpdateId) s.lag.record(clock_.elapsedNs(a.cycles, recvCycles));
+            return false;
+        }
+        b.lastFinal = finalUpdateId;
+        b.recent[finalUpdateId & (RECENT - 1)] = {finalUpdateId, recvCycles};
+        s.wins.store(s.wins.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void legUp(int leg) { legs_[leg].up.store(true, std::memory_order_relaxed); }
+
+    // Returns how many legs are still up.
+    int legDown(int leg) {
+        legs_[leg].up.store(false, std::memory_order_relaxed);
+        return legsUp();
+    }
+
+    int legsUp() const {
+        int n = 0;
+        for (int i = 0; i < numLegs_; i++) n += legs_[i].up.load(std::memory_order_relaxed);
+        return n;
+    }
+
+    // Every leg was down and the books are being rebuilt: accept whatever
+    // comes next.
+    void reset() {
+        for (Book& b : books_) b = Book();
+    }
+
+private:
+    struct Arrival {
+        int64_t  finalUpdateId = -1;
+        uint64_t cycles        = 0;
+    };
+
+    struct Book {
+        int64_t lastFinal = -1;
+        Arrival recent[RECENT];
+    };
+
+    int                         numLegs_;
+    std::unique_ptr<LegStats[]> legs_;
+    std::vector<Book>           books_;
+    CycleClock                  clock_;
+};
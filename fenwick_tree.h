@@ -0,0 +1,81 @@
+#pragma once
+
+// Fenwick (binary indexed) tree of quantities over a fixed range of slots.
+//
+// Node k holds the sum of the (k & -k) slots ending at slot k-1, so a
+// point update or a prefix sum touches O(log n) nodes, and the first slot
+// at which the running total reaches a target is found by one descent over
+// the powers of two. With the 65,536-cell default window that is 16 steps
+// for any of them, however many levels lie in between. Quantities must be
+// non-negative for the searches to be meaningful.
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+class FenwickTree {
+public:
+    explicit FenwickTree(int slots) : n_(slots), tree_(slots + 1, 0) {
+        top_ = 1;
+        while (top_ * 2 <= n_) top_ *= 2;
+    }
+
+    int slots() const { return n_; }
+
+    void add(int i, int64_t delta) {
+        for (int k = i + 1; k <= n_; k += k & -k) tree_[k] += delta;
+    }
+
+    // Sum of slots [0, i]; 0 for i < 0.
+    int64_t prefix(int i) const {
+        int64_t s = 0;
+        for (int k = std::min(i, n_ - 1) + 1; k > 0; k -= k & -k) s += tree_[k];
+        return s;
+    }
+
+    // Sum of slots [lo, hi].
+    int64_t range(int lo, int hi) const {
+        return lo > hi ? 0 : prefix(hi) - prefix(lo - 1);
+    }
+
+    // Smallest i with prefix(i) >= target, or slots() if the total falls short.
+    int lowerBound(int64_t target) const { return descend(target, false); }
+
+    // Smallest i with prefix(i) > target, or slots().
+    int upperBound(int64_t target) const { return descend(target, true); }
+
+    // Rebuilds from plain slot values in O(n).
+    template <typename T>
+    void build(const std::vector<T>& values) {
+        tree_[0] = 0;
+        for (int k = 1; k <= n_; k++) tree_[k] = (int64_t)values[k - 1];
+        for (int k = 1; k <= n_; k++) {
+            int parent = k + (k & -k);
+            if (parent <= n_) tree_[parent] += tree_[k];
+        }
+    }
+
+    void clearAll() { std::fill(tree_.begin(), tree_.end(), 0); }
+
+private:
+    // Walks down from the largest power of two, keeping every node whose
+    // sum still leaves the running total below (or at, when strict) target.
+    int descend(int64_t target, bool strict) const {
+        int pos = 0;
+        int64_t acc = 0;
+        for (int step = top_; step > 0; step >>= 1) {
+            int k = pos + step;
+            if (k > n_) continue;
+            int64_t next = acc + tree_[k];
+            if (strict ? next <= target : next < target) {
+                pos = k;
+                acc = next;
+            }
+        }
+        return pos;   // slots [0, pos) fall short, so the answer is slot pos
+    }
+
+    int n_;
+    int top_;
+    std::vector<int64_t> tree_;   // 1-based
+};
@@ -0,0 +1,59 @@
+#pragma once
+
+// Integer price / quantity representation used by the book.
+//
+// Prices travel as Ticks (multiples of the instrument tick size) and
+// quantities as Lots (multiples of the step size). Both are exact, so the
+// apply loop never rounds. Doubles are produced only for display, and the
+// CSV writer formats the integers directly.
+
+#include <cstdint>
+#include <cstddef>
+
+typedef int64_t  Ticks;
+typedef uint32_t Lots;    // 32 bits: ~42,949 BTC per level at 1e-5 step
+
+const int64_t FIXED_POW10[] = {
+    1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL,
+    100000000LL, 1000000000LL, 10000000000LL, 100000000000LL, 1000000000000LL
+};
+
+// parsed lot counts are 64-bit; a level larger than the Lots range is
+// clamped rather than wrapped
+inline Lots toLots(int64_t lots) {
+    if (lots < 0) return 0;
+    if (lots > (int64_t)UINT32_MAX) return UINT32_MAX;
+    return (Lots)lots;
+}
+
+// display edge only: exact division keeps the double identical to what
+// stod() produced from the original decimal string
+inline double fixedToDouble(int64_t value, int decimals) {
+    return (double)value / (double)FIXED_POW10[decimals];
+}
+
+// Writes `value` (scaled by 10^valueDecimals) with `outDecimals` digits
+// after the point, rounding half away from zero. Returns characters
+// written; `out` needs room for 24 characters.
+inline size_t formatFixed(char* out, int64_t value, int valueDecimals, int outDecimals) {
+    bool neg = value < 0;
+    uint64_t v = neg ? (uint64_t)(-value) : (uint64_t)value;
+
+    if (outDecimals < valueDecimals) {
+        uint64_t div = (uint64_t)FIXED_POW10[valueDecimals - outDecimals];
+        v = (v + div / 2) / div;
+    } else if (outDecimals > valueDecimals) {
+        v *= (uint64_t)FIXED_POW10[outDecimals - valueDecimals];
+    }
+    if (v == 0) neg = false;
+
+    char tmp[24];
+    int  n = 0;
+    for (int i = 0; i < outDecimals; i++) { tmp[n++] = char('0' + v % 10); v /= 10; }
+    if (outDecimals > 0) tmp[n++] = '.';
+    do { tmp[n++] = char('0' + v % 10); v /= 10; } while (v > 0);
+    if (neg) tmp[n++] = '-';
+
+    for (int i = 0; i < n; i++) out[i] = tmp[n - 1 - i];
+    return (size_t)n;
+}
@@ -0,0 +1,170 @@
+#pragma once
+
+// Instrument definitions and symbol routing.
+//
+// Each instrument carries its own tick size, step size and wall threshold,
+// given on the command line as
+//
+//     SYMBOL[:priceDecimals:qtyDecimals[:wallQty[:wallRange]]]
+//
+// e.g. "ETHUSDT:2:4:100:200" is a 0.01 tick, a 0.0001 step, walls from 100
+// ETH, looked for within $200 of the mid.
+//
+// Frames are routed to their book by symbol without a string-keyed map:
+// symbols of up to 16 characters pack into two 64-bit words, and a small
+// open-addressing table on those words yields the instrument index.
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <cctype>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdexcept>
+#include "fixed_point.h"
+#include "depth_parser.h"
+
+const int MAX_SYMBOL_CHARS = 16;
+
+struct InstrumentSpec {
+    std::string symbol;              // upper case, as in the "s" field
+    std::string base;                // base asset, for display
+    int         priceDecimals = 2;
+    int         qtyDecimals   = 5;
+    Lots        wallThreshold = 5 * 100000;   // 5 units at 1e-5
+    Ticks       wallRange     = 200000;       // 2000.00 at 1e-2
+};
+
+// Quote assets stripped from a symbol to name its base asset.
+const char* const QUOTE_ASSETS[] = {"USDT", "USDC", "FDUSD", "TUSD", "BUSD", "EUR",
+                                    "TRY", "BTC", "ETH", "BNB"};
+
+inline std::string baseAsset(const std::string& symbol) {
+    for (const char* q : QUOTE_ASSETS) {
+        size_t n = strlen(q);
+        if (symbol.size() > n && symbol.compare(symbol.size() - n, n, q) == 0)
+            return symbol.substr(0, symbol.size() - n);
+    }
+    return symbol;
+}
+
+inline InstrumentSpec parseInstrumentSpec(const std::string& text) {
+    std::vector<std::string> parts;
+    size_t start = 0;
+    while (true) {
+        size_t colon = text.find(':', start);
+        parts.push_back(text.substr(start, colon - start));
+        if (colon == std::string::npos) break;
+        start = colon + 1;
+    }
+
+    InstrumentSpec s;
+    for (char c : parts[0]) s.symbol += (char)toupper((unsigned char)c);
+    if (s.symbol.empty() || s.symbol.size() > (size_t)MAX_SYMBOL_CHARS)
+        throw std::runtime_error("bad symbol: " + text);
+    s.base = baseAsset(s.symbol);
+
+    if (parts.size() == 2 || parts.size() > 5) throw std::runtime_error("bad instrument spec: " + text);
+    if (parts.size() >= 3) {
+        s.priceDecimals = atoi(parts[1].c_str());
+        s.qtyDecimals   = atoi(parts[2].c_str());
+        if (s.priceDecimals < 0 || s.priceDecimals > 8 || s.qtyDecimals < 0 || s.qtyDecimals > 8)
+            throw std::runtime_error("decimals out of range: " + text);
+        // keep the defaults' meaning (5 units, 2000.00) at the new scale
+        s.wallThreshold = toLots(5 * FIXED_POW10[s.qtyDecimals]);
+        s.wallRange     = 2000 * FIXED_POW10[s.priceDecimals];
+    }
+    int64_t v;
+    if (parts.size() >= 4) {
+        const std::string& q = parts[3];
+        if (!depth_parser::parseFixed(q.data(), q.data() + q.size(), s.qtyDecimals, v))
+            throw std::runtime_error("bad wall quantity: " + text);
+        s.wallThreshold = toLots(v);
+    }
+    if (parts.size() == 5) {
+        const std::string& r = parts[4];
+        if (!depth_parser::parseFixed(r.data(), r.data() + r.size(), s.priceDecimals, v))
+            throw std::runtime_error("bad wall range: " + text);
+        s.wallRange = v;
+    }
+    return s;
+}
+
+// Upper-cased symbol packed into 16 bytes. Case-insensitive so that both
+// the lower-case stream name ("btcusdt@depth") and the "s" field
+// ("BTCUSDT") map to the same key.
+struct SymbolKey {
+    uint64_t lo = 0;
+    uint64_t hi = 0;
+    bool operator==(const SymbolKey& o) const { return lo == o.lo && hi == o.hi; }
+};
+
+inline bool packSymbol(std::string_view s, SymbolKey& out) {
+    if (s.empty() || s.size() > (size_t)MAX_SYMBOL_CHARS) return false;
+    char buf[MAX_SYMBOL_CHARS] = {};
+    for (size_t i = 0; i < s.size(); i++) {
+        char c = s[i];
+        buf[i] = (c >= 'a' && c <= 'z') ? char(c - 32) : c;
+    }
+    memcpy(&out.lo, buf, 8);
+    memcpy(&out.hi, buf + 8, 8);
+    return true;
+}
+
+class SymbolTable {
+public:
+    static const int NONE = -1;
+
+    void add(const std::string& symbol, int index) {
+        SymbolKey k;
+        if (!packSymbol(symbol, k)) throw std::runtime_error("bad symbol: " + symbol);
+        if (find(k) != NONE) throw std::runtime_error("duplicate symbol: " + symbol);
+        entries_.push_back({k, index});
+        rebuild();
+    }
+
+    int find(const SymbolKey& k) const {
+        if (slots_.empty()) return NONE;
+        for (size_t i = hash(k) & mask_;; i = (i + 1) & mask_) {
+            const Entry& e = slots_[i];
+            if (e.index == NONE) return NONE;
+            if (e.key == k) return e.index;
+        }
+    }
+
+    int find(std::string_view symbol) const {
+        SymbolKey k;
+        return packSymbol(symbol, k) ? find(k) : NONE;
+    }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry {
+        SymbolKey key;
+        int       index = NONE;
+    };
+
+    static size_t hash(const SymbolKey& k) {
+        uint64_t h = (k.lo ^ (k.hi * 0x9e3779b97f4a7c15ULL)) * 0xff51afd7ed558ccdULL;
+        return (size_t)(h ^ (h >> 32));
+    }
+
+    // at most half full, so probes stay short and always hit an empty slot
+    void rebuild() {
+        size_t cap = 4;
+        while (cap < entries_.size() * 2) cap <<= 1;
+        slots_.assign(cap, Entry{});
+        mask_ = cap - 1;
+        for (const Entry& e : entries_) {
+            size_t i = hash(e.key) & mask_;
+            while (slots_[i].index != NONE) i = (i + 1) & mask_;
+            slots_[i] = e;
+        }
+    }
+
+    std::vector<Entry> entries_;
+    std::vector<Entry> slots_;
+    size_t             mask_ = 0;
+};
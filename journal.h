@@ -0,0 +1,233 @@
+#pragma once
+
+// Append-only journal of raw WebSocket frames.
+//
+// Layout: a 16-byte file header followed by back-to-back records. Each record
+// is a 16-byte header (receive time in ns since epoch, payload length,
+// record type) plus the payload, padded to 8 bytes so every record header
+// stays aligned when the file is memory-mapped for replay. Besides stream
+// frames the journal holds the REST snapshots fetched during sync, in the
+// order they were applied, so a replay resyncs exactly like the live run.
+// A snapshot payload is the symbol, a newline and the response body; older
+// single-symbol journals store the bare body.
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <stdexcept>
+#include <chrono>
+#include <mutex>
+#include <atomic>
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+const char     JOURNAL_MAGIC[8] = {'P', 'L', 'S', 'J', 'R', 'N', 'L', '1'};
+const uint32_t JOURNAL_VERSION  = 1;
+
+const uint32_t JOURNAL_FRAME    = 0;   // WebSocket frame
+const uint32_t JOURNAL_SNAPSHOT = 1;   // REST depth snapshot body
+
+struct JournalFileHeader {
+    char     magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+struct JournalRecordHeader {
+    uint64_t recvNs;
+    uint32_t length;
+    uint32_t type;
+};
+
+static_assert(sizeof(JournalFileHeader) == 16, "journal header must stay 16 bytes");
+static_assert(sizeof(JournalRecordHeader) == 16, "record header must stay 16 bytes");
+
+inline size_t journalPadded(size_t n) { return (n + 7) & ~size_t(7); }
+
+inline uint64_t wallClockNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+class JournalWriter {
+public:
+    explicit JournalWriter(const std::string& path) {
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT | O_APPEND, 0644);
+        if (fd_ < 0) throw std::runtime_error("cannot open journal " + path);
+
+        off_t end = completeLength(path);
+        struct stat st;
+        if (::fstat(fd_, &st) == 0 && st.st_size != end && ::ftruncate(fd_, end) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("cannot truncate torn record in journal " + path);
+        }
+        if (end == 0) {
+            JournalFileHeader h{};
+            memcpy(h.magic, JOURNAL_MAGIC, sizeof(h.magic));
+            h.version = JOURNAL_VERSION;
+            if (!writeAll(&h, sizeof(h))) {
+                ::close(fd_);
+                throw std::runtime_error("cannot write journal " + path);
+            }
+        }
+    }
+
+    ~JournalWriter() { if (fd_ >= 0) ::close(fd_); }
+
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // header, payload and padding go out in a single write so a crash can
+    // only ever leave a torn record at the tail, which the reader skips and
+    // the next writer on the file cuts off.
+    // Safe to call from the reader and engine threads concurrently.
+    //
+    // Never throws: the reader calls it for every frame. A failed write
+    // (disk full, I/O error) stops the recording for good, since the
+    // records after a torn one could not be read back; failed() and
+    // error() report it and later calls return false at once.
+    bool append(uint64_t recvNs, const void* data, size_t len,
+                uint32_t type = JOURNAL_FRAME) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (failed()) return false;
+        size_t total = sizeof(JournalRecordHeader) + journalPadded(len);
+        if (staging_.size() < total) staging_.resize(total);
+
+        JournalRecordHeader h{recvNs, (uint32_t)len, type};
+        memcpy(&staging_[0], &h, sizeof(h));
+        memcpy(&staging_[sizeof(h)], data, len);
+        memset(&staging_[sizeof(h) + len], 0, total - sizeof(h) - len);
+        if (!writeAll(staging_.data(), total)) {
+            error_.store(errno, std::memory_order_relaxed);
+            failed_.store(true, std::memory_order_release);
+            return false;
+        }
+        framesWritten_.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    uint64_t framesWritten() const { return framesWritten_.load(std::memory_order_relaxed); }
+    bool     failed()        const { return failed_.load(std::memory_order_acquire); }
+    // errno of the write that stopped the recording
+    int      error()         const { return error_.load(std::memory_order_relaxed); }
+
+private:
+    // Records appended after a torn one would be unreadable: reopening
+    // cuts the file back to the end of its last complete record (header,
+    // payload and padding). Only an empty file is taken as a new journal;
+    // anything else must start with the journal header, so a file that is
+    // not a journal is never truncated.
+    off_t completeLength(const std::string& path) {
+        struct stat st;
+        if (::fstat(fd_, &st) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("cannot stat journal " + path);
+        }
+        if (st.st_size == 0) return 0;
+        JournalFileHeader fh;
+        if (st.st_size < (off_t)sizeof(fh) ||
+            ::pread(fd_, &fh, sizeof(fh), 0) != (ssize_t)sizeof(fh) ||
+            memcmp(fh.magic, JOURNAL_MAGIC, sizeof(fh.magic)) != 0 || fh.version != JOURNAL_VERSION) {
+            ::close(fd_);
+            throw std::runtime_error("not a pulse journal: " + path);
+        }
+        off_t offset = sizeof(fh);
+        JournalRecordHeader h;
+        while (offset + (off_t)sizeof(h) <= st.st_size &&
+               ::pread(fd_, &h, sizeof(h), offset) == (ssize_t)sizeof(h)) {
+            off_t next = offset + (off_t)(sizeof(h) + journalPadded(h.length));
+            if (next > st.st_size) break;
+            offset = next;
+        }
+        return offset;
+    }
+
+    bool writeAll(const void* p, size_t n) {
+        const char* c = static_cast<const char*>(p);
+        while (n > 0) {
+            ssize_t w = ::write(fd_, c, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                return false;
+            }
+            c += w;
+            n -= (size_t)w;
+        }
+        return true;
+    }
+
+    int                   fd_ = -1;
+    std::mutex            mutex_;
+    std::string           staging_;
+    std::atomic<uint64_t> framesWritten_{0};
+    std::atomic<bool>     failed_{false};
+    std::atomic<int>      error_{0};
+};
+
+struct JournalFrame {
+    uint64_t    recvNs;
+    const char* data;
+    uint32_t    length;
+    uint32_t    type;
+};
+
+// Read-only memory-mapped view over a journal file. Frames point straight
+// into the mapping, so iterating a journal never copies payloads.
+class JournalReader {
+public:
+    explicit JournalReader(const std::string& path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open journal " + path);
+
+        struct stat st;
+        if (::fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(JournalFileHeader)) {
+            ::close(fd);
+            throw std::runtime_error("journal too small: " + path);
+        }
+        size_ = (size_t)st.st_size;
+        void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("cannot mmap journal " + path);
+        base_ = static_cast<const char*>(p);
+        ::madvise(p, size_, MADV_SEQUENTIAL);
+
+        const JournalFileHeader* h = reinterpret_cast<const JournalFileHeader*>(base_);
+        if (memcmp(h->magic, JOURNAL_MAGIC, sizeof(h->magic)) != 0 ||
+            h->version != JOURNAL_VERSION) {
+            ::munmap(p, size_);
+            throw std::runtime_error("not a pulse journal: " + path);
+        }
+        rewind();
+    }
+
+    ~JournalReader() { if (base_) ::munmap(const_cast<char*>(base_), size_); }
+
+    JournalReader(const JournalReader&) = delete;
+    JournalReader& operator=(const JournalReader&) = delete;
+
+    void rewind() { offset_ = sizeof(JournalFileHeader); }
+
+    // returns false at end of file or on a torn trailing record
+    bool next(JournalFrame& out) {
+        if (offset_ + sizeof(JournalRecordHeader) > size_) return false;
+        const JournalRecordHeader* h =
+            reinterpret_cast<const JournalRecordHeader*>(base_ + offset_);
+        size_t body = journalPadded(h->length);
+        if (offset_ + sizeof(JournalRecordHeader) + h->length > size_) return false;
+
+        out.recvNs = h->recvNs;
+        out.data   = base_ + offset_ + sizeof(JournalRecordHeader);
+        out.length = h->length;
+        out.type   = h->type;
+        offset_ += sizeof(JournalRecordHeader) + body;
+        return true;
+    }
+
+private:
+    const char* base_   = nullptr;
+    size_t      size_   = 0;
+    size_t      offset_ = 0;
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+// Log-bucketed latency histograms in the style of HdrHistogram.
+//
+// Values (nanoseconds) below 32 get a bucket each; above that every power
+// of two is split into 32 linear sub-buckets, so any recorded value is
+// known to within 1/32 (~3%) whatever its magnitude. 1,152 buckets cover
+// up to 2^40 ns (about 18 minutes); anything larger lands in the last one.
+//
+// LatencyHistogram has a single writer, which records with plain relaxed
+// loads and stores (no locked instructions). Any thread may copy it into a
+// LatencySnapshot, merge several snapshots and read percentiles from it.
+
+#include <atomic>
+#include <cstdint>
+
+class LatencyHistogram {
+public:
+    static const int SUB_BITS = 5;
+    static const int SUB      = 1 << SUB_BITS;
+    static const int MAX_BITS = 40;
+    static const int BUCKETS  = (MAX_BITS - SUB_BITS + 1) * SUB;
+
+    static int bucketOf(uint64_t v) {
+        if (v < (uint64_t)SUB) return (int)v;
+        int msb = 63 - __builtin_clzll(v);
+        if (msb >= MAX_BITS) return BUCKETS - 1;
+        return (msb - SUB_BITS + 1) * SUB + (int)((v >> (msb - SUB_BITS)) - SUB);
+    }
+
+    static uint64_t lowestIn(int bucket) {
+        if (bucket < SUB) return (uint64_t)bucket;
+        int e = bucket / SUB;
+        return (uint64_t)(bucket % SUB + SUB) << (e - 1);
+    }
+
+    static uint64_t highestIn(int bucket) { return lowestIn(bucket + 1) - 1; }
+
+    // Writer thread only.
+    void record(uint64_t ns) {
+        bump(counts_[bucketOf(ns)], 1);
+        bump(count_, 1);
+        bump(sum_, ns);
+        if (ns > max_.load(std::memory_order_relaxed)) max_.store(ns, std::memory_order_relaxed);
+    }
+
+    uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+
+private:
+    friend struct LatencySnapshot;
+
+    static void bump(std::atomic<uint64_t>& a, uint64_t n) {
+        a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+    }
+
+    std::atomic<uint64_t> counts_[BUCKETS] = {};
+    std::atomic<uint64_t> count_{0};
+    std::atomic<uint64_t> sum_{0};
+    std::atomic<uint64_t> max_{0};
+};
+
+// A plain copy of one or more histograms. Copies taken while the writer is
+// running may disagree by a few in-flight records between the total and
+// the buckets; percentiles are computed from the buckets alone.
+struct LatencySnapshot {
+    uint64_t counts[LatencyHistogram::BUCKETS] = {};
+    uint64_t count = 0;
+    uint64_t sumNs = 0;
+    uint64_t maxNs = 0;
+
+    void clear() { *this = LatencySnapshot(); }
+
+    void add(const LatencyHistogram& h) {
+        for (int i = 0; i < LatencyHistogram::BUCKETS; i++)
+            counts[i] += h.counts_[i].load(std::memory_order_relaxed);
+        count += h.count_.load(std::memory_order_relaxed);
+        sumNs += h.sum_.load(std::memory_order_relaxed);
+        uint64_t m = h.max_.load(std::memory_order_relaxed);
+        if (m > maxNs) maxNs = m;
+    }
+
+    // What happened between `earlier` and this snapshot. The exact maximum
+    // of the interval is not kept, so it is taken from the highest bucket
+    // that moved.
+    LatencySnapshot since(const LatencySnapshot& earlier) const {
+        LatencySnapshot d;
+        int top = -1;
+        for (int i = 0; i < LatencyHistogram::BUCKETS; i++) {
+            d.counts[i] = counts[i] - earlier.counts[i];
+            if (d.counts[i]) top = i;
+        }
+        d.count = count - earlier.count;
+        d.sumNs = sumNs - earlier.sumNs;
+        if (top >= 0) {
+            uint64_t hi = LatencyHistogram::highestIn(top);
+            d.maxNs = hi < maxNs ? hi : maxNs;
+        }
+        return d;
+    }
+
+    // Upper edge of the bucket holding the q-th quantile, never above the
+    // recorded maximum; 0 when empty.
+    uint64_t percentile(double q) const {
+        uint64_t total = 0;
+        for (int i = 0; i < LatencyHistogram::BUCKETS; i++) total += counts[i];
+        if (total == 0) return 0;
+        uint64_t target = (uint64_t)(q * (double)total + 0.999999);
+        if (target == 0) target = 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < LatencyHistogram::BUCKETS; i++) {
+            seen += counts[i];
+            if (seen >= target) {
+                uint64_t hi = LatencyHistogram::highestIn(i);
+                return maxNs && hi > maxNs ? maxNs : hi;
+            }
+        }
+        return maxNs;
+    }
+
+    double meanNs() const { return count ? (double)sumNs / (double)count : 0.0; }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+// Simulated market maker for the backtester: a bid and an ask resting
+// against a replayed book, with queue position, fills, inventory and PnL.
+//
+// The recorded feed never shows our own orders, so where a quote stands in
+// its level's queue is inferred from what happens to that level:
+//   - a quote joins the back of its level: everything resting there when it
+//     goes live is ahead of it
+//   - size added to the level afterwards queues behind it
+//   - a decrease at the touch is read as trading (as the aggression counter
+//     reads it) and eats the queue from the front; whatever is left once the
+//     queue ahead is gone fills the quote
+//   - a decrease behind the touch is a cancel somewhere in the queue and
+//     shortens the queue ahead pro rata
+//   - if the opposite side trades through the quote's price, the rest of
+//     the quote fills at its price
+// Some decreases at the touch are cancels, so fills lean optimistic; a
+// quote latency and a wider spread are the levers to make a run harsher.
+//
+// Quotes are placed around a fair price: the mid, moved up by imbalance
+// and down by inventory. A side is pulled while the aggression ratio says
+// the flow is running against it, or while inventory is at its limit.
+// Everything is driven by the book's exchange time, never the wall clock,
+// so a run is deterministic.
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "book_engine.h"
+
+struct MakerParams {
+    int     halfSpreadTicks    = 1;      // quotes this far either side of the fair price
+    int64_t quoteLots          = 1000;   // size of each quote
+    int64_t maxInventoryLots   = 10000;  // no more buying (selling) at +(-) this
+    double  inventorySkewTicks = 0.0;    // fair price moves down this far per quote of inventory
+    double  imbalanceSkewTicks = 0.0;    // ...and up this far at imbalance 1, down at 0
+    double  toxicity           = 1.0;    // pull the ask above this aggression ratio, the bid below 1 - it
+    int     latencyMs          = 0;      // a new quote goes live this long after it is decided
+    double  feeBps             = 0.0;    // on filled notional; negative for a rebate
+};
+
+struct MakerResult {
+    long long fills        = 0;
+    long long quotesPlaced = 0;
+    int64_t   boughtLots   = 0;
+    int64_t   soldLots     = 0;
+    int64_t   inventoryLots    = 0;
+    int64_t   maxInventoryLots = 0;   // largest absolute position held
+    double    cash         = 0.0;     // quote currency, after fees
+    double    fees         = 0.0;
+    double    pnl          = 0.0;     // cash + inventory marked at the last mid
+    double    maxDrawdown  = 0.0;     // largest fall of pnl from its running peak
+};
+
+struct SimQuote {
+    Ticks   price = NO_PRICE;   // NO_PRICE: not quoting this side
+    int64_t open  = 0;          // lots still resting
+    int64_t ahead = 0;          // lots in front of it at its price
+};
+
+class MarketMaker {
+public:
+    MarketMaker(const MakerParams& p, const InstrumentSpec& spec)
+        : p_(p), lotValue_(1.0 / (double)FIXED_POW10[spec.priceDecimals] /
+                                 (double)FIXED_POW10[spec.qtyDecimals]) {}
+
+    // Before (isBid, price) is set to qty in the book. Only does work when
+    // the level is one a quote rests at.
+    void onLevel(const Instrument& in, bool isBid, Ticks price, Lots qty) {
+        SimQuote& q = quotes_[isBid];
+        if (price != q.price) return;
+        const PriceLadder& ladder = isBid ? in.bidLadder : in.askLadder;
+        int64_t prev = ladder.get(price);
+        if ((int64_t)qty >= prev) return;
+
+        int64_t gone = prev - qty;
+        bool atTouch = isBid ? ladder.bestAtOrAbove(price + 1) == NO_PRICE
+                             : ladder.bestAtOrBelow(price - 1) == NO_PRICE;
+        if (atTouch) {
+            int64_t past = gone - q.ahead;
+            q.ahead = std::max<int64_t>(0, q.ahead - gone);
+            if (past > 0) fill(isBid, past);
+        } else {
+            q.ahead -= gone * q.ahead / prev;
+        }
+    }
+
+    // After a diff is applied and top has been updated: fills from trades
+    // through the quotes, then requotes and marks the position.
+    void onBook(const Instrument& in, int64_t nowMs, const TopOfBook& top) {
+        if (top.numBids == 0 || top.numAsks == 0) return;
+        Ticks bestBid = top.bids[0].price, bestAsk = top.asks[0].price;
+        if (quotes_[1].price != NO_PRICE && bestAsk <= quotes_[1].price) fill(true, quotes_[1].open);
+        if (quotes_[0].price != NO_PRICE && bestBid >= quotes_[0].price) fill(false, quotes_[0].open);
+
+        double fair = top.midTicks2 / 2.0
+                    + p_.imbalanceSkewTicks * (2.0 * top.imbalance - 1.0)
+                    - p_.inventorySkewTicks * (double)r_.inventoryLots / (double)p_.quoteLots;
+        Ticks bid = (Ticks)std::floor(fair - p_.halfSpreadTicks);
+        Ticks ask = (Ticks)std::ceil(fair + p_.halfSpreadTicks);
+        bid = std::min(bid, bestAsk - 1);   // post only
+        ask = std::max(ask, bestBid + 1);
+        if (r_.inventoryLots >= p_.maxInventoryLots || top.aggressionRatio < 1.0 - p_.toxicity)
+            bid = NO_PRICE;
+        if (-r_.inventoryLots >= p_.maxInventoryLots || top.aggressionRatio > p_.toxicity)
+            ask = NO_PRICE;
+        requote(in, true, bid, nowMs);
+        requote(in, false, ask, nowMs);
+
+        mid_ = top.midTicks2 / 2.0;
+        double pnl = mark();
+        peak_ = std::max(peak_, pnl);
+        r_.maxDrawdown = std::max(r_.maxDrawdown, peak_ - pnl);
+    }
+
+    // The book was wiped; whatever rested in it is gone.
+    void cancelAll() {
+        for (int side = 0; side < 2; side++) {
+            quotes_[side] = SimQuote();
+            pending_[side] = Pending();
+        }
+    }
+
+    const SimQuote& quote(bool isBid) const { return quotes_[isBid]; }
+
+    MakerResult result() const {
+        MakerResult r = r_;
+        r.pnl = mark();
+        return r;
+    }
+
+private:
+    struct Pending {
+        Ticks   price  = NO_PRICE;
+        int64_t liveAt = -1;   // exchange ms; -1 when nothing is pending
+    };
+
+    double mark() const {
+        return r_.cash + (double)r_.inventoryLots * mid_ * lotValue_;
+    }
+
+    void fill(bool isBid, int64_t lots) {
+        SimQuote& q = quotes_[isBid];
+        lots = std::min(lots, q.open);
+        if (lots <= 0) return;
+        double notional = (double)q.price * (double)lots * lotValue_;
+        double fee      = notional * p_.feeBps / 10000.0;
+        if (isBid) {
+            r_.inventoryLots += lots;
+            r_.boughtLots    += lots;
+            r_.cash          -= notional;
+        } else {
+            r_.inventoryLots -= lots;
+            r_.soldLots      += lots;
+            r_.cash          += notional;
+        }
+        r_.cash -= fee;
+        r_.fees += fee;
+        r_.fills++;
+        r_.maxInventoryLots = std::max(r_.maxInventoryLots, std::abs(r_.inventoryLots));
+        q.open -= lots;
+        if (q.open == 0) q = SimQuote();
+    }
+
+    // Moves a side to target (NO_PRICE pulls it). The change is sent at
+    // once and lands latencyMs later with the price decided now; until then
+    // the old quote keeps resting and no new change is sent for that side.
+    // A quote that would cross the book when it lands is rejected, as a
+    // post-only order would be. An unchanged quote keeps its queue place.
+    void requote(const Instrument& in, bool isBid, Ticks target, int64_t nowMs) {
+        Pending& w = pending_[isBid];
+        if (w.liveAt < 0) {
+            if (target == quotes_[isBid].price) return;
+            w = {target, nowMs + p_.latencyMs};
+        }
+        if (nowMs < w.liveAt) return;
+
+        Ticks price = w.price;
+        w = Pending();
+        SimQuote& q = quotes_[isBid];
+        q = SimQuote();
+        if (price == NO_PRICE) return;
+        if (isBid ? in.bestAsk != NO_PRICE && price >= in.bestAsk
+                  : in.bestBid != NO_PRICE && price <= in.bestBid)
+            return;
+        q.price = price;
+        q.open  = p_.quoteLots;
+        q.ahead = (isBid ? in.bidLadder : in.askLadder).get(price);
+        r_.quotesPlaced++;
+    }
+
+    MakerParams p_;
+    double      lotValue_;    // quote currency per tick per lot
+    SimQuote    quotes_[2];   // [0] ask, [1] bid
+    Pending     pending_[2];
+    MakerResult r_;
+    double      mid_  = 0.0;  // ticks
+    double      peak_ = 0.0;
+};
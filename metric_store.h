@@ -0,0 +1,589 @@
+#pragma once
+
+// Append-only columnar store for the per-update metrics (orderbook --store),
+// and the reader pulse_query scans it with.
+//
+// A store file is a StoreFileHeader naming its columns, followed by blocks.
+// A block holds up to STORE_BLOCK_ROWS consecutive rows of one symbol,
+// column after column, each column compressed on its own:
+//   STORE_DELTA  integers (times, counts, prices in ticks, sizes in lots):
+//                the difference from the previous row as a zigzag varint,
+//                so a steady clock or an unchanged price costs one byte
+//   STORE_XOR    doubles (ratios, signals): Gorilla's XOR with the previous
+//                value, writing only the bits that changed
+// Each block header carries the symbol, its scale and every column's min
+// and max. A query skips blocks on the headers alone and decodes only the
+// columns it reads. Column 0 is the row time in milliseconds.
+//
+// A block is appended whole with one write(2), and a session appends to the
+// file it finds instead of starting over. A block cut short by a crash is
+// dropped when the file is next opened. A file written with other columns
+// (another --bands, say) is refused rather than mixed.
+//
+// Values are kept unscaled. A column's scale says which of the block's
+// decimals, plus its own, turn them back into prices or quantities. Like
+// shm_book.h, this header depends on nothing else in the engine.
+
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint64_t STORE_MAGIC        = 0x31524f5453534c50ULL;   // "PLSSTOR1"
+const uint32_t STORE_VERSION      = 1;
+const uint32_t STORE_BLOCK_MAGIC  = 0x314b4c42;              // "BLK1"
+const int      STORE_BLOCK_ROWS   = 4096;
+const int      STORE_NAME_CHARS   = 32;
+const int      STORE_SYMBOL_CHARS = 16;
+
+enum StoreCodec : uint8_t { STORE_DELTA, STORE_XOR };
+enum StoreScale : uint8_t { STORE_UNITS, STORE_PRICE, STORE_QTY };
+
+struct StoreColumn {
+    char    name[STORE_NAME_CHARS];
+    uint8_t codec;
+    uint8_t scale;
+    int8_t  decimals;      // on top of the scale's
+    uint8_t reserved[5];
+};
+
+union StoreValue {
+    int64_t i;    // STORE_DELTA
+    double  f;    // STORE_XOR
+};
+
+struct StoreFileHeader {
+    uint64_t magic;
+    uint32_t version;
+    uint32_t numColumns;
+};   // then numColumns StoreColumns
+
+struct StoreBlockHeader {
+    uint32_t magic;
+    uint32_t rows;
+    uint64_t bytes;        // the whole block, this header included
+    char     symbol[STORE_SYMBOL_CHARS];
+    int32_t  priceDecimals;
+    int32_t  qtyDecimals;
+};   // then numColumns StoreColumnIndex, then the column data
+
+struct StoreColumnIndex {
+    StoreValue min;
+    StoreValue max;
+    uint64_t   offset;     // from the start of the column data
+    uint64_t   bytes;
+};
+
+inline StoreColumn storeColumn(const std::string& name, StoreCodec codec, StoreScale scale = STORE_UNITS,
+                               int decimals = 0) {
+    StoreColumn c = {};
+    snprintf(c.name, sizeof(c.name), "%s", name.c_str());
+    c.codec    = codec;
+    c.scale    = scale;
+    c.decimals = (int8_t)decimals;
+    return c;
+}
+
+// ===== CODECS =====
+namespace store_codec {
+
+inline uint64_t zigzag(int64_t v)    { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t  unzigzag(uint64_t u) { return (int64_t)(u >> 1) ^ -(int64_t)(u & 1); }
+
+inline void putVarint(std::vector<uint8_t>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((uint8_t)(v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((uint8_t)v);
+}
+
+// null on truncated input
+inline const uint8_t* getVarint(const uint8_t* p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+inline void encodeDelta(const int64_t* v, int n, std::vector<uint8_t>& out) {
+    uint64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+        putVarint(out, zigzag((int64_t)((uint64_t)v[i] - prev)));
+        prev = (uint64_t)v[i];
+    }
+}
+
+inline bool decodeDelta(const uint8_t* p, const uint8_t* end, int n, int64_t* out) {
+    uint64_t prev = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t u;
+        if (p < end && *p < 0x80) u = *p++;
+        else if (!(p = getVarint(p, end, u))) return false;
+        prev += (uint64_t)unzigzag(u);
+        out[i] = (int64_t)prev;
+    }
+    return true;
+}
+
+// most significant bit first
+class BitWriter {
+public:
+    explicit BitWriter(std::vector<uint8_t>& out) : out_(out) {}
+
+    void put(uint64_t bits, int n) {
+        if (n > 32) {
+            put(bits >> 32, n - 32);
+            bits &= 0xffffffffULL;
+            n = 32;
+        }
+        acc_   = (acc_ << n) | (bits & ((1ULL << n) - 1));
+        used_ += n;
+        while (used_ >= 8) {
+            used_ -= 8;
+            out_.push_back((uint8_t)(acc_ >> used_));
+        }
+    }
+
+    void finish() {
+        if (used_) out_.push_back((uint8_t)(acc_ << (8 - used_)));
+        used_ = 0;
+    }
+
+private:
+    std::vector<uint8_t>& out_;
+    uint64_t acc_  = 0;
+    int      used_ = 0;
+};
+
+class BitReader {
+public:
+    BitReader(const uint8_t* p, const uint8_t* end) : p_(p), end_(end) {}
+
+    uint64_t get(int n) {
+        if (n > 32) {
+            uint64_t hi = get(n - 32);
+            return (hi << 32) | get(32);
+        }
+        while (used_ < n) {
+            acc_   = (acc_ << 8) | (p_ < end_ ? *p_++ : (overrun_ = true, 0));
+            used_ += 8;
+        }
+        used_ -= n;
+        return (acc_ >> used_) & ((1ULL << n) - 1);
+    }
+
+    bool overrun() const { return overrun_; }
+
+private:
+    const uint8_t* p_;
+    const uint8_t* end_;
+    uint64_t acc_     = 0;
+    int      used_    = 0;
+    bool     overrun_ = false;
+};
+
+// Gorilla: '0' repeats the previous value; '10' + bits reuses the previous
+// window of meaningful bits; '11' + 5 bits of leading zeros + 6 bits of
+// length + bits opens a new one.
+inline void encodeXor(const double* v, int n, std::vector<uint8_t>& out) {
+    BitWriter w(out);
+    uint64_t prev = 0;
+    int lead = -1, trail = 0;
+    for (int i = 0; i < n; i++) {
+        uint64_t bits;
+        memcpy(&bits, &v[i], 8);
+        uint64_t x = bits ^ prev;
+        prev = bits;
+        if (x == 0) {
+            w.put(0, 1);
+            continue;
+        }
+        int l = std::min(__builtin_clzll(x), 31), t = __builtin_ctzll(x);
+        if (lead < 0 || l < lead || t < trail) {
+            lead  = l;
+            trail = t;
+            w.put(3, 2);
+            w.put((uint64_t)lead, 5);
+            w.put((uint64_t)(64 - lead - trail - 1), 6);
+        } else {
+            w.put(2, 2);
+        }
+        w.put(x >> trail, 64 - lead - trail);
+    }
+    w.finish();
+}
+
+inline bool decodeXor(const uint8_t* p, const uint8_t* end, int n, double* out) {
+    BitReader r(p, end);
+    uint64_t prev = 0;
+    int lead = 0, len = 0;
+    for (int i = 0; i < n; i++) {
+        if (r.get(1)) {
+            if (r.get(1)) {
+                lead = (int)r.get(5);
+                len  = (int)r.get(6) + 1;
+            } else if (len == 0) {
+                return false;
+            }
+            prev ^= r.get(len) << (64 - lead - len);
+        }
+        memcpy(&out[i], &prev, 8);
+    }
+    return !r.overrun();
+}
+
+}  // namespace store_codec
+
+// ===== WRITER =====
+struct StoreStats {
+    std::atomic<uint64_t> rows{0};
+    std::atomic<uint64_t> blocks{0};
+    std::atomic<uint64_t> bytes{0};         // written by this session
+    std::atomic<uint64_t> writeErrors{0};
+};
+
+// Used from one thread (the telemetry writer's).
+class MetricStoreWriter {
+public:
+    // Opens path for appending, or creates it with these columns. Partial
+    // blocks are written once their first row is flushAgeMs old.
+    MetricStoreWriter(const std::string& path, const std::vector<StoreColumn>& columns,
+                      int flushAgeMs = 10000)
+        : path_(path), columns_(columns), flushAge_(std::chrono::milliseconds(flushAgeMs)) {
+        if (columns_.empty() || columns_[0].codec != STORE_DELTA)
+            throw std::runtime_error("a store's first column is its integer time");
+        fd_ = ::open(path.c_str(), O_RDWR | O_CREAT, 0644);
+        if (fd_ < 0) throw std::runtime_error("cannot open " + path + ": " + strerror(errno));
+        try {
+            openExisting();
+        } catch (...) {
+            ::close(fd_);
+            throw;
+        }
+        scratchI_.resize(STORE_BLOCK_ROWS);
+        scratchF_.resize(STORE_BLOCK_ROWS);
+    }
+
+    ~MetricStoreWriter() { close(); }
+
+    MetricStoreWriter(const MetricStoreWriter&) = delete;
+    MetricStoreWriter& operator=(const MetricStoreWriter&) = delete;
+
+    // One row of series, a small index with one symbol and scale per series.
+    // values has one entry per column.
+    void append(int series, const char* symbol, int priceDecimals, int qtyDecimals,
+                const StoreValue* values) {
+        if (series >= (int)series_.size()) series_.resize(series + 1);
+        if (!series_[series]) {
+            series_[series].reset(new Series);
+            Series& s = *series_[series];
+            snprintf(s.symbol, sizeof(s.symbol), "%s", symbol);
+            s.priceDecimals = priceDecimals;
+            s.qtyDecimals   = qtyDecimals;
+            s.values.resize(columns_.size() * STORE_BLOCK_ROWS);
+        }
+        Series& s = *series_[series];
+        if (s.rows == 0) s.started = Clock::now();
+        for (size_t c = 0; c < columns_.size(); c++) s.values[c * STORE_BLOCK_ROWS + s.rows] = values[c];
+        if (++s.rows == STORE_BLOCK_ROWS) writeBlock(s);
+    }
+
+    // Writes partial blocks that are due, or all of them.
+    void flush(bool all) {
+        auto now = Clock::now();
+        for (auto& s : series_)
+            if (s && s->rows && (all || now - s->started >= flushAge_)) writeBlock(*s);
+    }
+
+    void close() {
+        if (fd_ < 0) return;
+        flush(true);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    const StoreStats& stats() const        { return stats_; }
+    const std::string& path() const        { return path_; }
+    uint64_t existingBlocks() const        { return existingBlocks_; }
+    uint64_t droppedTailBytes() const      { return droppedTail_; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    struct Series {
+        char    symbol[STORE_SYMBOL_CHARS];
+        int     priceDecimals;
+        int     qtyDecimals;
+        int     rows = 0;
+        Clock::time_point       started;
+        std::vector<StoreValue> values;   // column-major, STORE_BLOCK_ROWS per column
+    };
+
+    size_t headerBytes() const { return sizeof(StoreFileHeader) + columns_.size() * sizeof(StoreColumn); }
+
+    // A new file gets a header. An existing one must have the same columns,
+    // and loses a torn last block.
+    void openExisting() {
+        struct stat st;
+        if (fstat(fd_, &st) != 0) throw std::runtime_error("cannot stat " + path_);
+        size_t size = (size_t)st.st_size;
+        if (size == 0) {
+            std::vector<uint8_t> h(headerBytes());
+            StoreFileHeader fh = {STORE_MAGIC, STORE_VERSION, (uint32_t)columns_.size()};
+            memcpy(h.data(), &fh, sizeof(fh));
+            memcpy(h.data() + sizeof(fh), columns_.data(), columns_.size() * sizeof(StoreColumn));
+            if (!writeAll(h.data(), h.size())) throw std::runtime_error("cannot write " + path_);
+            return;
+        }
+
+        std::vector<uint8_t> h(headerBytes());
+        StoreFileHeader fh;
+        if (size < h.size() || pread(fd_, h.data(), h.size(), 0) != (ssize_t)h.size())
+            throw std::runtime_error(path_ + " is not a metric store");
+        memcpy(&fh, h.data(), sizeof(fh));
+        if (fh.magic != STORE_MAGIC || fh.version != STORE_VERSION)
+            throw std::runtime_error(path_ + " is not a metric store of this version");
+        if (fh.numColumns != columns_.size() ||
+            memcmp(h.data() + sizeof(fh), columns_.data(), columns_.size() * sizeof(StoreColumn)) != 0)
+            throw std::runtime_error(path_ + " was written with other columns; use another file");
+
+        size_t pos = h.size(), minBlock = sizeof(StoreBlockHeader) + columns_.size() * sizeof(StoreColumnIndex);
+        StoreBlockHeader bh;
+        while (pos + sizeof(bh) <= size && pread(fd_, &bh, sizeof(bh), (off_t)pos) == (ssize_t)sizeof(bh) &&
+               bh.magic == STORE_BLOCK_MAGIC && bh.bytes >= minBlock && pos + bh.bytes <= size) {
+            pos += bh.bytes;
+            existingBlocks_++;
+        }
+        if (pos < size) {
+            droppedTail_ = size - pos;
+            if (ftruncate(fd_, (off_t)pos) != 0) throw std::runtime_error("cannot truncate " + path_);
+        }
+        if (lseek(fd_, (off_t)pos, SEEK_SET) < 0) throw std::runtime_error("cannot seek " + path_);
+    }
+
+    void writeBlock(Series& s) {
+        const size_t nc = columns_.size();
+        const size_t dataStart = sizeof(StoreBlockHeader) + nc * sizeof(StoreColumnIndex);
+        block_.assign(dataStart, 0);
+        index_.assign(nc, StoreColumnIndex{});
+
+        for (size_t c = 0; c < nc; c++) {
+            const StoreValue* v = &s.values[c * STORE_BLOCK_ROWS];
+            StoreColumnIndex& ix = index_[c];
+            ix.offset = block_.size() - dataStart;
+            if (columns_[c].codec == STORE_DELTA) {
+                int64_t lo = v[0].i, hi = v[0].i;
+                for (int r = 0; r < s.rows; r++) {
+                    scratchI_[r] = v[r].i;
+                    lo = std::min(lo, v[r].i);
+                    hi = std::max(hi, v[r].i);
+                }
+                ix.min.i = lo;
+                ix.max.i = hi;
+                store_codec::encodeDelta(scratchI_.data(), s.rows, block_);
+            } else {
+                double lo = INFINITY, hi = -INFINITY;
+                for (int r = 0; r < s.rows; r++) {
+                    scratchF_[r] = v[r].f;
+                    if (v[r].f < lo) lo = v[r].f;
+                    if (v[r].f > hi) hi = v[r].f;
+                }
+                ix.min.f = lo;
+                ix.max.f = hi;
+                store_codec::encodeXor(scratchF_.data(), s.rows, block_);
+            }
+            ix.bytes = block_.size() - dataStart - ix.offset;
+        }
+
+        StoreBlockHeader bh = {};
+        bh.magic = STORE_BLOCK_MAGIC;
+        bh.rows  = (uint32_t)s.rows;
+        bh.bytes = block_.size();
+        memcpy(bh.symbol, s.symbol, sizeof(bh.symbol));
+        bh.priceDecimals = s.priceDecimals;
+        bh.qtyDecimals   = s.qtyDecimals;
+        memcpy(block_.data(), &bh, sizeof(bh));
+        memcpy(block_.data() + sizeof(bh), index_.data(), nc * sizeof(StoreColumnIndex));
+
+        if (writeAll(block_.data(), block_.size())) {
+            stats_.rows.fetch_add(s.rows, std::memory_order_relaxed);
+            stats_.blocks.fetch_add(1, std::memory_order_relaxed);
+            stats_.bytes.fetch_add(block_.size(), std::memory_order_relaxed);
+        }
+        s.rows = 0;
+    }
+
+    // a failed write loses the block but not the writer
+    bool writeAll(const uint8_t* p, size_t n) {
+        while (n > 0) {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                stats_.writeErrors.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            p += w;
+            n -= (size_t)w;
+        }
+        return true;
+    }
+
+    std::string                          path_;
+    std::vector<StoreColumn>             columns_;
+    Clock::duration                      flushAge_;
+    int                                  fd_ = -1;
+    std::vector<std::unique_ptr<Series>> series_;
+    std::vector<uint8_t>                 block_;
+    std::vector<StoreColumnIndex>        index_;
+    std::vector<int64_t>                 scratchI_;
+    std::vector<double>                  scratchF_;
+    StoreStats                           stats_;
+    uint64_t                             existingBlocks_ = 0;
+    uint64_t                             droppedTail_    = 0;
+};
+
+// ===== READER =====
+struct StoreBlock {
+    const StoreBlockHeader* header;
+    const StoreColumnIndex* index;   // one per column
+    const uint8_t*          data;
+};
+
+// Maps a store file read-only. Safe to open while a writer appends; it
+// sees the blocks complete when it was opened.
+class MetricStoreReader {
+public:
+    explicit MetricStoreReader(const std::string& path) : path_(path) {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) throw std::runtime_error("cannot open " + path + ": " + strerror(errno));
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(StoreFileHeader)) {
+            ::close(fd);
+            throw std::runtime_error(path + " is not a metric store");
+        }
+        bytes_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("cannot map " + path);
+        base_ = static_cast<const uint8_t*>(p);
+        madvise(p, bytes_, MADV_SEQUENTIAL);
+
+        StoreFileHeader fh;
+        memcpy(&fh, base_, sizeof(fh));
+        size_t pos = sizeof(fh) + (size_t)fh.numColumns * sizeof(StoreColumn);
+        if (fh.magic != STORE_MAGIC || fh.version != STORE_VERSION || pos > bytes_) {
+            munmap(const_cast<uint8_t*>(base_), bytes_);
+            throw std::runtime_error(path + " is not a metric store of this version");
+        }
+        columns_.resize(fh.numColumns);
+        memcpy(columns_.data(), base_ + sizeof(fh), fh.numColumns * sizeof(StoreColumn));
+
+        size_t indexBytes = columns_.size() * sizeof(StoreColumnIndex);
+        while (pos + sizeof(StoreBlockHeader) <= bytes_) {
+            auto* h = reinterpret_cast<const StoreBlockHeader*>(base_ + pos);
+            if (!validBlock(h, pos, indexBytes)) break;
+            blocks_.push_back({h, reinterpret_cast<const StoreColumnIndex*>(h + 1),
+                               base_ + pos + sizeof(StoreBlockHeader) + indexBytes});
+            rows_ += h->rows;
+            pos += h->bytes;
+        }
+    }
+
+    ~MetricStoreReader() { munmap(const_cast<uint8_t*>(base_), bytes_); }
+
+    MetricStoreReader(const MetricStoreReader&) = delete;
+    MetricStoreReader& operator=(const MetricStoreReader&) = delete;
+
+    const std::string&              path() const      { return path_; }
+    size_t                          fileBytes() const { return bytes_; }
+    uint64_t                        rows() const      { return rows_; }
+    const std::vector<StoreColumn>& columns() const   { return columns_; }
+    const std::vector<StoreBlock>&  blocks() const    { return blocks_; }
+
+    // -1 if there is no such column
+    int column(const std::string& name) const {
+        for (size_t c = 0; c < columns_.size(); c++)
+            if (name == columns_[c].name) return (int)c;
+        return -1;
+    }
+
+    // Decimals that turn column c of block b into units.
+    int decimals(const StoreBlock& b, int c) const {
+        const StoreColumn& col = columns_[c];
+        int base = col.scale == STORE_PRICE ? b.header->priceDecimals
+                 : col.scale == STORE_QTY   ? b.header->qtyDecimals : 0;
+        return base + col.decimals;
+    }
+
+    // Raw values of column c into out, one per row of b; false on corrupt
+    // data. decode(int64_t*) wants a STORE_DELTA column, decode(double*) a
+    // STORE_XOR one.
+    bool decode(const StoreBlock& b, int c, int64_t* out) const {
+        const StoreColumnIndex& ix = b.index[c];
+        return columns_[c].codec == STORE_DELTA &&
+               store_codec::decodeDelta(b.data + ix.offset, b.data + ix.offset + ix.bytes, b.header->rows, out);
+    }
+
+    bool decode(const StoreBlock& b, int c, double* out) const {
+        const StoreColumnIndex& ix = b.index[c];
+        return columns_[c].codec == STORE_XOR &&
+               store_codec::decodeXor(b.data + ix.offset, b.data + ix.offset + ix.bytes, b.header->rows, out);
+    }
+
+    // Column c of b in units, whatever its codec; scratch holds a block of
+    // integers.
+    bool decodeScaled(const StoreBlock& b, int c, double* out, std::vector<int64_t>& scratch) const {
+        double scale = std::pow(10.0, -decimals(b, c));
+        int n = (int)b.header->rows;
+        if (columns_[c].codec == STORE_XOR) {
+            if (!decode(b, c, out)) return false;
+            if (scale != 1.0)
+                for (int r = 0; r < n; r++) out[r] *= scale;
+            return true;
+        }
+        scratch.resize(n);
+        if (!decode(b, c, scratch.data())) return false;
+        for (int r = 0; r < n; r++) out[r] = (double)scratch[r] * scale;
+        return true;
+    }
+
+private:
+    // The scan stops at the first block that fails these, as at a torn
+    // tail: every length and offset the decoders follow must stay inside
+    // the block, and its rows must fit the readers' STORE_BLOCK_ROWS
+    // buffers.
+    bool validBlock(const StoreBlockHeader* h, size_t pos, size_t indexBytes) const {
+        if (h->magic != STORE_BLOCK_MAGIC || h->bytes < sizeof(StoreBlockHeader) + indexBytes ||
+            h->bytes > bytes_ - pos || h->rows == 0 || h->rows > (uint32_t)STORE_BLOCK_ROWS ||
+            memchr(h->symbol, 0, sizeof(h->symbol)) == nullptr)
+            return false;
+        uint64_t dataBytes = h->bytes - sizeof(StoreBlockHeader) - indexBytes;
+        auto* index = reinterpret_cast<const StoreColumnIndex*>(h + 1);
+        for (size_t c = 0; c < columns_.size(); c++)
+            if (index[c].offset > dataBytes || index[c].bytes > dataBytes - index[c].offset) return false;
+        return true;
+    }
+
+    std::string              path_;
+    const uint8_t*           base_  = nullptr;
+    size_t                   bytes_ = 0;
+    uint64_t                 rows_  = 0;
+    std::vector<StoreColumn> columns_;
+    std::vector<StoreBlock>  blocks_;
+};
@@ -0,0 +1,108 @@
+#pragma once
+
+// Allocator for the node-based maps the apply loop inserts into and erases
+// from (WallIndex, OverflowLevels).
+//
+// Each container gets a pool of its own when it is constructed. Nodes are
+// carved from chunks of CHUNK_NODES and an erased node goes on a free list
+// for the next insert, so once a book has seen its working size an update
+// never reaches the heap. Only single nodes of the size first asked for
+// come from the pool; anything else is passed to operator new. A pool
+// belongs to the containers of one book and so to one thread.
+
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <vector>
+#include <type_traits>
+
+class NodePool {
+public:
+    static const size_t CHUNK_NODES = 256;
+
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    ~NodePool() {
+        for (void* c : chunks_) ::operator delete(c);
+    }
+
+    bool serves(size_t bytes) {
+        if (nodeBytes_ == 0) nodeBytes_ = roundUp(bytes);
+        return roundUp(bytes) == nodeBytes_;
+    }
+
+    void* take() {
+        if (!free_) grow();
+        Free* n = free_;
+        free_ = n->next;
+        return n;
+    }
+
+    void give(void* p) {
+        Free* n = static_cast<Free*>(p);
+        n->next = free_;
+        free_ = n;
+    }
+
+    size_t chunks() const { return chunks_.size(); }
+
+private:
+    struct Free { Free* next; };
+
+    static size_t roundUp(size_t bytes) {
+        const size_t a = alignof(std::max_align_t);
+        bytes = bytes < sizeof(Free) ? sizeof(Free) : bytes;
+        return (bytes + a - 1) / a * a;
+    }
+
+    void grow() {
+        char* c = static_cast<char*>(::operator new(CHUNK_NODES * nodeBytes_));
+        chunks_.push_back(c);
+        for (size_t i = CHUNK_NODES; i-- > 0;) give(c + i * nodeBytes_);
+    }
+
+    size_t              nodeBytes_ = 0;
+    Free*               free_      = nullptr;
+    std::vector<void*>  chunks_;
+};
+
+template <typename T>
+class PoolAllocator {
+public:
+    typedef T value_type;
+
+    // a copied container gets a pool of its own; a moved one keeps its pool
+    typedef std::true_type  propagate_on_container_move_assignment;
+    typedef std::true_type  propagate_on_container_swap;
+    typedef std::false_type propagate_on_container_copy_assignment;
+    typedef std::false_type is_always_equal;
+
+    PoolAllocator() : pool_(std::make_shared<NodePool>()) {}
+
+    template <typename U>
+    PoolAllocator(const PoolAllocator<U>& other) : pool_(other.pool_) {}
+
+    PoolAllocator select_on_container_copy_construction() const { return PoolAllocator(); }
+
+    T* allocate(size_t n) {
+        if (n == 1 && pool_->serves(sizeof(T))) return static_cast<T*>(pool_->take());
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n) {
+        if (n == 1 && pool_->serves(sizeof(T))) pool_->give(p);
+        else ::operator delete(p);
+    }
+
+    template <typename U>
+    bool operator==(const PoolAllocator<U>& other) const { return pool_ == other.pool_; }
+    template <typename U>
+    bool operator!=(const PoolAllocator<U>& other) const { return pool_ != other.pool_; }
+
+private:
+    template <typename U> friend class PoolAllocator;
+
+    std::shared_ptr<NodePool> pool_;
+};
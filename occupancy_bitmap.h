@@ -0,0 +1,126 @@
+#pragma once
+
+// Hierarchical occupancy bitmap over a fixed range of slots.
+//
+// Level 0 has one bit per slot. Each higher level has one bit per 64-bit
+// word of the level below, set when that word is non-zero, up to a single
+// summary word. Finding the next or previous occupied slot climbs until a
+// word has a candidate bit and then descends with one count-zeros
+// instruction per level, so the cost is O(levels) regardless of how many
+// empty slots lie in between.
+
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+
+class OccupancyBitmap {
+public:
+    static const int NONE = -1;
+
+    explicit OccupancyBitmap(int slots) : slots_(slots) {
+        int n = slots;
+        do {
+            n = (n + 63) / 64;
+            levels_.emplace_back(n, 0);
+        } while (n > 1);
+    }
+
+    int slots() const { return slots_; }
+
+    bool test(int i) const {
+        return (levels_[0][i >> 6] >> (i & 63)) & 1;
+    }
+
+    // Level 0 is handled inline: most changes leave its word non-empty (set)
+    // or non-empty after (clear), and never reach the summary levels.
+    void set(int i) {
+        uint64_t& w = levels_[0][i >> 6];
+        bool wasEmpty = w == 0;
+        w |= 1ULL << (i & 63);
+        if (wasEmpty) setAbove(i >> 6);
+    }
+
+    void clear(int i) {
+        uint64_t& w = levels_[0][i >> 6];
+        w &= ~(1ULL << (i & 63));
+        if (w == 0) clearAbove(i >> 6);
+    }
+
+    void clearAll() {
+        for (auto& words : levels_) std::fill(words.begin(), words.end(), 0);
+    }
+
+    // Highest occupied slot <= i, or NONE.
+    int prev(int i) const {
+        if (i < 0) return NONE;
+        if (i >= slots_) i = slots_ - 1;
+        int lvl = 0;
+        int idx = i;
+        // climb until some word has an occupied bit at or below idx
+        while (true) {
+            uint64_t w = levels_[lvl][idx >> 6] & maskUpTo(idx & 63);
+            if (w != 0) { idx = (idx & ~63) | (63 - __builtin_clzll(w)); break; }
+            if (lvl + 1 == (int)levels_.size()) return NONE;
+            idx = (idx >> 6) - 1;
+            if (idx < 0) return NONE;
+            lvl++;
+        }
+        // descend taking the highest bit of each child word
+        while (lvl > 0) {
+            lvl--;
+            uint64_t w = levels_[lvl][idx];
+            idx = (idx << 6) | (63 - __builtin_clzll(w));
+        }
+        return idx;
+    }
+
+    // Lowest occupied slot >= i, or NONE.
+    int next(int i) const {
+        if (i >= slots_) return NONE;
+        if (i < 0) i = 0;
+        int lvl = 0;
+        int idx = i;
+        while (true) {
+            const auto& words = levels_[lvl];
+            uint64_t w = words[idx >> 6] & maskFrom(idx & 63);
+            if (w != 0) { idx = (idx & ~63) | __builtin_ctzll(w); break; }
+            if (lvl + 1 == (int)levels_.size()) return NONE;
+            idx = (idx >> 6) + 1;
+            if ((idx >> 6) >= (int)levels_[lvl + 1].size()) return NONE;
+            lvl++;
+        }
+        while (lvl > 0) {
+            lvl--;
+            uint64_t w = levels_[lvl][idx];
+            idx = (idx << 6) | __builtin_ctzll(w);
+        }
+        return idx < slots_ ? idx : NONE;
+    }
+
+private:
+    // word i of level 0 went from empty to occupied, or back
+    void setAbove(int i) {
+        for (size_t l = 1; l < levels_.size(); l++) {
+            uint64_t& w = levels_[l][i >> 6];
+            bool wasEmpty = w == 0;
+            w |= 1ULL << (i & 63);
+            if (!wasEmpty) return;
+            i >>= 6;
+        }
+    }
+
+    void clearAbove(int i) {
+        for (size_t l = 1; l < levels_.size(); l++) {
+            uint64_t& w = levels_[l][i >> 6];
+            w &= ~(1ULL << (i & 63));
+            if (w != 0) return;
+            i >>= 6;
+        }
+    }
+
+    static uint64_t maskUpTo(int bit) { return bit == 63 ? ~0ULL : (2ULL << bit) - 1; }
+    static uint64_t maskFrom(int bit) { return ~0ULL << bit; }
+
+    int slots_;
+    std::vector<std::vector<uint64_t>> levels_;
+};
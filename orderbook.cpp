@@ -7,14 +7,17 @@
 #include <thread>
 #include <unordered_map>
 #include <chrono>
-#include <signal.h>
+#include <memory>
+#include <iomanip>
+#include <atomic>
+#include <mutex>
 #include <boost/beast/core.hpp>
 #include <boost/beast/websocket.hpp>
 #include <boost/beast/ssl.hpp>
-#include <boost/asio/connect.hpp>
 #include <boost/asio/ip/tcp.hpp>
 #include <boost/asio/ssl.hpp>
-#include <nlohmann/json.hpp>
+#include <boost/asio/steady_timer.hpp>
+#include <boost/asio/post.hpp>
 #ifdef timeout
 #undef timeout
 #endif
@@ -22,15 +25,24 @@
 #ifdef timeout
 #undef timeout
 #endif
+#include "journal.h"
+#include "fixed_point.h"
+#include "depth_parser.h"
+#include "price_ladder.h"
+#include "depth_sync.h"
+#include "snapshot_client.h"
+#include "pipeline.h"
+#include "telemetry_writer.h"
+#include "instrument.h"
+#include "book_engine.h"
+#include "cycle_clock.h"
+#include "latency_histogram.h"
+#include "ws_reader.h"
+#include "feed_arbiter.h"
+#include "screen_buffer.h"
+#include "checkpoint.h"
 
 using namespace std;
-using json = nlohmann::json;
-
-namespace beast = boost::beast;
-namespace websocket = beast::websocket;
-namespace net = boost::asio;
-namespace ssl = boost::asio::ssl;
-using tcp = net::ip::tcp;
 
 #define COL_HEADER  1
 #define COL_ASK     2
@@ -40,65 +52,13 @@ using tcp = net::ip::tcp;
 #define COL_NEUTRAL 6
 #define COL_WALL    7
 
-const double BASE_PRICE     = 44000.0;
-const double TICK_SIZE      = 0.01;
-const int    LADDER_SIZE    = 5000000;
-const double WALL_THRESHOLD = 5.0;
-const double WALL_RANGE     = 2000.0;
-
-vector<double> bidLadder(LADDER_SIZE, 0.0);
-vector<double> askLadder(LADDER_SIZE, 0.0);
-
-int bestBidIdx = 0;
-int bestAskIdx = LADDER_SIZE - 1;
-
-unordered_map<int, double> bidWalls;
-unordered_map<int, double> askWalls;
-vector<string> recentWallEvents;
-
-const int TOXICITY_WINDOW = 100;
-deque<double> aggressiveBuyVol;
-deque<double> aggressiveSellVol;
-double totalAggressiveBuy  = 0.0;
-double totalAggressiveSell = 0.0;
-double updateAggressiveBuy  = 0.0;
-double updateAggressiveSell = 0.0;
-
-const int IMBALANCE_HISTORY = 60;
-deque<double> imbalanceHistory;
-
-const int LATENCY_HISTORY = 60;
-deque<double> latencyHistory;
-
-ofstream csvFile;
-long long updateCount = 0;
-
-// ===== RESET STATE ON RECONNECT =====
-void resetState() {
-    fill(bidLadder.begin(), bidLadder.end(), 0.0);
-    fill(askLadder.begin(), askLadder.end(), 0.0);
-    bestBidIdx = 0;
-    bestAskIdx = LADDER_SIZE - 1;
-    bidWalls.clear();
-    askWalls.clear();
-    recentWallEvents.clear();
-    aggressiveBuyVol.clear();
-    aggressiveSellVol.clear();
-    totalAggressiveBuy  = 0.0;
-    totalAggressiveSell = 0.0;
-    updateAggressiveBuy  = 0.0;
-    updateAggressiveSell = 0.0;
-}
-
-void initCSV() {
-    csvFile.open("pulse_data.csv");
-    csvFile << "timestamp_ms,update_count,mid_price,best_bid,best_ask,"
-            << "spread,latency_ns,num_updates,imbalance,buy_aggression,"
-            << "sell_aggression,aggression_ratio,nearest_ask_wall_price,"
-            << "nearest_ask_wall_qty,nearest_bid_wall_price,"
-            << "nearest_bid_wall_qty,wall_event\n";
-    csvFile.flush();
-}
+// prices are carried as integer ticks and quantities as integer lots at
+// each instrument's own scale; see fixed_point.h and instrument.h
+const int  DEFAULT_LADDER_WINDOW = 1 << 16;  // ticks kept flat around mid
+const char DEFAULT_SYMBOL[]      = "BTCUSDT";
+
+vector<unique_ptr<Instrument>> instruments;
+SymbolTable                    symbolTable;
 
 void initNcurses() {
     initscr();
@@ -107,13 +67,8 @@ void initNcurses() {
     noecho();
     curs_set(0);
     keypad(stdscr, TRUE);
-
-    // handle terminal resize gracefully
-    signal(SIGWINCH, [](int) {
-        endwin();
-        refresh();
-        clear();
-    });
+    // ncurses' own SIGWINCH handler turns a resize into KEY_RESIZE, which
+    // uiLoop handles on its own thread
 
     init_pair(COL_HEADER,  COLOR_CYAN,    COLOR_BLACK);
     init_pair(COL_ASK,     COLOR_RED,     COLOR_BLACK);
@@ -124,128 +79,205 @@ void initNcurses() {
     init_pair(COL_WALL,    COLOR_YELLOW,  COLOR_BLACK);
 }
 
-inline int priceToIndex(double price) {
-    return (int)round((price - BASE_PRICE) / TICK_SIZE);
-}
-
-inline double indexToPrice(int idx) {
-    return BASE_PRICE + idx * TICK_SIZE;
+// ===== LATENCY =====
+// Every applied frame is stamped on the cycle counter when it is received,
+// dequeued, parsed, applied, analysed and output; each stage's duration
+// goes into a histogram owned by the worker that ran it. The UI thread
+// adds one more stage: publish to on screen.
+enum Stage {
+    STAGE_QUEUE,       // receive -> engine dequeue
+    STAGE_PARSE,       // parse and sequence check
+    STAGE_APPLY,       // ladder updates
+    STAGE_ANALYTICS,   // top of book, walls, imbalance, view
+    STAGE_OUTPUT,      // CSV row queued, view published
+    STAGE_TOTAL,       // receive -> output
+    ENGINE_STAGES,
+    STAGE_RENDER = ENGINE_STAGES,
+    NUM_STAGES
+};
+
+const char* const STAGE_NAMES[NUM_STAGES] = {
+    "queue", "parse", "apply", "analytics", "output", "recv->out", "render"
+};
+
+CycleClock       cycleClock;      // calibrated in main before any thread starts
+LatencyHistogram renderLatency;   // UI thread only
+
+// ===== PIPELINE STATE =====
+const size_t DEFAULT_RING_BYTES = 16 << 20;
+
+// One engine thread, its input ring and the instruments it owns.
+struct Worker {
+    int                   index;
+    int                   core = -1;
+    unique_ptr<FrameRing> ring;
+    BookEventRing*        events = nullptr;   // owned by eventBus
+    EngineStats           stats;
+    LatencyHistogram      latency[ENGINE_STAGES];
+    vector<Instrument*>   books;
+    thread                th;
+};
+
+vector<unique_ptr<Worker>> workers;
+BookEventBus               eventBus;       // one ring per worker
+const size_t               EVENT_RING_EVENTS = 4096;
+atomic<int>                workersRunning{0};
+
+// An idle worker polls its ring for workerSpinUs, then parks on it until
+// the reader pushes (FrameRing::park). Negative: poll forever, for a
+// worker with a core to itself.
+int            workerSpinUs     = 50;
+uint64_t       workerSpinCycles = 0;
+const int      WORKER_PARK_MS   = 100;
+uint64_t                   pipelineStartNs = 0;
+
+atomic<uint64_t> uiFrames{0};
+atomic<uint64_t> uiCells{0};           // terminal cells written, all frames
+atomic<uint64_t> uiViewAgeNs{0};       // publish -> draw, last frame
+atomic<uint64_t> unroutedFrames{0};    // symbol not subscribed or unreadable
+
+// Sums every worker's stage histograms, plus the UI's, into out.
+void collectStageLatency(vector<LatencySnapshot>& out) {
+    out.resize(NUM_STAGES);
+    for (auto& s : out) s.clear();
+    for (auto& w : workers)
+        for (int i = 0; i < ENGINE_STAGES; i++) out[i].add(w->latency[i]);
+    out[STAGE_RENDER].add(renderLatency);
 }
 
-void updateLevel(bool isBid, double price, double qty) {
-    int idx = priceToIndex(price);
-    if (idx < 0 || idx >= LADDER_SIZE) return;
+int uiFps      = 20;
+int pinReader  = -1;
+int pinUi      = -1;
+int pinCsv     = -1;
 
-    auto& ladder = isBid ? bidLadder : askLadder;
-    auto& walls  = isBid ? bidWalls  : askWalls;
-    string side  = isBid ? "BID" : "ASK";
+mutex  statusMutex;
+string statusText;
 
-    double prevQty = ladder[idx];
-    ladder[idx] = qty;
+// live feed arbitration across --legs connections: the reader thread
+// decides, the UI reads the per-leg statistics
+unique_ptr<FeedArbiter> feedArbiter;
 
-    if (isBid) {
-        if (qty > 0.0 && idx > bestBidIdx) bestBidIdx = idx;
-    } else {
-        if (qty > 0.0 && idx < bestAskIdx) bestAskIdx = idx;
-    }
-
-    if (!isBid && qty < prevQty && prevQty > 0.0)
-        updateAggressiveBuy  += prevQty - qty;
-    if (isBid  && qty < prevQty && prevQty > 0.0)
-        updateAggressiveSell += prevQty - qty;
-
-    if (qty >= WALL_THRESHOLD && prevQty < WALL_THRESHOLD) {
-        walls[idx] = qty;
-        string event = "[WALL APPEARED] " + side + " $" +
-            to_string((int)round(indexToPrice(idx) * 100) / 100.0).substr(0, 9) +
-            "  " + to_string(qty).substr(0, 4) + " BTC";
-        recentWallEvents.push_back(event);
-        if (recentWallEvents.size() > 3) recentWallEvents.erase(recentWallEvents.begin());
-    }
-
-    if (prevQty >= WALL_THRESHOLD && qty < WALL_THRESHOLD) {
-        walls.erase(idx);
-        string event = "[WALL GONE !!!] " + side + " $" +
-            to_string((int)round(indexToPrice(idx) * 100) / 100.0).substr(0, 9) +
-            "  was " + to_string(prevQty).substr(0, 4) + " BTC << SPOOF?";
-        recentWallEvents.push_back(event);
-        if (recentWallEvents.size() > 3) recentWallEvents.erase(recentWallEvents.begin());
-    }
+void setReaderStatus(const string& s) {
+    lock_guard<mutex> lock(statusMutex);
+    statusText = s;
 }
 
-void updateToxicityWindow() {
-    aggressiveBuyVol.push_back(updateAggressiveBuy);
-    aggressiveSellVol.push_back(updateAggressiveSell);
-    totalAggressiveBuy  += updateAggressiveBuy;
-    totalAggressiveSell += updateAggressiveSell;
+string readerStatus() {
+    lock_guard<mutex> lock(statusMutex);
+    return statusText;
+}
 
-    if ((int)aggressiveBuyVol.size() > TOXICITY_WINDOW) {
-        totalAggressiveBuy  -= aggressiveBuyVol.front();
-        totalAggressiveSell -= aggressiveSellVol.front();
-        aggressiveBuyVol.pop_front();
-        aggressiveSellVol.pop_front();
-    }
+// --record: the live reader's journal; a failed write stops the recording
+// (journal.h) and the UI reports it
+JournalWriter* recordJournal = nullptr;
 
-    updateAggressiveBuy  = 0.0;
-    updateAggressiveSell = 0.0;
+string journalStatus() {
+    if (!recordJournal || !recordJournal->failed()) return "";
+    return "Journal: recording stopped after " + to_string(recordJournal->framesWritten()) +
+           " records: " + strerror(recordJournal->error());
 }
 
-uint64_t rdtsc() {
-    uint64_t val;
-    asm volatile("mrs %0, cntvct_el0" : "=r"(val));
-    return val;
+// --shm: every published view also goes to a shared-memory seqlock slot
+// per instrument (shm_book.h), written by the owning worker
+unique_ptr<ShmBookWriter> shmWriter;
+
+// --udp: and to a UDP publisher (udp_feed.h), whose thread sends the
+// changed books once per conflation interval
+unique_ptr<UdpPublisher> udpPublisher;
+
+// --checkpoint: each worker copies its books into private buffers every
+// checkpointIntervalMs, one book per frame; checkpointWriter commits them
+// to the mapped checkpoint file (checkpoint.h) and the next start restores
+// them. Declared after the file so it is stopped before the file unmaps.
+unique_ptr<CheckpointFile>   checkpoints;
+unique_ptr<CheckpointWriter> checkpointWriter;
+int      checkpointIntervalMs = 1000;
+int      checkpointMaxAgeSeconds = 60;
+uint64_t checkpointIntervalCycles = 0;
+
+// startup: from main() to the first book in sequence, and the restore
+uint64_t         processStartNs = 0;
+atomic<uint64_t> firstLiveNs{0};       // 0 until a book is live
+double           restoreMs = 0.0;
+int              booksRestored = 0;
+int              checkpointsTooOld = 0;
+atomic<int>      checkpointsRejected{0};   // restored books the stream did not continue
+
+string startupSummary() {
+    char buf[256];
+    uint64_t live = firstLiveNs.load(memory_order_relaxed);
+    int n = snprintf(buf, sizeof(buf), "Startup: first book live %s%.1f ms after start",
+                     live ? "" : "(none yet) ", live / 1e6);
+    if (checkpoints)
+        snprintf(buf + n, sizeof(buf) - n, "; restored %d/%zu books in %.2f ms, %d too old, %d not continued",
+                 booksRestored, instruments.size(), restoreMs, checkpointsTooOld,
+                 checkpointsRejected.load(memory_order_relaxed));
+    return buf;
 }
 
-double ticksToNanos(uint64_t ticks, uint64_t freq) {
-    return (double)ticks * 1e9 / (double)freq;
+// the writer thread only reads specs, which are fixed before it starts
+size_t formatCsvRow(char* line, const TelemetryRow& r) {
+    return formatTelemetryRow(line, r, instruments[r.instrument]->spec);
 }
 
-void logToCSV(double midPrice, double bestBid, double bestAsk,
-              double spread, double latencyNs, int numUpdates,
-              double imbalance, double buyAggression, double sellAggression,
-              double aggressionRatio,
-              double nearestAskWallPrice, double nearestAskWallQty,
-              double nearestBidWallPrice, double nearestBidWallQty) {
+// --store: the CSV writer's thread also appends every row to a columnar
+// metric store (metric_store.h), one series per instrument
+class StoreTap : public TelemetryTap<TelemetryRow> {
+public:
+    explicit StoreTap(const string& path) : store_(path, storeColumns()), values_(storeColumns().size()) {}
+
+    void record(const TelemetryRow& r) override {
+        makeStoreRow(r, values_.data());
+        const InstrumentSpec& s = instruments[r.instrument]->spec;
+        store_.append(r.instrument, s.symbol.c_str(), s.priceDecimals, s.qtyDecimals, values_.data());
+    }
+    void flush(bool closing) override {
+        if (closing) store_.close();
+        else store_.flush(false);
+    }
+
+    const MetricStoreWriter& store() const { return store_; }
 
-    auto now = chrono::system_clock::now();
-    long long ms = chrono::duration_cast<chrono::milliseconds>(
-        now.time_since_epoch()).count();
+private:
+    MetricStoreWriter  store_;
+    vector<StoreValue> values_;
+};
+unique_ptr<StoreTap> storeTap;
 
-    string wallEvent = recentWallEvents.empty() ? "" : recentWallEvents.back();
-    for (auto& c : wallEvent) if (c == ',') c = ';';
+// declared after the tap it feeds, so destroyed before it
+unique_ptr<TelemetryWriter<TelemetryRow>> csvWriter;
 
-    csvFile << ms << "," << updateCount << ","
-            << fixed << setprecision(2) << midPrice << ","
-            << fixed << setprecision(2) << bestBid  << ","
-            << fixed << setprecision(2) << bestAsk  << ","
-            << fixed << setprecision(2) << spread   << ","
-            << fixed << setprecision(0) << latencyNs << ","
-            << numUpdates << ","
-            << fixed << setprecision(4) << imbalance << ","
-            << fixed << setprecision(4) << buyAggression  << ","
-            << fixed << setprecision(4) << sellAggression << ","
-            << fixed << setprecision(4) << aggressionRatio << ","
-            << fixed << setprecision(2) << nearestAskWallPrice << ","
-            << fixed << setprecision(2) << nearestAskWallQty   << ","
-            << fixed << setprecision(2) << nearestBidWallPrice << ","
-            << fixed << setprecision(2) << nearestBidWallQty   << ","
-            << wallEvent << "\n";
-    csvFile.flush();
+void logToCSV(const BookView& v, int lane) {
+    TelemetryRow r;
+    makeTelemetryRow(v, r);
+    csvWriter->write(r, lane);
 }
 
+// Every panel draws into this back buffer; uiLoop flushes only the cells
+// that changed since the last frame to ncurses. UI thread only.
+ScreenBuffer screen;
+
 void printAt(int row, int col, int colorPair, const string& s, bool bold = false) {
-    if (bold) attron(A_BOLD);
-    attron(COLOR_PAIR(colorPair));
-    mvprintw(row, col, "%s", s.c_str());
-    attroff(COLOR_PAIR(colorPair));
-    if (bold) attroff(A_BOLD);
+    screen.put(row, col, (uint8_t)(colorPair | (bold ? SCREEN_BOLD : 0)), s.data(), s.size());
+}
+
+void flushScreen() {
+    ScreenFlushStats st = screen.flush([](int row, int col, uint8_t attr, const char* text, int len) {
+        attrset(COLOR_PAIR(attr & ~SCREEN_BOLD) | (attr & SCREEN_BOLD ? A_BOLD : A_NORMAL));
+        mvaddnstr(row, col, text, len);
+    });
+    uiCells.fetch_add(st.cells, memory_order_relaxed);
+    refresh();
 }
 
-void drawImbalanceGraph(int startRow) {
+void drawImbalanceGraph(int startRow, const BookView& v) {
     const int GRAPH_HEIGHT = 8;
     const int GRAPH_WIDTH  = IMBALANCE_HISTORY;
 
-    printAt(startRow, 0, COL_HEADER, "--------- IMBALANCE HISTORY (last 60 updates) ---------");
+    char title[96];
+    snprintf(title, sizeof(title), "--------- IMBALANCE HISTORY (last %d updates, %.2f-%.2f) ---------",
+             IMBALANCE_HISTORY, v.imbalanceMin, v.imbalanceMax);
+    printAt(startRow, 0, COL_HEADER, string(title));
     startRow++;
 
     for (int r = 0; r < GRAPH_HEIGHT; r++) {
@@ -253,18 +285,13 @@ void drawImbalanceGraph(int startRow) {
         char label[8];
         snprintf(label, sizeof(label), "%.1f |", rowVal);
         printAt(startRow + r, 0, COL_NEUTRAL, string(label));
-
-        int col = 6;
-        for (int i = 0; i < (int)imbalanceHistory.size(); i++) {
-            double val = imbalanceHistory[i];
-            int valRow = (int)round((1.0 - val) * (GRAPH_HEIGHT - 1));
-            if (valRow == r) {
-                int color = (val > 0.6) ? COL_BID : (val < 0.4) ? COL_ASK : COL_SPREAD;
-                printAt(startRow + r, col + i, color, "*", true);
-            } else {
-                printAt(startRow + r, col + i, COL_NEUTRAL, " ");
-            }
-        }
+    }
+    // the frame starts blank, so only the points are drawn
+    for (int i = 0; i < v.imbalanceCount; i++) {
+        double val = v.imbalanceHistory[i];
+        int valRow = (int)round((1.0 - val) * (GRAPH_HEIGHT - 1));
+        int color  = (val > 0.6) ? COL_BID : (val < 0.4) ? COL_ASK : COL_SPREAD;
+        screen.put(startRow + valRow, 6 + i, (uint8_t)(color | SCREEN_BOLD), "*", 1);
     }
 
     string xaxis = "     +";
@@ -274,85 +301,195 @@ void drawImbalanceGraph(int startRow) {
             "      <-- older                                     newer -->");
 }
 
-void drawLatencyGraph(int startRow) {
-    const int GRAPH_HEIGHT = 6;
-    const int GRAPH_WIDTH  = LATENCY_HISTORY;
-
-    printAt(startRow, 0, COL_HEADER, "--------- LATENCY HISTORY (last 60 updates) -----------");
-    startRow++;
-
-    if (latencyHistory.empty()) {
-        printAt(startRow, 0, COL_NEUTRAL, "  waiting for data...");
-        return;
+void drawStageLatency(int startRow) {
+    static vector<LatencySnapshot> stages;   // UI thread only
+    collectStageLatency(stages);
+
+    char buf[160];
+    snprintf(buf, sizeof(buf), "--------- LATENCY BY STAGE (ns, %s %.2f GHz) ---------",
+             cycleClock.source, cycleClock.hz / 1e9);
+    printAt(startRow++, 0, COL_HEADER, string(buf));
+    printAt(startRow++, 0, COL_NEUTRAL,
+            "  STAGE           COUNT       P50       P99     P99.9       MAX");
+    for (int i = 0; i < NUM_STAGES; i++) {
+        const LatencySnapshot& h = stages[i];
+        uint64_t p999 = h.percentile(0.999);
+        snprintf(buf, sizeof(buf), "  %-10s %10llu %9llu %9llu %9llu %9llu", STAGE_NAMES[i],
+                 (unsigned long long)h.count, (unsigned long long)h.percentile(0.50),
+                 (unsigned long long)h.percentile(0.99), (unsigned long long)p999,
+                 (unsigned long long)h.maxNs);
+        int color = p999 >= 500000 ? COL_ASK : p999 >= 200000 ? COL_SPREAD : COL_NEUTRAL;
+        printAt(startRow++, 0, color, string(buf));
     }
+}
 
-    double maxLat = *max_element(latencyHistory.begin(), latencyHistory.end());
-    maxLat = max(maxLat, 100000.0);
-    double scale = ceil(maxLat / 100000.0) * 100000.0;
+void drawPipelineStats(int& row) {
+    char buf[256];
+    double elapsedNs = (double)(wallClockNs() - pipelineStartNs);
+
+    printAt(row++, 0, COL_HEADER, "--------- PIPELINE -----------");
+    for (auto& w : workers) {
+        const EngineStats& es = w->stats;
+        uint64_t processed = es.framesProcessed.load(memory_order_relaxed);
+        double avgDelayUs = processed
+            ? es.queueDelaySumNs.load(memory_order_relaxed) / 1000.0 / processed : 0.0;
+        snprintf(buf, sizeof(buf), "  W%d %2zu books  ring %llu / %.1f KB (max %.1f KB)  delay %.1f/%.1f us  busy %.1f%%  parked %llu",
+                 w->index, w->books.size(), (unsigned long long)w->ring->depthFrames(),
+                 w->ring->depthBytes() / 1024.0, w->ring->maxDepthBytes() / 1024.0,
+                 avgDelayUs, es.queueDelayMaxNs.load(memory_order_relaxed) / 1000.0,
+                 elapsedNs > 0 ? 100.0 * es.engineBusyNs.load(memory_order_relaxed) / elapsedNs : 0.0,
+                 (unsigned long long)w->ring->parks());
+        printAt(row++, 0, w->ring->fullStalls() ? COL_ALERT : COL_NEUTRAL, string(buf));
+    }
+    for (int i = 0; feedArbiter && feedArbiter->legs() > 1 && i < feedArbiter->legs(); i++) {
+        const LegStats& ls = feedArbiter->leg(i);
+        uint64_t frames = ls.frames.load(memory_order_relaxed);
+        LatencySnapshot lag;
+        lag.add(ls.lag);
+        bool up = ls.up.load(memory_order_relaxed);
+        snprintf(buf, sizeof(buf), "  Leg %d %-4s %10llu frames  won %5.1f%%  lag p50 %.2f ms  p99 %.2f ms",
+                 i, up ? "up" : "DOWN", (unsigned long long)frames,
+                 frames ? 100.0 * ls.wins.load(memory_order_relaxed) / frames : 0.0,
+                 lag.percentile(0.50) / 1e6, lag.percentile(0.99) / 1e6);
+        printAt(row++, 0, up ? COL_NEUTRAL : COL_ALERT, string(buf));
+    }
+    uint64_t frames = uiFrames.load(memory_order_relaxed);
+    snprintf(buf, sizeof(buf), "  UI:%d fps, view age %.1f ms, %.0f cells/frame   unrouted frames: %llu",
+             uiFps, uiViewAgeNs.load(memory_order_relaxed) / 1e6,
+             frames ? (double)uiCells.load(memory_order_relaxed) / frames : 0.0,
+             (unsigned long long)unroutedFrames.load(memory_order_relaxed));
+    printAt(row++, 0, COL_NEUTRAL, string(buf));
 
-    for (int r = 0; r < GRAPH_HEIGHT; r++) {
-        double rowVal = scale * (1.0 - (double)r / (GRAPH_HEIGHT - 1));
-        char label[10];
-        if (rowVal >= 1000000.0)
-            snprintf(label, sizeof(label), "%.0fm|", rowVal / 1000000.0);
-        else
-            snprintf(label, sizeof(label), "%.0fk|", rowVal / 1000.0);
-        printAt(startRow + r, 0, COL_NEUTRAL, string(label));
+    const TelemetryStats& ts = csvWriter->stats();
+    uint64_t dropped = ts.recordsDropped.load(memory_order_relaxed);
+    uint64_t rotationErrors = ts.rotationErrors.load(memory_order_relaxed);
+    int n = snprintf(buf, sizeof(buf), "  CSV: %llu rows  %.1f KB/s  queued %llu  dropped %llu  rotations %llu",
+                     (unsigned long long)ts.recordsWritten.load(memory_order_relaxed),
+                     ts.bytesPerSec.load(memory_order_relaxed) / 1024.0,
+                     (unsigned long long)csvWriter->queued(), (unsigned long long)dropped,
+                     (unsigned long long)ts.rotations.load(memory_order_relaxed));
+    if (rotationErrors)
+        snprintf(buf + n, sizeof(buf) - n, " (%llu failed)", (unsigned long long)rotationErrors);
+    printAt(row++, 0, dropped || rotationErrors || ts.writeErrors.load(memory_order_relaxed) ? COL_ALERT : COL_NEUTRAL,
+            string(buf));
+    if (storeTap) {
+        const StoreStats& ss = storeTap->store().stats();
+        uint64_t rows = ss.rows.load(memory_order_relaxed);
+        snprintf(buf, sizeof(buf), "  Store: %llu rows in %llu blocks  %.1f bytes/row",
+                 (unsigned long long)rows, (unsigned long long)ss.blocks.load(memory_order_relaxed),
+                 rows ? (double)ss.bytes.load(memory_order_relaxed) / rows : 0.0);
+        printAt(row++, 0, ss.writeErrors.load(memory_order_relaxed) ? COL_ALERT : COL_NEUTRAL, string(buf));
+    }
+    if (udpPublisher) {
+        const UdpStats& us = udpPublisher->stats();
+        snprintf(buf, sizeof(buf), "  UDP: %llu frames (%llu full)  %.1f KB/s  send errors %llu",
+                 (unsigned long long)us.frames.load(memory_order_relaxed),
+                 (unsigned long long)us.fullFrames.load(memory_order_relaxed),
+                 us.bytesPerSec.load(memory_order_relaxed) / 1024.0,
+                 (unsigned long long)us.sendErrors.load(memory_order_relaxed));
+        printAt(row++, 0, us.sendErrors.load(memory_order_relaxed) ? COL_ALERT : COL_NEUTRAL, string(buf));
+    }
 
-        int col = 6;
-        for (int i = 0; i < (int)latencyHistory.size(); i++) {
-            double val = latencyHistory[i];
-            int valRow = (int)round((1.0 - val / scale) * (GRAPH_HEIGHT - 1));
-            valRow = max(0, min(GRAPH_HEIGHT - 1, valRow));
-            if (valRow == r) {
-                int color;
-                if      (val < 200000.0) color = COL_BID;
-                else if (val < 500000.0) color = COL_SPREAD;
-                else                     color = COL_ASK;
-                printAt(startRow + r, col + i, color, "*", true);
-            } else {
-                printAt(startRow + r, col + i, COL_NEUTRAL, " ");
-            }
+    if (checkpoints) {
+        uint64_t saved = 0, sumNs = 0, maxNs = 0;
+        for (auto& w : workers) {
+            saved += w->stats.checkpoints.load(memory_order_relaxed);
+            sumNs += w->stats.checkpointSumNs.load(memory_order_relaxed);
+            maxNs  = max(maxNs, w->stats.checkpointMaxNs.load(memory_order_relaxed));
         }
+        uint64_t written = checkpointWriter->written(), writeNs = checkpointWriter->writeSumNs();
+        snprintf(buf, sizeof(buf),
+                 "  Checkpoints: %llu copied  avg %.1f us  max %.1f us  |  %llu written  avg %.1f us  max %.1f us  %llu deferred",
+                 (unsigned long long)saved, saved ? sumNs / 1e3 / saved : 0.0, maxNs / 1e3,
+                 (unsigned long long)written, written ? writeNs / 1e3 / written : 0.0,
+                 checkpointWriter->writeMaxNs() / 1e3, (unsigned long long)checkpointWriter->busy());
+        printAt(row++, 0, COL_NEUTRAL, string(buf));
     }
+    printAt(row++, 0, COL_NEUTRAL, "  " + startupSummary());
+    string journalError = journalStatus();
+    if (!journalError.empty()) printAt(row++, 0, COL_ALERT, "  " + journalError);
 
-    string xaxis = "     +";
-    for (int i = 0; i < GRAPH_WIDTH; i++) xaxis += "-";
-    printAt(startRow + GRAPH_HEIGHT,     0, COL_NEUTRAL, xaxis);
-    printAt(startRow + GRAPH_HEIGHT + 1, 0, COL_NEUTRAL,
-            "      <-- older                                     newer -->");
+    string status = readerStatus();
+    if (!status.empty()) printAt(row++, 0, COL_ALERT, "  " + status);
+}
+
+// One line per instrument to the right of the detail view; up/down keys
+// choose which one the detail view shows.
+const int SYMBOL_TABLE_COL = 72;
+
+void drawSymbolTable(const vector<const BookView*>& views, int selected) {
+    if (screen.cols() < SYMBOL_TABLE_COL + 40) return;
+    char buf[160];
+    int row = 0;
+    printAt(row++, SYMBOL_TABLE_COL, COL_HEADER,
+            "  SYMBOL            MID    SPREAD   UPDATES  LAT AVG  LAT MAX  SYNC", true);
+    for (size_t i = 0; i < views.size() && row < screen.rows(); i++) {
+        const BookView& v = *views[i];
+        const InstrumentSpec& s = instruments[i]->spec;
+        snprintf(buf, sizeof(buf), "%c %-10s %12.*f %9.*f %9lld %7.0fns %7.0fns  %s",
+                 (int)i == selected ? '>' : ' ', s.symbol.c_str(),
+                 s.priceDecimals, ticksToPrice(s, v.midTicks2) / 2.0,
+                 s.priceDecimals, ticksToPrice(s, v.spread),
+                 v.updateCount, v.latencyAvgNs, v.latencyMaxNs,
+                 v.syncEnabled && v.syncState ? v.syncState : "-");
+        int color = (int)i == selected ? COL_SPREAD
+                  : v.syncEnabled && !v.syncLive ? COL_ALERT : COL_NEUTRAL;
+        printAt(row++, SYMBOL_TABLE_COL, color, string(buf), (int)i == selected);
+    }
 }
 
-void drawUI(double midPrice, double bestBid, double bestAsk,
-            double spread, double latencyNs, int numUpdates,
-            double imbalance, double buyAggression, double sellAggression,
-            double aggressionRatio,
-            vector<pair<double,double>>& topAsks,
-            vector<pair<double,double>>& topBids,
-            pair<double,double> nearestAskWall,
-            pair<double,double> nearestBidWall) {
+// Latest pulled/filled walls, spread alerts and gaps across every book,
+// fed from the event bus by the UI thread.
+const int      UI_ALERT_LINES = 4;
+const uint32_t UI_ALERT_MASK  = eventBit(EVENT_WALL_PULLED) | eventBit(EVENT_WALL_FILLED) |
+                                eventBit(EVENT_SPREAD_WIDE) | eventBit(EVENT_GAP);
+BookEvent uiAlerts[UI_ALERT_LINES];
+int       numUiAlerts = 0;
+int       uiAlertNext = 0;
+
+void drawUI(const InstrumentSpec& spec, const BookView& v) {
+    const int   pd = spec.priceDecimals;
+    const char* base = spec.base.c_str();
+
+    double midPrice        = ticksToPrice(spec, v.midTicks2) / 2.0;
+    double spread          = ticksToPrice(spec, v.spread);
+    double latencyNs       = v.latencyNs;
+    double imbalance       = v.imbalance;
+    double buyAggression   = lotsToQty(spec, v.buyAggression);
+    double sellAggression  = lotsToQty(spec, v.sellAggression);
+    double aggressionRatio = v.aggressionRatio;
+    Level  nearestAskWall  = v.nearestAskWall;
+    Level  nearestBidWall  = v.nearestBidWall;
 
-    erase();
     int row = 0;
     char buf[256];
 
-    printAt(row++, 0, COL_HEADER, "=============== PULSE ===============", true);
-    snprintf(buf, sizeof(buf), "Price: $%.2f   Spread: $%.2f   Latency: %.0f ns   Rows: %lld",
-             midPrice, spread, latencyNs, updateCount);
+    snprintf(buf, sizeof(buf), "=============== PULSE: %s ===============", spec.symbol.c_str());
+    printAt(row++, 0, COL_HEADER, string(buf), true);
+    snprintf(buf, sizeof(buf), "Price: $%.*f   Spread: $%.*f   Latency: %.0f ns   Rows: %lld",
+             pd, midPrice, pd, spread, latencyNs, v.updateCount);
     printAt(row++, 0, COL_NEUTRAL, string(buf));
-    snprintf(buf, sizeof(buf), "Updates: %d", numUpdates);
+    snprintf(buf, sizeof(buf), "Updates: %d   Latency avg: %.0f ns  max: %.0f ns",
+             v.numUpdates, v.latencyAvgNs, v.latencyMaxNs);
     printAt(row++, 0, COL_NEUTRAL, string(buf));
+    if (v.syncEnabled) {
+        snprintf(buf, sizeof(buf), "Sync: %s  id %lld   gaps: %lld   snapshots: %lld   last resync: %.1f ms",
+                 v.syncState, v.syncUpdateId, v.syncGaps, v.syncSnapshots, v.syncLastResyncMs);
+        printAt(row++, 0, v.syncLive ? COL_NEUTRAL : COL_ALERT, string(buf));
+    }
     row++;
 
     printAt(row++, 0, COL_HEADER, "--------- ORDER BOOK ---------");
-    for (auto it = topAsks.rbegin(); it != topAsks.rend(); ++it) {
-        snprintf(buf, sizeof(buf), "  $%.2f  |  %.4f BTC  <-- SELL", it->first, it->second);
+    for (int i = v.numAsks - 1; i >= 0; --i) {
+        snprintf(buf, sizeof(buf), "  $%.*f  |  %.4f %s  <-- SELL",
+                 pd, ticksToPrice(spec, v.topAsks[i].price), lotsToQty(spec, v.topAsks[i].qty), base);
         printAt(row++, 0, COL_ASK, string(buf));
     }
-    snprintf(buf, sizeof(buf), "  ------- SPREAD: $%.2f -------", spread);
+    snprintf(buf, sizeof(buf), "  ------- SPREAD: $%.*f -------", pd, spread);
     printAt(row++, 0, COL_SPREAD, string(buf));
-    for (auto& b : topBids) {
-        snprintf(buf, sizeof(buf), "  $%.2f  |  %.4f BTC  <-- BUY ", b.first, b.second);
+    for (int i = 0; i < v.numBids; ++i) {
+        snprintf(buf, sizeof(buf), "  $%.*f  |  %.4f %s  <-- BUY ",
+                 pd, ticksToPrice(spec, v.topBids[i].price), lotsToQty(spec, v.topBids[i].qty), base);
         printAt(row++, 0, COL_BID, string(buf));
     }
     row++;
@@ -372,12 +509,26 @@ void drawUI(double midPrice, double bestBid, double bestAsk,
     }
     snprintf(buf, sizeof(buf), "  Imbalance: %.4f  %s", imbalance, imbalanceStr.c_str());
     printAt(row++, 0, imbalanceColor, string(buf), true);
+    for (int b = 0; b < v.numBands; b++) {
+        double bandImb = v.bandImbalance[b];
+        snprintf(buf, sizeof(buf), "  %4d bps: %.4f   bid %.2f / ask %.2f %s", imbalanceBandsBps[b],
+                 bandImb, lotsToQty(spec, v.bandBidDepth[b]), lotsToQty(spec, v.bandAskDepth[b]), base);
+        printAt(row++, 0, bandImb > 0.6 ? COL_BID : bandImb < 0.4 ? COL_ASK : COL_NEUTRAL, string(buf));
+    }
+    snprintf(buf, sizeof(buf), "  Move %d bps: up %.2f %s   down %.2f %s", costToMoveBps,
+             lotsToQty(spec, v.costUpLots), base, lotsToQty(spec, v.costDownLots), base);
+    printAt(row++, 0, COL_NEUTRAL, string(buf));
+    string sweepAsk = v.sweepAskPx ? "$" + formatPrice(spec, v.sweepAskPx) : "book too thin";
+    string sweepBid = v.sweepBidPx ? "$" + formatPrice(spec, v.sweepBidPx) : "book too thin";
+    snprintf(buf, sizeof(buf), "  Sweep %s %s: buy to %s   sell to %s",
+             formatQty(spec, spec.wallThreshold).c_str(), base, sweepAsk.c_str(), sweepBid.c_str());
+    printAt(row++, 0, COL_NEUTRAL, string(buf));
     row++;
 
     printAt(row++, 0, COL_HEADER, "--------- FLOW TOXICITY ------");
-    snprintf(buf, sizeof(buf), "  Buy  aggression: %.4f BTC", buyAggression);
+    snprintf(buf, sizeof(buf), "  Buy  aggression: %.4f %s", buyAggression, base);
     printAt(row++, 0, COL_BID, string(buf));
-    snprintf(buf, sizeof(buf), "  Sell aggression: %.4f BTC", sellAggression);
+    snprintf(buf, sizeof(buf), "  Sell aggression: %.4f %s", sellAggression, base);
     printAt(row++, 0, COL_ASK, string(buf));
     string toxStr;
     int toxColor;
@@ -386,186 +537,1162 @@ void drawUI(double midPrice, double bestBid, double bestAsk,
     else                              { toxStr = "MIXED AGGRESSION";   toxColor = COL_NEUTRAL; }
     snprintf(buf, sizeof(buf), "  Ratio: %.4f  %s", aggressionRatio, toxStr.c_str());
     printAt(row++, 0, toxColor, string(buf), true);
+    snprintf(buf, sizeof(buf), "  OFI: %+.4f %s   last %d: %+.4f %s", lotsToQty(spec, v.ofi), base,
+             OFI_WINDOW, lotsToQty(spec, v.ofiWindow), base);
+    printAt(row++, 0, v.ofiWindow > 0 ? COL_BID : v.ofiWindow < 0 ? COL_ASK : COL_NEUTRAL, string(buf));
+    row++;
+
+    printAt(row++, 0, COL_HEADER, "--------- VOLATILITY ---------");
+    snprintf(buf, sizeof(buf), "  Microprice: $%.*f  (%+.2f ticks from mid)", pd + 1,
+             fixedToDouble(llround(v.microprice * 10.0), pd + 1), v.microprice - v.midTicks2 / 2.0);
+    printAt(row++, 0, COL_NEUTRAL, string(buf));
+    for (int h = 0; h < NUM_HORIZONS; h++) {
+        snprintf(buf, sizeof(buf), "  %3llds: vol %6.2f bps   spread avg $%.*f  max $%.*f",
+                 (long long)(SIGNAL_HORIZONS_MS[h] / 1000), v.volBps[h], pd + 1,
+                 fixedToDouble(llround(v.spreadAvg[h] * 10.0), pd + 1), pd, ticksToPrice(spec, v.spreadMax[h]));
+        printAt(row++, 0, COL_NEUTRAL, string(buf));
+    }
     row++;
 
     printAt(row++, 0, COL_HEADER, "--------- NEAREST WALLS ------");
-    if (nearestAskWall.first > 0) {
-        snprintf(buf, sizeof(buf), "  ASK WALL  $%.2f  |  %.2f BTC  ($%.2f away)",
-                 nearestAskWall.first, nearestAskWall.second,
-                 nearestAskWall.first - midPrice);
+    if (nearestAskWall.price > 0) {
+        double wallPrice = ticksToPrice(spec, nearestAskWall.price);
+        snprintf(buf, sizeof(buf), "  ASK WALL  $%.*f  |  %.2f %s  ($%.*f away)",
+                 pd, wallPrice, lotsToQty(spec, nearestAskWall.qty), base, pd, wallPrice - midPrice);
         printAt(row++, 0, COL_ASK, string(buf));
     } else {
         printAt(row++, 0, COL_NEUTRAL, "  ASK WALL  none nearby");
     }
-    if (nearestBidWall.first > 0) {
-        snprintf(buf, sizeof(buf), "  BID WALL  $%.2f  |  %.2f BTC  ($%.2f away)",
-                 nearestBidWall.first, nearestBidWall.second,
-                 midPrice - nearestBidWall.first);
+    if (nearestBidWall.price > 0) {
+        double wallPrice = ticksToPrice(spec, nearestBidWall.price);
+        snprintf(buf, sizeof(buf), "  BID WALL  $%.*f  |  %.2f %s  ($%.*f away)",
+                 pd, wallPrice, lotsToQty(spec, nearestBidWall.qty), base, pd, midPrice - wallPrice);
         printAt(row++, 0, COL_BID, string(buf));
     } else {
         printAt(row++, 0, COL_NEUTRAL, "  BID WALL  none nearby");
     }
+    auto drawWall = [&](const WallInfo& w, const char* side, int color) {
+        snprintf(buf, sizeof(buf), "  %s $%.*f  %.2f %s  peak %.2f  up %.1fs", side,
+                 pd, ticksToPrice(spec, w.price), lotsToQty(spec, w.qty), base,
+                 lotsToQty(spec, w.peakQty), max<long long>(0, v.eventTimeMs - w.appearedMs) / 1000.0);
+        printAt(row++, 0, color, string(buf));
+    };
+    for (int i = v.numNearAskWalls - 1; i >= 0; --i) drawWall(v.nearAskWalls[i], "ask", COL_ASK);
+    for (int i = 0; i < v.numNearBidWalls; ++i)      drawWall(v.nearBidWalls[i], "bid", COL_BID);
+
+    long long filled = v.bidWallStats.filled + v.askWallStats.filled;
+    long long pulled = v.bidWallStats.pulled + v.askWallStats.pulled;
+    double filledLife = filled ? (v.bidWallStats.filledLifeMs + v.askWallStats.filledLifeMs) / 1000.0 / filled : 0;
+    double pulledLife = pulled ? (v.bidWallStats.pulledLifeMs + v.askWallStats.pulledLifeMs) / 1000.0 / pulled : 0;
+    snprintf(buf, sizeof(buf), "  %d live   gone at touch %lld (avg %.1fs)   pulled %lld (avg %.1fs)",
+             v.liveWalls, filled, filledLife, pulled, pulledLife);
+    printAt(row++, 0, pulled > filled ? COL_ALERT : COL_NEUTRAL, string(buf));
     row++;
 
     printAt(row++, 0, COL_HEADER, "--------- LAST ALERTS --------");
-    if (recentWallEvents.empty()) {
+    if (v.numWallEvents == 0) {
         printAt(row++, 0, COL_NEUTRAL, "  none yet");
     } else {
-        for (auto& e : recentWallEvents)
-            printAt(row++, 0, COL_ALERT, "  " + e, true);
+        for (int i = 0; i < v.numWallEvents; i++) {
+            formatEvent(buf, v.wallEvents[i], spec);
+            printAt(row++, 0, COL_ALERT, string("  ") + buf, true);
+        }
     }
     row++;
 
-    drawImbalanceGraph(row);
+    printAt(row++, 0, COL_HEADER, "--------- ALL SYMBOLS --------");
+    if (numUiAlerts == 0) printAt(row++, 0, COL_NEUTRAL, "  quiet");
+    for (int i = 0; i < numUiAlerts; i++) {
+        const BookEvent& e = uiAlerts[(uiAlertNext - numUiAlerts + i + UI_ALERT_LINES) % UI_ALERT_LINES];
+        formatEvent(buf, e, instruments[e.instrument]->spec);
+        printAt(row++, 0, e.type == EVENT_WALL_FILLED ? COL_NEUTRAL : COL_ALERT, string("  ") + buf);
+    }
+    row++;
+
+    drawPipelineStats(row);
+    row++;
+
+    drawImbalanceGraph(row, v);
     row += 12;
-    drawLatencyGraph(row);
+    drawStageLatency(row);
+}
 
-    refresh();
+void publishBookView(Instrument& in) {
+    BookView& v = in.view.back();
+    v.publishCycles = cycleNow();
+    if (!firstLiveNs.load(memory_order_relaxed) && !in.restored) {
+        uint64_t zero = 0;
+        firstLiveNs.compare_exchange_strong(zero, wallClockNs() - processStartNs, memory_order_relaxed);
+    }
+    logToCSV(v, in.worker);
+    if (shmWriter) {
+        ShmBook b = {};
+        makeShmBook(in, v, b);
+        shmWriter->publish(in.id, b);
+    }
+    if (udpPublisher) {
+        UdpBook b = {};
+        makeUdpBook(in, v, b);
+        udpPublisher->post(in.id, b);
+    }
+    in.view.publish();
 }
 
-void renderOrderBook(double latencyNs, int numUpdates) {
-    updateCount++;
+// ===== FRAME PIPELINE: parse -> apply -> analytics =====
+// Shared by the live socket loop and journal replay so both exercise the
+// exact same code path. `data` is the bare depth message for `in`;
+// recvCycles is 0 for diffs replayed from the sync buffer, whose receive
+// time says nothing about this pass.
+void processFrame(Instrument& in, const char* data, size_t len, uint64_t recvCycles) {
+    uint64_t start = cycleNow();
+    DepthMessage msg;
+    if (!parseDepthMessage(data, len, msg))
+        throw runtime_error("malformed depth message");
+
+    if (syncEnabled) {
+        switch (in.depthSync.onUpdate(msg)) {
+        case SyncVerdict::Apply:
+            break;
+        case SyncVerdict::Drop:
+            return;
+        case SyncVerdict::Buffer:
+            in.depthSync.buffer(data, len, msg.firstUpdateId);
+            return;
+        case SyncVerdict::Gap:
+            if (in.restored) {
+                // the stream has moved past the checkpoint: start cold,
+                // keeping the restored flow windows and signals
+                checkpointsRejected.fetch_add(1, memory_order_relaxed);
+                in.restored = false;
+                resetBook(in);
+                in.depthSync.restart();
+                in.depthSync.buffer(data, len, msg.firstUpdateId);
+                return;
+            }
+            // the book is wrong from here on; wipe it and wait for a new
+            // snapshot, keeping this diff for the bridge
+            {
+                BookEvent e = {EVENT_GAP, false, 0, 0, 0, msg.firstUpdateId, 0,
+                               in.depthSync.lastUpdateId()};
+                in.eventTimeMs = msg.eventTime;
+                emitEvent(in, e);
+            }
+            resetState(in);
+            in.depthSync.restart();
+            in.depthSync.buffer(data, len, msg.firstUpdateId);
+            return;
+        }
+    }
 
-    while (bestBidIdx > 0 && bidLadder[bestBidIdx] == 0.0) bestBidIdx--;
-    while (bestAskIdx < LADDER_SIZE - 1 && askLadder[bestAskIdx] == 0.0) bestAskIdx++;
+    uint64_t parsed = cycleNow();
+
+    in.restored    = false;
+    in.eventTimeMs = msg.eventTime;
+    int numUpdates = applyLevels(in, msg.bids, msg.asks);
+    uint64_t applied = cycleNow();
+    if (numUpdates < 0)
+        throw runtime_error("malformed depth level");
+    double latencyNs = cycleClock.toNs(applied - parsed);
+
+    updateToxicityWindow(in);
+    updateAnalytics(in, latencyNs, numUpdates);
+    uint64_t analysed = cycleNow();
+    publishBookView(in);
+    uint64_t output = cycleNow();
+
+    LatencyHistogram* h = workers[in.worker]->latency;
+    h[STAGE_PARSE].record(cycleClock.elapsedNs(start, parsed));
+    h[STAGE_APPLY].record(cycleClock.elapsedNs(parsed, applied));
+    h[STAGE_ANALYTICS].record(cycleClock.elapsedNs(applied, analysed));
+    h[STAGE_OUTPUT].record(cycleClock.elapsedNs(analysed, output));
+    if (recvCycles) h[STAGE_TOTAL].record(cycleClock.elapsedNs(recvCycles, output));
+}
 
-    vector<pair<double,double>> topAsks;
-    for (int i = bestAskIdx; i < LADDER_SIZE && topAsks.size() < 5; ++i) {
-        if (askLadder[i] > 0.0) topAsks.push_back({indexToPrice(i), askLadder[i]});
+// ===== SNAPSHOT =====
+// Loads a REST snapshot into an empty book and replays the diffs buffered
+// while it was in flight. Returns false if the snapshot is older than the
+// buffered diffs and another one is needed.
+bool applySnapshot(Instrument& in, const char* data, size_t len) {
+    DepthSnapshot snap;
+    if (!parseDepthSnapshot(data, len, snap))
+        throw runtime_error("malformed depth snapshot");
+    if (!in.depthSync.acceptSnapshot(snap.lastUpdateId)) return false;
+
+    // through updateLevel so resting walls are registered; the book is
+    // empty, so no aggression is counted
+    resetState(in);
+    if (applyLevels(in, snap.bids, snap.asks) < 0)
+        throw runtime_error("malformed snapshot level");
+
+    for (auto& frame : in.depthSync.snapshotApplied(snap.lastUpdateId))
+        processFrame(in, frame.data(), frame.size(), 0);
+    return true;
+}
+
+// Live only: snapshots are fetched on the fetcher's threads and come back
+// through the reader as RING_SNAPSHOT records (see deliverSnapshot), so a
+// worker never waits on the network. The socket stays open meanwhile and
+// the book's diffs are buffered by its DepthSync until the snapshot is in.
+// A replay takes its snapshots from the journal instead.
+unique_ptr<SnapshotFetcher> snapshotFetcher;
+
+// Takes a snapshot record off the ring. A snapshot that arrives after the
+// book has moved on (a checkpoint held, or a gap restarted it since) is
+// ignored; a stale one is fetched again.
+void takeSnapshot(Instrument& in, const char* data, size_t len) {
+    if (snapshotFetcher) snapshotFetcher->delivered(in.id);
+    // a restored book only takes a snapshot once the stream rejects it
+    if (!syncEnabled || in.restored || in.depthSync.state() != SyncState::AwaitingSnapshot) return;
+    if (!applySnapshot(in, data, len))
+        setReaderStatus(in.spec.symbol + " snapshot is older than the stream -- fetching another");
+}
+
+// After a frame or snapshot: ask for a snapshot if the book is waiting on
+// one. Repeated asks while one is in flight are no-ops.
+void requestSnapshotIfNeeded(const Instrument& in) {
+    if (snapshotFetcher && syncEnabled && in.depthSync.needsSnapshot()) snapshotFetcher->request(in.id);
+}
+
+// ===== CHECKPOINTS =====
+// Called by the owning worker after a frame. A book is saved once its
+// interval is up and only while it is in sequence. The worker only copies
+// it into one of its private buffers; checkpointWriter does the write into
+// the mapped file, so page faults and writeback never stall the apply
+// loop. With both buffers still queued the book waits for a later frame.
+void checkpointIfDue(Worker& w, Instrument& in) {
+    uint64_t now = cycleNow();
+    if (now < in.checkpointDue || in.restored ||
+        (syncEnabled && in.depthSync.state() != SyncState::Live))
+        return;
+    void* buf = checkpointWriter->acquire(w.index);
+    if (!buf) return;
+    in.checkpointDue = now + checkpointIntervalCycles;
+
+    size_t bytes = saveCheckpoint(in, *static_cast<BookCheckpoint*>(buf));
+    checkpointWriter->submit(w.index, in.id, in.spec.symbol, bytes);
+
+    uint64_t ns = cycleClock.elapsedNs(now, cycleNow());
+    w.stats.checkpoints.fetch_add(1, memory_order_relaxed);
+    w.stats.checkpointSumNs.fetch_add(ns, memory_order_relaxed);
+    if (ns > w.stats.checkpointMaxNs.load(memory_order_relaxed))
+        w.stats.checkpointMaxNs.store(ns, memory_order_relaxed);
+}
+
+// Before the workers start: every book with a checkpoint young enough is
+// rebuilt from it and, with sync on, waits for the stream to continue it.
+void restoreCheckpoints() {
+    auto t0 = chrono::steady_clock::now();
+    int64_t now = (int64_t)wallClockNs();
+    for (auto& in : instruments) {
+        int64_t savedNs = 0;
+        const void* p = checkpoints->latest(in->spec.symbol, savedNs);
+        if (!p) continue;
+        if (now - savedNs > (int64_t)checkpointMaxAgeSeconds * 1000000000LL) {
+            checkpointsTooOld++;
+            continue;
+        }
+        const BookCheckpoint& c = *static_cast<const BookCheckpoint*>(p);
+        if (!restoreCheckpoint(*in, c)) continue;
+        if (syncEnabled) in->depthSync.resume(c.lastUpdateId);
+        in->restored = true;
+        booksRestored++;
     }
+    checkpoints->startWriting();
+    restoreMs = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+}
+
+// ===== ENGINE WORKERS =====
+// Each worker owns its books outright. It consumes records from its own
+// frame ring, parses them in place and publishes a BookView per applied
+// update. It makes no syscalls: no socket, terminal or file I/O happens
+// here, and a resync only flags a request for the snapshot fetcher.
+void engineLoop(Worker& w) {
+    if (!pinCurrentThread(w.core))
+        setReaderStatus("could not pin worker " + to_string(w.index));
+
+    RingRecord rec;
+    uint64_t idleSince = 0;
+    while (true) {
+        if (!w.ring->peek(rec)) {
+            w.stats.engineEmptyPolls.fetch_add(1, memory_order_relaxed);
+            uint64_t now = cycleNow();
+            if (!idleSince) idleSince = now;
+            if (workerSpinUs >= 0 && now - idleSince >= workerSpinCycles) {
+                w.ring->park(WORKER_PARK_MS);
+                idleSince = 0;
+            } else {
+                cpuRelax();
+            }
+            continue;
+        }
+        idleSince = 0;
+
+        uint64_t t0 = cycleNow();
+        uint64_t queueNs = cycleClock.elapsedNs(rec.recvCycles, t0);
+        w.stats.recordQueueDelay(queueNs);
+        if (rec.type == RING_END) {
+            w.ring->pop();
+            break;
+        }
+        if (rec.type == RING_RESET) {
+            // a reconnect loses the book, not the flow it has seen
+            for (Instrument* in : w.books) {
+                resetBook(*in);
+                in->restored = false;
+                in->depthSync.restart();
+            }
+            w.ring->pop();
+            continue;
+        }
 
-    vector<pair<double,double>> topBids;
-    for (int i = bestBidIdx; i >= 0 && topBids.size() < 5; --i) {
-        if (bidLadder[i] > 0.0) topBids.push_back({indexToPrice(i), bidLadder[i]});
+        Instrument& in = *instruments[rec.instrument];
+        try {
+            if (rec.type == RING_FRAME) {
+                w.latency[STAGE_QUEUE].record(queueNs);
+                processFrame(in, rec.data, rec.length, rec.recvCycles);
+                requestSnapshotIfNeeded(in);
+                if (checkpoints) checkpointIfDue(w, in);
+            } else if (rec.type == RING_SNAPSHOT) {
+                takeSnapshot(in, rec.data, rec.length);
+                requestSnapshotIfNeeded(in);
+            }
+        } catch (exception const& e) {
+            // this book can no longer be trusted; start it over from the
+            // next frame (and snapshot) without touching the others
+            setReaderStatus(in.spec.symbol + " engine error: " + e.what());
+            resetState(in);
+            in.restored = false;
+            in.depthSync.restart();
+        }
+
+        w.ring->pop();
+        w.stats.framesProcessed.fetch_add(1, memory_order_relaxed);
+        w.stats.engineBusyNs.fetch_add(cycleClock.elapsedNs(t0, cycleNow()), memory_order_relaxed);
     }
+    workersRunning.fetch_sub(1, memory_order_release);
+}
 
-    double midPrice = (!topBids.empty() && !topAsks.empty())
-                      ? (topBids.front().first + topAsks.front().first) / 2.0
-                      : 69000.0;
-    double bestBid  = !topBids.empty() ? topBids.front().first : 0.0;
-    double bestAsk  = !topAsks.empty() ? topAsks.front().first : 0.0;
-    double spread   = bestAsk - bestBid;
+// ===== UI THREAD =====
+// Redraws at most uiFps times a second from the latest conflated views,
+// however fast the feed is, and only when something changed. Each frame is
+// drawn into the back buffer and only the cells that differ from the last
+// one reach the terminal. Up/down (or k/j) select the instrument shown in
+// detail.
+void uiLoop() {
+    pinCurrentThread(pinUi);
+    initNcurses();
+    nodelay(stdscr, TRUE);
+    screen.resize(LINES, COLS);
 
-    double bidVolume = 0.0, askVolume = 0.0;
-    for (auto& b : topBids) bidVolume += b.second;
-    for (auto& a : topAsks) askVolume += a.second;
-    double imbalance = (bidVolume + askVolume > 0)
-                       ? bidVolume / (bidVolume + askVolume) : 0.5;
+    int selected = 0;
+    int count    = (int)instruments.size();
+    vector<const BookView*> views(count);
+    BookEventBus::Subscriber alerts = eventBus.subscribe(UI_ALERT_MASK);
 
-    imbalanceHistory.push_back(imbalance);
-    if ((int)imbalanceHistory.size() > IMBALANCE_HISTORY)
-        imbalanceHistory.pop_front();
+    auto period = chrono::nanoseconds(1000000000LL / uiFps);
+    auto next   = chrono::steady_clock::now();
+    while (true) {
+        bool done    = workersRunning.load(memory_order_acquire) == 0;
+        bool changed = done;
+
+        for (int ch; (ch = getch()) != ERR; changed = true) {
+            if      (ch == KEY_UP   || ch == 'k') selected = (selected + count - 1) % count;
+            else if (ch == KEY_DOWN || ch == 'j') selected = (selected + 1) % count;
+            else if (ch == KEY_RESIZE) {
+                screen.resize(LINES, COLS);
+                clear();
+            }
+        }
+        bool fresh = false;   // the selected view changed since the last draw
+        for (int i = 0; i < count; i++) {
+            if (instruments[i]->view.update()) {
+                changed = true;
+                if (i == selected) fresh = true;
+            }
+            views[i] = &instruments[i]->view.front();
+        }
+        if (eventBus.poll(alerts, [](const BookEvent& e) {
+                uiAlerts[uiAlertNext] = e;
+                uiAlertNext = (uiAlertNext + 1) % UI_ALERT_LINES;
+                numUiAlerts = min(numUiAlerts + 1, UI_ALERT_LINES);
+            }))
+            changed = true;
+
+        if (changed) {
+            const BookView& v = *views[selected];
+            uiViewAgeNs.store(v.publishCycles ? cycleClock.elapsedNs(v.publishCycles, cycleNow()) : 0,
+                              memory_order_relaxed);
+            screen.clear();
+            drawUI(instruments[selected]->spec, v);
+            drawSymbolTable(views, selected);
+            flushScreen();
+            if (fresh && v.publishCycles)
+                renderLatency.record(cycleClock.elapsedNs(v.publishCycles, cycleNow()));
+            uiFrames.fetch_add(1, memory_order_relaxed);
+        }
+        if (done) break;
+        next += period;
+        this_thread::sleep_until(next);
+    }
+    endwin();
+}
 
-    latencyHistory.push_back(latencyNs);
-    if ((int)latencyHistory.size() > LATENCY_HISTORY)
-        latencyHistory.pop_front();
+// ===== HEADLESS =====
+// --headless: for servers with no terminal. ncurses is never initialised;
+// this thread takes the UI's place as the consumer of the view buffers and
+// writes one status line per symbol to stderr every statusEverySeconds
+// (never if 0). It ends with the workers, as uiLoop does.
+bool headless           = false;
+int  statusEverySeconds = 10;
+
+void headlessLoop() {
+    pinCurrentThread(pinUi);
+    auto next = chrono::steady_clock::now() + chrono::seconds(statusEverySeconds);
+    string lastStatus;
+    char buf[256];
+    bool startupShown = false, journalShown = false;
+    while (workersRunning.load(memory_order_acquire) != 0) {
+        this_thread::sleep_for(chrono::milliseconds(100));
+        if (!startupShown && firstLiveNs.load(memory_order_relaxed)) {
+            cerr << startupSummary() << endl;
+            startupShown = true;
+        }
+        if (!journalShown && recordJournal && recordJournal->failed()) {
+            cerr << journalStatus() << endl;
+            journalShown = true;
+        }
+        if (statusEverySeconds <= 0 || chrono::steady_clock::now() < next) continue;
+        next += chrono::seconds(statusEverySeconds);
+
+        for (auto& in : instruments) {
+            in->view.update();
+            const BookView& v = in->view.front();
+            const InstrumentSpec& s = in->spec;
+            snprintf(buf, sizeof(buf), "%-10s mid %.*f  spread %.*f  updates %lld  imb %.3f  aggr %.3f  %s",
+                     s.symbol.c_str(), s.priceDecimals, ticksToPrice(s, v.midTicks2) / 2.0,
+                     s.priceDecimals, ticksToPrice(s, v.spread), v.updateCount, v.imbalance,
+                     v.aggressionRatio, v.syncEnabled && v.syncState ? v.syncState : "-");
+            cerr << buf << "\n";
+        }
+        string status = readerStatus();
+        if (status != lastStatus && !status.empty()) cerr << status << "\n";
+        lastStatus = status;
+        cerr << flush;
+    }
+}
 
-    double totalAggressive = totalAggressiveBuy + totalAggressiveSell;
-    double buyAggression   = totalAggressiveBuy;
-    double sellAggression  = totalAggressiveSell;
-    double aggressionRatio = (totalAggressive > 0)
-                             ? buyAggression / totalAggressive : 0.5;
+// ===== ROUTING =====
+// Finds the book a raw frame belongs to and the depth message inside it.
+// Combined-stream frames name the stream in their envelope; bare frames
+// (single-stream journals) carry the symbol in "s". Either way the symbol
+// resolves through the packed-key table, not a string map.
+int routeFrame(const char* data, size_t len, string_view& payload) {
+    string_view stream;
+    if (parseStreamEnvelope(data, len, stream, payload))
+        return symbolTable.find(stream.substr(0, stream.find('@')));
+
+    payload = string_view(data, len);
+    string_view symbol;
+    return peekSymbol(data, len, symbol) ? symbolTable.find(symbol) : SymbolTable::NONE;
+}
 
-    pair<double,double> nearestBidWall = {0, 0};
-    pair<double,double> nearestAskWall = {0, 0};
+void pushFrame(int index, uint64_t recvCycles, string_view payload) {
+    const Instrument& in = *instruments[index];
+    workers[in.worker]->ring->push(recvCycles, RING_FRAME, in.id, payload.data(),
+                                   (uint32_t)payload.size());
+}
 
-    for (auto& w : bidWalls) {
-        double wp = indexToPrice(w.first);
-        if (abs(wp - midPrice) < WALL_RANGE) {
-            if (nearestBidWall.first == 0 || abs(wp - midPrice) < abs(nearestBidWall.first - midPrice))
-                nearestBidWall = {wp, w.second};
+void dispatchFrame(uint64_t recvCycles, const char* data, size_t len) {
+    string_view payload;
+    int index = routeFrame(data, len, payload);
+    if (index == SymbolTable::NONE) {
+        unroutedFrames.fetch_add(1, memory_order_relaxed);
+        return;
+    }
+    pushFrame(index, recvCycles, payload);
+}
+
+// Journaled snapshots are "SYMBOL\n{...}"; journals from before
+// multi-symbol support hold the bare body, which belongs to the first
+// instrument.
+void dispatchSnapshot(uint64_t recvCycles, const char* data, size_t len) {
+    int index = 0;
+    if (len > 0 && data[0] != '{') {
+        const char* nl = static_cast<const char*>(memchr(data, '\n', len));
+        index = nl ? symbolTable.find(string_view(data, nl - data)) : SymbolTable::NONE;
+        if (index == SymbolTable::NONE) {
+            unroutedFrames.fetch_add(1, memory_order_relaxed);
+            return;
         }
+        len -= nl + 1 - data;
+        data = nl + 1;
     }
-    for (auto& w : askWalls) {
-        double wp = indexToPrice(w.first);
-        if (abs(wp - midPrice) < WALL_RANGE) {
-            if (nearestAskWall.first == 0 || abs(wp - midPrice) < abs(nearestAskWall.first - midPrice))
-                nearestAskWall = {wp, w.second};
+    const Instrument& in = *instruments[index];
+    workers[in.worker]->ring->push(recvCycles, RING_SNAPSHOT, in.id, data, (uint32_t)len);
+}
+
+void broadcast(uint64_t recvCycles, uint16_t type) {
+    for (auto& w : workers) w->ring->push(recvCycles, type, ALL_INSTRUMENTS, nullptr, 0);
+}
+
+// ===== READER: LIVE =====
+// Network thread. Reads frames of the combined stream into one reused
+// buffer per connection and copies each into the ring of the worker owning
+// its symbol; journaling, if enabled, also happens here so the workers
+// never touch the disk for stream frames.
+//
+// With --legs N the same stream is read over N connections on this one
+// thread (the worker rings have a single producer). Each update is taken
+// from whichever leg delivers it first and later copies are dropped before
+// they are journaled or queued. The books are only reset once every leg
+// is down.
+//
+// Snapshots fetched for the workers are posted to this thread too, so the
+// rings keep their single producer and a snapshot is journaled exactly
+// where its worker applies it relative to the frames.
+ReaderOptions           readerOpts;
+int                     feedLegs = 1;
+vector<string>          feedHosts;      // host[:port], assigned to legs round-robin
+boost::asio::io_context readerIoc;
+
+// Called on a fetcher thread. Journaled snapshots are prefixed with their
+// symbol; see journal.h.
+void deliverSnapshot(JournalWriter* journal, int index, string&& body) {
+    boost::asio::post(readerIoc, [journal, index, body = std::move(body)] {
+        const Instrument& in = *instruments[index];
+        if (journal) {
+            string record = in.spec.symbol + "\n" + body;
+            journal->append(wallClockNs(), record.data(), record.size(), JOURNAL_SNAPSHOT);
         }
+        workers[in.worker]->ring->push(cycleNow(), RING_SNAPSHOT, in.id, body.data(), (uint32_t)body.size());
+    });
+}
+
+void liveReader(JournalWriter* journal, const string& target) {
+    pinCurrentThread(pinReader);
+
+    boost::asio::io_context& ioc = readerIoc;
+    FeedArbiter& arbiter = *feedArbiter;
+    vector<unique_ptr<WsReader>> legs;
+    for (int leg = 0; leg < feedLegs; leg++) {
+        ReaderOptions opts = readerOpts;
+        opts.endpoint = leg;
+        if (!feedHosts.empty()) {
+            const string& h = feedHosts[leg % feedHosts.size()];
+            size_t colon = h.rfind(':');
+            opts.host = h.substr(0, colon);
+            if (colon != string::npos) opts.port = h.substr(colon + 1);
+        }
+        string name = feedLegs > 1 ? "Leg " + to_string(leg) + ": " : "";
+
+        legs.emplace_back(new WsReader(ioc, opts, target,
+            [journal, &arbiter, leg](uint64_t recvCycles, const char* data, size_t len) {
+                string_view payload;
+                int index = routeFrame(data, len, payload);
+                if (index == SymbolTable::NONE) {
+                    unroutedFrames.fetch_add(1, memory_order_relaxed);
+                    return;
+                }
+                int64_t finalUpdateId;
+                if (peekFinalUpdateId(payload.data(), payload.size(), finalUpdateId) &&
+                    !arbiter.accept(leg, index, finalUpdateId, recvCycles))
+                    return;
+                if (journal) journal->append(wallClockNs(), data, len);
+                pushFrame(index, recvCycles, payload);
+            },
+            [&arbiter, leg] {
+                arbiter.legUp(leg);
+                setReaderStatus("");
+            },
+            [&arbiter, leg, name](const string& why, int retryMs) {
+                bool wasUp = arbiter.leg(leg).up.load(memory_order_relaxed);
+                if (arbiter.legDown(leg) == 0 && wasUp) {
+                    broadcast(cycleNow(), RING_RESET);
+                    arbiter.reset();
+                }
+                char delay[32];
+                snprintf(delay, sizeof(delay), "%.1f", retryMs / 1000.0);
+                setReaderStatus(name + "Disconnected: " + why + " -- reconnecting in " + delay +
+                                " seconds...");
+            }));
     }
+    for (auto& l : legs) l->start();
+    ioc.run();
+}
 
-    logToCSV(midPrice, bestBid, bestAsk, spread, latencyNs, numUpdates,
-             imbalance, buyAggression, sellAggression, aggressionRatio,
-             nearestAskWall.first, nearestAskWall.second,
-             nearestBidWall.first, nearestBidWall.second);
+// ===== READER: REPLAY =====
+// Routes a recorded journal into the worker rings. With maxSpeed the
+// records go back to back; otherwise the original inter-arrival gaps are
+// reproduced against a steady clock.
+struct ReplayTotals {
+    long long frames = 0;
+    uint64_t  bytes  = 0;
+};
+
+void replayReader(JournalReader& reader, bool maxSpeed, ReplayTotals& totals) {
+    pinCurrentThread(pinReader);
+
+    JournalFrame frame;
+    uint64_t firstRecvNs = 0;
+    auto wallStart = chrono::steady_clock::now();
+
+    while (reader.next(frame)) {
+        if (totals.frames == 0) firstRecvNs = frame.recvNs;
+        if (!maxSpeed) {
+            auto due = wallStart + chrono::nanoseconds(frame.recvNs - firstRecvNs);
+            this_thread::sleep_until(due);
+        }
+        if (frame.type == JOURNAL_SNAPSHOT) dispatchSnapshot(cycleNow(), frame.data, frame.length);
+        else                                dispatchFrame(cycleNow(), frame.data, frame.length);
+        totals.frames++;
+        totals.bytes += frame.length;
+    }
+    broadcast(cycleNow(), RING_END);
+}
 
-    drawUI(midPrice, bestBid, bestAsk, spread, latencyNs, numUpdates,
-           imbalance, buyAggression, sellAggression, aggressionRatio,
-           topAsks, topBids, nearestAskWall, nearestBidWall);
+// ===== LATENCY LOG =====
+// Every latencyLogSeconds, appends one row per stage covering just that
+// interval, so a tail that comes and goes shows up when it happened rather
+// than being averaged into the whole run. A last row set is written when
+// the workers stop.
+int latencyLogSeconds = 10;
+
+const char* LATENCY_LOG_HEADER =
+    "elapsed_s,stage,count,mean_ns,p50_ns,p90_ns,p99_ns,p999_ns,max_ns\n";
+
+void writeLatencyRows(ostream& out, double elapsedS, const vector<LatencySnapshot>& now,
+                      const vector<LatencySnapshot>& before) {
+    for (int i = 0; i < NUM_STAGES; i++) {
+        LatencySnapshot d = now[i].since(before[i]);
+        out << fixed << setprecision(3) << elapsedS << ',' << STAGE_NAMES[i] << ',' << d.count
+            << ',' << setprecision(0) << d.meanNs() << ',' << d.percentile(0.50) << ','
+            << d.percentile(0.90) << ',' << d.percentile(0.99) << ',' << d.percentile(0.999)
+            << ',' << d.maxNs << '\n';
+    }
+    out.flush();
 }
 
-int main() {
-    initCSV();
-    initNcurses();
+void latencyLogLoop(ofstream& out) {
+    vector<LatencySnapshot> prev(NUM_STAGES), cur;
+    auto start = chrono::steady_clock::now();
+    auto next  = start + chrono::seconds(latencyLogSeconds);
+    while (true) {
+        bool done = workersRunning.load(memory_order_acquire) == 0;
+        auto now  = chrono::steady_clock::now();
+        if (done || now >= next) {
+            collectStageLatency(cur);
+            writeLatencyRows(out, chrono::duration<double>(now - start).count(), cur, prev);
+            swap(prev, cur);
+            next += chrono::seconds(latencyLogSeconds);
+        }
+        if (done) break;
+        this_thread::sleep_for(chrono::milliseconds(100));
+    }
+}
 
-    uint64_t freq;
-    asm volatile("mrs %0, cntfrq_el0" : "=r"(freq));
+// ===== EVENT LOG =====
+// An event bus subscriber that appends one line per matching event. The
+// text is built here, on its own thread, not on the engine.
+uint32_t eventLogMask = ALL_EVENTS & ~eventBit(EVENT_BEST_CHANGE);
+
+const char* EVENT_LOG_HEADER = "event_time_ms,symbol,type,detail\n";
+
+// "all", "wall" or a list of EVENT_TYPE_NAMES; 0 if a name is unknown.
+uint32_t parseEventTypes(const vector<string>& names) {
+    uint32_t mask = 0;
+    for (auto& n : names) {
+        uint32_t bit = n == "all" ? ALL_EVENTS : n == "wall" ? WALL_EVENTS : 0;
+        for (int t = 0; t < NUM_EVENT_TYPES; t++)
+            if (n == EVENT_TYPE_NAMES[t]) bit = eventBit(t);
+        if (!bit) return 0;
+        mask |= bit;
+    }
+    return mask;
+}
 
+void eventLogLoop(ofstream& out, BookEventBus::Subscriber& sub) {
+    char text[EVENT_TEXT_CHARS];
     while (true) {
-        try {
-            net::io_context ioc;
-            ssl::context ctx(ssl::context::tlsv12_client);
-            ctx.set_default_verify_paths();
+        bool done = workersRunning.load(memory_order_acquire) == 0;
+        eventBus.poll(sub, [&](const BookEvent& e) {
+            const InstrumentSpec& spec = instruments[e.instrument]->spec;
+            size_t n = formatEvent(text, e, spec);
+            replace(text, text + n, ',', ';');
+            out << e.timeMs << ',' << spec.symbol << ',' << EVENT_TYPE_NAMES[e.type] << ',' << text << '\n';
+        });
+        out.flush();
+        if (done) break;
+        this_thread::sleep_for(chrono::milliseconds(50));
+    }
+}
 
-            tcp::resolver resolver(ioc);
-            websocket::stream<beast::ssl_stream<tcp::socket>> ws(ioc, ctx);
+void printStageLatency() {
+    vector<LatencySnapshot> stages;
+    collectStageLatency(stages);
+    cerr << "Latency by stage (ns, " << cycleClock.source << " " << setprecision(2)
+         << cycleClock.hz / 1e9 << " GHz):\n"
+         << "  stage           count      mean       p50       p99     p99.9       max\n";
+    for (int i = 0; i < NUM_STAGES; i++) {
+        const LatencySnapshot& h = stages[i];
+        cerr << "  " << left << setw(10) << STAGE_NAMES[i] << right << setw(11) << h.count
+             << setprecision(0) << setw(10) << h.meanNs() << setw(10) << h.percentile(0.50)
+             << setw(10) << h.percentile(0.99) << setw(10) << h.percentile(0.999)
+             << setw(10) << h.maxNs << "\n";
+    }
+}
 
-            string host   = "stream.binance.com";
-            string port   = "9443";
-            string target = "/ws/btcusdt@depth";
+void printUsage(const char* prog) {
+    cerr << "usage: " << prog << " [--record <journal>] | [--replay <journal> [--max-speed]]\n"
+         << "       [--symbols <spec>,<spec>,...]  instruments to track (default "
+         << DEFAULT_SYMBOL << ")\n"
+         << "           spec: SYMBOL[:priceDecimals:qtyDecimals[:wallQty[:wallRange]]]\n"
+         << "       [--workers <n>]  engine threads, books spread round-robin (default 1)\n"
+         << "       [--window <ticks>]   price ladder window (default "
+         << DEFAULT_LADDER_WINDOW << ")\n"
+         << "       [--snapshot-url <url>]  REST depth snapshot endpoint, {symbol} is substituted\n"
+         << "           (default " << DEFAULT_SNAPSHOT_URL << ")\n"
+         << "       [--no-sync]  apply diffs without snapshot/sequence checks\n"
+         << "       [--ring-mb <n>]  frame ring size per worker (default "
+         << (DEFAULT_RING_BYTES >> 20) << ")\n"
+         << "       [--spin-us <us>]  an idle worker polls this long, then sleeps until the next\n"
+         << "           frame (default 50; -1 polls forever)\n"
+         << "       [--ui-fps <n>]   UI refresh rate cap; frames are only drawn on change (default 20)\n"
+         << "       [--headless [--status-every <s>]]  no terminal UI; a status line per symbol to\n"
+         << "           stderr every interval (default 10 s, 0 for none)\n"
+         << "       [--pin-reader <core>] [--pin-workers <core>,<core>,...] [--pin-ui <core>] [--pin-csv <core>]\n"
+         << "       [--csv <path>]   telemetry file (default pulse_data.csv)\n"
+         << "       [--csv-full drop|block]  when the CSV ring is full (default: drop live, block replay)\n"
+         << "       [--csv-ring <rows>] [--csv-flush-ms <ms>] [--csv-fsync never|flush|<ms>]\n"
+         << "       [--csv-rotate-mb <n>] [--csv-rotate-min <n>]\n"
+         << "       [--store <path>]  also append every row to a compressed columnar store (pulse_query)\n"
+         << "       [--latency-log <path>] [--latency-every <s>]  per-stage latency percentiles,\n"
+         << "           one row per stage every interval (default 10 s)\n"
+         << "       [--bands <bps>,<bps>,...]  depth imbalance bands around the mid, up to "
+         << MAX_BANDS << " (default 10,50,100)\n"
+         << "       [--cost-bps <n>]  price move the cost-to-move metric prices (default 10)\n"
+         << "       [--busy-poll <us>] [--sock-rcvbuf-kb <n>] [--sock-sndbuf-kb <n>] [--no-nodelay]\n"
+         << "           socket tuning for the live connection (TCP_NODELAY is on by default)\n"
+         << "       [--backoff <min_ms>,<max_ms>]  reconnect backoff with jitter (default 250,30000)\n"
+         << "       [--legs <n>]  redundant connections to the stream, first arrival wins (default 1)\n"
+         << "       [--feed-hosts <host[:port]>,...]  stream servers, assigned to legs round-robin\n"
+         << "           (default stream.binance.com:9443)\n"
+         << "       [--no-verify-tls]  accept any certificate from the stream and snapshot servers,\n"
+         << "           for a local stand-in with a self-signed one (verified by default)\n"
+         << "       [--shm <name>]  publish every book to POSIX shared memory (e.g. /pulse_book)\n"
+         << "       [--udp <host:port>] [--udp-ms <ms>] [--udp-full-ms <ms>]  broadcast the top of every\n"
+         << "           book over UDP, unicast or to a multicast group, at most one frame per book per\n"
+         << "           interval (default 100 ms) and a full frame at least every --udp-full-ms (1000)\n"
+         << "       [--checkpoint <path>] [--checkpoint-ms <ms>] [--checkpoint-max-age <s>]  keep books\n"
+         << "           and signals in a mapped file, written every interval (default 1000 ms) and\n"
+         << "           restored at start unless older than the max age (default 60 s)\n"
+         << "       [--event-log <path>] [--event-types <type>,...]  engine events as CSV; types are\n"
+         << "           all, wall, wall_appeared, wall_pulled, wall_filled, best, spread, gap\n"
+         << "           (default: all but best)\n";
+}
 
-            auto const results = resolver.resolve(host, port);
-            net::connect(get_lowest_layer(ws), results.begin(), results.end());
+void printCsvSummary() {
+    const TelemetryStats& ts = csvWriter->stats();
+    cerr << "CSV: " << ts.recordsWritten.load() << " rows, " << ts.bytesWritten.load() / 1024
+         << " KB in " << ts.writes.load() << " writes, " << ts.recordsDropped.load() << " dropped, "
+         << ts.producerWaits.load() << " ring-full waits, " << ts.rotations.load() << " rotations";
+    if (ts.rotationErrors.load()) cerr << ", " << ts.rotationErrors.load() << " FAILED ROTATIONS";
+    if (ts.writeErrors.load()) cerr << ", " << ts.writeErrors.load() << " WRITE ERRORS";
+    cerr << endl;
+    if (storeTap) {
+        const MetricStoreWriter& st = storeTap->store();
+        const StoreStats& ss = st.stats();
+        cerr << "Store: " << ss.rows.load() << " rows in " << ss.blocks.load() << " blocks, "
+             << ss.bytes.load() / 1024 << " KB appended to " << st.path() << " ("
+             << st.existingBlocks() << " blocks already there)";
+        if (ss.writeErrors.load()) cerr << ", " << ss.writeErrors.load() << " WRITE ERRORS";
+        cerr << endl;
+    }
+}
 
-            if (!SSL_set_tlsext_host_name(ws.next_layer().native_handle(), host.c_str()))
-                throw beast::system_error(beast::error_code(
-                    static_cast<int>(::ERR_get_error()),
-                    net::error::get_ssl_category()));
+void printUdpSummary() {
+    const UdpStats& us = udpPublisher->stats();
+    cerr << "UDP: " << us.frames.load() << " frames (" << us.fullFrames.load() << " full) to "
+         << udpPublisher->options().destination << (udpPublisher->multicast() ? " (multicast)" : "") << ", "
+         << us.bytes.load() / 1024 << " KB, " << us.posts.load() << " book updates conflated";
+    if (us.sendErrors.load()) cerr << ", " << us.sendErrors.load() << " SEND ERRORS";
+    cerr << endl;
+}
 
-            ws.next_layer().handshake(ssl::stream_base::client);
-            ws.handshake(host, target);
+vector<string> splitList(const string& s) {
+    vector<string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == string::npos) comma = s.size();
+        if (comma > start) out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
 
-            while (true) {
-                beast::flat_buffer buffer;
-                ws.read(buffer);
+void startWorkers() {
+    workersRunning.store((int)workers.size());
+    for (auto& w : workers)
+        w->th = thread(engineLoop, ref(*w));
+}
+
+void joinWorkers() {
+    for (auto& w : workers) w->th.join();
+}
+
+int main(int argc, char** argv) {
+    processStartNs = wallClockNs();
+    string recordPath, replayPath, latencyLogPath, eventLogPath, shmName, checkpointPath, storePath;
+    string snapshotUrl = DEFAULT_SNAPSHOT_URL;
+    string symbolList  = DEFAULT_SYMBOL;
+    bool   maxSpeed  = false;
+    size_t ringBytes = DEFAULT_RING_BYTES;
+    int    window    = DEFAULT_LADDER_WINDOW;
+    int    numWorkers = 1;
+    vector<int> workerCores;
+    bool   csvFullSet = false;
+
+    TelemetryOptions csvOpts;
+    csvOpts.path   = "pulse_data.csv";
+    UdpOptions udpOpts;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--record" && hasValue)       recordPath = argv[++i];
+        else if (arg == "--replay" && hasValue)       replayPath = argv[++i];
+        else if (arg == "--max-speed")                maxSpeed = true;
+        else if (arg == "--no-sync")                  syncEnabled = false;
+        else if (arg == "--snapshot-url" && hasValue) snapshotUrl = argv[++i];
+        else if (arg == "--symbols" && hasValue)      symbolList = argv[++i];
+        else if (arg == "--workers" && hasValue)      numWorkers = max(1, atoi(argv[++i]));
+        else if (arg == "--ring-mb" && hasValue)      ringBytes = (size_t)max(1, atoi(argv[++i])) << 20;
+        else if (arg == "--spin-us" && hasValue)      workerSpinUs = max(-1, atoi(argv[++i]));
+        else if (arg == "--ui-fps" && hasValue)       uiFps = max(1, atoi(argv[++i]));
+        else if (arg == "--headless")                 headless = true;
+        else if (arg == "--status-every" && hasValue) statusEverySeconds = max(0, atoi(argv[++i]));
+        else if (arg == "--pin-reader" && hasValue)   pinReader = atoi(argv[++i]);
+        else if (arg == "--pin-ui" && hasValue)       pinUi = atoi(argv[++i]);
+        else if (arg == "--pin-csv" && hasValue)      pinCsv = atoi(argv[++i]);
+        else if (arg == "--latency-log" && hasValue)  latencyLogPath = argv[++i];
+        else if (arg == "--latency-every" && hasValue) latencyLogSeconds = max(1, atoi(argv[++i]));
+        else if (arg == "--pin-workers" && hasValue) {
+            for (auto& c : splitList(argv[++i])) workerCores.push_back(atoi(c.c_str()));
+        }
+        else if (arg == "--csv" && hasValue)          csvOpts.path = argv[++i];
+        else if (arg == "--store" && hasValue)        storePath = argv[++i];
+        else if (arg == "--csv-ring" && hasValue)     csvOpts.ringRecords = (size_t)max(2, atoi(argv[++i]));
+        else if (arg == "--csv-flush-ms" && hasValue) csvOpts.flushIntervalMs = max(0, atoi(argv[++i]));
+        else if (arg == "--csv-rotate-mb" && hasValue)  csvOpts.rotateBytes = (uint64_t)max(0, atoi(argv[++i])) << 20;
+        else if (arg == "--csv-rotate-min" && hasValue) csvOpts.rotateSeconds = max(0, atoi(argv[++i])) * 60;
+        else if (arg == "--csv-full" && hasValue) {
+            string v = argv[++i];
+            if      (v == "drop")  csvOpts.whenFull = FullPolicy::Drop;
+            else if (v == "block") csvOpts.whenFull = FullPolicy::Block;
+            else { printUsage(argv[0]); return 1; }
+            csvFullSet = true;
+        }
+        else if (arg == "--csv-fsync" && hasValue) {
+            string v = argv[++i];
+            if      (v == "never") csvOpts.fsync = FsyncPolicy::Never;
+            else if (v == "flush") csvOpts.fsync = FsyncPolicy::EveryFlush;
+            else if (atoi(v.c_str()) > 0) {
+                csvOpts.fsync = FsyncPolicy::Interval;
+                csvOpts.fsyncIntervalMs = atoi(v.c_str());
+            }
+            else { printUsage(argv[0]); return 1; }
+        }
+        else if (arg == "--bands" && hasValue) {
+            auto bands = splitList(argv[++i]);
+            if (bands.empty() || bands.size() > (size_t)MAX_BANDS) { printUsage(argv[0]); return 1; }
+            numImbalanceBands = (int)bands.size();
+            for (int b = 0; b < numImbalanceBands; b++) {
+                imbalanceBandsBps[b] = atoi(bands[b].c_str());
+                if (imbalanceBandsBps[b] <= 0) { printUsage(argv[0]); return 1; }
+            }
+        }
+        else if (arg == "--event-log" && hasValue)    eventLogPath = argv[++i];
+        else if (arg == "--shm" && hasValue)          shmName = argv[++i];
+        else if (arg == "--udp" && hasValue)          udpOpts.destination = argv[++i];
+        else if (arg == "--udp-ms" && hasValue)       udpOpts.intervalMs = max(1, atoi(argv[++i]));
+        else if (arg == "--udp-full-ms" && hasValue)  udpOpts.fullEveryMs = max(1, atoi(argv[++i]));
+        else if (arg == "--checkpoint" && hasValue)   checkpointPath = argv[++i];
+        else if (arg == "--checkpoint-ms" && hasValue) checkpointIntervalMs = max(1, atoi(argv[++i]));
+        else if (arg == "--checkpoint-max-age" && hasValue) checkpointMaxAgeSeconds = max(0, atoi(argv[++i]));
+        else if (arg == "--busy-poll" && hasValue)    readerOpts.busyPollUs = max(0, atoi(argv[++i]));
+        else if (arg == "--sock-rcvbuf-kb" && hasValue) readerOpts.rcvBufBytes = max(0, atoi(argv[++i])) * 1024;
+        else if (arg == "--sock-sndbuf-kb" && hasValue) readerOpts.sndBufBytes = max(0, atoi(argv[++i])) * 1024;
+        else if (arg == "--no-nodelay")               readerOpts.tcpNoDelay = false;
+        else if (arg == "--no-verify-tls")            readerOpts.verifyPeer = false;
+        else if (arg == "--legs" && hasValue)         feedLegs = max(1, atoi(argv[++i]));
+        else if (arg == "--feed-hosts" && hasValue)   feedHosts = splitList(argv[++i]);
+        else if (arg == "--backoff" && hasValue) {
+            auto v = splitList(argv[++i]);
+            if (v.size() != 2 || atoi(v[0].c_str()) <= 0 || atoi(v[1].c_str()) < atoi(v[0].c_str())) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            readerOpts.backoffMinMs = atoi(v[0].c_str());
+            readerOpts.backoffMaxMs = atoi(v[1].c_str());
+        }
+        else if (arg == "--event-types" && hasValue) {
+            eventLogMask = parseEventTypes(splitList(argv[++i]));
+            if (!eventLogMask) { printUsage(argv[0]); return 1; }
+        }
+        else if (arg == "--cost-bps" && hasValue) {
+            costToMoveBps = atoi(argv[++i]);
+            if (costToMoveBps <= 0) { printUsage(argv[0]); return 1; }
+        }
+        else if (arg == "--window" && hasValue) {
+            window = atoi(argv[++i]);
+            if (window < 64) { printUsage(argv[0]); return 1; }
+        }
+        else { printUsage(argv[0]); return 1; }
+    }
 
-                string msg = beast::buffers_to_string(buffer.data());
-                auto j = json::parse(msg);
+    // instruments are fixed from here on; workers, the writer and the UI
+    // index into them without locking
+    try {
+        for (auto& text : splitList(symbolList)) {
+            if (instruments.size() == ALL_INSTRUMENTS) throw runtime_error("too many symbols");
+            InstrumentSpec spec = parseInstrumentSpec(text);
+            uint16_t id = (uint16_t)instruments.size();
+            symbolTable.add(spec.symbol, id);
+            instruments.emplace_back(new Instrument(spec, id, window));
+            instruments.back()->snapshotUrl = snapshotUrlFor(snapshotUrl, spec.symbol);
+        }
+        if (instruments.empty()) throw runtime_error("no symbols given");
+    } catch (exception const& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
 
-                int numUpdates = j["b"].size() + j["a"].size();
+    numWorkers = min(numWorkers, (int)instruments.size());
+    for (int i = 0; i < numWorkers; i++) {
+        workers.emplace_back(new Worker);
+        Worker& w = *workers.back();
+        w.index = i;
+        w.core  = i < (int)workerCores.size() ? workerCores[i] : -1;
+        w.ring.reset(new FrameRing(ringBytes));
+        w.events = &eventBus.addProducer(EVENT_RING_EVENTS);
+    }
+    for (auto& in : instruments) {
+        in->worker = in->id % numWorkers;
+        in->events = workers[in->worker]->events;
+        workers[in->worker]->books.push_back(in.get());
+    }
 
-                uint64_t start = rdtsc();
+    cycleClock = CycleClock::calibrate();
+    workerSpinCycles = (uint64_t)(cycleClock.hz * max(0, workerSpinUs) / 1e6);
+    if (!cycleClock.invariant)
+        cerr << "warning: TSC is not invariant; stage latencies across threads are unreliable" << endl;
+
+    ofstream latencyLog;
+    if (!latencyLogPath.empty()) {
+        latencyLog.open(latencyLogPath);
+        if (!latencyLog) {
+            cerr << "cannot open " << latencyLogPath << endl;
+            return 1;
+        }
+        latencyLog << LATENCY_LOG_HEADER;
+    }
 
-                for (auto& level : j["b"]) {
-                    double price = stod(level[0].get<string>());
-                    double qty   = stod(level[1].get<string>());
-                    updateLevel(true, price, qty);
-                }
+    // subscribed before the workers start, so the log sees every event
+    ofstream eventLog;
+    BookEventBus::Subscriber eventLogSub = eventBus.subscribe(eventLogMask);
+    if (!eventLogPath.empty()) {
+        eventLog.open(eventLogPath);
+        if (!eventLog) {
+            cerr << "cannot open " << eventLogPath << endl;
+            return 1;
+        }
+        eventLog << EVENT_LOG_HEADER;
+    }
 
-                for (auto& level : j["a"]) {
-                    double price = stod(level[0].get<string>());
-                    double qty   = stod(level[1].get<string>());
-                    updateLevel(false, price, qty);
-                }
+    if (!shmName.empty()) {
+        try {
+            shmWriter.reset(new ShmBookWriter(shmName, (int)instruments.size()));
+        } catch (exception const& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        // readers can look symbols up before the first update arrives
+        for (auto& in : instruments) {
+            ShmBook b = {};
+            snprintf(b.symbol, SHM_SYMBOL_CHARS, "%s", in->spec.symbol.c_str());
+            b.priceDecimals = in->spec.priceDecimals;
+            b.qtyDecimals   = in->spec.qtyDecimals;
+            shmWriter->publish(in->id, b);
+        }
+        shmWriter->setLive();
+    }
+
+    if (!udpOpts.destination.empty()) {
+        try {
+            udpPublisher.reset(new UdpPublisher(udpOpts, (int)instruments.size()));
+        } catch (exception const& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+    }
+
+    if (!checkpointPath.empty()) {
+        try {
+            checkpoints.reset(new CheckpointFile(checkpointPath, (int)instruments.size(),
+                                                 sizeof(BookCheckpoint), CHECKPOINT_LAYOUT));
+        } catch (exception const& e) {
+            cerr << e.what() << endl;
+            return 1;
+        }
+        checkpointIntervalCycles = (uint64_t)(cycleClock.hz * checkpointIntervalMs / 1000.0);
+        checkpointWriter.reset(new CheckpointWriter(*checkpoints, numWorkers, sizeof(BookCheckpoint)));
+        if (!checkpoints->compatible())
+            cerr << "Checkpoint file " << checkpointPath << " is new or from another build; starting cold"
+                 << endl;
+    }
+
+    pipelineStartNs = wallClockNs();
+
+    // a replay should reproduce every row; live, the engine must never wait on the disk
+    if (!csvFullSet && !replayPath.empty()) csvOpts.whenFull = FullPolicy::Block;
+    csvOpts.pinCore = pinCsv;
+    csvOpts.header  = csvHeader();
+    try {
+        if (!storePath.empty()) {
+            storeTap.reset(new StoreTap(storePath));
+            if (storeTap->store().droppedTailBytes())
+                cerr << "Store " << storePath << ": dropped a torn last block ("
+                     << storeTap->store().droppedTailBytes() << " bytes)" << endl;
+        }
+        csvWriter.reset(new TelemetryWriter<TelemetryRow>(csvOpts, formatCsvRow, CSV_MAX_LINE,
+                                                          numWorkers, storeTap.get()));
+    } catch (exception const& e) {
+        cerr << e.what() << endl;
+        return 1;
+    }
 
-                uint64_t end = rdtsc();
-                double latencyNs = ticksToNanos(end - start, freq);
+    if (!replayPath.empty()) {
+        unique_ptr<JournalReader> reader;
+        try {
+            reader.reset(new JournalReader(replayPath));
+        } catch (exception const& e) {
+            cerr << "Replay failed: " << e.what() << endl;
+            return 1;
+        }
 
-                updateToxicityWindow();
-                renderOrderBook(latencyNs, numUpdates);
+        // journals recorded with --no-sync carry no snapshots to sync from
+        bool hasSnapshots = false;
+        JournalFrame frame;
+        while (!hasSnapshots && reader->next(frame)) hasSnapshots = frame.type == JOURNAL_SNAPSHOT;
+        reader->rewind();
+        if (!hasSnapshots) syncEnabled = false;
+
+        if (checkpoints) restoreCheckpoints();
+        auto wallStart = chrono::steady_clock::now();
+        startWorkers();
+        thread ui(headless ? headlessLoop : uiLoop);
+        thread latencyLogger, eventLogger;
+        if (latencyLog.is_open()) latencyLogger = thread(latencyLogLoop, ref(latencyLog));
+        if (eventLog.is_open()) eventLogger = thread(eventLogLoop, ref(eventLog), ref(eventLogSub));
+
+        ReplayTotals totals;
+        replayReader(*reader, maxSpeed, totals);
+        joinWorkers();
+        if (checkpointWriter) checkpointWriter->stop();
+        double elapsed = chrono::duration<double>(chrono::steady_clock::now() - wallStart).count();
+        ui.join();
+        if (latencyLogger.joinable()) latencyLogger.join();
+        if (eventLogger.joinable()) eventLogger.join();
+        csvWriter->close();
+        if (udpPublisher) udpPublisher->close();
+
+        cerr << "Replayed " << totals.frames << " frames (" << totals.bytes << " bytes) in "
+             << fixed << setprecision(3) << elapsed << " s";
+        if (elapsed > 0)
+            cerr << "  ->  " << setprecision(0) << totals.frames / elapsed << " msgs/sec";
+        cerr << "\n";
+        for (auto& w : workers)
+            cerr << "Worker " << w->index << ": " << w->books.size() << " books, max queue "
+                 << w->ring->maxDepthBytes() / 1024 << " KB, ring full stalls "
+                 << w->ring->fullStalls() << "\n";
+        for (auto& in : instruments) {
+            cerr << "  " << left << setw(12) << in->spec.symbol << right << setw(9) << in->updateCount
+                 << " updates";
+            if (in->updateCount)
+                cerr << "   latency avg " << setprecision(0) << in->latencySumNs / in->updateCount
+                     << " ns  max " << in->latencyMaxNs << " ns";
+            cerr << "\n";
+        }
+        if (unroutedFrames.load()) cerr << "Unrouted frames: " << unroutedFrames.load() << "\n";
+        cerr << startupSummary() << "\n";
+        if (checkpoints) {
+            uint64_t saved = 0, sumNs = 0, maxNs = 0;
+            for (auto& w : workers) {
+                saved += w->stats.checkpoints.load();
+                sumNs += w->stats.checkpointSumNs.load();
+                maxNs  = max(maxNs, w->stats.checkpointMaxNs.load());
             }
+            uint64_t written = checkpointWriter->written();
+            cerr << "Checkpoints: " << saved << " copied by the workers, avg " << setprecision(1)
+                 << (saved ? sumNs / 1e3 / saved : 0.0) << " us, max " << maxNs / 1e3 << " us; "
+                 << written << " written, avg "
+                 << (written ? checkpointWriter->writeSumNs() / 1e3 / written : 0.0) << " us, max "
+                 << checkpointWriter->writeMaxNs() / 1e3 << " us; " << checkpointWriter->busy()
+                 << " deferred with both buffers queued\n";
         }
-        catch (exception const& e) {
-            endwin();
-            resetState();
-            cerr << "Disconnected: " << e.what() << endl;
-            cerr << "Reconnecting in 2 seconds..." << endl;
-            this_thread::sleep_for(chrono::seconds(2));
-            initNcurses();
+        printStageLatency();
+        printCsvSummary();
+        if (udpPublisher) printUdpSummary();
+        if (eventLog.is_open())
+            cerr << "Events: " << eventLogSub.delivered << " logged, " << eventLogSub.lost
+                 << " overwritten before they were read" << endl;
+        return 0;
+    }
+
+    unique_ptr<JournalWriter> journal;
+    if (!recordPath.empty()) {
+        try {
+            journal.reset(new JournalWriter(recordPath));
+        } catch (exception const& e) {
+            cerr << e.what() << endl;
+            return 1;
         }
+        recordJournal = journal.get();
     }
 
-    endwin();
-    csvFile.close();
+    string target = "/stream?streams=";
+    for (auto& in : instruments) {
+        string name;
+        for (char c : in->spec.symbol) name += (char)tolower((unsigned char)c);
+        target += (in->id ? "/" : "") + name + "@depth";
+    }
+
+    feedArbiter.reset(new FeedArbiter(feedLegs, (int)instruments.size(), cycleClock));
+    if (checkpoints) restoreCheckpoints();
+    if (syncEnabled) {
+        vector<string> urls;
+        for (auto& in : instruments) urls.push_back(in->snapshotUrl);
+        JournalWriter* j = journal.get();
+        snapshotFetcher.reset(new SnapshotFetcher(urls, min<int>(SNAPSHOT_THREADS, (int)urls.size()),
+            [j](int index, string&& body) { deliverSnapshot(j, index, std::move(body)); },
+            [](int index, const string& why) {
+                setReaderStatus(instruments[index]->spec.symbol + " snapshot failed: " + why +
+                                " -- retrying");
+            },
+            SNAPSHOT_TIMEOUT_MS, readerOpts.verifyPeer));
+    }
+    startWorkers();
+    thread ui(headless ? headlessLoop : uiLoop);
+    thread latencyLogger, eventLogger;
+    if (latencyLog.is_open()) latencyLogger = thread(latencyLogLoop, ref(latencyLog));
+    if (eventLog.is_open()) eventLogger = thread(eventLogLoop, ref(eventLog), ref(eventLogSub));
+    liveReader(journal.get(), target);
+
+    // not reached: the live reader reconnects forever
+    joinWorkers();
+    ui.join();
+    if (latencyLogger.joinable()) latencyLogger.join();
+    if (eventLogger.joinable()) eventLogger.join();
+    csvWriter->close();
     return 0;
-}
\ No newline at end of file
+}
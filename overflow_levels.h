@@ -0,0 +1,209 @@
+#pragma once
+
+// The levels a PriceLadder keeps outside its flat window: an ordered map of
+// tick -> lots, plus per-bucket totals in a FenwickTree so depth and sweep
+// queries over the far book stay O(log) instead of walking every level.
+// The map's nodes are pooled (node_pool.h), so levels moving in and out
+// allocate nothing once the map has seen its working size.
+//
+// The buckets cover only the span the levels occupy, from an origin near
+// the first one, and grow toward new levels on demand. They start 128
+// ticks wide; a span that would need more than MAX_BUCKETS doubles
+// the width instead, so a nonsense price far from the book costs coarser
+// buckets, never more memory (at most 128 KB per side). Only the one or two
+// buckets a query starts or ends inside are walked level by level, and the
+// first and last buckets stretch to either end of the price range, so the
+// answers stay exact whatever the width.
+
+#include <cstdint>
+#include <map>
+#include <vector>
+#include <algorithm>
+#include "fixed_point.h"
+#include "fenwick_tree.h"
+#include "node_pool.h"
+
+class OverflowLevels {
+public:
+    static const int       BUCKET_BITS = 7;                // 128 ticks to start with
+    static const int       MAX_BUCKETS = 1 << 14;
+    static constexpr Ticks MAX_TICK    = INT64_MAX >> 2;   // higher ticks share its bucket
+    static const Ticks     NONE        = -1;
+
+    typedef std::map<Ticks, Lots, std::less<Ticks>, PoolAllocator<std::pair<const Ticks, Lots>>> LevelMap;
+
+    OverflowLevels() : buckets_(0) {}
+
+    Ticks bucketTicks() const { return (Ticks)1 << shift_; }
+    int   buckets()     const { return buckets_.slots(); }
+
+    size_t size() const { return levels_.size(); }
+    const LevelMap& levels() const { return levels_; }
+
+    Lots get(Ticks t) const {
+        auto it = levels_.find(t);
+        return it == levels_.end() ? 0 : it->second;
+    }
+
+    // qty 0 removes the level; returns the previous quantity
+    Lots set(Ticks t, Lots qty) {
+        auto it = levels_.find(t);
+        Lots prev = it == levels_.end() ? 0 : it->second;
+        if (qty == 0) {
+            if (it != levels_.end()) levels_.erase(it);
+        } else if (it != levels_.end()) {
+            it->second = qty;
+        } else {
+            levels_.emplace(t, qty);
+        }
+        addToBucket(t, (int64_t)qty - (int64_t)prev);
+        return prev;
+    }
+
+    // Removes every level in [lo, hi), handing each to f(tick, lots).
+    template <typename F>
+    void extract(Ticks lo, Ticks hi, F&& f) {
+        auto first = levels_.lower_bound(lo);
+        auto last  = levels_.lower_bound(hi);
+        for (auto it = first; it != last; ++it) {
+            f(it->first, it->second);
+            addToBucket(it->first, -(int64_t)it->second);
+        }
+        levels_.erase(first, last);
+    }
+
+    void clear() {
+        levels_.clear();
+        buckets_.clearAll();
+    }
+
+    // Total lots on [lo, hi].
+    int64_t depthBetween(Ticks lo, Ticks hi) const {
+        lo = std::max<Ticks>(lo, 0);
+        if (lo > hi || levels_.empty()) return 0;
+        int bl = bucketOf(lo), bh = bucketOf(hi);
+        if (bl == bh) return walk(lo, hi);
+        return walk(lo, bucketEnd(bl)) + buckets_.range(bl + 1, bh - 1) + walk(bucketStart(bh), hi);
+    }
+
+    // Lowest tick p in [lo, hi] where [lo, p] reaches need; otherwise
+    // subtracts everything in [lo, hi] from need and returns NONE.
+    Ticks sweepUp(Ticks lo, Ticks hi, int64_t& need) const {
+        lo = std::max<Ticks>(lo, 0);
+        if (lo > hi || levels_.empty()) return NONE;
+        int bl = bucketOf(lo), bh = bucketOf(hi);
+        if (bl == bh) return walkUp(lo, hi, need);
+
+        Ticks p = walkUp(lo, bucketEnd(bl), need);
+        if (p != NONE) return p;
+        int b = buckets_.lowerBound(buckets_.prefix(bl) + need);
+        if (b < bh && b < buckets_.slots()) {
+            need -= buckets_.range(bl + 1, b - 1);
+            return walkUp(bucketStart(b), bucketEnd(b), need);
+        }
+        need -= buckets_.range(bl + 1, bh - 1);
+        return walkUp(bucketStart(bh), hi, need);
+    }
+
+    // Highest tick p in [lo, hi] where [p, hi] reaches need; otherwise
+    // subtracts everything in [lo, hi] from need and returns NONE.
+    Ticks sweepDown(Ticks lo, Ticks hi, int64_t& need) const {
+        lo = std::max<Ticks>(lo, 0);
+        if (lo > hi || levels_.empty()) return NONE;
+        int bl = bucketOf(lo), bh = bucketOf(hi);
+        if (bl == bh) return walkDown(lo, hi, need);
+
+        Ticks p = walkDown(bucketStart(bh), hi, need);
+        if (p != NONE) return p;
+        int64_t below = buckets_.prefix(bh - 1);
+        int b = below >= need ? buckets_.upperBound(below - need) : -1;
+        if (b > bl) {
+            need -= buckets_.range(b + 1, bh - 1);
+            return walkDown(bucketStart(b), bucketEnd(b), need);
+        }
+        need -= buckets_.range(bl + 1, bh - 1);
+        return walkDown(lo, bucketEnd(bl), need);
+    }
+
+private:
+    int lastBucket() const { return buckets_.slots() - 1; }
+
+    // queries clamp to the span: no level lies outside it
+    int bucketOf(Ticks t) const {
+        if (t < origin_) return 0;
+        return (int)std::min<Ticks>((t - origin_) >> shift_, lastBucket());
+    }
+    Ticks bucketStart(int b) const { return b == 0 ? 0 : origin_ + ((Ticks)b << shift_); }
+    Ticks bucketEnd(int b) const {
+        return b == lastBucket() ? INT64_MAX : origin_ + ((Ticks)(b + 1) << shift_) - 1;
+    }
+
+    void addToBucket(Ticks t, int64_t delta) {
+        if (delta == 0) return;
+        t = std::min(t, MAX_TICK);
+        if (buckets_.slots() == 0 || t < origin_ || ((t - origin_) >> shift_) > lastBucket()) cover(t);
+        buckets_.add((int)((t - origin_) >> shift_), delta);
+    }
+
+    // Grows the span to take in t, at least doubling it so growth is
+    // amortised O(1) per bucket, and widens the buckets once their count
+    // would pass MAX_BUCKETS. With t the only level the span just moves.
+    void cover(Ticks t) {
+        if (buckets_.slots() == 0 || levels_.size() == 1) {
+            int n = std::max(buckets_.slots(), 64);
+            shift_ = BUCKET_BITS;
+            origin_ = std::min(std::max<Ticks>(t - ((Ticks)n << shift_) / 2, 0) >> shift_,
+                               (MAX_TICK >> shift_) - n + 1) << shift_;
+            if (n != buckets_.slots()) buckets_ = FenwickTree(n);
+            else buckets_.clearAll();
+            return;
+        }
+        Ticks lo = origin_, hi = std::min(origin_ + ((Ticks)buckets_.slots() << shift_) - 1, MAX_TICK);
+        Ticks span = hi - lo + 1;
+        if (t < lo) lo = std::max<Ticks>(std::min(t, hi - span - span + 1), 0);
+        else        hi = std::min(std::max(t, hi + span), MAX_TICK);
+
+        int shift = shift_;
+        while (((hi - lo) >> shift) + 2 > MAX_BUCKETS) shift++;
+        Ticks origin = (lo >> shift) << shift;
+        int n = (int)((hi - origin) >> shift) + 1;
+
+        // every old bucket falls inside one new bucket: both origins are
+        // aligned to their widths and the old width divides the new
+        std::vector<int64_t> sums(n, 0);
+        for (int b = 0; b < buckets_.slots(); b++)
+            sums[(origin_ + ((Ticks)b << shift_) - origin) >> shift] += buckets_.range(b, b);
+        buckets_ = FenwickTree(n);
+        buckets_.build(sums);
+        origin_ = origin;
+        shift_ = shift;
+    }
+
+    int64_t walk(Ticks lo, Ticks hi) const {
+        int64_t sum = 0;
+        for (auto it = levels_.lower_bound(lo); it != levels_.end() && it->first <= hi; ++it)
+            sum += it->second;
+        return sum;
+    }
+
+    Ticks walkUp(Ticks lo, Ticks hi, int64_t& need) const {
+        for (auto it = levels_.lower_bound(lo); it != levels_.end() && it->first <= hi; ++it)
+            if ((need -= it->second) <= 0) return it->first;
+        return NONE;
+    }
+
+    Ticks walkDown(Ticks lo, Ticks hi, int64_t& need) const {
+        auto it = levels_.upper_bound(hi);
+        while (it != levels_.begin()) {
+            --it;
+            if (it->first < lo) break;
+            if ((need -= it->second) <= 0) return it->first;
+        }
+        return NONE;
+    }
+
+    LevelMap    levels_;
+    FenwickTree buckets_;
+    Ticks       origin_ = 0;   // tick of bucket 0, a multiple of its width
+    int         shift_  = BUCKET_BITS;
+};
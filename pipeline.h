@@ -0,0 +1,283 @@
+#pragma once
+
+// Building blocks for the staged pipeline:
+//
+//   reader thread --FrameRing--> engine worker(s) --TripleBuffer--> UI
+//                                                  \--TelemetryWriter--> CSV
+//
+// Each worker owns a set of instruments and has a ring of its own; the
+// reader routes every frame to the worker that owns its symbol.
+//
+// FrameRing is a single-producer single-consumer byte ring carrying raw
+// frames. The consumer parses each frame in place and only then releases
+// it, so a frame is copied exactly once, from the socket buffer into the
+// ring. An idle consumer can park on the ring instead of polling it; the
+// producer wakes it on the next push. TripleBuffer hands the latest value from one writer to one reader
+// without either side ever blocking; intermediate values are conflated.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <thread>
+#include <stdexcept>
+#include <string>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+const size_t CACHE_LINE = 64;
+
+// Record types carried through the ring. Frame and snapshot match the
+// journal record types so replay can forward records unchanged.
+const uint16_t RING_FRAME    = 0;
+const uint16_t RING_SNAPSHOT = 1;
+const uint16_t RING_RESET    = 2;   // connection lost; engine wipes the book
+const uint16_t RING_END      = 3;   // end of replay
+const uint16_t RING_WRAP     = 0xffff;
+
+const uint16_t ALL_INSTRUMENTS = 0xffff;   // RESET / END go to every book
+
+struct RingRecordHeader {
+    uint64_t recvCycles;  // cycleNow() when the reader received the record
+    uint32_t length;
+    uint16_t type;
+    uint16_t instrument;
+};
+
+static_assert(sizeof(RingRecordHeader) == 16, "ring header must stay 16 bytes");
+
+struct RingRecord {
+    uint64_t    recvCycles;
+    uint16_t    type;
+    uint16_t    instrument;
+    const char* data;
+    uint32_t    length;
+};
+
+class FrameRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit FrameRing(size_t capacity) {
+        size_t cap = 1024;
+        while (cap < capacity) cap <<= 1;
+        buf_.assign(cap, 0);
+        mask_ = cap - 1;
+    }
+
+    size_t capacity() const { return buf_.size(); }
+
+    // ---- producer side ----
+
+    bool tryPush(uint64_t recvCycles, uint16_t type, uint16_t instrument,
+                 const char* data, uint32_t len) {
+        size_t need = sizeof(RingRecordHeader) + pad(len);
+        if (need > buf_.size() / 2) throw std::runtime_error("frame larger than ring");
+
+        uint64_t head = head_.load(std::memory_order_relaxed);
+        size_t   pos  = head & mask_;
+        size_t   toEnd = buf_.size() - pos;
+        size_t   total = toEnd < need ? toEnd + need : need;
+
+        if (buf_.size() - (head - cachedTail_) < total) {
+            cachedTail_ = tail_.load(std::memory_order_acquire);
+            if (buf_.size() - (head - cachedTail_) < total) return false;
+        }
+
+        if (toEnd < need) {
+            RingRecordHeader wrap{0, 0, RING_WRAP, 0};
+            memcpy(&buf_[pos], &wrap, sizeof(wrap));
+            head += toEnd;
+            pos = 0;
+        }
+        RingRecordHeader h{recvCycles, len, type, instrument};
+        memcpy(&buf_[pos], &h, sizeof(h));
+        if (len) memcpy(&buf_[pos + sizeof(h)], data, len);
+        head += need;
+
+        head_.store(head, std::memory_order_release);
+        pushed_.fetch_add(1, std::memory_order_relaxed);
+
+        // pairs with the fence in park(): either the consumer sees the new
+        // head or this sees it parked
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (parked_.load(std::memory_order_relaxed)) {
+            std::lock_guard<std::mutex> lock(parkMutex_);
+            parkCv_.notify_one();
+        }
+
+        uint64_t depth = head - cachedTail_;
+        if (depth > maxDepthBytes_.load(std::memory_order_relaxed))
+            maxDepthBytes_.store(depth, std::memory_order_relaxed);
+        return true;
+    }
+
+    // backpressure rather than loss: a dropped diff would corrupt the book
+    void push(uint64_t recvCycles, uint16_t type, uint16_t instrument,
+              const char* data, uint32_t len) {
+        if (tryPush(recvCycles, type, instrument, data, len)) return;
+        fullStalls_.fetch_add(1, std::memory_order_relaxed);
+        while (!tryPush(recvCycles, type, instrument, data, len)) std::this_thread::yield();
+    }
+
+    // ---- consumer side ----
+
+    // The record stays valid until pop().
+    bool peek(RingRecord& out) {
+        uint64_t tail = tail_.load(std::memory_order_relaxed);
+        while (true) {
+            if (tail == cachedHead_) {
+                cachedHead_ = head_.load(std::memory_order_acquire);
+                if (tail == cachedHead_) return false;
+            }
+            size_t pos = tail & mask_;
+            RingRecordHeader h;
+            memcpy(&h, &buf_[pos], sizeof(h));
+            if (h.type == RING_WRAP) {
+                tail += buf_.size() - pos;
+                tail_.store(tail, std::memory_order_release);
+                continue;
+            }
+            out.recvCycles = h.recvCycles;
+            out.type      = h.type;
+            out.instrument = h.instrument;
+            out.length    = h.length;
+            out.data      = &buf_[pos + sizeof(h)];
+            peekSize_     = sizeof(h) + pad(h.length);
+            return true;
+        }
+    }
+
+    void pop() {
+        tail_.store(tail_.load(std::memory_order_relaxed) + peekSize_,
+                    std::memory_order_release);
+        popped_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Sleeps until the producer pushes or timeoutMs passes, unless a
+    // record is already there. For a consumer that has polled an empty
+    // ring long enough; the timeout only bounds the damage of a bug.
+    void park(int timeoutMs) {
+        std::unique_lock<std::mutex> lock(parkMutex_);
+        parked_.store(true, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (head_.load(std::memory_order_relaxed) == tail_.load(std::memory_order_relaxed))
+            parkCv_.wait_for(lock, std::chrono::milliseconds(timeoutMs));
+        parked_.store(false, std::memory_order_relaxed);
+        parks_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // ---- stats, readable from any thread ----
+
+    uint64_t depthBytes() const {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+    uint64_t depthFrames() const {
+        return pushed_.load(std::memory_order_relaxed) - popped_.load(std::memory_order_relaxed);
+    }
+    uint64_t maxDepthBytes() const { return maxDepthBytes_.load(std::memory_order_relaxed); }
+    uint64_t fullStalls()    const { return fullStalls_.load(std::memory_order_relaxed); }
+    uint64_t pushed()        const { return pushed_.load(std::memory_order_relaxed); }
+    uint64_t parks()         const { return parks_.load(std::memory_order_relaxed); }
+
+private:
+    static size_t pad(size_t n) { return (n + 15) & ~size_t(15); }
+
+    std::vector<char> buf_;
+    size_t mask_;
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> head_{0};
+    uint64_t cachedTail_ = 0;                   // producer's view of tail
+    std::atomic<uint64_t> pushed_{0};
+    std::atomic<uint64_t> fullStalls_{0};
+    std::atomic<uint64_t> maxDepthBytes_{0};
+
+    alignas(CACHE_LINE) std::atomic<uint64_t> tail_{0};
+    uint64_t cachedHead_ = 0;                   // consumer's view of head
+    size_t   peekSize_   = 0;
+    std::atomic<uint64_t> popped_{0};
+    std::atomic<uint64_t> parks_{0};
+
+    alignas(CACHE_LINE) std::atomic<bool> parked_{false};
+    std::mutex              parkMutex_;
+    std::condition_variable parkCv_;
+};
+
+// Single-writer single-reader latest-value slot. The writer fills back()
+// and publish()es it; the reader calls update() and, if it returns true,
+// reads a consistent front().
+template <typename T>
+class TripleBuffer {
+public:
+    T& back() { return bufs_[back_]; }
+
+    void publish() {
+        int old = middle_.exchange(back_ | DIRTY, std::memory_order_acq_rel);
+        back_ = old & INDEX;
+    }
+
+    bool update() {
+        if (!(middle_.load(std::memory_order_relaxed) & DIRTY)) return false;
+        int old = middle_.exchange(front_, std::memory_order_acq_rel);
+        front_ = old & INDEX;
+        return true;
+    }
+
+    const T& front() const { return bufs_[front_]; }
+
+private:
+    static const int INDEX = 3;
+    static const int DIRTY = 4;
+
+    T bufs_[3] = {};
+    int back_  = 0;
+    int front_ = 2;
+    alignas(CACHE_LINE) std::atomic<int> middle_{1};
+};
+
+// Spin-wait hint for polling loops.
+inline void cpuRelax() {
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__)
+    asm volatile("yield");
+#else
+    std::this_thread::yield();
+#endif
+}
+
+// Pins the calling thread to one core. Returns false where affinity is
+// not supported (macOS) or the core does not exist.
+inline bool pinCurrentThread(int core) {
+    if (core < 0) return true;
+#ifdef __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+// Counters for one engine worker, written only by that worker.
+struct EngineStats {
+    std::atomic<uint64_t> framesProcessed{0};
+    std::atomic<uint64_t> queueDelaySumNs{0};   // receive -> engine dequeue
+    std::atomic<uint64_t> queueDelayMaxNs{0};
+    std::atomic<uint64_t> engineBusyNs{0};      // time spent processing records
+    std::atomic<uint64_t> engineEmptyPolls{0};  // ring empty, nothing to do
+    std::atomic<uint64_t> checkpoints{0};       // books written to the checkpoint file
+    std::atomic<uint64_t> checkpointSumNs{0};
+    std::atomic<uint64_t> checkpointMaxNs{0};
+
+    void recordQueueDelay(uint64_t ns) {
+        queueDelaySumNs.fetch_add(ns, std::memory_order_relaxed);
+        if (ns > queueDelayMaxNs.load(std::memory_order_relaxed))
+            queueDelayMaxNs.store(ns, std::memory_order_relaxed);
+    }
+};
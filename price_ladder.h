@@ -0,0 +1,317 @@
+#pragma once
+
+// One side of the book as a window of ticks around the current mid.
+//
+// The window is a flat array of lot counts indexed by (tick - base). Levels
+// outside it live in a small ordered overflow map, so nothing the exchange
+// sends is ever dropped and there is no fixed price band. When the mid
+// drifts away from the window centre the window re-centres in O(window),
+// pushing levels that fall out into the overflow map and pulling back the
+// ones that come into range. Reset only clears cells that are occupied.
+//
+// An OccupancyBitmap mirrors which cells are non-empty, so best-level
+// recovery and top-N walks jump straight between occupied ticks instead of
+// scanning the zeros left behind when the top of book is swept.
+//
+// A FenwickTree over blocks of DEPTH_BLOCK cells keeps running quantity
+// totals, so the size resting between two prices and the price a sweep of
+// Q would reach cost O(log window) plus a scan inside at most two blocks,
+// instead of a walk over the cells. Indexing blocks rather than cells keeps
+// the tree in L1 (8 KB for the default window). Updates to the same block
+// in a row, as a sweep or refill sends them, are summed and go into the
+// tree as one add, on the next update elsewhere or the next depth query.
+// OverflowLevels keeps the same totals
+// per bucket for the levels outside the window, so bands wider than the
+// window stay logarithmic too.
+
+#include <cstdint>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <algorithm>
+#include "fixed_point.h"
+#include "occupancy_bitmap.h"
+#include "fenwick_tree.h"
+#include "overflow_levels.h"
+
+const Ticks NO_PRICE = -1;
+const int   DEPTH_BLOCK_BITS = 6;
+const int   DEPTH_BLOCK      = 1 << DEPTH_BLOCK_BITS;
+
+class PriceLadder {
+public:
+    explicit PriceLadder(int windowTicks)
+        : window_(windowTicks), cells_(windowTicks, 0), scratch_(windowTicks, 0),
+          occupied_(windowTicks), depth_((windowTicks + DEPTH_BLOCK - 1) / DEPTH_BLOCK),
+          blockSums_(depth_.slots(), 0) {
+        moved_.reserve(windowTicks);
+    }
+
+    Ticks base()        const { return base_; }
+    int   window()      const { return window_; }
+    size_t overflowSize() const { return overflow_.size(); }
+    long long recenters() const { return recenters_; }
+
+    bool inWindow(Ticks t) const { return t >= base_ && t < base_ + window_; }
+
+    Lots get(Ticks t) const {
+        if (inWindow(t)) return cells_[t - base_];
+        return overflow_.get(t);
+    }
+
+    // returns the previous quantity at t
+    Lots set(Ticks t, Lots qty) {
+        if (!anchored_) anchor(t);
+        if (!inWindow(t)) return overflow_.set(t, qty);
+
+        int i = (int)(t - base_);
+        Lots prev = cells_[i];
+        // sweeps re-send long runs of already-empty ticks; leave the
+        // bitmap and depth tree alone for those
+        if (prev == qty) return prev;
+        if (prev == 0) occupied_.set(i);
+        else if (qty == 0) occupied_.clear(i);
+        cells_[i] = qty;
+        int block = i >> DEPTH_BLOCK_BITS;
+        if (block != pendingBlock_) {
+            flushDepth();
+            pendingBlock_ = block;
+        }
+        pendingDelta_ += (int64_t)qty - (int64_t)prev;
+        return prev;
+    }
+
+    // Highest non-empty tick <= from, or NO_PRICE.
+    Ticks bestAtOrBelow(Ticks from) const {
+        const auto& overflow = overflow_.levels();
+        if (from >= base_ + window_) {
+            auto it = overflow.upper_bound(from);
+            if (it != overflow.begin()) {
+                --it;
+                if (it->first >= base_ + window_) return it->first;
+            }
+            from = base_ + window_ - 1;
+        }
+        if (from >= base_) {
+            int i = occupied_.prev((int)(from - base_));
+            if (i != OccupancyBitmap::NONE) return base_ + i;
+            from = base_ - 1;
+        }
+        auto it = overflow.upper_bound(from);
+        if (it == overflow.begin()) return NO_PRICE;
+        return (--it)->first;
+    }
+
+    // Lowest non-empty tick >= from, or NO_PRICE.
+    Ticks bestAtOrAbove(Ticks from) const {
+        const auto& overflow = overflow_.levels();
+        if (from < base_) {
+            auto it = overflow.lower_bound(from);
+            if (it != overflow.end() && it->first < base_) return it->first;
+            from = base_;
+        }
+        if (from < base_ + window_) {
+            int i = occupied_.next((int)(from - base_));
+            if (i != OccupancyBitmap::NONE) return base_ + i;
+            from = base_ + window_;
+        }
+        auto it = overflow.lower_bound(from);
+        return it == overflow.end() ? NO_PRICE : it->first;
+    }
+
+    // Calls f(tick, qty) for up to n levels at or below from, best first,
+    // and returns how many. One pass along the bitmap and the overflow map
+    // rather than a search per level, which matters for deep walks.
+    template <typename F>
+    int walkDown(Ticks from, int n, F&& f) const {
+        const auto& overflow = overflow_.levels();
+        const Ticks top = base_ + window_;
+        int count = 0;
+        for (auto it = overflow.upper_bound(from); count < n && it != overflow.begin(); count++) {
+            if ((--it)->first < top) break;
+            f(it->first, it->second);
+        }
+        if (from >= base_) {
+            for (int i = occupied_.prev((int)std::min<Ticks>(from - base_, window_ - 1));
+                 i != OccupancyBitmap::NONE && count < n; i = occupied_.prev(i - 1), count++)
+                f(base_ + i, cells_[i]);
+        }
+        for (auto it = overflow.lower_bound(std::min(from + 1, base_)); count < n && it != overflow.begin(); count++) {
+            --it;
+            f(it->first, it->second);
+        }
+        return count;
+    }
+
+    // The same upwards: levels at or above from, lowest first.
+    template <typename F>
+    int walkUp(Ticks from, int n, F&& f) const {
+        const auto& overflow = overflow_.levels();
+        const Ticks top = base_ + window_;
+        int count = 0;
+        for (auto it = overflow.lower_bound(from); count < n && it != overflow.end() && it->first < base_; ++it, count++)
+            f(it->first, it->second);
+        if (from < top) {
+            for (int i = occupied_.next((int)std::max<Ticks>(from - base_, 0));
+                 i != OccupancyBitmap::NONE && count < n; i = occupied_.next(i + 1), count++)
+                f(base_ + i, cells_[i]);
+        }
+        for (auto it = overflow.lower_bound(std::max(from, top)); count < n && it != overflow.end(); ++it, count++)
+            f(it->first, it->second);
+        return count;
+    }
+
+    // Total size resting on [lo, hi].
+    int64_t depthBetween(Ticks lo, Ticks hi) const {
+        if (lo > hi) return 0;
+        int64_t sum = overflow_.depthBetween(lo, hi);   // never holds in-window ticks
+        Ticks wlo = std::max(lo, base_), whi = std::min(hi, base_ + window_ - 1);
+        if (wlo <= whi) sum += cellPrefix((int)(whi - base_)) - cellPrefix((int)(wlo - base_) - 1);
+        return sum;
+    }
+
+    // Lowest price p >= from such that [from, p] holds at least qty, i.e.
+    // where a buy of qty sweeping up from `from` stops; NO_PRICE if the
+    // side is too thin.
+    Ticks sweepUp(Ticks from, int64_t qty) const {
+        int64_t need = std::max<int64_t>(qty, 1);
+        Ticks p = overflow_.sweepUp(from, base_ - 1, need);
+        if (p != OverflowLevels::NONE) return p;
+
+        Ticks start = std::max(from, base_);
+        if (start < base_ + window_) {
+            int s = (int)(start - base_);
+            int64_t before = cellPrefix(s - 1);
+            int i = cellSearch(before + need, false);
+            if (i < window_) return base_ + i;
+            need -= cellPrefix(window_ - 1) - before;
+        }
+        p = overflow_.sweepUp(std::max(from, base_ + window_), INT64_MAX, need);
+        return p == OverflowLevels::NONE ? NO_PRICE : p;
+    }
+
+    // Highest price p <= from such that [p, from] holds at least qty: where
+    // a sell of qty sweeping down from `from` stops, or NO_PRICE.
+    Ticks sweepDown(Ticks from, int64_t qty) const {
+        int64_t need = std::max<int64_t>(qty, 1);
+        Ticks p = overflow_.sweepDown(base_ + window_, from, need);
+        if (p != OverflowLevels::NONE) return p;
+
+        Ticks end = std::min(from, base_ + window_ - 1);
+        if (end >= base_) {
+            int e = (int)(end - base_);
+            int64_t upTo = cellPrefix(e);
+            if (upTo >= need) return base_ + cellSearch(upTo - need, true);
+            need -= upTo;
+        }
+        p = overflow_.sweepDown(0, std::min(from, base_ - 1), need);
+        return p == OverflowLevels::NONE ? NO_PRICE : p;
+    }
+
+    // Re-centres on mid once it has drifted more than a quarter window
+    // from the centre. Returns true if the window moved.
+    bool maybeRecenter(Ticks mid) {
+        Ticks center = base_ + window_ / 2;
+        if (!anchored_ || std::abs(mid - center) <= window_ / 4) return false;
+        recenter(mid - window_ / 2);
+        return true;
+    }
+
+    void recenter(Ticks newBase) {
+        std::fill(scratch_.begin(), scratch_.end(), 0);
+        moved_.clear();
+        pendingBlock_ = -1;
+        pendingDelta_ = 0;   // the tree is rebuilt below
+
+        for (int i = 0; i < window_; i++) {
+            Lots q = cells_[i];
+            if (q == 0) continue;
+            Ticks t = base_ + i;
+            if (t >= newBase && t < newBase + window_) {
+                scratch_[t - newBase] = q;
+                moved_.push_back((uint32_t)(t - newBase));
+            } else {
+                overflow_.set(t, q);
+            }
+        }
+
+        overflow_.extract(newBase, newBase + window_, [&](Ticks t, Lots q) {
+            scratch_[t - newBase] = q;
+            moved_.push_back((uint32_t)(t - newBase));
+        });
+
+        cells_.swap(scratch_);
+        occupied_.clearAll();
+        for (uint32_t i : moved_) occupied_.set((int)i);
+        std::fill(blockSums_.begin(), blockSums_.end(), 0);
+        for (uint32_t i : moved_) blockSums_[i >> DEPTH_BLOCK_BITS] += cells_[i];
+        depth_.build(blockSums_);
+        base_ = newBase;
+        recenters_++;
+    }
+
+    // O(occupied levels), not O(window)
+    void reset() {
+        flushDepth();
+        for (int i = occupied_.next(0); i != OccupancyBitmap::NONE; i = occupied_.next(i + 1)) {
+            depth_.add(i >> DEPTH_BLOCK_BITS, -(int64_t)cells_[i]);
+            cells_[i] = 0;
+        }
+        occupied_.clearAll();
+        overflow_.clear();
+        anchored_ = false;
+    }
+
+private:
+    // Sum of cells [0, i]; 0 for i < 0.
+    int64_t cellPrefix(int i) const {
+        if (i < 0) return 0;
+        flushDepth();
+        int b = i >> DEPTH_BLOCK_BITS;
+        int64_t sum = depth_.prefix(b - 1);
+        for (int k = b << DEPTH_BLOCK_BITS; k <= i; k++) sum += cells_[k];
+        return sum;
+    }
+
+    // Smallest cell whose prefix reaches target (exceeds it when strict),
+    // or window_.
+    int cellSearch(int64_t target, bool strict) const {
+        flushDepth();
+        int b = strict ? depth_.upperBound(target) : depth_.lowerBound(target);
+        if (b >= depth_.slots()) return window_;
+        int64_t acc = depth_.prefix(b - 1);
+        int end = std::min(window_, (b + 1) << DEPTH_BLOCK_BITS);
+        for (int k = b << DEPTH_BLOCK_BITS; k < end; k++) {
+            acc += cells_[k];
+            if (strict ? acc > target : acc >= target) return k;
+        }
+        return window_;
+    }
+
+    void anchor(Ticks t) {
+        base_ = t - window_ / 2;
+        anchored_ = true;
+    }
+
+    // Puts the summed changes to pendingBlock_ into the tree. Called from
+    // the const queries too: the totals they see are unchanged by it.
+    void flushDepth() const {
+        if (pendingDelta_ != 0) depth_.add(pendingBlock_, pendingDelta_);
+        pendingDelta_ = 0;
+    }
+
+    int   window_;
+    Ticks base_     = 0;
+    bool  anchored_ = false;
+    long long recenters_ = 0;
+
+    std::vector<Lots>     cells_;
+    std::vector<Lots>     scratch_;
+    std::vector<uint32_t> moved_;       // scratch for recenter
+    OccupancyBitmap       occupied_;
+    mutable FenwickTree   depth_;       // per DEPTH_BLOCK cells
+    mutable int           pendingBlock_ = -1;
+    mutable int64_t       pendingDelta_ = 0;   // not yet in depth_
+    std::vector<int64_t>  blockSums_;   // scratch for recenter
+    OverflowLevels        overflow_;
+};
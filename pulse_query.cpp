@@ -0,0 +1,255 @@
+// Queries over the metric stores orderbook --store appends to
+// (metric_store.h): time-range aggregates, a description of the file, and
+// export back to CSV.
+//
+//   ./pulse_query pulse.store [more.store ...] [--symbol BTCUSDT]
+//                 [--from <time>] [--to <time>] [--percentiles 1,50,99]
+//   ./pulse_query pulse.store --info
+//   ./pulse_query pulse.store --export out.csv [--columns mid_price,imbalance]
+//
+// Times are milliseconds since the epoch or UTC dates such as 2024-05-01,
+// 2024-05-01T12:00 or 2024-05-01T12:00:05.250. Files are read in the order
+// given; pass a session's files oldest first.
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <algorithm>
+#include "store_query.h"
+
+using namespace std;
+
+void printUsage(const char* prog) {
+    cerr << "usage: " << prog << " <store> [<store> ...] [--symbol <SYMBOL>]\n"
+         << "           [--from <time>] [--to <time>]  ms since the epoch or a UTC date,\n"
+         << "               2024-05-01[T12:00[:05[.250]]]\n"
+         << "           [--percentiles <p>,<p>,...]  imbalance percentiles (default 1,50,99)\n"
+         << "       [--info]  blocks, rows and compressed size per column\n"
+         << "       [--export <out.csv> [--columns <name>,...]]  matching rows as CSV\n";
+}
+
+vector<string> splitList(const string& s) {
+    vector<string> out;
+    size_t start = 0;
+    while (start <= s.size()) {
+        size_t comma = s.find(',', start);
+        if (comma == string::npos) comma = s.size();
+        if (comma > start) out.push_back(s.substr(start, comma - start));
+        start = comma + 1;
+    }
+    return out;
+}
+
+int64_t parseTime(const string& s) {
+    if (s.find('-') == string::npos) return atoll(s.c_str());
+    struct tm t = {};
+    double sec = 0.0;
+    int n = sscanf(s.c_str(), "%d-%d-%dT%d:%d:%lf", &t.tm_year, &t.tm_mon, &t.tm_mday, &t.tm_hour,
+                   &t.tm_min, &sec);
+    if (n < 3) throw runtime_error("bad time: " + s);
+    t.tm_year -= 1900;
+    t.tm_mon  -= 1;
+    return (int64_t)timegm(&t) * 1000 + (int64_t)llround(sec * 1000.0);
+}
+
+string formatTime(int64_t ms) {
+    time_t secs = (time_t)(ms / 1000);
+    struct tm t;
+    gmtime_r(&secs, &t);
+    char buf[40];
+    size_t n = strftime(buf, sizeof(buf), "%Y-%m-%d %H:%M:%S", &t);
+    snprintf(buf + n, sizeof(buf) - n, ".%03d", (int)(ms % 1000));
+    return buf;
+}
+
+void printInfo(const MetricStoreReader& r) {
+    const auto& cols = r.columns();
+    vector<uint64_t> bytes(cols.size());
+    uint64_t rows = 0;
+    for (const StoreBlock& b : r.blocks()) {
+        rows += b.header->rows;
+        for (size_t c = 0; c < cols.size(); c++) bytes[c] += b.index[c].bytes;
+    }
+    cout << r.path() << ": " << r.fileBytes() / 1024 << " KB, " << r.blocks().size() << " blocks, "
+         << rows << " rows, " << fixed << setprecision(1)
+         << (rows ? (double)r.fileBytes() / rows : 0.0) << " bytes/row ("
+         << (rows ? 8.0 * cols.size() * rows / r.fileBytes() : 0.0) << "x smaller than 8-byte columns)\n";
+    if (!r.blocks().empty())
+        cout << "  " << formatTime(r.blocks().front().index[0].min.i) << " .. "
+             << formatTime(r.blocks().back().index[0].max.i) << " UTC\n";
+    cout << "\n  " << left << setw(26) << "column" << setw(7) << "codec" << right << setw(12) << "bytes"
+         << setw(12) << "bits/value\n";
+    for (size_t c = 0; c < cols.size(); c++)
+        cout << "  " << left << setw(26) << cols[c].name << setw(7)
+             << (cols[c].codec == STORE_DELTA ? "delta" : "xor") << right << setw(12) << bytes[c]
+             << setw(11) << setprecision(2) << (rows ? 8.0 * bytes[c] / rows : 0.0) << "\n";
+}
+
+// Rows in the range as CSV, one file after another. Values are scaled back
+// to prices and sizes; wall_event is written as its type name.
+uint64_t exportCsv(const vector<unique_ptr<MetricStoreReader>>& readers, const QueryOptions& q,
+                   const vector<string>& names, ostream& out) {
+    const MetricStoreReader& first = *readers.front();
+    vector<int> cols;
+    for (const string& n : names) {
+        int c = first.column(n);
+        if (c < 0) throw runtime_error("no column " + n);
+        cols.push_back(c);
+    }
+    out << "symbol";
+    for (int c : cols) out << ',' << first.columns()[c].name;
+    out << '\n';
+
+    int cTime = 0, cEvent = first.column("wall_event");
+    vector<vector<StoreValue>> values(first.columns().size(), vector<StoreValue>(STORE_BLOCK_ROWS));
+    vector<int64_t> ints(STORE_BLOCK_ROWS);
+    vector<double>  floats(STORE_BLOCK_ROWS);
+    char buf[64];
+    uint64_t rows = 0;
+    for (auto& rp : readers) {
+        const MetricStoreReader& r = *rp;
+        if (r.columns().size() != first.columns().size())
+            throw runtime_error(r.path() + " has other columns than " + first.path());
+        for (const StoreBlock& b : r.blocks()) {
+            const StoreColumnIndex& t = b.index[cTime];
+            if ((!q.symbol.empty() && strncmp(b.header->symbol, q.symbol.c_str(), STORE_SYMBOL_CHARS) != 0) ||
+                t.max.i < q.fromMs || t.min.i >= q.toMs)
+                continue;
+            int n = (int)b.header->rows;
+            vector<int> need = cols;
+            need.push_back(cTime);
+            for (int c : need) {
+                bool ok;
+                if (r.columns()[c].codec == STORE_DELTA) {
+                    ok = r.decode(b, c, ints.data());
+                    for (int i = 0; i < n; i++) values[c][i].i = ints[i];
+                } else {
+                    ok = r.decode(b, c, floats.data());
+                    for (int i = 0; i < n; i++) values[c][i].f = floats[i];
+                }
+                if (!ok) throw runtime_error(r.path() + ": corrupt block for " + b.header->symbol);
+            }
+            string symbol(b.header->symbol, strnlen(b.header->symbol, STORE_SYMBOL_CHARS));
+            for (int i = 0; i < n; i++) {
+                int64_t ts = values[cTime][i].i;
+                if (ts < q.fromMs || ts >= q.toMs) continue;
+                out << symbol;
+                for (int c : cols) {
+                    const StoreColumn& col = r.columns()[c];
+                    int dec = r.decimals(b, c);
+                    out << ',';
+                    if (c == cEvent) {
+                        int64_t e = values[c][i].i;
+                        if (e > 0 && e <= NUM_EVENT_TYPES) out << EVENT_TYPE_NAMES[e - 1];
+                    } else if (col.codec == STORE_DELTA) {
+                        out.write(buf, (streamsize)formatFixed(buf, values[c][i].i, dec, dec));
+                    } else {
+                        int prec = dec + (col.scale == STORE_UNITS ? 4 : 2);
+                        out.write(buf, snprintf(buf, sizeof(buf), "%.*f", prec, values[c][i].f * pow(10.0, -dec)));
+                    }
+                }
+                out << '\n';
+                rows++;
+            }
+        }
+    }
+    return rows;
+}
+
+int main(int argc, char** argv) {
+    vector<string> paths, columns;
+    string exportPath;
+    QueryOptions q;
+    vector<double> percentiles = {1, 50, 99};
+    bool info = false;
+
+    try {
+        for (int i = 1; i < argc; i++) {
+            string arg = argv[i];
+            bool   hasValue = i + 1 < argc;
+            if      (arg == "--symbol" && hasValue)      q.symbol = argv[++i];
+            else if (arg == "--from" && hasValue)        q.fromMs = parseTime(argv[++i]);
+            else if (arg == "--to" && hasValue)          q.toMs = parseTime(argv[++i]);
+            else if (arg == "--info")                    info = true;
+            else if (arg == "--export" && hasValue)      exportPath = argv[++i];
+            else if (arg == "--columns" && hasValue)     columns = splitList(argv[++i]);
+            else if (arg == "--percentiles" && hasValue) {
+                percentiles.clear();
+                for (auto& p : splitList(argv[++i])) percentiles.push_back(atof(p.c_str()));
+            }
+            else if (arg[0] != '-')                      paths.push_back(arg);
+            else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+        if (paths.empty()) {
+            printUsage(argv[0]);
+            return 1;
+        }
+
+        auto t0 = chrono::steady_clock::now();
+        vector<unique_ptr<MetricStoreReader>> readers;
+        for (auto& p : paths) readers.emplace_back(new MetricStoreReader(p));
+
+        if (info) {
+            for (auto& r : readers) printInfo(*r);
+            return 0;
+        }
+
+        if (!exportPath.empty()) {
+            if (columns.empty())
+                for (auto& c : readers.front()->columns()) columns.push_back(c.name);
+            ofstream out(exportPath);
+            if (!out) throw runtime_error("cannot open " + exportPath);
+            uint64_t rows = exportCsv(readers, q, columns, out);
+            cerr << rows << " rows written to " << exportPath << "\n";
+            return 0;
+        }
+
+        vector<SymbolSummary> symbols;
+        QueryStats st;
+        for (auto& r : readers) queryStore(*r, q, symbols, st);
+        double ms = chrono::duration<double, milli>(chrono::steady_clock::now() - t0).count();
+
+        for (const SymbolSummary& s : symbols) {
+            if (s.rows == 0) continue;
+            int pd = s.priceDecimals + 1;
+            cout << s.symbol << ": " << s.rows << " rows, " << formatTime(s.firstMs) << " .. "
+                 << formatTime(s.lastMs) << " UTC\n"
+                 << fixed << setprecision(pd)
+                 << "  mid        first " << s.midFirst << "  last " << s.midLast << "  min " << s.midMin
+                 << "  max " << s.midMax << "  mean " << s.midMean() << "\n"
+                 << "  mid VWAP   ";
+            if (s.volume > 0)
+                cout << s.vwap() << " over " << setprecision(s.qtyDecimals) << s.volume << " taken at the touch\n";
+            else
+                cout << "none, nothing taken at the touch\n";
+            cout << "  imbalance ";
+            for (double p : percentiles)
+                cout << " p" << setprecision(p == floor(p) ? 0 : 1) << p << " " << setprecision(4)
+                     << s.imbalancePercentile(p / 100.0);
+            cout << "\n  walls     ";
+            uint64_t events = 0;
+            for (int e = 0; e < NUM_EVENT_TYPES; e++) {
+                if (s.wallEvents[e]) cout << " " << EVENT_TYPE_NAMES[e] << " " << s.wallEvents[e];
+                events += s.wallEvents[e];
+            }
+            cout << (events ? "\n" : " none\n");
+        }
+        cout << fixed << setprecision(1) << st.rowsScanned << " rows decoded from "
+             << st.blocks - st.blocksSkipped << " of " << st.blocks << " blocks ("
+             << st.bytesDecoded / 1024 << " KB of column data) in " << ms << " ms";
+        if (ms > 0) cout << ", " << setprecision(1) << st.rowsScanned / ms / 1000.0 << "M rows/s";
+        cout << "\n";
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,110 @@
+// The reference receiver for orderbook --udp (udp_feed.h): rebuilds each
+// book from its frames and prints it, with the loss and throughput seen.
+//
+//   ./pulse_udp --listen 9100 [--symbol BTCUSDT] [--every 1000] [--seconds 0]
+//   ./pulse_udp --listen 239.10.10.1:9100      join a multicast group
+//
+// --every is how often to print, --seconds how long to run (0: until
+// interrupted). It needs nothing from the engine but the one header, and
+// is the code to port for a receiver elsewhere.
+
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include "udp_feed.h"
+
+using namespace std;
+
+void printUsage(const char* prog) {
+    cerr << "usage: " << prog << " --listen <[group:]port> [--symbol <SYMBOL>]\n"
+         << "           [--every <ms>]  print interval (default 1000)\n"
+         << "           [--seconds <n>]  stop after n seconds (default 0: run until interrupted)\n";
+}
+
+const char* WALL_EVENT_NAMES[] = {"-", "appeared", "pulled", "filled"};
+
+string price(int64_t ticks, int decimals) {
+    char buf[40];
+    snprintf(buf, sizeof(buf), "%.*f", decimals, ticks * pow(10.0, -decimals));
+    return buf;
+}
+
+void printBook(const UdpBook& b) {
+    int pd = b.priceDecimals, qd = b.qtyDecimals;
+    double qs = pow(10.0, -qd);
+    cout << b.symbol << "  update " << b.updateCount << "  bid " << price(b.bestBid, pd) << "  ask "
+         << price(b.bestAsk, pd) << fixed << setprecision(3) << "  imb " << b.imbalance << "  aggr "
+         << b.aggressionRatio << " (buy " << setprecision(qd) << b.buyAggression * qs << " sell "
+         << b.sellAggression * qs << ")\n";
+    int rows = max(b.numBids, b.numAsks);
+    for (int i = 0; i < rows; i++) {
+        cout << "  " << setw(16) << (i < b.numBids ? price(b.bids[i].price, pd) : "") << setw(14);
+        if (i < b.numBids) cout << b.bids[i].qty * qs;
+        else cout << "";
+        cout << "  |" << setw(16) << (i < b.numAsks ? price(b.asks[i].price, pd) : "") << setw(14);
+        if (i < b.numAsks) cout << b.asks[i].qty * qs;
+        else cout << "";
+        cout << "\n";
+    }
+    cout << "  walls " << b.liveWalls << "  nearest bid "
+         << (b.nearestBidWall.price ? price(b.nearestBidWall.price, pd) : "-") << "  ask "
+         << (b.nearestAskWall.price ? price(b.nearestAskWall.price, pd) : "-") << "  last event ";
+    if (b.wallEvent > UDP_WALL_NONE && b.wallEvent <= UDP_WALL_FILLED)
+        cout << WALL_EVENT_NAMES[b.wallEvent] << " " << (b.wallEventBid ? "bid " : "ask ")
+             << price(b.wallEventPrice, pd) << " x " << b.wallEventQty * qs << "\n";
+    else
+        cout << "none\n";
+}
+
+int main(int argc, char** argv) {
+    string listen, symbol;
+    int everyMs = 1000, seconds = 0;
+
+    for (int i = 1; i < argc; i++) {
+        string arg = argv[i];
+        bool   hasValue = i + 1 < argc;
+        if      (arg == "--listen" && hasValue)  listen = argv[++i];
+        else if (arg == "--symbol" && hasValue)  symbol = argv[++i];
+        else if (arg == "--every" && hasValue)   everyMs = max(1, atoi(argv[++i]));
+        else if (arg == "--seconds" && hasValue) seconds = max(0, atoi(argv[++i]));
+        else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (listen.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        UdpReceiver rx(listen);
+        auto start = chrono::steady_clock::now();
+        auto next  = start + chrono::milliseconds(everyMs);
+        UdpReceiveStats last;
+        while (seconds == 0 || chrono::steady_clock::now() - start < chrono::seconds(seconds)) {
+            rx.poll(max<int>(1, (int)chrono::duration_cast<chrono::milliseconds>(next - chrono::steady_clock::now()).count()));
+            auto now = chrono::steady_clock::now();
+            if (now < next) continue;
+            double secs = chrono::duration<double>(now - next + chrono::milliseconds(everyMs)).count();
+            next = now + chrono::milliseconds(everyMs);
+
+            for (int i = 0; i < rx.numBooks(); i++)
+                if (rx.has(i) && (symbol.empty() || symbol == rx.book(i).symbol)) printBook(rx.book(i));
+            const UdpReceiveStats& s = rx.stats();
+            cout << fixed << setprecision(1) << (s.datagrams - last.datagrams) / secs << " frames/s  "
+                 << (s.bytes - last.bytes) / 1024.0 / secs << " KB/s  full " << s.fullFrames << "  delta "
+                 << s.deltaFrames << "  lost " << s.lost << "  skipped " << s.skipped << "  late " << s.late
+                 << "  malformed " << s.malformed << "  restarts " << s.restarts << "\n\n"
+                 << flush;
+            last = s;
+        }
+    } catch (exception const& e) {
+        cerr << e.what() << "\n";
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,185 @@
+#pragma once
+
+// Rolling statistics over the last samples of a per-update signal, in
+// fixed storage: a window is a ring of at most N samples, so pushing one
+// never allocates and costs the same whatever the window length.
+//
+// RollingWindow keeps a running sum and sum of squares for mean and
+// variance and, when Extremes is set, two monotonic queues for min and
+// max: each sample enters each queue once and leaves once, so push is O(1)
+// amortised and every query is O(1). The queues are opt-in because on
+// noisy data their pops are hard to predict and cost more than the rest of
+// a push together (bench_engine's signals stage). A window is bounded by
+// count (at most limit samples) and optionally by time (nothing older than
+// horizonMs before the newest), so one type serves "the last 100 updates"
+// and "the last 10 seconds". A time window still holds at most N samples;
+// past that rate it is count-limited.
+//
+// Floating-point sums are rebuilt from the samples every N pushes, so the
+// rounding of adding and subtracting does not accumulate over a session.
+// Integer sums are exact.
+//
+// Ewma is the exponentially weighted mean and variance, per update or,
+// given the time since the last sample, with a half-life.
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include <type_traits>
+
+template <typename T, int N, bool Extremes = false>
+class RollingWindow {
+    static_assert(N > 0 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    using Sum = typename std::conditional<std::is_integral<T>::value, int64_t, double>::type;
+
+    explicit RollingWindow(int limit = N, int64_t horizonMs = 0)
+        : limit_(std::max(1, std::min(limit, N))), horizonMs_(horizonMs) {}
+
+    int     limit() const     { return limit_; }
+    int64_t horizonMs() const { return horizonMs_; }
+
+    void push(T x, int64_t timeMs = 0) {
+        if (size() == limit_) evictOldest();
+        samples_[tail_ & MASK] = {x, timeMs};
+        sum_   += x;
+        sumSq_ += (double)x * (double)x;
+        if constexpr (Extremes) {
+            while (minTail_ != minHead_ && samples_[minQ_[(minTail_ - 1) & MASK] & MASK].value >= x) minTail_--;
+            minQ_[minTail_++ & MASK] = tail_;
+            while (maxTail_ != maxHead_ && samples_[maxQ_[(maxTail_ - 1) & MASK] & MASK].value <= x) maxTail_--;
+            maxQ_[maxTail_++ & MASK] = tail_;
+        }
+        tail_++;
+        if (horizonMs_ > 0) expire(timeMs);
+        if (!std::is_integral<T>::value && ++sinceRebuild_ == N) rebuild();
+    }
+
+    // Drops samples more than horizonMs older than nowMs.
+    void expire(int64_t nowMs) {
+        while (head_ != tail_ && nowMs - samples_[head_ & MASK].timeMs >= horizonMs_) evictOldest();
+    }
+
+    void clear() {
+        head_ = tail_ = minHead_ = minTail_ = maxHead_ = maxTail_ = 0;
+        sum_   = 0;
+        sumSq_ = 0.0;
+    }
+
+    int  size() const  { return (int)(tail_ - head_); }
+    bool empty() const { return head_ == tail_; }
+
+    // i = 0 is the oldest
+    T operator[](int i) const { return samples_[(head_ + i) & MASK].value; }
+    T newest() const          { return samples_[(tail_ - 1) & MASK].value; }
+    int64_t spanMs() const {
+        return empty() ? 0 : samples_[(tail_ - 1) & MASK].timeMs - samples_[head_ & MASK].timeMs;
+    }
+
+    Sum    sum() const        { return sum_; }
+    double sumSquares() const { return sumSq_; }
+    double mean() const       { return empty() ? 0.0 : (double)sum_ / size(); }
+    double variance() const {
+        if (empty()) return 0.0;
+        double m = mean();
+        return std::max(0.0, sumSq_ / size() - m * m);
+    }
+    double stddev() const { return std::sqrt(variance()); }
+
+    // Extremes only; the window must not be empty
+    T min() const {
+        static_assert(Extremes, "min() needs RollingWindow<T, N, true>");
+        return samples_[minQ_[minHead_ & MASK] & MASK].value;
+    }
+    T max() const {
+        static_assert(Extremes, "max() needs RollingWindow<T, N, true>");
+        return samples_[maxQ_[maxHead_ & MASK] & MASK].value;
+    }
+
+private:
+    static const uint32_t MASK = N - 1;
+
+    struct Sample {
+        T       value;
+        int64_t timeMs;
+    };
+
+    void evictOldest() {
+        const T x = samples_[head_ & MASK].value;
+        sum_   -= x;
+        sumSq_ -= (double)x * (double)x;
+        if constexpr (Extremes) {
+            if (minQ_[minHead_ & MASK] == head_) minHead_++;
+            if (maxQ_[maxHead_ & MASK] == head_) maxHead_++;
+        }
+        head_++;
+    }
+
+    void rebuild() {
+        sinceRebuild_ = 0;
+        sum_   = 0;
+        sumSq_ = 0.0;
+        for (uint32_t s = head_; s != tail_; s++) {
+            const T x = samples_[s & MASK].value;
+            sum_   += x;
+            sumSq_ += (double)x * (double)x;
+        }
+    }
+
+    // sequence numbers: samples_[s & MASK] holds sample s for head_ <= s < tail_;
+    // the queues hold sequence numbers, oldest at their head
+    Sample   samples_[N];
+    uint32_t minQ_[Extremes ? N : 1];
+    uint32_t maxQ_[Extremes ? N : 1];
+    uint32_t head_ = 0, tail_ = 0;
+    uint32_t minHead_ = 0, minTail_ = 0;
+    uint32_t maxHead_ = 0, maxTail_ = 0;
+    uint32_t sinceRebuild_ = 0;
+    int      limit_;
+    int64_t  horizonMs_;
+    Sum      sum_   = 0;
+    double   sumSq_ = 0.0;
+};
+
+class Ewma {
+public:
+    explicit Ewma(double alpha = 0.0) : alpha_(alpha) {}
+
+    // The weight of the newest sample for a half-life, when dtMs have
+    // passed since the previous one.
+    static double alphaForHalfLife(double dtMs, double halfLifeMs) {
+        return dtMs <= 0.0 ? 0.0 : 1.0 - std::exp2(-dtMs / halfLifeMs);
+    }
+
+    void update(double x) { update(x, alpha_); }
+
+    // The first sample sets the mean.
+    void update(double x, double alpha) {
+        if (!seeded_) {
+            mean_   = x;
+            seeded_ = true;
+            return;
+        }
+        double d = x - mean_;
+        mean_ += alpha * d;
+        var_   = (1.0 - alpha) * (var_ + alpha * d * d);
+    }
+
+    void clear() {
+        mean_   = 0.0;
+        var_    = 0.0;
+        seeded_ = false;
+    }
+
+    bool   seeded() const   { return seeded_; }
+    double mean() const     { return mean_; }
+    double variance() const { return var_; }
+    double stddev() const   { return std::sqrt(var_); }
+
+private:
+    double alpha_;
+    double mean_   = 0.0;
+    double var_    = 0.0;
+    bool   seeded_ = false;
+};
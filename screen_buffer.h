@@ -0,0 +1,114 @@
+#pragma once
+
+// Back-buffered terminal frame for the UI thread.
+//
+// The UI draws each frame into a ScreenBuffer rather than straight into
+// ncurses. flush() compares it with the previous frame and hands a sink
+// only the cells that changed, one call per run of cells sharing an
+// attribute. A frame where a few numbers moved then costs a few cursor
+// moves and attribute switches, instead of an erase() and a repaint of
+// every cell through an attron/attroff pair each. Short stretches of
+// unchanged cells inside a run are rewritten rather than jumped over,
+// since a cursor move costs more bytes on the wire than a few characters.
+//
+// The buffer knows nothing about ncurses: orderbook.cpp supplies a sink
+// that calls attrset/mvaddnstr, and bench_render one that only counts.
+
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <vector>
+
+struct ScreenCell {
+    char    ch;
+    uint8_t attr;   // colour pair, | SCREEN_BOLD
+    bool operator==(const ScreenCell& o) const { return ch == o.ch && attr == o.attr; }
+    bool operator!=(const ScreenCell& o) const { return !(*this == o); }
+};
+
+const uint8_t SCREEN_BOLD    = 0x80;
+const uint8_t SCREEN_UNKNOWN = 0xff;   // front-buffer cells the terminal may not show
+const int     SCREEN_MERGE_GAP = 4;    // unchanged cells rewritten to avoid a cursor move
+
+struct ScreenFlushStats {
+    uint64_t cells = 0;   // written, including rewritten gaps
+    uint64_t runs  = 0;   // sink calls: one cursor move and attribute each
+};
+
+class ScreenBuffer {
+public:
+    int rows() const { return rows_; }
+    int cols() const { return cols_; }
+
+    // Sizes both frames; everything is redrawn on the next flush.
+    void resize(int rows, int cols) {
+        rows_ = std::max(0, rows);
+        cols_ = std::max(0, cols);
+        back_.assign((size_t)rows_ * cols_, BLANK);
+        front_.assign(back_.size(), ScreenCell{0, SCREEN_UNKNOWN});
+    }
+
+    // The terminal was cleared behind our back: redraw everything.
+    void invalidate() { std::fill(front_.begin(), front_.end(), ScreenCell{0, SCREEN_UNKNOWN}); }
+
+    // Starts a frame.
+    void clear() { std::fill(back_.begin(), back_.end(), BLANK); }
+
+    // Text at (row, col), clipped to the screen.
+    void put(int row, int col, uint8_t attr, const char* s, size_t len) {
+        if (row < 0 || row >= rows_ || col >= cols_) return;
+        if (col < 0) {
+            if ((size_t)-col >= len) return;
+            s   += -col;
+            len -= (size_t)-col;
+            col  = 0;
+        }
+        len = std::min(len, (size_t)(cols_ - col));
+        ScreenCell* c = &back_[(size_t)row * cols_ + col];
+        for (size_t i = 0; i < len; i++) c[i] = {s[i], attr};
+    }
+
+    // Calls sink(row, col, attr, text, len) for every run of changed cells
+    // of one attribute, left to right and top to bottom, and makes the
+    // frame the new baseline.
+    template <typename Sink>
+    ScreenFlushStats flush(Sink&& sink) {
+        ScreenFlushStats st;
+        char text[MAX_RUN];
+        for (int r = 0; r < rows_; r++) {
+            ScreenCell* back  = &back_[(size_t)r * cols_];
+            ScreenCell* front = &front_[(size_t)r * cols_];
+            int c = 0;
+            while (c < cols_) {
+                if (back[c] == front[c]) { c++; continue; }
+
+                // extend over changed cells of this attribute, bridging
+                // short unchanged gaps
+                uint8_t attr = back[c].attr;
+                int start = c, end = c + 1;
+                for (int i = c + 1; i < cols_ && back[i].attr == attr && i - start < MAX_RUN; i++) {
+                    if (back[i] != front[i]) end = i + 1;
+                    else if (i - end >= SCREEN_MERGE_GAP) break;
+                }
+                for (int i = start; i < end; i++) {
+                    text[i - start] = back[i].ch;
+                    front[i] = back[i];
+                }
+                sink(r, start, attr, (const char*)text, end - start);
+                st.cells += end - start;
+                st.runs++;
+                c = end;
+            }
+        }
+        return st;
+    }
+
+private:
+    static constexpr ScreenCell BLANK = {' ', 0};
+    static const int MAX_RUN = 256;
+
+    int rows_ = 0;
+    int cols_ = 0;
+    std::vector<ScreenCell> back_;    // the frame being drawn
+    std::vector<ScreenCell> front_;   // what the terminal shows
+};
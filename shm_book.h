@@ -0,0 +1,245 @@
+#pragma once
+
+// The engine's books published to a POSIX shared-memory segment, for
+// strategies on the same host that would otherwise open their own socket
+// and rebuild the book.
+//
+// The segment is a ShmHeader followed by one ShmSlot per instrument. A
+// slot is a seqlock: the engine worker that owns the book builds the new
+// ShmBook on its own stack, makes the sequence odd, copies it in and makes
+// the sequence even again, so the window a reader can collide with is one
+// memcpy. A reader copies the book between two loads of the sequence and
+// retries if they differ or are odd, so it always gets one whole update,
+// never takes a lock, never makes a syscall, and can never slow the writer
+// down. Each slot has one writer; any number of readers in any number of
+// processes.
+//
+// Everything in a ShmBook is fixed-width plain data: prices in integer
+// ticks and quantities in integer lots at the instrument's scale
+// (priceDecimals / qtyDecimals), ratios as doubles. This header has no
+// dependency on the rest of the engine, so a consumer only needs it and
+// -lrt:
+//
+//   ShmBookReader shm("/pulse_book");
+//   int i = shm.find("BTCUSDT");
+//   ShmBook b;
+//   if (shm.read(i, b)) use(b.bestBid, b.bids[0].qty, b.imbalance);
+//   uint64_t seen = shm.version(i);   // changes whenever the book does
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint32_t SHM_MAGIC       = 0x534c5550;   // "PULS"
+const uint32_t SHM_VERSION     = 1;
+const int      SHM_LEVELS      = 20;           // per side
+const int      SHM_BANDS       = 4;
+const int      SHM_SYMBOL_CHARS = 16;
+
+enum ShmState : uint32_t { SHM_STARTING, SHM_LIVE, SHM_CLOSED };
+
+struct ShmLevel {
+    int64_t price;   // ticks
+    int64_t qty;     // lots
+};
+
+struct ShmBook {
+    char     symbol[SHM_SYMBOL_CHARS];
+    int32_t  priceDecimals;
+    int32_t  qtyDecimals;
+    uint64_t updateCount;
+    int64_t  eventTimeMs;       // exchange time of the last diff
+    int64_t  publishNs;         // wall clock when this update was written
+    uint64_t publishCycles;     // cycle counter, same moment (same host only)
+    int64_t  lastUpdateId;      // exchange "u" the book is at
+    uint8_t  synced;            // book verified against a snapshot, or sync off
+
+    int64_t  bestBid;           // 0 when the side is empty
+    int64_t  bestAsk;
+    int64_t  midTicks2;         // bid + ask
+    int64_t  spread;
+    int32_t  numBids;
+    int32_t  numAsks;
+    ShmLevel bids[SHM_LEVELS];  // best first
+    ShmLevel asks[SHM_LEVELS];
+
+    double   imbalance;         // top-of-book bid / (bid + ask)
+    double   aggressionRatio;   // aggressive buys / all aggressive, recent window
+    int64_t  buyAggression;
+    int64_t  sellAggression;
+    ShmLevel nearestBidWall;    // price 0 when none in range
+    ShmLevel nearestAskWall;
+    int32_t  numBands;
+    int32_t  bandBps[SHM_BANDS];
+    double   bandImbalance[SHM_BANDS];
+    int64_t  costUpLots;        // asks to lift to move the ask up by costBps
+    int64_t  costDownLots;
+    int32_t  costBps;
+};
+
+struct alignas(64) ShmSlot {
+    std::atomic<uint64_t> seq{0};    // odd while being written
+    ShmBook               book;
+};
+
+struct alignas(64) ShmHeader {
+    uint32_t              magic;
+    uint32_t              version;
+    uint32_t              numBooks;
+    uint32_t              levels;
+    uint32_t              slotBytes;
+    int32_t               writerPid;
+    std::atomic<uint32_t> state;
+};
+
+inline size_t shmSegmentBytes(int numBooks) {
+    return sizeof(ShmHeader) + (size_t)numBooks * sizeof(ShmSlot);
+}
+
+// ===== WRITER =====
+// Creates (or replaces) the named segment. Each slot must only ever be
+// written from one thread.
+class ShmBookWriter {
+public:
+    ShmBookWriter(const std::string& name, int numBooks)
+        : name_(name), bytes_(shmSegmentBytes(numBooks)) {
+        shm_unlink(name.c_str());   // readers of an old segment keep their mapping, marked closed
+        int fd = shm_open(name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0644);
+        if (fd < 0) throw std::runtime_error("cannot create shared memory " + name);
+        if (ftruncate(fd, (off_t)bytes_) != 0) {
+            close(fd);
+            shm_unlink(name.c_str());
+            throw std::runtime_error("cannot size shared memory " + name);
+        }
+        void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) {
+            shm_unlink(name.c_str());
+            throw std::runtime_error("cannot map shared memory " + name);
+        }
+        header_ = new (p) ShmHeader;
+        slots_  = reinterpret_cast<ShmSlot*>(static_cast<char*>(p) + sizeof(ShmHeader));
+        for (int i = 0; i < numBooks; i++) new (&slots_[i]) ShmSlot;
+
+        header_->version   = SHM_VERSION;
+        header_->numBooks  = (uint32_t)numBooks;
+        header_->levels    = SHM_LEVELS;
+        header_->slotBytes = sizeof(ShmSlot);
+        header_->writerPid = (int32_t)getpid();
+        header_->state.store(SHM_STARTING, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        header_->magic = SHM_MAGIC;
+    }
+
+    ~ShmBookWriter() {
+        header_->state.store(SHM_CLOSED, std::memory_order_release);
+        munmap(header_, bytes_);
+        shm_unlink(name_.c_str());
+    }
+
+    ShmBookWriter(const ShmBookWriter&) = delete;
+    ShmBookWriter& operator=(const ShmBookWriter&) = delete;
+
+    int numBooks() const { return (int)header_->numBooks; }
+
+    // Once every slot has its symbol and scale.
+    void setLive() { header_->state.store(SHM_LIVE, std::memory_order_release); }
+
+    void publish(int i, const ShmBook& book) {
+        ShmSlot& s = slots_[i];
+        uint64_t seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&s.book, &book, sizeof(ShmBook));
+        s.seq.store(seq + 2, std::memory_order_release);
+    }
+
+private:
+    std::string name_;
+    size_t      bytes_;
+    ShmHeader*  header_;
+    ShmSlot*    slots_;
+};
+
+// ===== READER =====
+class ShmBookReader {
+public:
+    explicit ShmBookReader(const std::string& name) {
+        int fd = shm_open(name.c_str(), O_RDONLY, 0);
+        if (fd < 0) throw std::runtime_error("no shared memory segment " + name);
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < sizeof(ShmHeader)) {
+            close(fd);
+            throw std::runtime_error("shared memory " + name + " is not a book segment");
+        }
+        bytes_ = (size_t)st.st_size;
+        void* p = mmap(nullptr, bytes_, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd);
+        if (p == MAP_FAILED) throw std::runtime_error("cannot map shared memory " + name);
+
+        header_ = static_cast<const ShmHeader*>(p);
+        slots_  = reinterpret_cast<const ShmSlot*>(static_cast<const char*>(p) + sizeof(ShmHeader));
+        bool ok = header_->magic == SHM_MAGIC;
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (!ok || header_->version != SHM_VERSION || header_->slotBytes != sizeof(ShmSlot) ||
+            bytes_ < shmSegmentBytes((int)header_->numBooks)) {
+            munmap(p, bytes_);
+            throw std::runtime_error("shared memory " + name + " has an incompatible layout");
+        }
+    }
+
+    ~ShmBookReader() { munmap(const_cast<ShmHeader*>(header_), bytes_); }
+
+    ShmBookReader(const ShmBookReader&) = delete;
+    ShmBookReader& operator=(const ShmBookReader&) = delete;
+
+    int      numBooks() const { return (int)header_->numBooks; }
+    ShmState state() const    { return (ShmState)header_->state.load(std::memory_order_acquire); }
+    int      writerPid() const { return header_->writerPid; }
+
+    // Index of symbol, or -1. Valid once state() is SHM_LIVE.
+    int find(const std::string& symbol) const {
+        for (int i = 0; i < numBooks(); i++)
+            if (strncmp(slots_[i].book.symbol, symbol.c_str(), SHM_SYMBOL_CHARS) == 0) return i;
+        return -1;
+    }
+
+    // Even and unchanged while the book is; cheap enough to poll.
+    uint64_t version(int i) const { return slots_[i].seq.load(std::memory_order_acquire); }
+
+    // Copies a consistent snapshot of book i. False if the writer kept it
+    // busy for maxTries attempts in a row (it never blocks on readers).
+    bool read(int i, ShmBook& out, int maxTries = 1000, int* retries = nullptr) const {
+        const ShmSlot& s = slots_[i];
+        for (int n = 0; n < maxTries; n++) {
+            uint64_t before = s.seq.load(std::memory_order_acquire);
+            if (!(before & 1)) {
+                memcpy(&out, &s.book, sizeof(ShmBook));
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (s.seq.load(std::memory_order_relaxed) == before) {
+                    if (retries) *retries = n;
+                    return true;
+                }
+            }
+#if defined(__x86_64__) || defined(__i386__)
+            __builtin_ia32_pause();
+#elif defined(__aarch64__)
+            __asm__ __volatile__("yield");
+#endif
+        }
+        if (retries) *retries = maxTries;
+        return false;
+    }
+
+private:
+    size_t           bytes_;
+    const ShmHeader* header_;
+    const ShmSlot*   slots_;
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+// HTTP(S) GET for REST depth snapshots, and the threads that run them.
+//
+// The endpoint is a plain URL so a local stand-in server can replace the
+// exchange, e.g. http://127.0.0.1:8080/api/v3/depth?symbol=BTCUSDT&limit=1000
+// An https:// URL has its certificate chain and host name verified; only
+// verifyPeer = false (--no-verify-tls) skips that, for a stand-in with a
+// self-signed certificate.
+//
+// fetchSnapshot blocks its caller, with a time limit on every step, so it
+// never runs on an engine worker: SnapshotFetcher runs it on threads of its
+// own and hands the bodies back.
+
+#include <string>
+#include <stdexcept>
+#include <vector>
+#include <atomic>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <algorithm>
+#include <boost/beast/core.hpp>
+#include <boost/beast/http.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/asio/connect.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/ssl/host_name_verification.hpp>
+
+const char DEFAULT_SNAPSHOT_URL[] =
+    "https://api.binance.com/api/v3/depth?symbol={symbol}&limit=1000";
+
+const int SNAPSHOT_TIMEOUT_MS = 10000;   // per step: resolve, connect, handshake, write, read
+const int SNAPSHOT_THREADS    = 4;       // books fetched at once
+
+// Substitutes {symbol} in a snapshot URL template. A URL without the
+// placeholder is used as is.
+inline std::string snapshotUrlFor(const std::string& tmpl, const std::string& symbol) {
+    size_t at = tmpl.find("{symbol}");
+    if (at == std::string::npos) return tmpl;
+    return tmpl.substr(0, at) + symbol + tmpl.substr(at + 8);
+}
+
+struct HttpUrl {
+    bool        tls = false;
+    std::string host;
+    std::string port;
+    std::string target;
+};
+
+inline HttpUrl parseHttpUrl(const std::string& url) {
+    HttpUrl u;
+    std::string rest;
+    if      (url.compare(0, 8, "https://") == 0) { u.tls = true;  rest = url.substr(8); }
+    else if (url.compare(0, 7, "http://")  == 0) { u.tls = false; rest = url.substr(7); }
+    else throw std::runtime_error("unsupported snapshot url: " + url);
+
+    size_t slash = rest.find('/');
+    std::string authority = rest.substr(0, slash);
+    u.target = slash == std::string::npos ? "/" : rest.substr(slash);
+
+    size_t colon = authority.find(':');
+    u.host = authority.substr(0, colon);
+    u.port = colon == std::string::npos ? (u.tls ? "443" : "80") : authority.substr(colon + 1);
+    return u;
+}
+
+// Returns the response body; throws on transport errors, an unverified
+// certificate, non-200, or a step that takes longer than timeoutMs.
+inline std::string fetchSnapshot(const std::string& url, int timeoutMs = SNAPSHOT_TIMEOUT_MS,
+                                 bool verifyPeer = true) {
+    namespace beast = boost::beast;
+    namespace http  = beast::http;
+    namespace net   = boost::asio;
+    namespace ssl   = boost::asio::ssl;
+    using tcp = net::ip::tcp;
+
+    HttpUrl u = parseHttpUrl(url);
+    net::io_context ioc;
+    tcp::resolver resolver(ioc);
+    tcp::socket socket(ioc);
+    ssl::context ctx(ssl::context::tlsv12_client);
+    beast::ssl_stream<tcp::socket&> stream(socket, ctx);
+
+    // Each step is started asynchronously and awaited here. One that is
+    // still running after timeoutMs is cancelled with the socket closed.
+    bool finished = false;
+    beast::error_code ec;
+    auto done = [&finished, &ec](beast::error_code e, auto&&...) {
+        ec = e;
+        finished = true;
+    };
+    auto await = [&](const char* step) {
+        ioc.restart();
+        ioc.run_for(std::chrono::milliseconds(timeoutMs));
+        if (!finished) {
+            resolver.cancel();
+            beast::error_code ignored;
+            socket.close(ignored);
+            ioc.restart();
+            ioc.run();
+            throw std::runtime_error(std::string("snapshot ") + step + " timed out after " +
+                                     std::to_string(timeoutMs) + " ms: " + u.host);
+        }
+        finished = false;
+        if (ec) throw beast::system_error(ec);
+    };
+
+    tcp::resolver::results_type results;
+    resolver.async_resolve(u.host, u.port,
+        [&](beast::error_code e, tcp::resolver::results_type r) {
+            results = r;
+            done(e);
+        });
+    await("resolve");
+    net::async_connect(socket, results, done);
+    await("connect");
+
+    http::request<http::empty_body> req{http::verb::get, u.target, 11};
+    req.set(http::field::host, u.host);
+    req.set(http::field::user_agent, "live-market-pulse");
+    beast::flat_buffer buffer;
+    http::response<http::string_body> res;
+
+    if (u.tls) {
+        ctx.set_default_verify_paths();
+        if (verifyPeer) {
+            stream.set_verify_mode(ssl::verify_peer);
+            stream.set_verify_callback(ssl::host_name_verification(u.host));
+        }
+        if (!SSL_set_tlsext_host_name(stream.native_handle(), u.host.c_str()))
+            throw beast::system_error(beast::error_code(
+                static_cast<int>(::ERR_get_error()), net::error::get_ssl_category()));
+        stream.async_handshake(ssl::stream_base::client, done);
+        await("handshake");
+        http::async_write(stream, req, done);
+        await("write");
+        http::async_read(stream, buffer, res, done);
+        await("read");
+    } else {
+        http::async_write(socket, req, done);
+        await("write");
+        http::async_read(socket, buffer, res, done);
+        await("read");
+    }
+    // the body is complete; close without waiting on a TLS close_notify
+    beast::error_code ignored;
+    socket.shutdown(tcp::socket::shutdown_both, ignored);
+    socket.close(ignored);
+
+    if (res.result() != http::status::ok)
+        throw std::runtime_error("snapshot request failed: HTTP " +
+                                 std::to_string(res.result_int()));
+    return std::move(res.body());
+}
+
+// ===== FETCHER =====
+// Snapshot requests for a set of books, served by a few threads of their
+// own. A worker asks for book i with request(i), which only flips an
+// atomic: no lock, no syscall. A fetch thread claims it, GETs the book's
+// URL and passes the body to deliver(i, body), which must route it to the
+// book's worker. The request stays claimed until the worker calls
+// delivered(i), so a book never has two snapshots in flight. A failed
+// fetch goes to fail(i, why) and is retried after a backoff of 0.5 s,
+// doubling up to 10 s. Books are fetched in parallel, up to one per thread.
+class SnapshotFetcher {
+public:
+    typedef std::function<void(int, std::string&&)>      Deliver;
+    typedef std::function<void(int, const std::string&)> Fail;
+
+    SnapshotFetcher(const std::vector<std::string>& urls, int threads, Deliver deliver, Fail fail,
+                    int timeoutMs = SNAPSHOT_TIMEOUT_MS, bool verifyPeer = true)
+        : urls_(urls), books_(urls.size()), deliver_(std::move(deliver)), fail_(std::move(fail)),
+          timeoutMs_(timeoutMs), verifyPeer_(verifyPeer) {
+        for (int t = 0; t < std::max(1, threads); t++) threads_.emplace_back([this] { run(); });
+    }
+
+    ~SnapshotFetcher() { stop(); }
+
+    SnapshotFetcher(const SnapshotFetcher&) = delete;
+    SnapshotFetcher& operator=(const SnapshotFetcher&) = delete;
+
+    // Engine side. A request while one is wanted or in flight is a no-op.
+    void request(int i) {
+        int idle = IDLE;
+        books_[i].state.compare_exchange_strong(idle, WANTED, std::memory_order_acq_rel);
+    }
+
+    // The worker has taken book i's snapshot off its ring.
+    void delivered(int i) { books_[i].state.store(IDLE, std::memory_order_release); }
+
+    // Waits for fetches under way to finish or time out.
+    void stop() {
+        stopping_.store(true, std::memory_order_release);
+        for (auto& t : threads_)
+            if (t.joinable()) t.join();
+    }
+
+    uint64_t fetches()  const { return fetches_.load(std::memory_order_relaxed); }
+    uint64_t failures() const { return failures_.load(std::memory_order_relaxed); }
+
+private:
+    enum { IDLE, WANTED, FETCHING };
+
+    struct Book {
+        std::atomic<int>     state{IDLE};
+        std::atomic<int64_t> retryAtMs{0};   // steady clock
+        int                  backoffMs = 0;  // claimer only
+    };
+
+    static int64_t nowMs() {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void run() {
+        while (!stopping_.load(std::memory_order_acquire)) {
+            bool fetched = false;
+            for (size_t i = 0; i < books_.size() && !stopping_.load(std::memory_order_relaxed); i++) {
+                Book& b = books_[i];
+                int wanted = WANTED;
+                if (b.state.load(std::memory_order_relaxed) != WANTED ||
+                    b.retryAtMs.load(std::memory_order_relaxed) > nowMs() ||
+                    !b.state.compare_exchange_strong(wanted, FETCHING, std::memory_order_acq_rel))
+                    continue;
+                fetched = true;
+                try {
+                    std::string body = fetchSnapshot(urls_[i], timeoutMs_, verifyPeer_);
+                    b.backoffMs = 0;
+                    fetches_.fetch_add(1, std::memory_order_relaxed);
+                    deliver_((int)i, std::move(body));
+                } catch (std::exception const& e) {
+                    failures_.fetch_add(1, std::memory_order_relaxed);
+                    b.backoffMs = std::min(std::max(b.backoffMs * 2, 500), 10000);
+                    b.retryAtMs.store(nowMs() + b.backoffMs, std::memory_order_relaxed);
+                    b.state.store(WANTED, std::memory_order_release);
+                    fail_((int)i, e.what());
+                }
+            }
+            // a resync is hundreds of ms of HTTPS; polling adds at most 10
+            if (!fetched) std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    std::vector<std::string> urls_;
+    std::vector<Book>        books_;
+    Deliver                  deliver_;
+    Fail                     fail_;
+    int                      timeoutMs_;
+    bool                     verifyPeer_;
+    std::atomic<bool>        stopping_{false};
+    std::atomic<uint64_t>    fetches_{0};
+    std::atomic<uint64_t>    failures_{0};
+    std::vector<std::thread> threads_;
+};
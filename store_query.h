@@ -0,0 +1,176 @@
+#pragma once
+
+// Time-range aggregates over metric store files (metric_store.h), for
+// pulse_query and bench_store.
+//
+// A query walks the blocks in file order. Blocks of another symbol, or
+// whose time column's min and max miss the range, are skipped on their
+// headers alone. The rest have just the columns the aggregates read
+// decoded, a block at a time, into flat arrays; the loops over those run
+// without branches, and a block wholly inside the range skips the per-row
+// time test. Per symbol a query yields:
+//   - the mid's first, last, min, max and mean;
+//   - its VWAP, weighted by the volume each diff took out at the touch
+//     (buy_volume + sell_volume);
+//   - imbalance percentiles, from a histogram at the CSV's 1e-4 precision;
+//   - wall event counts by type. A row repeats the latest wall event, so
+//     an event is counted once, on the row where it first appears.
+
+#include <cstdint>
+#include <cstring>
+#include <cmath>
+#include <string>
+#include <vector>
+#include <stdexcept>
+#include "metric_store.h"
+#include "book_engine.h"
+
+const int IMBALANCE_BINS = 10000;
+
+struct QueryOptions {
+    std::string symbol;               // empty: every symbol
+    int64_t     fromMs = INT64_MIN;   // [fromMs, toMs)
+    int64_t     toMs   = INT64_MAX;
+};
+
+struct SymbolSummary {
+    std::string symbol;
+    int         priceDecimals = 0;
+    int         qtyDecimals   = 0;
+    uint64_t    rows    = 0;
+    int64_t     firstMs = 0;
+    int64_t     lastMs  = 0;
+    double      midFirst = 0.0;
+    double      midLast  = 0.0;
+    double      midMin   = INFINITY;
+    double      midMax   = -INFINITY;
+    double      midSum   = 0.0;
+    double      midVolume = 0.0;   // sum of mid x volume
+    double      volume    = 0.0;
+    std::vector<uint64_t> imbalanceBins = std::vector<uint64_t>(IMBALANCE_BINS + 1);
+    uint64_t    wallEvents[NUM_EVENT_TYPES] = {};
+
+    // the wall event the previous row carried
+    int64_t     lastEventType  = 0;
+    int64_t     lastEventTime  = 0;
+    int64_t     lastEventPrice = 0;
+
+    double midMean() const { return rows ? midSum / rows : 0.0; }
+    double vwap() const    { return volume > 0 ? midVolume / volume : NAN; }
+
+    // q in [0, 1]
+    double imbalancePercentile(double q) const {
+        if (rows == 0) return NAN;
+        uint64_t want = (uint64_t)std::ceil(q * rows), seen = 0;
+        for (int b = 0; b <= IMBALANCE_BINS; b++) {
+            seen += imbalanceBins[b];
+            if (seen >= std::max<uint64_t>(want, 1)) return (double)b / IMBALANCE_BINS;
+        }
+        return 1.0;
+    }
+};
+
+struct QueryStats {
+    uint64_t blocks        = 0;
+    uint64_t blocksSkipped = 0;
+    uint64_t rowsScanned   = 0;
+    uint64_t bytesDecoded  = 0;
+};
+
+// Adds the rows of r that match q to out, one summary per symbol in order
+// of appearance. Calling it again for further files of the same session
+// continues the summaries.
+inline void queryStore(const MetricStoreReader& r, const QueryOptions& q, std::vector<SymbolSummary>& out,
+                       QueryStats& st) {
+    const char* needed[] = {"timestamp_ms", "mid_price", "imbalance", "buy_volume", "sell_volume",
+                            "wall_event", "wall_event_time_ms", "wall_event_price"};
+    int col[8];
+    for (int i = 0; i < 8; i++)
+        if ((col[i] = r.column(needed[i])) < 0)
+            throw std::runtime_error(r.path() + " has no " + needed[i] + " column");
+    const int cTime = col[0], cMid = col[1], cImb = col[2], cBuy = col[3], cSell = col[4],
+              cEvent = col[5], cEventTime = col[6], cEventPrice = col[7];
+
+    std::vector<int64_t> time(STORE_BLOCK_ROWS), event(STORE_BLOCK_ROWS), eventTime(STORE_BLOCK_ROWS),
+                         eventPrice(STORE_BLOCK_ROWS), scratch;
+    std::vector<double>  mid(STORE_BLOCK_ROWS), imb(STORE_BLOCK_ROWS), buy(STORE_BLOCK_ROWS),
+                         sell(STORE_BLOCK_ROWS), in(STORE_BLOCK_ROWS);
+
+    for (const StoreBlock& b : r.blocks()) {
+        st.blocks++;
+        const StoreColumnIndex& t = b.index[cTime];
+        if ((!q.symbol.empty() && strncmp(b.header->symbol, q.symbol.c_str(), STORE_SYMBOL_CHARS) != 0) ||
+            t.max.i < q.fromMs || t.min.i >= q.toMs) {
+            st.blocksSkipped++;
+            continue;
+        }
+        const int n = (int)b.header->rows;
+        bool ok = r.decode(b, cTime, time.data()) && r.decodeScaled(b, cMid, mid.data(), scratch) &&
+                  r.decode(b, cImb, imb.data()) && r.decodeScaled(b, cBuy, buy.data(), scratch) &&
+                  r.decodeScaled(b, cSell, sell.data(), scratch) && r.decode(b, cEvent, event.data()) &&
+                  r.decode(b, cEventTime, eventTime.data()) && r.decode(b, cEventPrice, eventPrice.data());
+        if (!ok) throw std::runtime_error(r.path() + ": corrupt block for " + b.header->symbol);
+        for (int c : col) st.bytesDecoded += b.index[c].bytes;
+        st.rowsScanned += n;
+
+        SymbolSummary* s = nullptr;
+        for (auto& x : out)
+            if (strncmp(x.symbol.c_str(), b.header->symbol, STORE_SYMBOL_CHARS) == 0) s = &x;
+        if (!s) {
+            out.emplace_back();
+            s = &out.back();
+            s->symbol = std::string(b.header->symbol, strnlen(b.header->symbol, STORE_SYMBOL_CHARS));
+            s->priceDecimals = b.header->priceDecimals;
+            s->qtyDecimals   = b.header->qtyDecimals;
+        }
+
+        // 1.0 for rows in the range, 0.0 for the others
+        if (t.min.i >= q.fromMs && t.max.i < q.toMs) {
+            std::fill(in.begin(), in.begin() + n, 1.0);
+        } else {
+            for (int i = 0; i < n; i++) in[i] = (double)(time[i] >= q.fromMs && time[i] < q.toMs);
+        }
+
+        double count = 0.0, midSum = 0.0, midVolume = 0.0, volume = 0.0;
+        double lo = s->midMin, hi = s->midMax;
+        for (int i = 0; i < n; i++) {
+            double v = (buy[i] + sell[i]) * in[i];
+            count     += in[i];
+            midSum    += mid[i] * in[i];
+            midVolume += mid[i] * v;
+            volume    += v;
+            lo = std::min(lo, in[i] > 0.0 ? mid[i] : lo);
+            hi = std::max(hi, in[i] > 0.0 ? mid[i] : hi);
+        }
+        if (count == 0.0) continue;
+        s->midMin = lo;
+        s->midMax = hi;
+        s->midSum    += midSum;
+        s->midVolume += midVolume;
+        s->volume    += volume;
+
+        int first = 0, last = n - 1;
+        while (in[first] == 0.0) first++;
+        while (in[last] == 0.0) last--;
+        if (s->rows == 0) {
+            s->firstMs  = time[first];
+            s->midFirst = mid[first];
+        }
+        s->lastMs  = time[last];
+        s->midLast = mid[last];
+        s->rows   += (uint64_t)count;
+
+        for (int i = first; i <= last; i++) {
+            if (in[i] == 0.0) continue;
+            int bin = (int)std::lround(std::min(1.0, std::max(0.0, imb[i])) * IMBALANCE_BINS);
+            s->imbalanceBins[bin]++;
+            if (event[i] != s->lastEventType || eventTime[i] != s->lastEventTime ||
+                eventPrice[i] != s->lastEventPrice) {
+                if (event[i] > 0 && event[i] <= NUM_EVENT_TYPES) s->wallEvents[event[i] - 1]++;
+                s->lastEventType  = event[i];
+                s->lastEventTime  = eventTime[i];
+                s->lastEventPrice = eventPrice[i];
+            }
+        }
+    }
+}
@@ -0,0 +1,322 @@
+#pragma once
+
+// Asynchronous, batched writer for per-update telemetry rows.
+//
+// A producer (an engine worker) copies a fixed-size POD record into its own
+// preallocated single-producer single-consumer lane and returns; it never
+// formats, allocates or makes a syscall. A background thread drains the
+// lanes in batches, formats each record straight into a large output
+// buffer and hands the buffer to write(2) once it is full or the flush
+// interval has passed. fsync and file rotation are policies of the
+// background thread.
+//
+// When a lane is full the producer either drops the record (counted) or
+// waits for space, chosen per writer. Dropping keeps the engine's latency
+// independent of the disk; blocking keeps every row, which replay wants.
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <memory>
+#include <thread>
+#include <chrono>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pipeline.h"
+
+enum class FullPolicy  { Drop, Block };
+enum class FsyncPolicy { Never, EveryFlush, Interval };
+
+struct TelemetryOptions {
+    std::string path;
+    std::string header;                     // written at the top of every file
+    size_t      ringRecords     = 1 << 16;  // per lane, rounded up to a power of two
+    FullPolicy  whenFull        = FullPolicy::Drop;
+    size_t      flushBytes      = 1 << 20;  // write once this much is formatted
+    int         flushIntervalMs = 200;      // ...or this long after the last write
+    FsyncPolicy fsync           = FsyncPolicy::Never;
+    int         fsyncIntervalMs = 1000;
+    uint64_t    rotateBytes     = 0;        // 0 = no size-based rotation
+    int         rotateSeconds   = 0;        // 0 = no time-based rotation
+    int         pinCore         = -1;
+};
+
+// Counters for the UI and the exit summary.
+struct TelemetryStats {
+    std::atomic<uint64_t> recordsQueued{0};
+    std::atomic<uint64_t> recordsDropped{0};
+    std::atomic<uint64_t> producerWaits{0};   // Block policy: times a lane was full
+    std::atomic<uint64_t> recordsWritten{0};
+    std::atomic<uint64_t> bytesWritten{0};
+    std::atomic<uint64_t> bytesPerSec{0};     // over the last second
+    std::atomic<uint64_t> writes{0};
+    std::atomic<uint64_t> fsyncs{0};
+    std::atomic<uint64_t> rotations{0};
+    std::atomic<uint64_t> rotationErrors{0};  // rotations abandoned; the current file goes on
+    std::atomic<uint64_t> writeErrors{0};
+};
+
+// A second consumer of the records on the background thread, for output
+// that is not one line per record (metric_store.h). record() sees every
+// record as it is drained; flush() follows each write of the line file,
+// with closing set on the last.
+template <typename Record>
+class TelemetryTap {
+public:
+    virtual ~TelemetryTap() {}
+    virtual void record(const Record& r) = 0;
+    virtual void flush(bool closing) = 0;
+};
+
+// Record must be trivially copyable. format writes one line for a record
+// into out, which has room for maxLineBytes, and returns its length. Each
+// producer thread writes to its own lane.
+template <typename Record>
+class TelemetryWriter {
+public:
+    typedef size_t (*Formatter)(char* out, const Record& r);
+
+    TelemetryWriter(const TelemetryOptions& opts, Formatter format, size_t maxLineBytes,
+                    int lanes = 1, TelemetryTap<Record>* tap = nullptr)
+        : opts_(opts), format_(format), maxLine_(maxLineBytes), tap_(tap) {
+        size_t cap = 2;
+        while (cap < opts_.ringRecords) cap <<= 1;
+        for (int i = 0; i < lanes; i++) {
+            lanes_.emplace_back(new Lane);
+            lanes_.back()->slots.resize(cap);
+        }
+        mask_ = cap - 1;
+        out_.resize(opts_.flushBytes + maxLine_);
+
+        if (!openFile())
+            throw std::runtime_error("cannot open " + opts_.path + ": " + strerror(errno));
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~TelemetryWriter() { close(); }
+
+    TelemetryWriter(const TelemetryWriter&) = delete;
+    TelemetryWriter& operator=(const TelemetryWriter&) = delete;
+
+    // Hot path. Returns false if the record was dropped.
+    bool write(const Record& r, int lane = 0) {
+        Lane& l = *lanes_[lane];
+        size_t cap = l.slots.size();
+        uint64_t head = l.head.load(std::memory_order_relaxed);
+        if (head - l.cachedTail == cap) {
+            l.cachedTail = l.tail.load(std::memory_order_acquire);
+            if (head - l.cachedTail == cap) {
+                if (opts_.whenFull == FullPolicy::Drop) {
+                    stats_.recordsDropped.fetch_add(1, std::memory_order_relaxed);
+                    return false;
+                }
+                stats_.producerWaits.fetch_add(1, std::memory_order_relaxed);
+                while (head - l.cachedTail == cap) {
+                    std::this_thread::yield();
+                    l.cachedTail = l.tail.load(std::memory_order_acquire);
+                }
+            }
+        }
+        l.slots[head & mask_] = r;
+        l.head.store(head + 1, std::memory_order_release);
+        stats_.recordsQueued.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // Drains everything queued, writes it out and stops the thread.
+    void close() {
+        if (!thread_.joinable()) return;
+        stopping_.store(true, std::memory_order_release);
+        thread_.join();
+    }
+
+    const TelemetryStats& stats() const { return stats_; }
+    uint64_t queued() const {
+        uint64_t n = 0;
+        for (auto& l : lanes_)
+            n += l->head.load(std::memory_order_relaxed) - l->tail.load(std::memory_order_relaxed);
+        return n;
+    }
+    const std::string& path() const { return opts_.path; }
+
+private:
+    typedef std::chrono::steady_clock Clock;
+
+    void run() {
+        pinCurrentThread(opts_.pinCore);
+        auto lastWrite = Clock::now();
+        auto lastSync  = lastWrite;
+        auto rateStart = lastWrite;
+        uint64_t rateBytes = 0;
+
+        while (true) {
+            bool stopping = stopping_.load(std::memory_order_acquire);
+            size_t drained = drain();
+
+            auto now = Clock::now();
+            bool due = now - lastWrite >= std::chrono::milliseconds(opts_.flushIntervalMs);
+            if (used_ >= opts_.flushBytes || (used_ > 0 && (due || stopping))) {
+                flush();
+                lastWrite = now;
+                if (opts_.fsync == FsyncPolicy::EveryFlush) sync();
+                if (tap_) tap_->flush(false);
+            }
+            if (opts_.fsync == FsyncPolicy::Interval &&
+                now - lastSync >= std::chrono::milliseconds(opts_.fsyncIntervalMs)) {
+                sync();
+                lastSync = now;
+            }
+            if (rotationDue(now)) rotate();
+
+            if (now - rateStart >= std::chrono::seconds(1)) {
+                uint64_t total = stats_.bytesWritten.load(std::memory_order_relaxed);
+                double secs = std::chrono::duration<double>(now - rateStart).count();
+                stats_.bytesPerSec.store((uint64_t)((total - rateBytes) / secs),
+                                         std::memory_order_relaxed);
+                rateBytes = total;
+                rateStart = now;
+            }
+
+            if (stopping && drained == 0 && queued() == 0) break;
+            if (drained == 0) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        flush();
+        if (opts_.fsync != FsyncPolicy::Never) sync();
+        ::close(fd_);
+        fd_ = -1;
+        if (tap_) tap_->flush(true);
+    }
+
+    // Formats queued records from every lane until the output buffer is
+    // full. Returns the number consumed. Rows from one lane stay in order.
+    size_t drain() {
+        size_t total = 0;
+        for (auto& lp : lanes_) {
+            Lane& l = *lp;
+            uint64_t tail = l.tail.load(std::memory_order_relaxed);
+            uint64_t head = l.head.load(std::memory_order_acquire);
+            size_t n = 0;
+            while (tail != head && used_ < opts_.flushBytes) {
+                if (tap_) tap_->record(l.slots[tail & mask_]);
+                used_ += format_(&out_[used_], l.slots[tail & mask_]);
+                tail++;
+                n++;
+            }
+            if (n) l.tail.store(tail, std::memory_order_release);
+            total += n;
+        }
+        if (total) stats_.recordsWritten.fetch_add(total, std::memory_order_relaxed);
+        return total;
+    }
+
+    void flush() {
+        if (used_ == 0) return;
+        writeAll(out_.data(), used_);
+        fileBytes_ += used_;
+        stats_.bytesWritten.fetch_add(used_, std::memory_order_relaxed);
+        stats_.writes.fetch_add(1, std::memory_order_relaxed);
+        used_ = 0;
+    }
+
+    void sync() {
+        if (fd_ >= 0 && ::fsync(fd_) == 0) stats_.fsyncs.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // a failed write loses the batch but not the writer
+    void writeAll(const char* p, size_t n) {
+        while (n > 0) {
+            ssize_t w = ::write(fd_, p, n);
+            if (w < 0) {
+                if (errno == EINTR) continue;
+                stats_.writeErrors.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+            p += w;
+            n -= (size_t)w;
+        }
+    }
+
+    bool rotationDue(Clock::time_point now) const {
+        if (opts_.rotateBytes && fileBytes_ >= opts_.rotateBytes) return true;
+        return opts_.rotateSeconds &&
+               now - fileOpened_ >= std::chrono::seconds(opts_.rotateSeconds);
+    }
+
+    // The active file keeps its name; closed files become stem.N.ext.
+    // If the rename or the new file fails, rows go on into the file that
+    // is open (under whichever name it now has), the failure is counted
+    // and the next rotation is tried a full interval later.
+    void rotate() {
+        flush();
+        if (opts_.fsync != FsyncPolicy::Never) sync();
+        std::string closed = rotatedName(nextRotation());
+        if (::rename(opts_.path.c_str(), closed.c_str()) != 0 || !openFile()) {
+            stats_.rotationErrors.fetch_add(1, std::memory_order_relaxed);
+            fileOpened_ = Clock::now();
+            fileBytes_  = 0;
+            return;
+        }
+        stats_.rotations.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    int nextRotation() {
+        while (::access(rotatedName(rotationSeq_).c_str(), F_OK) == 0) rotationSeq_++;
+        return rotationSeq_++;
+    }
+
+    std::string rotatedName(int n) const {
+        const std::string& p = opts_.path;
+        size_t slash = p.find_last_of('/');
+        size_t dot   = p.find_last_of('.');
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash))
+            return p + "." + std::to_string(n);
+        return p.substr(0, dot) + "." + std::to_string(n) + p.substr(dot);
+    }
+
+    // Replaces the open file with a fresh one at opts_.path. Returns false,
+    // keeping the open file and errno, if it cannot be created.
+    bool openFile() {
+        int fd = ::open(opts_.path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) return false;
+        if (fd_ >= 0) ::close(fd_);
+        fd_ = fd;
+        fileOpened_ = Clock::now();
+        fileBytes_  = 0;
+        if (!opts_.header.empty()) {
+            writeAll(opts_.header.data(), opts_.header.size());
+            fileBytes_ += opts_.header.size();
+        }
+        return true;
+    }
+
+    TelemetryOptions opts_;
+    Formatter        format_;
+    size_t           maxLine_;
+    TelemetryTap<Record>* tap_;
+    TelemetryStats   stats_;
+
+    struct Lane {
+        alignas(CACHE_LINE) std::atomic<uint64_t> head{0};
+        uint64_t cachedTail = 0;                // producer's view of tail
+        alignas(CACHE_LINE) std::atomic<uint64_t> tail{0};
+        std::vector<Record> slots;
+    };
+
+    std::vector<std::unique_ptr<Lane>> lanes_;
+    size_t            mask_;
+    std::atomic<bool> stopping_{false};
+
+    // background thread only
+    std::vector<char>  out_;
+    size_t             used_       = 0;
+    int                fd_         = -1;
+    uint64_t           fileBytes_  = 0;
+    Clock::time_point  fileOpened_;
+    int                rotationSeq_ = 1;
+    std::thread        thread_;
+};
@@ -0,0 +1,622 @@
+#pragma once
+
+// The top of each book over UDP, unicast or multicast, for dashboards,
+// wall displays and small devices (the roadmap's ESP32) on other hosts.
+//
+// Engine workers post each book's latest state into a per-book seqlock
+// slot, as shm_book.h does, and return. A background thread samples the
+// slots once per conflation interval and sends one datagram for each book
+// that changed since its last frame. So the wire carries at most
+// books x 1000 / interval frames a second, whatever the feed rate.
+//
+// A frame is a UdpFrameHeader followed by the book's fields:
+//   FULL   the symbol, the decimals, then every field
+//   DELTA  a 64-bit mask of the fields that changed, then their changes
+// A book is a fixed list of integer fields (udpToFields): the touch, the
+// top UDP_LEVELS levels a side, imbalance and aggression, the nearest
+// walls and the latest wall event. Each level's price is stored as its
+// distance from the level before it, so a book that shifts by a tick
+// changes two fields rather than twenty. Ratios are sent in millionths.
+// Values and changes are zigzag varints, so a frame where only a few
+// levels moved is a few dozen bytes. Byte order is little-endian, as on
+// x86-64, ARM and the ESP32.
+//
+// Sequence numbers run per book, and a DELTA applies only to the frame
+// just before it. A receiver that misses a frame counts the loss and
+// ignores the book's DELTAs until its next FULL frame. FULL frames go out
+// every full-refresh interval whether or not the book changed.
+//
+// Like shm_book.h this header needs nothing else from the engine:
+//
+//   UdpReceiver rx("239.10.10.1:9100");   // or "9100" for unicast
+//   while (true) {
+//       rx.poll(100);
+//       for (int i = 0; i < rx.numBooks(); i++)
+//           if (rx.has(i)) show(rx.book(i).symbol, rx.book(i).bestBid, rx.book(i).imbalance);
+//   }
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "udp_feed.h writes frames in host order and needs a little-endian host"
+#endif
+
+const uint16_t UDP_MAGIC        = 0x5550;   // "PU"
+const uint8_t  UDP_VERSION      = 1;
+const int      UDP_LEVELS       = 10;       // per side
+const int      UDP_SYMBOL_CHARS = 16;
+
+enum UdpFrameKind : uint8_t { UDP_FULL = 1, UDP_DELTA = 2 };
+
+// The latest wall event's type on the wire.
+enum UdpWallEvent : uint8_t { UDP_WALL_NONE, UDP_WALL_APPEARED, UDP_WALL_PULLED, UDP_WALL_FILLED };
+
+struct UdpLevel {
+    int64_t price;   // ticks
+    int64_t qty;     // lots
+};
+
+// One book as a receiver rebuilds it. Prices in ticks and sizes in lots at
+// the instrument's scale, as in ShmBook.
+struct UdpBook {
+    char     symbol[UDP_SYMBOL_CHARS];
+    int32_t  priceDecimals;
+    int32_t  qtyDecimals;
+    uint64_t updateCount;
+    int64_t  eventTimeMs;       // exchange time of the last diff
+    int64_t  bestBid;           // 0 when the side is empty
+    int64_t  bestAsk;
+    int32_t  numBids;
+    int32_t  numAsks;
+    UdpLevel bids[UDP_LEVELS];  // best first
+    UdpLevel asks[UDP_LEVELS];
+
+    double   imbalance;         // top-of-book bid / (bid + ask)
+    double   aggressionRatio;   // aggressive buys / all aggressive, recent window
+    int64_t  buyAggression;
+    int64_t  sellAggression;
+    UdpLevel nearestBidWall;    // price 0 when none in range
+    UdpLevel nearestAskWall;
+    int32_t  liveWalls;
+    uint8_t  wallEvent;         // UdpWallEvent, with its side, price, size and time below
+    uint8_t  wallEventBid;
+    int64_t  wallEventPrice;
+    int64_t  wallEventQty;
+    int64_t  wallEventTimeMs;
+};
+
+#pragma pack(push, 1)
+struct UdpFrameHeader {
+    uint16_t magic;
+    uint8_t  version;
+    uint8_t  kind;       // UdpFrameKind
+    uint16_t book;       // index in the publisher's book list
+    uint16_t numBooks;
+    uint32_t session;    // random per publisher run
+    uint32_t seq;        // per book, from 1
+};
+#pragma pack(pop)
+
+const int    UDP_SCALAR_FIELDS = 20;
+const int    UDP_FIELDS        = UDP_SCALAR_FIELDS + 4 * UDP_LEVELS;
+const size_t UDP_MAX_FRAME     = sizeof(UdpFrameHeader) + UDP_SYMBOL_CHARS + 2 + 8 + 10 * UDP_FIELDS;
+static_assert(UDP_FIELDS <= 64, "a DELTA's field mask is 64 bits");
+
+namespace udp_wire {
+
+inline uint64_t zigzag(int64_t v)   { return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63); }
+inline int64_t  unzigzag(uint64_t v) { return (int64_t)(v >> 1) ^ -(int64_t)(v & 1); }
+
+inline uint8_t* putVarint(uint8_t* p, uint64_t v) {
+    while (v >= 0x80) {
+        *p++ = (uint8_t)(v | 0x80);
+        v >>= 7;
+    }
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+// null on a truncated or overlong varint
+inline const uint8_t* getVarint(const uint8_t* p, const uint8_t* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; shift < 64 && p < end; shift += 7) {
+        uint8_t b = *p++;
+        v |= (uint64_t)(b & 0x7f) << shift;
+        if (!(b & 0x80)) return p;
+    }
+    return nullptr;
+}
+
+inline int64_t toMillionths(double r)   { return std::isfinite(r) ? std::llround(r * 1e6) : 0; }
+inline double  fromMillionths(int64_t v) { return (double)v / 1e6; }
+
+} // namespace udp_wire
+
+// The fields a frame carries, in wire order. Levels past numBids/numAsks
+// are zero.
+inline void udpToFields(const UdpBook& b, int64_t* f) {
+    using namespace udp_wire;
+    int64_t scalars[UDP_SCALAR_FIELDS] = {
+        (int64_t)b.updateCount, b.eventTimeMs, b.bestBid, b.bestAsk, b.numBids, b.numAsks,
+        toMillionths(b.imbalance), toMillionths(b.aggressionRatio), b.buyAggression, b.sellAggression,
+        b.nearestBidWall.price, b.nearestBidWall.qty, b.nearestAskWall.price, b.nearestAskWall.qty,
+        b.liveWalls, b.wallEvent, b.wallEventBid, b.wallEventPrice, b.wallEventQty, b.wallEventTimeMs,
+    };
+    memcpy(f, scalars, sizeof(scalars));
+    f += UDP_SCALAR_FIELDS;
+    for (int i = 0; i < UDP_LEVELS; i++) {
+        bool has = i < b.numBids;
+        *f++ = has ? (i ? b.bids[i - 1].price : b.bestBid) - b.bids[i].price : 0;
+        *f++ = has ? b.bids[i].qty : 0;
+    }
+    for (int i = 0; i < UDP_LEVELS; i++) {
+        bool has = i < b.numAsks;
+        *f++ = has ? b.asks[i].price - (i ? b.asks[i - 1].price : b.bestAsk) : 0;
+        *f++ = has ? b.asks[i].qty : 0;
+    }
+}
+
+// The inverse; symbol and decimals come from the FULL frame.
+inline void udpFromFields(const int64_t* f, UdpBook& b) {
+    using namespace udp_wire;
+    b.updateCount     = (uint64_t)f[0];
+    b.eventTimeMs     = f[1];
+    b.bestBid         = f[2];
+    b.bestAsk         = f[3];
+    b.numBids         = (int32_t)std::min<int64_t>(std::max<int64_t>(f[4], 0), UDP_LEVELS);
+    b.numAsks         = (int32_t)std::min<int64_t>(std::max<int64_t>(f[5], 0), UDP_LEVELS);
+    b.imbalance       = fromMillionths(f[6]);
+    b.aggressionRatio = fromMillionths(f[7]);
+    b.buyAggression   = f[8];
+    b.sellAggression  = f[9];
+    b.nearestBidWall  = {f[10], f[11]};
+    b.nearestAskWall  = {f[12], f[13]};
+    b.liveWalls       = (int32_t)f[14];
+    b.wallEvent       = (uint8_t)f[15];
+    b.wallEventBid    = (uint8_t)f[16];
+    b.wallEventPrice  = f[17];
+    b.wallEventQty    = f[18];
+    b.wallEventTimeMs = f[19];
+    f += UDP_SCALAR_FIELDS;
+    for (int i = 0; i < UDP_LEVELS; i++, f += 2) {
+        bool has = i < b.numBids;
+        b.bids[i].price = has ? (i ? b.bids[i - 1].price : b.bestBid) - f[0] : 0;
+        b.bids[i].qty   = has ? f[1] : 0;
+    }
+    for (int i = 0; i < UDP_LEVELS; i++, f += 2) {
+        bool has = i < b.numAsks;
+        b.asks[i].price = has ? (i ? b.asks[i - 1].price : b.bestAsk) + f[0] : 0;
+        b.asks[i].qty   = has ? f[1] : 0;
+    }
+}
+
+// ===== FRAMES =====
+// Frames for one publisher's books: per book, the fields last sent and the
+// sequence number.
+class UdpEncoder {
+public:
+    UdpEncoder(int numBooks, uint32_t session)
+        : session_(session), sent_(numBooks), seq_(numBooks, 0) {}
+
+    // Writes book i's next frame to out, which has room for UDP_MAX_FRAME
+    // bytes, and returns its length. A book's first frame is always FULL.
+    // A DELTA with no field changed is not written: returns 0.
+    size_t encode(int i, const UdpBook& b, bool full, uint8_t* out) {
+        using namespace udp_wire;
+        int64_t f[UDP_FIELDS];
+        udpToFields(b, f);
+        Sent& last = sent_[i];
+        full = full || seq_[i] == 0;
+
+        uint64_t mask = 0;
+        if (!full) {
+            for (int k = 0; k < UDP_FIELDS; k++) mask |= (uint64_t)(f[k] != last.fields[k]) << k;
+            if (!mask) return 0;
+        }
+
+        UdpFrameHeader h = {UDP_MAGIC, UDP_VERSION, (uint8_t)(full ? UDP_FULL : UDP_DELTA), (uint16_t)i,
+                            (uint16_t)sent_.size(), session_, ++seq_[i]};
+        memcpy(out, &h, sizeof(h));
+        uint8_t* p = out + sizeof(h);
+        if (full) {
+            memcpy(p, b.symbol, UDP_SYMBOL_CHARS);
+            p += UDP_SYMBOL_CHARS;
+            *p++ = (uint8_t)b.priceDecimals;
+            *p++ = (uint8_t)b.qtyDecimals;
+            for (int k = 0; k < UDP_FIELDS; k++) p = putVarint(p, zigzag(f[k]));
+        } else {
+            memcpy(p, &mask, 8);
+            p += 8;
+            for (int k = 0; k < UDP_FIELDS; k++)
+                if (mask >> k & 1) p = putVarint(p, zigzag((int64_t)((uint64_t)f[k] - (uint64_t)last.fields[k])));
+        }
+        memcpy(last.fields, f, sizeof(f));
+        return p - out;
+    }
+
+    uint32_t session() const { return session_; }
+
+private:
+    struct Sent {
+        int64_t fields[UDP_FIELDS] = {};
+    };
+    uint32_t              session_;
+    std::vector<Sent>     sent_;
+    std::vector<uint32_t> seq_;
+};
+
+struct UdpReceiveStats {
+    uint64_t datagrams   = 0;
+    uint64_t bytes       = 0;
+    uint64_t fullFrames  = 0;
+    uint64_t deltaFrames = 0;   // applied
+    uint64_t lost        = 0;   // frames missing from the sequence
+    uint64_t skipped     = 0;   // DELTAs with no base to apply to
+    uint64_t late        = 0;   // duplicate or out of order
+    uint64_t malformed   = 0;
+    uint64_t restarts    = 0;   // the publisher's session changed
+};
+
+// Rebuilds books from frames. Keeps no socket, so it also runs where the
+// frames arrive some other way.
+class UdpDecoder {
+public:
+    // The book index the frame updated, or -1.
+    int apply(const uint8_t* data, size_t n) {
+        using namespace udp_wire;
+        stats_.datagrams++;
+        stats_.bytes += n;
+        UdpFrameHeader h;
+        if (n < sizeof(h)) return malformed();
+        memcpy(&h, data, sizeof(h));
+        if (h.magic != UDP_MAGIC || h.version != UDP_VERSION || h.book >= h.numBooks ||
+            (h.kind != UDP_FULL && h.kind != UDP_DELTA))
+            return malformed();
+        if (h.session != session_) {
+            if (!books_.empty()) stats_.restarts++;
+            books_.clear();
+            session_ = h.session;
+        }
+        if (books_.size() < h.numBooks) books_.resize(h.numBooks);
+        State& s = books_[h.book];
+
+        if (s.seq && h.seq <= s.seq) {
+            stats_.late++;
+            return -1;
+        }
+        if (s.seq) stats_.lost += h.seq - s.seq - 1;
+        bool continues = s.valid && h.seq == s.seq + 1;
+        s.seq = h.seq;
+
+        const uint8_t* p   = data + sizeof(h);
+        const uint8_t* end = data + n;
+        int64_t f[UDP_FIELDS];
+        if (h.kind == UDP_FULL) {
+            if (end - p < UDP_SYMBOL_CHARS + 2) return invalidate(s);
+            memcpy(s.book.symbol, p, UDP_SYMBOL_CHARS);
+            s.book.symbol[UDP_SYMBOL_CHARS - 1] = '\0';
+            p += UDP_SYMBOL_CHARS;
+            s.book.priceDecimals = *p++;
+            s.book.qtyDecimals   = *p++;
+            for (int k = 0; k < UDP_FIELDS; k++) {
+                uint64_t v;
+                if (!(p = getVarint(p, end, v))) return invalidate(s);
+                f[k] = unzigzag(v);
+            }
+            stats_.fullFrames++;
+        } else {
+            if (!continues) {
+                stats_.skipped++;
+                s.valid = false;
+                return -1;
+            }
+            uint64_t mask;
+            if (end - p < 8) return invalidate(s);
+            memcpy(&mask, p, 8);
+            p += 8;
+            memcpy(f, s.fields, sizeof(f));
+            for (int k = 0; k < UDP_FIELDS; k++) {
+                if (!(mask >> k & 1)) continue;
+                uint64_t v;
+                if (!(p = getVarint(p, end, v))) return invalidate(s);
+                f[k] = (int64_t)((uint64_t)f[k] + (uint64_t)unzigzag(v));
+            }
+            stats_.deltaFrames++;
+        }
+        memcpy(s.fields, f, sizeof(f));
+        udpFromFields(f, s.book);
+        s.valid = true;
+        return h.book;
+    }
+
+    int numBooks() const { return (int)books_.size(); }
+
+    // Book i holds a whole frame's state: a FULL frame and every DELTA
+    // since.
+    bool           has(int i) const  { return i < numBooks() && books_[i].valid; }
+    const UdpBook& book(int i) const { return books_[i].book; }
+    uint32_t       seq(int i) const  { return books_[i].seq; }
+
+    // -1 if no FULL frame of symbol has arrived yet
+    int find(const std::string& symbol) const {
+        for (int i = 0; i < numBooks(); i++)
+            if (books_[i].seq && strncmp(books_[i].book.symbol, symbol.c_str(), UDP_SYMBOL_CHARS) == 0) return i;
+        return -1;
+    }
+
+    const UdpReceiveStats& stats() const { return stats_; }
+
+private:
+    struct State {
+        UdpBook  book = {};
+        int64_t  fields[UDP_FIELDS] = {};
+        uint32_t seq   = 0;
+        bool     valid = false;
+    };
+
+    int malformed() {
+        stats_.malformed++;
+        return -1;
+    }
+    int invalidate(State& s) {
+        s.valid = false;
+        return malformed();
+    }
+
+    std::vector<State> books_;
+    uint32_t           session_ = 0;
+    UdpReceiveStats    stats_;
+};
+
+// ===== SOCKETS =====
+// "host:port" or, for a receiver, "port" alone. The host is a name or an
+// IPv4 address; a multicast group address makes the socket multicast.
+inline sockaddr_in udpAddress(const std::string& text, bool needHost) {
+    size_t colon = text.rfind(':');
+    std::string host = colon == std::string::npos ? "" : text.substr(0, colon);
+    std::string port = colon == std::string::npos ? text : text.substr(colon + 1);
+    int p = atoi(port.c_str());
+    if (p <= 0 || p > 65535 || (needHost && host.empty()))
+        throw std::runtime_error("bad UDP address " + text + ", want host:port");
+
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_port   = htons((uint16_t)p);
+    a.sin_addr.s_addr = htonl(INADDR_ANY);
+    if (!host.empty() && inet_pton(AF_INET, host.c_str(), &a.sin_addr) != 1) {
+        addrinfo hints = {}, *res = nullptr;
+        hints.ai_family   = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        if (getaddrinfo(host.c_str(), nullptr, &hints, &res) != 0 || !res)
+            throw std::runtime_error("cannot resolve " + host);
+        a.sin_addr = reinterpret_cast<sockaddr_in*>(res->ai_addr)->sin_addr;
+        freeaddrinfo(res);
+    }
+    return a;
+}
+
+inline bool udpIsMulticast(const sockaddr_in& a) { return IN_MULTICAST(ntohl(a.sin_addr.s_addr)); }
+
+// ===== PUBLISHER =====
+struct UdpStats {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> fullFrames{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> bytesPerSec{0};   // over the last second
+    std::atomic<uint64_t> posts{0};         // book states the workers handed over
+    std::atomic<uint64_t> sendErrors{0};
+    std::atomic<uint64_t> dropped{0};       // left unsent by dropEvery
+};
+
+struct UdpOptions {
+    std::string destination;          // host:port, unicast or a multicast group
+    int         intervalMs    = 100;  // conflation: one frame per changed book per interval
+    int         fullEveryMs   = 1000; // FULL frame per book at least this often
+    int         ttl           = 1;    // multicast hops
+    // Drops every n-th datagram instead of sending it, to exercise
+    // receivers' recovery; 0 sends everything.
+    int         dropEvery     = 0;
+};
+
+// Each book's slot is written from one thread (the worker that owns it).
+class UdpPublisher {
+public:
+    UdpPublisher(const UdpOptions& opts, int numBooks)
+        : opts_(opts), dest_(udpAddress(opts.destination, true)), slots_(numBooks),
+          encoder_(numBooks, std::random_device{}() | 1) {
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) throw std::runtime_error("cannot open a UDP socket");
+        if (udpIsMulticast(dest_)) {
+            unsigned char ttl = (unsigned char)opts_.ttl, loop = 1;
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+            setsockopt(fd_, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+        }
+        thread_ = std::thread([this] { run(); });
+    }
+
+    ~UdpPublisher() {
+        close();
+        ::close(fd_);
+    }
+
+    UdpPublisher(const UdpPublisher&) = delete;
+    UdpPublisher& operator=(const UdpPublisher&) = delete;
+
+    // Hot path: book i's latest state. One memcpy between two stores.
+    void post(int i, const UdpBook& b) {
+        Slot& s = slots_[i];
+        uint64_t seq = s.seq.load(std::memory_order_relaxed);
+        s.seq.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        memcpy(&s.book, &b, sizeof(UdpBook));
+        s.seq.store(seq + 2, std::memory_order_release);
+        stats_.posts.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    // Sends every book one last time as a FULL frame, never dropped, so a
+    // receiver ends level with the source and sees every earlier drop as a
+    // gap; then stops the thread.
+    void close() {
+        if (!thread_.joinable()) return;
+        stopping_.store(true, std::memory_order_release);
+        thread_.join();
+    }
+
+    const UdpStats&    stats() const       { return stats_; }
+    const UdpOptions&  options() const     { return opts_; }
+    bool               multicast() const   { return udpIsMulticast(dest_); }
+
+private:
+    struct alignas(64) Slot {
+        std::atomic<uint64_t> seq{0};   // odd while being written
+        UdpBook               book;
+    };
+
+    typedef std::chrono::steady_clock Clock;
+
+    void run() {
+        std::vector<uint64_t>          sentVersion(slots_.size(), 0);
+        std::vector<Clock::time_point> lastFull(slots_.size());
+        std::vector<uint8_t>           frame(UDP_MAX_FRAME);
+        auto interval  = std::chrono::milliseconds(std::max(1, opts_.intervalMs));
+        auto fullEvery = std::chrono::milliseconds(std::max(opts_.intervalMs, opts_.fullEveryMs));
+        auto next = Clock::now(), rateStart = next;
+        uint64_t rateBytes = 0, datagrams = 0;
+        bool last = false;
+
+        while (!last) {
+            last = stopping_.load(std::memory_order_acquire);
+            auto now = Clock::now();
+            for (size_t i = 0; i < slots_.size(); i++) {
+                uint64_t version = slots_[i].seq.load(std::memory_order_acquire);
+                if (version == 0) continue;   // nothing posted yet
+                bool full = last || now - lastFull[i] >= fullEvery;
+                if (version == sentVersion[i] && !full) continue;
+                UdpBook b;
+                if (!read(slots_[i], b, version)) continue;   // mid-write: next interval
+                size_t n = encoder_.encode((int)i, b, full, frame.data());
+                sentVersion[i] = version;
+                if (full) lastFull[i] = now;
+                if (n == 0) continue;
+                datagrams++;
+                bool drop = !last && opts_.dropEvery > 0 && datagrams % opts_.dropEvery == 0;
+                if (drop) stats_.dropped.fetch_add(1, std::memory_order_relaxed);
+                if (!drop && sendto(fd_, frame.data(), n, MSG_DONTWAIT, reinterpret_cast<const sockaddr*>(&dest_),
+                                    sizeof(dest_)) != (ssize_t)n) {
+                    stats_.sendErrors.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                // a frame dropped on purpose still counts as sent
+                stats_.frames.fetch_add(1, std::memory_order_relaxed);
+                if (full) stats_.fullFrames.fetch_add(1, std::memory_order_relaxed);
+                stats_.bytes.fetch_add(n, std::memory_order_relaxed);
+                rateBytes += n;
+            }
+            if (now - rateStart >= std::chrono::seconds(1)) {
+                stats_.bytesPerSec.store(rateBytes * 1000 /
+                    std::max<int64_t>(1, std::chrono::duration_cast<std::chrono::milliseconds>(now - rateStart).count()),
+                    std::memory_order_relaxed);
+                rateBytes = 0;
+                rateStart = now;
+            }
+            next += interval;
+            if (next < Clock::now()) next = Clock::now();
+            while (!last && !stopping_.load(std::memory_order_acquire) && Clock::now() < next)
+                std::this_thread::sleep_for(std::min<Clock::duration>(next - Clock::now(), std::chrono::milliseconds(20)));
+        }
+    }
+
+    // The copy of s made while its sequence was the even `version`.
+    static bool read(const Slot& s, UdpBook& out, uint64_t version) {
+        if (version & 1) return false;
+        memcpy(&out, &s.book, sizeof(UdpBook));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return s.seq.load(std::memory_order_relaxed) == version;
+    }
+
+    UdpOptions        opts_;
+    sockaddr_in       dest_;
+    std::vector<Slot> slots_;
+    UdpEncoder        encoder_;
+    UdpStats          stats_;
+    int               fd_ = -1;
+    std::atomic<bool> stopping_{false};
+    std::thread       thread_;
+};
+
+// ===== RECEIVER =====
+class UdpReceiver {
+public:
+    // "port" for unicast, or "group:port" to join a multicast group.
+    explicit UdpReceiver(const std::string& listen) {
+        sockaddr_in a = udpAddress(listen, false);
+        bool group = udpIsMulticast(a);
+        fd_ = socket(AF_INET, SOCK_DGRAM, 0);
+        if (fd_ < 0) throw std::runtime_error("cannot open a UDP socket");
+        int one = 1, rcvbuf = 1 << 20;
+        setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        setsockopt(fd_, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+        // a group is joined below; the socket itself listens on every interface
+        sockaddr_in bindTo = a;
+        if (group) bindTo.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (bind(fd_, reinterpret_cast<sockaddr*>(&bindTo), sizeof(bindTo)) != 0) {
+            ::close(fd_);
+            throw std::runtime_error("cannot bind UDP " + listen + ": " + strerror(errno));
+        }
+        if (group) {
+            ip_mreq m = {};
+            m.imr_multiaddr        = a.sin_addr;
+            m.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (setsockopt(fd_, IPPROTO_IP, IP_ADD_MEMBERSHIP, &m, sizeof(m)) != 0) {
+                ::close(fd_);
+                throw std::runtime_error("cannot join multicast group " + listen + ": " + strerror(errno));
+            }
+        }
+    }
+
+    ~UdpReceiver() { ::close(fd_); }
+
+    UdpReceiver(const UdpReceiver&) = delete;
+    UdpReceiver& operator=(const UdpReceiver&) = delete;
+
+    // Waits up to timeoutMs for a datagram, then applies every one queued.
+    // Returns the number of frames applied.
+    int poll(int timeoutMs) {
+        pollfd p = {fd_, POLLIN, 0};
+        if (::poll(&p, 1, timeoutMs) <= 0) return 0;
+        int applied = 0;
+        uint8_t buf[2048];
+        ssize_t n;
+        while ((n = recv(fd_, buf, sizeof(buf), MSG_DONTWAIT)) > 0)
+            applied += decoder_.apply(buf, (size_t)n) >= 0;
+        return applied;
+    }
+
+    int                    numBooks() const                 { return decoder_.numBooks(); }
+    bool                   has(int i) const                 { return decoder_.has(i); }
+    const UdpBook&         book(int i) const                { return decoder_.book(i); }
+    int                    find(const std::string& s) const { return decoder_.find(s); }
+    const UdpReceiveStats& stats() const                    { return decoder_.stats(); }
+
+private:
+    int        fd_ = -1;
+    UdpDecoder decoder_;
+};
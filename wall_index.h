@@ -0,0 +1,142 @@
+#pragma once
+
+// The walls on one side of the book, ordered by tick, with the life of each
+// one: when it appeared, the most size it showed, and how it ended.
+//
+// Nearest-to-mid and nearest-K-from-the-touch lookups are a map descent
+// plus K steps, so they no longer grow with the number of walls a session
+// has seen. Walls further than a keep range from the mid are pruned, which
+// bounds memory; one that is touched again while still at wall size is
+// re-admitted with a fresh appear time. The map's nodes come from a pool
+// of its own (node_pool.h), so a wall coming and going allocates nothing.
+//
+// A wall that drops below the threshold with no better level resting in
+// front of it went at the touch, most likely filled. One that goes while
+// other levels still sit between it and the spread was pulled, which is
+// what spoofing looks like. WallStats keeps counts and lifetimes of both.
+
+#include <cstdint>
+#include <cstdlib>
+#include <map>
+#include <iterator>
+#include "fixed_point.h"
+#include "node_pool.h"
+
+struct WallInfo {
+    Ticks   price;
+    Lots    qty;
+    Lots    peakQty;
+    int64_t appearedMs;
+};
+
+struct WallStats {
+    long long appeared   = 0;
+    long long filled     = 0;   // went at the touch
+    long long pulled     = 0;   // went from behind other levels
+    long long pruned     = 0;   // dropped for being too far from mid
+    int64_t   filledLifeMs = 0; // summed lifetimes
+    int64_t   pulledLifeMs = 0;
+};
+
+class WallIndex {
+public:
+    size_t size() const { return walls_.size(); }
+    const WallStats& stats() const { return stats_; }
+
+    // A level crossed up through the threshold.
+    void appear(Ticks price, Lots qty, int64_t nowMs) {
+        walls_[price] = {qty, qty, nowMs};
+        stats_.appeared++;
+    }
+
+    // A level already at wall size changed but stayed above the threshold.
+    void resize(Ticks price, Lots qty, int64_t nowMs) {
+        auto it = walls_.find(price);
+        if (it == walls_.end()) {
+            walls_.emplace(price, Entry{qty, qty, nowMs});   // pruned earlier
+            return;
+        }
+        it->second.qty = qty;
+        if (qty > it->second.peakQty) it->second.peakQty = qty;
+    }
+
+    // A level dropped below the threshold; atTouch says nothing better was
+    // resting in front of it. Returns the wall's lifetime, or -1 if it had
+    // been pruned.
+    int64_t disappear(Ticks price, bool atTouch, int64_t nowMs) {
+        auto it = walls_.find(price);
+        if (it == walls_.end()) return -1;
+        int64_t life = nowMs > it->second.appearedMs ? nowMs - it->second.appearedMs : 0;
+        if (atTouch) { stats_.filled++; stats_.filledLifeMs += life; }
+        else         { stats_.pulled++; stats_.pulledLifeMs += life; }
+        walls_.erase(it);
+        return life;
+    }
+
+    // Wall closest to the mid within range ticks of it (distances compared
+    // doubled, against the doubled mid), or {0, 0, ...}.
+    WallInfo nearest(Ticks midTicks2, Ticks range) const {
+        WallInfo best = {0, 0, 0, 0};
+        Ticks bestDist = 0;
+        auto it = walls_.lower_bound((midTicks2 + 1) / 2);
+        auto consider = [&](Walls::const_iterator w) {
+            Ticks dist = llabs(2 * w->first - midTicks2);
+            if (dist < 2 * range && (best.price == 0 || dist < bestDist)) {
+                best = info(w);
+                bestDist = dist;
+            }
+        };
+        if (it != walls_.begin()) consider(std::prev(it));
+        if (it != walls_.end()) consider(it);
+        return best;
+    }
+
+    // Up to k walls at or below from, highest first (bids from the best bid).
+    int below(Ticks from, WallInfo* out, int k) const {
+        int n = 0;
+        for (auto it = walls_.upper_bound(from); it != walls_.begin() && n < k;)
+            out[n++] = info(--it);
+        return n;
+    }
+
+    // Up to k walls at or above from, lowest first (asks from the best ask).
+    int above(Ticks from, WallInfo* out, int k) const {
+        int n = 0;
+        for (auto it = walls_.lower_bound(from); it != walls_.end() && n < k; ++it)
+            out[n++] = info(it);
+        return n;
+    }
+
+    // Forgets walls outside [lo, hi].
+    void prune(Ticks lo, Ticks hi) {
+        auto first = walls_.lower_bound(lo);
+        stats_.pruned += std::distance(walls_.begin(), first);
+        walls_.erase(walls_.begin(), first);
+        auto last = walls_.upper_bound(hi);
+        stats_.pruned += std::distance(last, walls_.end());
+        walls_.erase(last, walls_.end());
+    }
+
+    // Book reset: the walls go, the session's statistics stay.
+    void clear() { walls_.clear(); }
+
+    // Warm restart (book_engine's restoreCheckpoint): puts back walls and
+    // statistics exactly as saved.
+    void restore(const WallInfo& w) { walls_[w.price] = {w.qty, w.peakQty, w.appearedMs}; }
+    void restoreStats(const WallStats& s) { stats_ = s; }
+
+private:
+    struct Entry {
+        Lots    qty;
+        Lots    peakQty;
+        int64_t appearedMs;
+    };
+    typedef std::map<Ticks, Entry, std::less<Ticks>, PoolAllocator<std::pair<const Ticks, Entry>>> Walls;
+
+    static WallInfo info(Walls::const_iterator it) {
+        return {it->first, it->second.qty, it->second.peakQty, it->second.appearedMs};
+    }
+
+    Walls     walls_;
+    WallStats stats_;
+};
@@ -0,0 +1,331 @@
+#pragma once
+
+// The live WebSocket reader: one TLS connection to the exchange, read
+// asynchronously on a single io_context, with every frame handed to the
+// caller in place.
+//
+// The frame buffer is sized once (ReaderOptions::bufferBytes) and kept for
+// the life of the reader, across reconnects, so a steady stream of frames
+// allocates nothing. Socket buffer sizes are applied before connect so the
+// kernel can scale the TCP window to them; TCP_NODELAY and SO_BUSY_POLL
+// (Linux) after. A dropped connection is retried after an exponential
+// backoff with jitter, reset once a connection delivers its first frame,
+// so a flapping exchange is not hammered and many clients do not retry in
+// lockstep.
+//
+// Several readers can share one io_context (and so one thread); redundant
+// connections to the same stream are built that way, each preferring a
+// different resolved address (ReaderOptions::endpoint). Connection setup
+// is asynchronous too, so one leg reconnecting never stalls the others'
+// reads. Setup as a whole must finish within connectTimeoutMs. A watchdog
+// that wakes every idleTimeoutMs / 2 pings a connection it has heard
+// nothing from and drops one that is still silent at the next wake, pong
+// included, so a half-open leg is noticed rather than waited on forever.
+// It only reads a flag the frame path sets, so reads stay allocation-free.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include <boost/beast/core.hpp>
+#include <boost/beast/websocket.hpp>
+#include <boost/beast/ssl.hpp>
+#include <boost/asio/ip/tcp.hpp>
+#include <boost/asio/ssl.hpp>
+#include <boost/asio/ssl/host_name_verification.hpp>
+#include <boost/asio/steady_timer.hpp>
+#ifdef __linux__
+#include <sys/socket.h>
+#endif
+#include "cycle_clock.h"
+
+struct ReaderOptions {
+    std::string host = "stream.binance.com";
+    std::string port = "9443";
+    bool   tcpNoDelay  = true;
+    int    busyPollUs  = 0;          // SO_BUSY_POLL; 0 leaves it off
+    int    rcvBufBytes = 0;          // SO_RCVBUF; 0 keeps the kernel default
+    int    sndBufBytes = 0;          // SO_SNDBUF
+    size_t bufferBytes = 1 << 20;    // frame buffer, reserved up front
+    int    endpoint    = 0;          // resolved address to try first (mod count)
+    int    backoffMinMs = 250;
+    int    backoffMaxMs = 30000;
+    int    connectTimeoutMs = 10000; // resolve through the WebSocket handshake
+    int    idleTimeoutMs    = 10000; // silence, pings unanswered included
+    bool   verifyPeer       = true;  // certificate chain and host name; off for a self-signed stand-in
+};
+
+// Exponential backoff with "equal jitter": the n-th delay is uniform in
+// [d/2, d] where d = min(max, min * 2^n).
+class Backoff {
+public:
+    Backoff(int minMs, int maxMs, uint64_t seed = std::random_device{}())
+        : minMs_(minMs), maxMs_(maxMs), rng_(seed) {}
+
+    int next() {
+        long long d = minMs_;
+        for (int i = 0; i < attempt_ && d < maxMs_; i++) d *= 2;
+        if (d > maxMs_) d = maxMs_;
+        attempt_++;
+        return (int)(d / 2 + (long long)(rng_() % (uint64_t)(d / 2 + 1)));
+    }
+
+    void reset()         { attempt_ = 0; }
+    int  attempts() const { return attempt_; }
+
+private:
+    int minMs_, maxMs_;
+    int attempt_ = 0;
+    std::mt19937_64 rng_;
+};
+
+struct ReaderStats {
+    std::atomic<uint64_t> frames{0};
+    std::atomic<uint64_t> bytes{0};
+    std::atomic<uint64_t> connects{0};
+    std::atomic<uint64_t> disconnects{0};
+    std::atomic<int>      lastBackoffMs{0};
+};
+
+class WsReader {
+public:
+    // onFrame(recvCycles, data, len): data is valid only during the call.
+    using FrameFn      = std::function<void(uint64_t, const char*, size_t)>;
+    using ConnectFn    = std::function<void()>;
+    using DisconnectFn = std::function<void(const std::string& why, int retryMs)>;
+
+    // A reader with its own io_context, driven by run().
+    WsReader(const ReaderOptions& opts, std::string target, FrameFn onFrame,
+             ConnectFn onConnect = nullptr, DisconnectFn onDisconnect = nullptr)
+        : WsReader(new boost::asio::io_context, true, opts, std::move(target), std::move(onFrame),
+                   std::move(onConnect), std::move(onDisconnect)) {}
+
+    // A reader on the caller's io_context: start() it, then run the context.
+    WsReader(boost::asio::io_context& ioc, const ReaderOptions& opts, std::string target,
+             FrameFn onFrame, ConnectFn onConnect = nullptr, DisconnectFn onDisconnect = nullptr)
+        : WsReader(&ioc, false, opts, std::move(target), std::move(onFrame),
+                   std::move(onConnect), std::move(onDisconnect)) {}
+
+    const ReaderStats& stats() const { return stats_; }
+
+    // Connects, or schedules a retry; frames arrive once the io_context runs.
+    void start() { connect(); }
+
+    // Connects and reads until stop(); reconnects on any failure.
+    void run() {
+        start();
+        ioc_.run();
+    }
+
+    // Safe from any thread. Stops the whole io_context, so readers sharing
+    // it stop together; run() returns soon after.
+    void stop() {
+        stopping_.store(true);
+        ioc_.stop();
+    }
+
+private:
+    using tcp    = boost::asio::ip::tcp;
+    using Stream = boost::beast::websocket::stream<boost::beast::ssl_stream<tcp::socket>>;
+
+    WsReader(boost::asio::io_context* ioc, bool owned, const ReaderOptions& opts, std::string target,
+             FrameFn onFrame, ConnectFn onConnect, DisconnectFn onDisconnect)
+        : opts_(opts), target_(std::move(target)), onFrame_(std::move(onFrame)),
+          onConnect_(std::move(onConnect)), onDisconnect_(std::move(onDisconnect)),
+          ownIoc_(owned ? ioc : nullptr), ioc_(*ioc),
+          ssl_(boost::asio::ssl::context::tlsv12_client), resolver_(ioc_), timer_(ioc_), watchdog_(ioc_),
+          backoff_(opts.backoffMinMs, opts.backoffMaxMs) {
+        ssl_.set_default_verify_paths();
+        ssl_.set_verify_mode(opts_.verifyPeer ? boost::asio::ssl::verify_peer : boost::asio::ssl::verify_none);
+        buffer_.reserve(opts_.bufferBytes);
+    }
+
+    // resolve -> connect (each address in turn) -> TLS -> WebSocket, every
+    // step a callback on the shared io_context. timer_ is the deadline for
+    // the lot; on expiry it closes the socket and the pending step fails.
+    void connect() {
+        attempt_++;
+        connecting_ = true;
+        ws_.reset(new Stream(ioc_, ssl_));
+        timer_.expires_after(std::chrono::milliseconds(opts_.connectTimeoutMs));
+        timer_.async_wait([this, attempt = attempt_](boost::system::error_code ec) {
+            if (ec || !connecting_ || attempt != attempt_) return;
+            timedOut_ = true;
+            resolver_.cancel();
+            boost::system::error_code ignored;
+            boost::beast::get_lowest_layer(*ws_).close(ignored);
+        });
+        timedOut_ = false;
+
+        resolver_.async_resolve(opts_.host, opts_.port,
+            [this](boost::system::error_code ec, tcp::resolver::results_type results) {
+                if (ec) return failConnect(ec);
+                endpoints_.clear();
+                for (auto& r : results) endpoints_.push_back(r.endpoint());
+                connectTo(0, boost::asio::error::host_not_found);
+            });
+    }
+
+    void connectTo(size_t i, boost::system::error_code last) {
+        if (i == endpoints_.size() || timedOut_) return failConnect(last);
+        const tcp::endpoint& e = endpoints_[(opts_.endpoint + i) % endpoints_.size()];
+        tcp::socket& sock = boost::beast::get_lowest_layer(*ws_);
+        boost::system::error_code ec;
+        sock.close(ec);
+        sock.open(e.protocol(), ec);
+        if (!ec && opts_.rcvBufBytes > 0)
+            sock.set_option(boost::asio::socket_base::receive_buffer_size(opts_.rcvBufBytes), ec);
+        if (!ec && opts_.sndBufBytes > 0)
+            sock.set_option(boost::asio::socket_base::send_buffer_size(opts_.sndBufBytes), ec);
+        if (ec) return failConnect(ec);
+        sock.async_connect(e, [this, i](boost::system::error_code ec) {
+            if (ec) return connectTo(i + 1, ec);
+            handshake();
+        });
+    }
+
+    void handshake() {
+        tcp::socket& sock = boost::beast::get_lowest_layer(*ws_);
+        boost::system::error_code ec;
+        sock.set_option(tcp::no_delay(opts_.tcpNoDelay), ec);
+#if defined(__linux__) && defined(SO_BUSY_POLL)
+        if (opts_.busyPollUs > 0)
+            setsockopt(sock.native_handle(), SOL_SOCKET, SO_BUSY_POLL,
+                       &opts_.busyPollUs, sizeof(opts_.busyPollUs));
+#endif
+        if (opts_.verifyPeer)
+            ws_->next_layer().set_verify_callback(boost::asio::ssl::host_name_verification(opts_.host));
+        if (!SSL_set_tlsext_host_name(ws_->next_layer().native_handle(), opts_.host.c_str()))
+            return failConnect(boost::system::error_code(
+                static_cast<int>(::ERR_get_error()), boost::asio::error::get_ssl_category()));
+
+        ws_->next_layer().async_handshake(boost::asio::ssl::stream_base::client,
+            [this](boost::system::error_code ec) {
+                if (ec) return failConnect(ec);
+                ws_->control_callback([this](boost::beast::websocket::frame_type, boost::beast::string_view) {
+                    heard_ = true;   // pings and pongs count as life
+                });
+                ws_->async_handshake(opts_.host, target_, [this](boost::system::error_code ec) {
+                    if (ec) return failConnect(ec);
+                    connected();
+                });
+            });
+    }
+
+    void connected() {
+        connecting_ = false;
+        timer_.cancel();
+        stats_.connects++;
+        firstFrame_ = true;
+        live_ = true;
+        heard_ = true;
+        pinged_ = false;
+        idle_ = false;
+        watch(attempt_);
+        if (onConnect_) onConnect_();
+        read();
+    }
+
+    // Closing the socket fails the pending read, which retries.
+    void watch(uint64_t attempt) {
+        watchdog_.expires_after(std::chrono::milliseconds(std::max(1, opts_.idleTimeoutMs / 2)));
+        watchdog_.async_wait([this, attempt](boost::system::error_code ec) {
+            if (ec || !live_ || attempt != attempt_) return;
+            if (heard_) {
+                heard_ = false;
+                pinged_ = false;
+            } else if (!pinged_) {
+                pinged_ = true;
+                ws_->async_ping({}, [](boost::system::error_code) {});
+            } else {
+                idle_ = true;
+                boost::system::error_code ignored;
+                boost::beast::get_lowest_layer(*ws_).close(ignored);
+                return;
+            }
+            watch(attempt);
+        });
+    }
+
+    void failConnect(boost::system::error_code ec) {
+        connecting_ = false;
+        retry(timedOut_ ? "connect timed out after " + std::to_string(opts_.connectTimeoutMs) + " ms"
+                        : ec.message());
+    }
+
+    void read() {
+        buffer_.consume(buffer_.size());
+        ws_->async_read(buffer_, [this](boost::beast::error_code ec, size_t) {
+            if (ec) {
+                retry(idle_ ? "nothing received for " + std::to_string(opts_.idleTimeoutMs) + " ms"
+                            : ec.message());
+                return;
+            }
+            uint64_t recvCycles = cycleNow();
+            heard_ = true;
+            auto frame = buffer_.data();
+            stats_.frames.fetch_add(1, std::memory_order_relaxed);
+            stats_.bytes.fetch_add(frame.size(), std::memory_order_relaxed);
+            if (firstFrame_) {
+                backoff_.reset();
+                firstFrame_ = false;
+            }
+            try {
+                onFrame_(recvCycles, static_cast<const char*>(frame.data()), frame.size());
+            } catch (std::exception const& e) {
+                retry(e.what());
+                return;
+            }
+            read();
+        });
+    }
+
+    void retry(const std::string& why) {
+        if (stopping_.load()) return;
+        live_ = false;
+        watchdog_.cancel();
+        stats_.disconnects++;
+        int delayMs = backoff_.next();
+        stats_.lastBackoffMs.store(delayMs);
+        if (onDisconnect_) onDisconnect_(why, delayMs);
+
+        boost::system::error_code ignored;
+        if (ws_) boost::beast::get_lowest_layer(*ws_).close(ignored);
+        timer_.expires_after(std::chrono::milliseconds(delayMs));
+        timer_.async_wait([this](boost::system::error_code ec) {
+            if (!ec && !stopping_.load()) connect();
+        });
+    }
+
+    ReaderOptions                      opts_;
+    std::string                        target_;
+    FrameFn                            onFrame_;
+    ConnectFn                          onConnect_;
+    DisconnectFn                       onDisconnect_;
+
+    std::unique_ptr<boost::asio::io_context> ownIoc_;
+    boost::asio::io_context&           ioc_;
+    boost::asio::ssl::context          ssl_;
+    tcp::resolver                      resolver_;
+    boost::asio::steady_timer          timer_;      // connect deadline, then backoff
+    boost::asio::steady_timer          watchdog_;
+    std::vector<tcp::endpoint>         endpoints_;
+    std::unique_ptr<Stream>            ws_;
+    boost::beast::flat_buffer          buffer_;
+    Backoff                            backoff_;
+    bool                               firstFrame_ = true;
+    bool                               connecting_ = false;
+    bool                               timedOut_   = false;
+    bool                               live_       = false;
+    bool                               heard_      = false;   // since the watchdog last woke
+    bool                               pinged_     = false;
+    bool                               idle_       = false;
+    uint64_t                           attempt_    = 0;
+    std::atomic<bool>                  stopping_{false};
+    ReaderStats                        stats_;
+};